@@ -3,6 +3,7 @@
 
 #include "lib/mcconfig.h"       /* mc_config_t */
 #include "lib/util.h"           /* file_entry_t */
+#include "lib/search.h"         /* mc_search_t */
 
 /*** typedefs(not structures) and defined constants **********************************************/
 
@@ -14,6 +15,13 @@ typedef struct mc_fhl_struct
 {
     mc_config_t *config;
     GPtrArray *filters;
+    /* unique id of rules, used to validate colors cached in file_entry_t */
+    unsigned int id;
+    /* extension -> 1-based index of the first filter, for case sensitive and insensitive rules */
+    GHashTable *extensions;
+    GHashTable *extensions_nocase;
+    /* alternation of all regexp rules; if it doesn't match, no regexp filter matches */
+    mc_search_t *regexp;
 } mc_fhl_t;
 
 /*** global variables defined in .c file *********************************************************/
@@ -25,6 +25,7 @@
  */
 
 #include <config.h>
+#include <string.h>
 
 #include "lib/global.h"
 #include "lib/filehighlight.h"
@@ -38,6 +39,8 @@
 
 /*** file scope variables ************************************************************************/
 
+static unsigned int mc_fhl_last_id = 0;
+
 /*** file scope functions ************************************************************************/
 
 static void
@@ -48,9 +51,73 @@ mc_fhl_filter_free (void *data)
     g_free (filter->fgcolor);
     g_free (filter->bgcolor);
     mc_search_free (filter->search_condition);
+    g_strfreev (filter->extensions);
     g_free (filter);
 }
 
+/* --------------------------------------------------------------------------------------------- */
+/**
+ * Check whether regexp refers to its own groups by number or name, or starts with a verb.
+ * Such regexp cannot be a part of an alternation with other ones.
+ */
+
+static gboolean
+mc_fhl_regexp_is_standalone (const char *regexp)
+{
+    const char *p;
+
+    if (strncmp (regexp, "(*", 2) == 0)
+        return TRUE;
+
+    for (p = regexp; *p != '\0'; p++)
+    {
+        if (*p == '\\')
+        {
+            if (g_ascii_isdigit (p[1]) || p[1] == 'g' || p[1] == 'k')
+                return TRUE;
+            if (p[1] != '\0')
+                p++;
+        }
+        else if (p[0] == '(' && p[1] == '?')
+        {
+            const char c = p[2];
+
+            /* (?1), (?+1), (?-1), (?&name), (?R), (?P>name), (?P=name) */
+            if (g_ascii_isdigit (c) || c == '&' || c == 'R'
+                || ((c == '+' || c == '-') && g_ascii_isdigit (p[3]))
+                || (c == 'P' && (p[3] == '=' || p[3] == '>')))
+                return TRUE;
+        }
+    }
+
+    return FALSE;
+}
+
+/* --------------------------------------------------------------------------------------------- */
+
+static void
+mc_fhl_compile_extensions (mc_fhl_t * fhl, guint filter_index, mc_fhl_filter_t * filter)
+{
+    GHashTable *table;
+    gchar **exts;
+
+    table = filter->extensions_case ? fhl->extensions : fhl->extensions_nocase;
+
+    for (exts = filter->extensions; *exts != NULL; exts++)
+    {
+        char *key;
+
+        /* regexp compiled without UTF-8 support folds ASCII letters only */
+        key = filter->extensions_case ? g_strdup (*exts) : g_ascii_strdown (*exts, -1);
+
+        /* first matched filter wins */
+        if (g_hash_table_lookup (table, key) == NULL)
+            g_hash_table_insert (table, key, GUINT_TO_POINTER (filter_index + 1));
+        else
+            g_free (key);
+    }
+}
+
 /* --------------------------------------------------------------------------------------------- */
 
 void
@@ -61,6 +128,89 @@ mc_fhl_array_free (mc_fhl_t * fhl)
         g_ptr_array_foreach (fhl->filters, (GFunc) mc_fhl_filter_free, NULL);
         fhl->filters = (GPtrArray *) g_ptr_array_free (fhl->filters, TRUE);
     }
+
+    if (fhl->extensions != NULL)
+    {
+        g_hash_table_destroy (fhl->extensions);
+        fhl->extensions = NULL;
+    }
+    if (fhl->extensions_nocase != NULL)
+    {
+        g_hash_table_destroy (fhl->extensions_nocase);
+        fhl->extensions_nocase = NULL;
+    }
+    mc_search_free (fhl->regexp);
+    fhl->regexp = NULL;
+}
+
+/* --------------------------------------------------------------------------------------------- */
+/**
+ * Build matchers for all filters: hash tables of extensions and a single alternation of
+ * regexps which is used to skip all regexp filters at once if none of them matches.
+ */
+
+void
+mc_fhl_compile (mc_fhl_t * fhl)
+{
+    GString *alternation;
+    gboolean combined = TRUE;
+    guint i;
+
+    /* colors cached with previous rules become invalid */
+    if (++mc_fhl_last_id == 0)
+        mc_fhl_last_id++;
+    fhl->id = mc_fhl_last_id;
+
+    fhl->extensions = g_hash_table_new_full (g_str_hash, g_str_equal, g_free, NULL);
+    fhl->extensions_nocase = g_hash_table_new_full (g_str_hash, g_str_equal, g_free, NULL);
+    alternation = g_string_sized_new (64);
+
+    for (i = 0; i < fhl->filters->len; i++)
+    {
+        mc_fhl_filter_t *mc_filter;
+
+        mc_filter = (mc_fhl_filter_t *) g_ptr_array_index (fhl->filters, i);
+
+        /* filter without color never matches */
+        if (mc_filter->color_pair_index <= 0)
+            continue;
+
+        switch (mc_filter->type)
+        {
+        case MC_FLHGH_T_EXT:
+            mc_fhl_compile_extensions (fhl, i, mc_filter);
+            break;
+        case MC_FLHGH_T_FREGEXP:
+            if (mc_fhl_regexp_is_standalone (mc_filter->search_condition->original))
+                combined = FALSE;
+            else
+            {
+                if (alternation->len != 0)
+                    g_string_append_c (alternation, '|');
+                g_string_append_printf (alternation, "(?:%s)",
+                                        mc_filter->search_condition->original);
+            }
+            break;
+        default:
+            break;
+        }
+    }
+
+    if (combined && alternation->len != 0)
+    {
+        fhl->regexp = mc_search_new_len (alternation->str, alternation->len, DEFAULT_CHARSET);
+        fhl->regexp->is_case_sensitive = TRUE;
+        fhl->regexp->search_type = MC_SEARCH_T_REGEX;
+
+        /* any regexp may be broken, so check them one by one */
+        if (!mc_search_prepare (fhl->regexp))
+        {
+            mc_search_free (fhl->regexp);
+            fhl->regexp = NULL;
+        }
+    }
+
+    g_string_free (alternation, TRUE);
 }
 
 /* --------------------------------------------------------------------------------------------- */
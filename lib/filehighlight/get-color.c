@@ -246,6 +246,48 @@ mc_fhl_get_color_regexp (mc_fhl_filter_t * mc_filter, mc_fhl_t * fhl, file_entry
 }
 
 /* --------------------------------------------------------------------------------------------- */
+/**
+ * Find the first extension filter matched by file name.
+ *
+ * @return index of filter or number of filters if no one matches
+ */
+
+static guint
+mc_fhl_get_extension_filter (mc_fhl_t * fhl, file_entry_t * fe)
+{
+    guint ret = fhl->filters->len;
+    gboolean nocase;
+    char *name_nocase = NULL;
+    const char *dot;
+
+    if (fhl->extensions == NULL)
+        return ret;
+
+    nocase = g_hash_table_size (fhl->extensions_nocase) != 0;
+    if (nocase)
+        name_nocase = g_ascii_strdown (fe->fname, fe->fnamelen);
+
+    /* extension may contain dots: check all suffixes which follow a dot */
+    for (dot = strchr (fe->fname, '.'); dot != NULL; dot = strchr (dot + 1, '.'))
+    {
+        guint i;
+
+        i = GPOINTER_TO_UINT (g_hash_table_lookup (fhl->extensions, dot + 1));
+        if (i != 0 && i - 1 < ret)
+            ret = i - 1;
+
+        if (nocase)
+        {
+            i = GPOINTER_TO_UINT (g_hash_table_lookup (fhl->extensions_nocase,
+                                                       name_nocase + (dot + 1 - fe->fname)));
+            if (i != 0 && i - 1 < ret)
+                ret = i - 1;
+        }
+    }
+
+    g_free (name_nocase);
+    return ret;
+}
 
 /* --------------------------------------------------------------------------------------------- */
 /*** public functions ****************************************************************************/
@@ -254,35 +296,54 @@ mc_fhl_get_color_regexp (mc_fhl_filter_t * mc_filter, mc_fhl_t * fhl, file_entry
 int
 mc_fhl_get_color (mc_fhl_t * fhl, file_entry_t * fe)
 {
-    guint i;
-    int ret;
+    guint i, found;
+    gboolean check_regexp;
 
-    if (fhl == NULL)
+    if (fhl == NULL || fhl->filters == NULL)
         return NORMAL_COLOR;
 
-    for (i = 0; i < fhl->filters->len; i++)
+    if (fe->fhl_id == fhl->id && fhl->id != 0)
+        return fe->fhl_color;
+
+    /* filters before the first matched extension are checked only */
+    found = mc_fhl_get_extension_filter (fhl, fe);
+
+    /* none of regexp filters can match if their alternation doesn't match */
+    check_regexp = fhl->regexp == NULL
+        || mc_search_run (fhl->regexp, fe->fname, 0, fe->fnamelen, NULL);
+
+    for (i = 0; i < found; i++)
     {
         mc_fhl_filter_t *mc_filter;
+        int ret = -1;
 
         mc_filter = (mc_fhl_filter_t *) g_ptr_array_index (fhl->filters, i);
         switch (mc_filter->type)
         {
         case MC_FLHGH_T_FTYPE:
             ret = mc_fhl_get_color_filetype (mc_filter, fhl, fe);
-            if (ret > 0)
-                return -ret;
             break;
-        case MC_FLHGH_T_EXT:
         case MC_FLHGH_T_FREGEXP:
-            ret = mc_fhl_get_color_regexp (mc_filter, fhl, fe);
-            if (ret > 0)
-                return -ret;
+            if (check_regexp)
+                ret = mc_fhl_get_color_regexp (mc_filter, fhl, fe);
             break;
         default:
             break;
         }
+
+        if (ret > 0)
+        {
+            found = i;
+            break;
+        }
     }
-    return NORMAL_COLOR;
+
+    fe->fhl_color = found < fhl->filters->len ?
+        -((mc_fhl_filter_t *) g_ptr_array_index (fhl->filters, found))->color_pair_index :
+        NORMAL_COLOR;
+    fe->fhl_id = fhl->id;
+
+    return fe->fhl_color;
 }
 
 /* --------------------------------------------------------------------------------------------- */
@@ -44,6 +44,8 @@ typedef struct mc_fhl_filter_struct
     mc_flhgh_filter_type type;
     mc_search_t *search_condition;
     mc_flhgh_ftype_type file_type;
+    gchar **extensions;
+    gboolean extensions_case;
 
 } mc_fhl_filter_t;
 
@@ -52,6 +54,7 @@ typedef struct mc_fhl_filter_struct
 /*** declarations of public functions ************************************************************/
 
 void mc_fhl_array_free (mc_fhl_t *);
+void mc_fhl_compile (mc_fhl_t *);
 
 gboolean mc_fhl_init_from_standard_files (mc_fhl_t *);
 
@@ -50,6 +50,8 @@
 #define FISH_INFO_FILE          "info"
 
 #define MC_EXTFS_DIR            "extfs.d"
+#define MC_TARFS_INDEX_DIR      "tarfs"
+#define MC_FIND_INDEX_FILE      "findindex"
 
 #define MC_BASHRC_FILE          "bashrc"
 #define MC_CONFIG_FILE          "ini"
@@ -17,6 +17,8 @@ typedef enum mc_search_cbret_t mc_search_cbret_t;
 
 typedef mc_search_cbret_t (*mc_search_fn) (const void *user_data, gsize char_offset,
                                            int *current_char);
+typedef mc_search_cbret_t (*mc_search_block_fn) (const void *user_data, gsize char_offset,
+                                                 const char **block, gsize * block_len);
 typedef mc_search_cbret_t (*mc_update_fn) (const void *user_data, gsize char_offset);
 
 #define MC_SEARCH__NUM_REPLACE_ARGS 64
@@ -81,9 +83,17 @@ typedef struct mc_search_struct
     /* search entire string (from begin to end). Used only with GLOB search type */
     gboolean is_entire_line;
 
+    /* match may contain several lines. Used only with REGEX search type */
+    gboolean multiline;
+
     /* function, used for getting data. NULL if not used */
     mc_search_fn search_fn;
 
+    /* function, used for getting contiguous blocks of data. NULL if not used.
+     * Used together with search_fn only: if it returns MC_SEARCH_CB_INVALID,
+     * data is read by search_fn byte by byte */
+    mc_search_block_fn block_fn;
+
     /* function, used for updatin current search status. NULL if not used */
     mc_update_fn update_fn;
 
@@ -149,6 +159,9 @@ gboolean mc_search_prepare (mc_search_t * mc_search);
 
 gboolean mc_search_run (mc_search_t * mc_search, const void *user_data, gsize start_search,
                         gsize end_search, gsize * found_len);
+gboolean mc_search_run_backward (mc_search_t * mc_search, const void *user_data,
+                                 gsize start_search, gsize last_start, gsize end_search,
+                                 gsize * found_len);
 
 gboolean mc_search_is_type_avail (mc_search_type_t);
 
@@ -29,9 +29,8 @@
 #include <stdio.h>
 
 #include "lib/global.h"
-#include "lib/strutil.h"
 #include "lib/search.h"
-#include "lib/strescape.h"
+#include "lib/util.h"           /* MC_PTR_FREE */
 
 #include "internal.h"
 
@@ -39,6 +38,9 @@
 
 /*** file scope macro definitions ****************************************************************/
 
+/* size of data read at once from callbacks */
+#define HEX_WINDOW_SIZE (64 * 1024)
+
 typedef enum
 {
     MC_SEARCH_HEX_E_OK,
@@ -49,21 +51,110 @@ typedef enum
 
 /*** file scope type declarations ****************************************************************/
 
+/* Byte pattern of one condition. Hex search doesn't need a regex engine: byte k of match
+ * is any byte b for which (b & mask[k]) == value[k]. */
+struct mc_search_hex_struct
+{
+    GByteArray *value;
+    GByteArray *mask;
+    /* TRUE if all bits of all bytes are compared: match is checked by memcmp() */
+    gboolean exact;
+    /* offset of byte in pattern which is looked for by memchr(); -1 if there is no such byte */
+    gssize anchor;
+    gboolean whole_words;
+};
+
 /*** file scope variables ************************************************************************/
 
 /*** file scope functions ************************************************************************/
 
-static GString *
-mc_search__hex_translate_to_regex (const GString * astr, mc_search_hex_parse_error_t * error_ptr,
-                                   int *error_pos_ptr)
+static void
+mc_search__hex_append (mc_search_hex_t * hex, guchar value, guchar mask)
+{
+    value &= mask;
+    g_byte_array_append (hex->value, &value, 1);
+    g_byte_array_append (hex->mask, &mask, 1);
+}
+
+/* --------------------------------------------------------------------------------------------- */
+/**
+ * Parse byte with wildcard nibbles: "?", "??", "4?", "?F".
+ *
+ * @return number of parsed characters, 0 if there is no such byte at str.
+ *         More than two characters are an error.
+ */
+
+static int
+mc_search__hex_parse_wildcard (const char *str, guchar * value, guchar * mask)
+{
+    int len, i;
+    gboolean wildcard = FALSE;
+
+    for (len = 0; str[len] == '?' || g_ascii_isxdigit (str[len]); len++)
+        wildcard = wildcard || str[len] == '?';
+
+    if (!wildcard)
+        return 0;
+
+    *value = 0;
+    *mask = 0;
+
+    for (i = 0; i < len && i < 2; i++)
+    {
+        *value <<= 4;
+        *mask <<= 4;
+        if (str[i] != '?')
+        {
+            *value |= g_ascii_xdigit_value (str[i]);
+            *mask |= 0x0F;
+        }
+    }
+
+    return len;
+}
+
+/* --------------------------------------------------------------------------------------------- */
+/**
+ * Choose byte of pattern for memchr(). Bytes 0x00 and 0xFF are too frequent in binary data.
+ */
+
+static gssize
+mc_search__hex_anchor (const mc_search_hex_t * hex)
+{
+    gssize anchor = -1;
+    guint i;
+
+    for (i = 0; i < hex->value->len; i++)
+        if (hex->mask->data[i] == 0xFF)
+        {
+            guchar c = hex->value->data[i];
+
+            if (c != 0x00 && c != 0xFF)
+                return (gssize) i;
+            if (anchor < 0)
+                anchor = (gssize) i;
+        }
+
+    return anchor;
+}
+
+/* --------------------------------------------------------------------------------------------- */
+
+static mc_search_hex_t *
+mc_search__hex_parse (const GString * astr, gboolean case_sensitive,
+                      mc_search_hex_parse_error_t * error_ptr, int *error_pos_ptr)
 {
-    GString *buff;
+    mc_search_hex_t *hex;
     const char *str;
     gsize str_len;
     gsize loop = 0;
     mc_search_hex_parse_error_t error = MC_SEARCH_HEX_E_OK;
+    guint i;
+
+    hex = g_new0 (mc_search_hex_t, 1);
+    hex->value = g_byte_array_new ();
+    hex->mask = g_byte_array_new ();
 
-    buff = g_string_sized_new (64);
     str = astr->str;
     str_len = astr->len;
 
@@ -71,6 +162,7 @@ mc_search__hex_translate_to_regex (const GString * astr, mc_search_hex_parse_err
     {
         unsigned int val;
         int ptr;
+        guchar value, mask;
 
         if (g_ascii_isspace (str[loop]))
         {
@@ -78,6 +170,16 @@ mc_search__hex_translate_to_regex (const GString * astr, mc_search_hex_parse_err
             while (g_ascii_isspace (str[loop]))
                 loop++;
         }
+        else if ((ptr = mc_search__hex_parse_wildcard (str + loop, &value, &mask)) != 0)
+        {
+            if (ptr > 2)
+                error = MC_SEARCH_HEX_E_INVALID_CHARACTER;
+            else
+            {
+                mc_search__hex_append (hex, value, mask);
+                loop += ptr;
+            }
+        }
         /* cppcheck-suppress invalidscanf */
         else if (sscanf (str + loop, "%x%n", &val, &ptr) == 1)
         {
@@ -85,7 +187,7 @@ mc_search__hex_translate_to_regex (const GString * astr, mc_search_hex_parse_err
                 error = MC_SEARCH_HEX_E_NUM_OUT_OF_RANGE;
             else
             {
-                g_string_append_printf (buff, "\\x%02X", val);
+                mc_search__hex_append (hex, (guchar) val, 0xFF);
                 loop += ptr;
             }
         }
@@ -97,11 +199,19 @@ mc_search__hex_translate_to_regex (const GString * astr, mc_search_hex_parse_err
 
             while (loop2 < str_len)
             {
+                guchar c;
+
                 if (str[loop2] == '"')
                     break;
                 if (str[loop2] == '\\' && loop2 + 1 < str_len)
                     loop2++;
-                g_string_append_c (buff, str[loop2]);
+
+                /* only ASCII letters are case-insensitive: they differ from each other in bit 5 */
+                c = (guchar) str[loop2];
+                if (!case_sensitive && g_ascii_isalpha (c))
+                    mc_search__hex_append (hex, c, 0xDF);
+                else
+                    mc_search__hex_append (hex, c, 0xFF);
                 loop2++;
             }
 
@@ -116,7 +226,7 @@ mc_search__hex_translate_to_regex (const GString * astr, mc_search_hex_parse_err
 
     if (error != MC_SEARCH_HEX_E_OK)
     {
-        g_string_free (buff, TRUE);
+        mc_search__hex_free (hex);
         if (error_ptr != NULL)
             *error_ptr = error;
         if (error_pos_ptr != NULL)
@@ -124,62 +234,274 @@ mc_search__hex_translate_to_regex (const GString * astr, mc_search_hex_parse_err
         return NULL;
     }
 
-    return buff;
+    hex->exact = TRUE;
+    for (i = 0; i < hex->mask->len; i++)
+        hex->exact = hex->exact && hex->mask->data[i] == 0xFF;
+    hex->anchor = mc_search__hex_anchor (hex);
+
+    return hex;
+}
+
+/* --------------------------------------------------------------------------------------------- */
+
+static inline gboolean
+mc_search__hex_is_word_char (guchar c)
+{
+    return g_ascii_isalnum (c) || c == '_';
+}
+
+/* --------------------------------------------------------------------------------------------- */
+
+static inline gboolean
+mc_search__hex_match_at (const mc_search_hex_t * hex, const guchar * buf, gsize len, gsize pos)
+{
+    const gsize m = hex->value->len;
+    gsize k;
+
+    if (hex->exact)
+    {
+        if (memcmp (buf + pos, hex->value->data, m) != 0)
+            return FALSE;
+    }
+    else
+        for (k = 0; k < m; k++)
+            if ((buf[pos + k] & hex->mask->data[k]) != hex->value->data[k])
+                return FALSE;
+
+    /* bytes out of buffer are word boundaries */
+    return !hex->whole_words || ((pos == 0 || !mc_search__hex_is_word_char (buf[pos - 1]))
+                                 && (pos + m >= len
+                                     || !mc_search__hex_is_word_char (buf[pos + m])));
+}
+
+/* --------------------------------------------------------------------------------------------- */
+/**
+ * Find first match of pattern which starts in [from, last] and ends in buffer.
+ */
+
+static gboolean
+mc_search__hex_find (const mc_search_hex_t * hex, const guchar * buf, gsize len, gsize from,
+                     gsize last, gsize * found_pos)
+{
+    const gsize m = hex->value->len;
+    gsize i;
+
+    if (len < m)
+        return FALSE;
+    last = MIN (last, len - m);
+
+    if (hex->anchor >= 0)
+    {
+        /* memchr() is vectorized by C library */
+        const gsize a = (gsize) hex->anchor;
+        const guchar c = hex->value->data[a];
+        const guchar *p = buf + from + a;
+        const guchar *end = buf + last + a;
+
+        while (p <= end && (p = memchr (p, c, end - p + 1)) != NULL)
+        {
+            i = p - buf - a;
+            if (mc_search__hex_match_at (hex, buf, len, i))
+            {
+                *found_pos = i;
+                return TRUE;
+            }
+            p++;
+        }
+
+        return FALSE;
+    }
+
+    for (i = from; i <= last; i++)
+        if (mc_search__hex_match_at (hex, buf, len, i))
+        {
+            *found_pos = i;
+            return TRUE;
+        }
+
+    return FALSE;
+}
+
+/* --------------------------------------------------------------------------------------------- */
+/**
+ * Find the first match of any condition which starts in [from, last].
+ */
+
+static gboolean
+mc_search__hex_find_cond (const mc_search_t * lc_mc_search, const char *buf, gsize len,
+                          gsize from, gsize last, gsize * found_pos, gsize * found_len)
+{
+    gboolean found = FALSE;
+    gsize loop;
+
+    for (loop = 0; loop < lc_mc_search->conditions->len; loop++)
+    {
+        mc_search_cond_t *mc_search_cond;
+        gsize pos;
+
+        mc_search_cond = (mc_search_cond_t *) g_ptr_array_index (lc_mc_search->conditions, loop);
+
+        if (mc_search_cond->hex != NULL
+            && mc_search__hex_find (mc_search_cond->hex, (const guchar *) buf, len, from,
+                                    found ? *found_pos : last, &pos)
+            && (!found || pos < *found_pos))
+        {
+            *found_pos = pos;
+            *found_len = mc_search_cond->hex->value->len;
+            found = TRUE;
+        }
+    }
+
+    return found;
+}
+
+/* --------------------------------------------------------------------------------------------- */
+/**
+ * Number of bytes after start of match which are needed to check it.
+ */
+
+static gsize
+mc_search__hex_max_len (const mc_search_t * lc_mc_search)
+{
+    gsize max_len = 1;
+    gsize loop;
+
+    for (loop = 0; loop < lc_mc_search->conditions->len; loop++)
+    {
+        mc_search_cond_t *mc_search_cond;
+
+        mc_search_cond = (mc_search_cond_t *) g_ptr_array_index (lc_mc_search->conditions, loop);
+        if (mc_search_cond->hex != NULL)
+            max_len = MAX (max_len, mc_search_cond->hex->value->len);
+    }
+
+    /* the byte after match for whole words */
+    if (lc_mc_search->whole_words && !lc_mc_search->is_entire_line)
+        max_len++;
+
+    return max_len;
+}
+
+/* --------------------------------------------------------------------------------------------- */
+
+static gboolean
+mc_search__hex_result (mc_search_t * lc_mc_search, gboolean found, gsize found_pos, gsize len,
+                       gsize * found_len, gboolean aborted)
+{
+    if (found)
+    {
+        if (found_len != NULL)
+            *found_len = len;
+        lc_mc_search->normal_offset = found_pos;
+        return TRUE;
+    }
+
+    if (lc_mc_search->regex_buffer != NULL)
+    {
+        g_string_free (lc_mc_search->regex_buffer, TRUE);
+        lc_mc_search->regex_buffer = NULL;
+    }
+
+    MC_PTR_FREE (lc_mc_search->error_str);
+    lc_mc_search->error = aborted ? MC_SEARCH_E_ABORT : MC_SEARCH_E_NOTFOUND;
+
+    return FALSE;
 }
 
+/* --------------------------------------------------------------------------------------------- */
+/**
+ * Search in data provided by callbacks. Data is read by large windows; the end of window
+ * is kept for matches which continue in the next one.
+ */
+
+static gboolean
+mc_search__run_hex_window (mc_search_t * lc_mc_search, const void *user_data,
+                           gsize start_search, gsize end_search, gsize * found_len)
+{
+    GString *buf;
+    mc_search_cbret_t ret = MC_SEARCH_CB_OK;
+    const gsize max_len = mc_search__hex_max_len (lc_mc_search);
+    const gsize before = lc_mc_search->whole_words && !lc_mc_search->is_entire_line ? 1 : 0;
+    gsize current_pos, virtual_pos;
+    gsize from = 0;
+    gboolean more = TRUE;
+
+    if (lc_mc_search->regex_buffer != NULL)
+        g_string_set_size (lc_mc_search->regex_buffer, 0);
+    else
+        lc_mc_search->regex_buffer = g_string_sized_new (HEX_WINDOW_SIZE);
+    buf = lc_mc_search->regex_buffer;
+
+    lc_mc_search->start_buffer = start_search;
+    current_pos = virtual_pos = start_search;
+
+    while (more)
+    {
+        gsize found_pos, len, last;
+
+        more =
+            mc_search__read_window (lc_mc_search, buf, user_data, &current_pos, &virtual_pos,
+                                    end_search, HEX_WINDOW_SIZE, &ret);
+        if (ret == MC_SEARCH_CB_ABORT)
+            break;
+
+        /* match which starts at last may continue in the next window */
+        if (!more)
+            last = buf->len;
+        else if (buf->len >= from + max_len)
+            last = buf->len - max_len;
+        else
+            continue;
+
+        if (mc_search__hex_find_cond (lc_mc_search, buf->str, buf->len, from, last, &found_pos,
+                                      &len))
+            return mc_search__hex_result (lc_mc_search, TRUE,
+                                          lc_mc_search->start_buffer + found_pos, len, found_len,
+                                          FALSE);
+
+        if (!more)
+            break;
+
+        /* keep the byte before the next start of match and bytes of match */
+        from = last + 1 - before;
+        g_string_erase (buf, 0, from);
+        lc_mc_search->start_buffer += from;
+        from = before;
+
+        if (lc_mc_search->update_fn != NULL
+            && lc_mc_search->update_fn (user_data, current_pos) == MC_SEARCH_CB_ABORT)
+            ret = MC_SEARCH_CB_ABORT;
+        if (ret == MC_SEARCH_CB_ABORT)
+            break;
+    }
+
+    return mc_search__hex_result (lc_mc_search, FALSE, 0, 0, NULL, ret == MC_SEARCH_CB_ABORT);
+}
+
+/* --------------------------------------------------------------------------------------------- */
 /*** public functions ****************************************************************************/
 
 void
 mc_search__cond_struct_new_init_hex (const char *charset, mc_search_t * lc_mc_search,
                                      mc_search_cond_t * mc_search_cond)
 {
-    GString *tmp;
     mc_search_hex_parse_error_t error = MC_SEARCH_HEX_E_OK;
     int error_pos = 0;
 
     /*
-     * We may be searching in binary data, which is often invalid UTF-8.
-     *
-     * We have to create a non UTF-8 regex (that is, G_REGEX_RAW) or else, as
-     * the data is invalid UTF-8, both GLib's PCRE and our
-     * mc_search__g_regex_match_full_safe() are going to fail us. The former by
-     * not finding all bytes, the latter by overwriting the supposedly invalid
-     * UTF-8 with NULs.
-     *
-     * To do this, we specify "ASCII" as the charset.
-     *
-     * In fact, we can specify any charset other than "UTF-8": any such charset
-     * will trigger G_REGEX_RAW (see [1]). The output of [2] will be the same
-     * for all charsets because it skips the \xXX symbols
-     * mc_search__hex_translate_to_regex() outputs.
-     *
-     * But "ASCII" is the best choice because a hex pattern may contain a
-     * quoted string: this way we know [2] will ignore any characters outside
-     * ASCII letters range (these ignored chars will be copied verbatim to the
-     * output and will match as-is; in other words, in a case-sensitive manner;
-     * If the user is interested in case-insensitive searches of international
-     * text, he shouldn't be using hex search in the first place.)
-     *
-     * Switching out of UTF-8 has another advantage:
-     *
-     * When doing case-insensitive searches, GLib treats \xXX symbols as normal
-     * letters and therefore matches both "a" and "A" for the hex pattern
-     * "0x61". When we switch out of UTF-8, we're switching to using [2], which
-     * doesn't have this issue.
-     *
-     * [1] mc_search__cond_struct_new_init_regex
-     * [2] mc_search__cond_struct_new_regex_ci_str
+     * We may be searching in binary data, which is often invalid UTF-8, so pattern
+     * is matched byte by byte regardless of charset. Only ASCII letters in quoted
+     * strings are case-insensitive: if the user is interested in case-insensitive
+     * searches of international text, they shouldn't be using hex search in the first place.
      */
-    if (str_isutf8 (charset))
-        charset = "ASCII";
-
-    tmp = mc_search__hex_translate_to_regex (mc_search_cond->str, &error, &error_pos);
-    if (tmp != NULL)
-    {
-        g_string_free (mc_search_cond->str, TRUE);
-        mc_search_cond->str = tmp;
-        mc_search__cond_struct_new_init_regex (charset, lc_mc_search, mc_search_cond);
-    }
+    (void) charset;
+
+    mc_search_cond->hex =
+        mc_search__hex_parse (mc_search_cond->str, lc_mc_search->is_case_sensitive, &error,
+                              &error_pos);
+    if (mc_search_cond->hex != NULL)
+        mc_search_cond->hex->whole_words = lc_mc_search->whole_words
+            && !lc_mc_search->is_entire_line;
     else
     {
         const char *desc;
@@ -209,11 +531,125 @@ mc_search__cond_struct_new_init_hex (const char *charset, mc_search_t * lc_mc_se
 
 /* --------------------------------------------------------------------------------------------- */
 
+void
+mc_search__hex_free (mc_search_hex_t * hex)
+{
+    if (hex != NULL)
+    {
+        g_byte_array_free (hex->value, TRUE);
+        g_byte_array_free (hex->mask, TRUE);
+        g_free (hex);
+    }
+}
+
+/* --------------------------------------------------------------------------------------------- */
+
 gboolean
 mc_search__run_hex (mc_search_t * lc_mc_search, const void *user_data,
                     gsize start_search, gsize end_search, gsize * found_len)
 {
-    return mc_search__run_regex (lc_mc_search, user_data, start_search, end_search, found_len);
+    const char *buf;
+    const char *nul;
+    gsize len, found_pos;
+
+    if (start_search > end_search)
+        return mc_search__hex_result (lc_mc_search, FALSE, 0, 0, NULL, FALSE);
+
+    if (lc_mc_search->search_fn != NULL)
+        return mc_search__run_hex_window (lc_mc_search, user_data, start_search, end_search,
+                                          found_len);
+
+    /* search in whole string at once; like regex search, stop at end_search or at NUL */
+    buf = (const char *) user_data + start_search;
+    len = end_search - start_search + 1;
+    nul = memchr (buf, '\0', len);
+    if (nul != NULL)
+        len = nul - buf;
+
+    lc_mc_search->start_buffer = start_search;
+
+    if (!mc_search__hex_find_cond (lc_mc_search, buf, len, 0, len, &found_pos, &len))
+        return mc_search__hex_result (lc_mc_search, FALSE, 0, 0, NULL, FALSE);
+
+    return mc_search__hex_result (lc_mc_search, TRUE, start_search + found_pos, len, found_len,
+                                  FALSE);
+}
+
+/* --------------------------------------------------------------------------------------------- */
+/**
+ * Search backward: find the match with the greatest start offset in [start_search, last_start].
+ * Data is read by chunks from the end; each chunk is searched forward for its last match.
+ */
+
+gboolean
+mc_search__run_hex_backward (mc_search_t * lc_mc_search, const void *user_data,
+                             gsize start_search, gsize last_start, gsize end_search,
+                             gsize * found_len)
+{
+    GString *buf;
+    const gsize max_len = mc_search__hex_max_len (lc_mc_search);
+    const gsize before = lc_mc_search->whole_words && !lc_mc_search->is_entire_line ? 1 : 0;
+    gsize chunk_end = MIN (last_start, end_search);
+    gboolean aborted = FALSE;
+
+    if (lc_mc_search->regex_buffer != NULL)
+        g_string_set_size (lc_mc_search->regex_buffer, 0);
+    else
+        lc_mc_search->regex_buffer = g_string_sized_new (HEX_WINDOW_SIZE);
+    buf = lc_mc_search->regex_buffer;
+
+    while (start_search <= chunk_end)
+    {
+        mc_search_cbret_t ret = MC_SEARCH_CB_OK;
+        gsize chunk_start, current_pos, virtual_pos, from, pos, len;
+        gsize found_pos = 0, found_size = 0;
+        gboolean found = FALSE;
+
+        chunk_start = chunk_end - start_search > HEX_WINDOW_SIZE
+            ? chunk_end - HEX_WINDOW_SIZE : start_search;
+
+        /* the byte before chunk is needed to check whole word */
+        lc_mc_search->start_buffer = chunk_start - MIN (chunk_start - start_search, before);
+        current_pos = virtual_pos = lc_mc_search->start_buffer;
+        from = chunk_start - lc_mc_search->start_buffer;
+
+        g_string_set_size (buf, 0);
+        mc_search__read_window (lc_mc_search, buf, user_data, &current_pos, &virtual_pos,
+                                end_search, chunk_end - lc_mc_search->start_buffer + max_len, &ret);
+        if (ret == MC_SEARCH_CB_ABORT)
+        {
+            aborted = TRUE;
+            break;
+        }
+
+        while (mc_search__hex_find_cond (lc_mc_search, buf->str, buf->len, from,
+                                         chunk_end - lc_mc_search->start_buffer, &pos, &len))
+        {
+            found_pos = pos;
+            found_size = len;
+            found = TRUE;
+            from = pos + 1;
+        }
+
+        if (found)
+            return mc_search__hex_result (lc_mc_search, TRUE,
+                                          lc_mc_search->start_buffer + found_pos, found_size,
+                                          found_len, FALSE);
+
+        if (chunk_start == start_search)
+            break;
+
+        if (lc_mc_search->update_fn != NULL
+            && lc_mc_search->update_fn (user_data, chunk_start) == MC_SEARCH_CB_ABORT)
+        {
+            aborted = TRUE;
+            break;
+        }
+
+        chunk_end = chunk_start - 1;
+    }
+
+    return mc_search__hex_result (lc_mc_search, FALSE, 0, 0, NULL, aborted);
 }
 
 /* --------------------------------------------------------------------------------------------- */
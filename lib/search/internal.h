@@ -9,6 +9,9 @@
 #define mc_search_regex_t pcre
 #endif
 
+typedef struct mc_search_literal_struct mc_search_literal_t;
+typedef struct mc_search_hex_struct mc_search_hex_t;
+
 /*** enums ***************************************************************************************/
 
 typedef enum
@@ -29,6 +32,11 @@ typedef struct mc_search_cond_struct
     GString *upper;
     GString *lower;
     mc_search_regex_t *regex_handle;
+#ifdef SEARCH_TYPE_PCRE
+    pcre_extra *regex_extra;    /* result of pcre_study() */
+#endif
+    mc_search_literal_t *literal;       /* used by normal search instead of regex */
+    mc_search_hex_t *hex;       /* used by hex search instead of regex */
     gchar *charset;
 } mc_search_cond_t;
 
@@ -52,6 +60,11 @@ void mc_search__cond_struct_new_init_regex (const char *, mc_search_t *, mc_sear
 
 gboolean mc_search__run_regex (mc_search_t *, const void *, gsize, gsize, gsize *);
 
+gboolean mc_search__run_regex_backward (mc_search_t *, const void *, gsize, gsize, gsize, gsize *);
+
+gboolean mc_search__read_window (mc_search_t *, GString *, const void *, gsize *, gsize *, gsize,
+                                 gsize, mc_search_cbret_t *);
+
 GString *mc_search_regex_prepare_replace_str (mc_search_t *, GString *);
 
 /* search/normal.c : */
@@ -60,6 +73,11 @@ void mc_search__cond_struct_new_init_normal (const char *, mc_search_t *, mc_sea
 
 gboolean mc_search__run_normal (mc_search_t *, const void *, gsize, gsize, gsize *);
 
+void mc_search__normal_literal_free (mc_search_literal_t *);
+
+gboolean mc_search__normal_find (const mc_search_literal_t *, const char *, gsize, gsize,
+                                 gsize *, gsize *);
+
 GString *mc_search_normal_prepare_replace_str (mc_search_t *, GString *);
 
 /* search/glob.c : */
@@ -76,6 +94,10 @@ void mc_search__cond_struct_new_init_hex (const char *, mc_search_t *, mc_search
 
 gboolean mc_search__run_hex (mc_search_t *, const void *, gsize, gsize, gsize *);
 
+gboolean mc_search__run_hex_backward (mc_search_t *, const void *, gsize, gsize, gsize, gsize *);
+
+void mc_search__hex_free (mc_search_hex_t *);
+
 GString *mc_search_hex_prepare_replace_str (mc_search_t *, GString *);
 
 /*** inline functions ****************************************************************************/
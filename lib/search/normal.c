@@ -36,63 +36,389 @@
 
 /*** file scope macro definitions ****************************************************************/
 
+/* shorter patterns are searched with memchr() and memcmp() */
+#define LITERAL_MIN_SKIP_LEN 3
+
 /*** file scope type declarations ****************************************************************/
 
+/* Literal matcher of one condition. Plain search doesn't need a regex engine:
+ * the pattern is found with Boyer-Moore-Horspool algorithm or, in UTF-8
+ * case-insensitive mode, by comparing of case-folded characters. */
+struct mc_search_literal_struct
+{
+    gboolean utf8;
+    gboolean case_sensitive;
+    gboolean whole_words;
+
+    /* pattern (case-folded if search is case-insensitive and charset is 8-bit) */
+    guchar *pattern;
+    gsize len;
+    /* folding of bytes: identity for case-sensitive search */
+    guchar fold[256];
+    /* Horspool shift for each folded byte */
+    gsize skip[256];
+
+    /* UTF-8 case-insensitive search: pattern as folded characters */
+    gunichar *chars;
+    glong chars_len;
+    /* bytes which can start a match */
+    gboolean first[256];
+};
+
 /*** file scope variables ************************************************************************/
 
 /*** file scope functions ************************************************************************/
+static inline gunichar
+mc_search__normal_fold_char (gunichar c)
+{
+    return g_unichar_tolower (g_unichar_toupper (c));
+}
 
-static GString *
-mc_search__normal_translate_to_regex (const GString * astr)
+/* --------------------------------------------------------------------------------------------- */
+/**
+ * Same set of symbols as "[\\p{L}\\p{N}_]" used by regex search for whole words.
+ */
+
+static gboolean
+mc_search__normal_is_word_char (gunichar c)
 {
-    const char *str = astr->str;
-    GString *buff;
-    gsize loop;
+    switch (g_unichar_type (c))
+    {
+    case G_UNICODE_DECIMAL_NUMBER:
+    case G_UNICODE_LETTER_NUMBER:
+    case G_UNICODE_OTHER_NUMBER:
+        return TRUE;
+    default:
+        return c == '_' || g_unichar_isalpha (c);
+    }
+}
+
+/* --------------------------------------------------------------------------------------------- */
+
+static gboolean
+mc_search__normal_word_before (const mc_search_literal_t * lit, const char *buf, gsize pos)
+{
+    gunichar c;
+
+    if (pos == 0)
+        return FALSE;
+
+    if (!lit->utf8)
+        /* 8-bit charsets are checked like G_REGEX_RAW does: byte is Latin-1 symbol */
+        return mc_search__normal_is_word_char ((guchar) buf[pos - 1]);
+
+    {
+        const char *prev;
 
-    buff = g_string_sized_new (32);
+        prev = g_utf8_find_prev_char (buf, buf + pos);
+        if (prev == NULL)
+            return FALSE;
+        c = g_utf8_get_char_validated (prev, buf + pos - prev);
+    }
+
+    return (c != (gunichar) (-1) && c != (gunichar) (-2) && mc_search__normal_is_word_char (c));
+}
+
+/* --------------------------------------------------------------------------------------------- */
+
+static gboolean
+mc_search__normal_word_after (const mc_search_literal_t * lit, const char *buf, gsize len,
+                              gsize pos)
+{
+    gunichar c;
+
+    if (pos >= len)
+        return FALSE;
+
+    if (!lit->utf8)
+        return mc_search__normal_is_word_char ((guchar) buf[pos]);
+
+    c = g_utf8_get_char_validated (buf + pos, len - pos);
+
+    return (c != (gunichar) (-1) && c != (gunichar) (-2) && mc_search__normal_is_word_char (c));
+}
 
-    for (loop = 0; loop < astr->len; loop++)
-        switch (str[loop])
+/* --------------------------------------------------------------------------------------------- */
+/**
+ * Fill table of lowercase bytes of 8-bit charset.
+ */
+
+static void
+mc_search__normal_fold_table (const char *charset, guchar * fold)
+{
+    char all[255];
+    GString *lower;
+    int i;
+
+    for (i = 0; i < 256; i++)
+        fold[i] = (guchar) i;
+
+    /* convert all bytes at once: charset conversion is expensive */
+    for (i = 1; i < 256; i++)
+        all[i - 1] = (char) i;
+
+    lower = mc_search__tolower_case_str (charset, all, sizeof (all));
+    if (lower->len == sizeof (all))
+    {
+        for (i = 1; i < 256; i++)
+            fold[i] = (guchar) lower->str[i - 1];
+        g_string_free (lower, TRUE);
+        return;
+    }
+    g_string_free (lower, TRUE);
+
+    /* some bytes are not representable in display charset: do it one by one */
+    for (i = 1; i < 256; i++)
+    {
+        char c = (char) i;
+
+        lower = mc_search__tolower_case_str (charset, &c, 1);
+        if (lower->len == 1)
+            fold[i] = (guchar) lower->str[0];
+        g_string_free (lower, TRUE);
+    }
+}
+
+/* --------------------------------------------------------------------------------------------- */
+
+static void
+mc_search__normal_first_bytes_add (mc_search_literal_t * lit, gunichar c)
+{
+    char tmp[6];
+
+    g_unichar_to_utf8 (c, tmp);
+    lit->first[(guchar) tmp[0]] = TRUE;
+}
+
+/* --------------------------------------------------------------------------------------------- */
+
+static mc_search_literal_t *
+mc_search__normal_literal_new (const char *charset, const mc_search_t * lc_mc_search,
+                               const GString * str)
+{
+    mc_search_literal_t *lit;
+    gsize i;
+
+    lit = g_new0 (mc_search_literal_t, 1);
+    lit->utf8 = str_isutf8 (charset);
+    lit->case_sensitive = lc_mc_search->is_case_sensitive;
+    lit->whole_words = lc_mc_search->whole_words && !lc_mc_search->is_entire_line;
+    lit->len = str->len;
+    lit->pattern = (guchar *) g_memdup (str->str, str->len);
+
+    if (!lit->case_sensitive && lit->utf8)
+    {
+        const char *p, *end;
+        gunichar c0;
+        int b;
+
+        lit->chars = g_new (gunichar, str->len);
+
+        for (p = str->str, end = str->str + str->len; p < end; lit->chars_len++)
         {
-        case '*':
-        case '?':
-        case ',':
-        case '{':
-        case '}':
-        case '[':
-        case ']':
-        case '\\':
-        case '+':
-        case '.':
-        case '$':
-        case '(':
-        case ')':
-        case '^':
-        case '-':
-        case '|':
-            g_string_append_c (buff, '\\');
-            /* fall through */
-        default:
-            g_string_append_c (buff, str[loop]);
-            break;
+            gunichar c;
+
+            c = g_utf8_get_char_validated (p, end - p);
+            if (c == (gunichar) (-1) || c == (gunichar) (-2))
+            {
+                /* invalid UTF-8 in pattern: search it as is */
+                g_free (lit->chars);
+                lit->chars = NULL;
+                lit->chars_len = 0;
+                lit->case_sensitive = TRUE;
+                break;
+            }
+            lit->chars[lit->chars_len] = mc_search__normal_fold_char (c);
+            p = g_utf8_next_char (p);
         }
 
-    return buff;
+        if (lit->chars != NULL)
+        {
+            c0 = lit->chars[0];
+            mc_search__normal_first_bytes_add (lit, c0);
+            mc_search__normal_first_bytes_add (lit, g_unichar_toupper (c0));
+            mc_search__normal_first_bytes_add (lit, g_unichar_totitle (c0));
+
+            /* other case variants of letter can be encoded by any number of bytes
+             * (for example, KELVIN SIGN is 'k') */
+            if (g_unichar_toupper (c0) != g_unichar_tolower (c0))
+                for (b = 0xC0; b < 256; b++)
+                    lit->first[b] = TRUE;
+
+            return lit;
+        }
+    }
+
+    for (i = 0; i < 256; i++)
+        lit->fold[i] = (guchar) i;
+
+    if (!lit->case_sensitive)
+    {
+        mc_search__normal_fold_table (charset, lit->fold);
+        for (i = 0; i < lit->len; i++)
+            lit->pattern[i] = lit->fold[lit->pattern[i]];
+    }
+
+    for (i = 0; i < 256; i++)
+        lit->skip[i] = lit->len;
+    for (i = 0; i + 1 < lit->len; i++)
+        lit->skip[lit->pattern[i]] = lit->len - 1 - i;
+
+    return lit;
+}
+
+/* --------------------------------------------------------------------------------------------- */
+/**
+ * Find first occurrence of pattern in bytes [from, len) ignoring whole words.
+ */
+
+static gboolean
+mc_search__normal_find_raw (const mc_search_literal_t * lit, const guchar * buf, gsize len,
+                            gsize from, gsize * start_pos, gsize * end_pos)
+{
+    const gsize m = lit->len;
+    const guchar *pat = lit->pattern;
+    gsize i;
+
+    if (lit->chars != NULL)
+    {
+        /* UTF-8 case-insensitive: compare folded characters */
+        for (i = from; i < len; i++)
+        {
+            gsize p;
+            glong k;
+
+            if (!lit->first[buf[i]])
+                continue;
+
+            for (p = i, k = 0; k < lit->chars_len && p < len; k++)
+            {
+                gunichar c;
+
+                c = g_utf8_get_char_validated ((const char *) buf + p, len - p);
+                if (c == (gunichar) (-1) || c == (gunichar) (-2)
+                    || mc_search__normal_fold_char (c) != lit->chars[k])
+                    break;
+                p = g_utf8_next_char (buf + p) - (const char *) buf;
+            }
+
+            if (k == lit->chars_len)
+            {
+                *start_pos = i;
+                *end_pos = p;
+                return TRUE;
+            }
+        }
+
+        return FALSE;
+    }
+
+    if (m == 0 || len < m || from > len - m)
+        return FALSE;
+
+    if (lit->case_sensitive && m < LITERAL_MIN_SKIP_LEN)
+    {
+        /* memchr() is vectorized by C library */
+        const guchar *p = buf + from;
+        const guchar *last = buf + len - m;
+
+        while (p <= last && (p = memchr (p, pat[0], last - p + 1)) != NULL)
+        {
+            if (memcmp (p + 1, pat + 1, m - 1) == 0)
+            {
+                *start_pos = p - buf;
+                *end_pos = *start_pos + m;
+                return TRUE;
+            }
+            p++;
+        }
+
+        return FALSE;
+    }
+
+    /* Boyer-Moore-Horspool */
+    for (i = from; i <= len - m;)
+    {
+        const guchar last = lit->fold[buf[i + m - 1]];
+
+        if (last == pat[m - 1])
+        {
+            gsize k;
+
+            if (lit->case_sensitive)
+                k = memcmp (buf + i, pat, m - 1) == 0 ? m - 1 : 0;
+            else
+                for (k = 0; k < m - 1 && lit->fold[buf[i + k]] == pat[k]; k++)
+                    ;
+
+            if (k == m - 1)
+            {
+                *start_pos = i;
+                *end_pos = i + m;
+                return TRUE;
+            }
+        }
+
+        i += lit->skip[last];
+    }
+
+    return FALSE;
 }
 
+/* --------------------------------------------------------------------------------------------- */
 /*** public functions ****************************************************************************/
 
 void
 mc_search__cond_struct_new_init_normal (const char *charset, mc_search_t * lc_mc_search,
                                         mc_search_cond_t * mc_search_cond)
 {
-    GString *tmp;
+    mc_search_cond->literal =
+        mc_search__normal_literal_new (charset, lc_mc_search, mc_search_cond->str);
+    lc_mc_search->is_utf8 = str_isutf8 (charset);
+}
 
-    tmp = mc_search__normal_translate_to_regex (mc_search_cond->str);
-    g_string_free (mc_search_cond->str, TRUE);
+/* --------------------------------------------------------------------------------------------- */
 
-    mc_search_cond->str = tmp;
-    mc_search__cond_struct_new_init_regex (charset, lc_mc_search, mc_search_cond);
+void
+mc_search__normal_literal_free (mc_search_literal_t * lit)
+{
+    if (lit != NULL)
+    {
+        g_free (lit->pattern);
+        g_free (lit->chars);
+        g_free (lit);
+    }
+}
+
+/* --------------------------------------------------------------------------------------------- */
+/**
+ * Find first occurrence of literal pattern in the buffer.
+ *
+ * @param lit literal matcher
+ * @param buf buffer; may contain NULs
+ * @param len length of buffer
+ * @param from offset in the buffer to start search from; preceding bytes are used
+ *             to check word boundary
+ * @param start_pos offset of found pattern in the buffer
+ * @param end_pos offset of the first byte after found pattern
+ *
+ * @return TRUE if pattern is found, FALSE otherwise
+ */
+
+gboolean
+mc_search__normal_find (const mc_search_literal_t * lit, const char *buf, gsize len, gsize from,
+                        gsize * start_pos, gsize * end_pos)
+{
+    while (mc_search__normal_find_raw (lit, (const guchar *) buf, len, from, start_pos, end_pos))
+    {
+        if (!lit->whole_words || (!mc_search__normal_word_before (lit, buf, *start_pos)
+                                  && !mc_search__normal_word_after (lit, buf, len, *end_pos)))
+            return TRUE;
+
+        from = *start_pos + 1;
+    }
+
+    return FALSE;
 }
 
 /* --------------------------------------------------------------------------------------------- */
@@ -101,7 +427,63 @@ gboolean
 mc_search__run_normal (mc_search_t * lc_mc_search, const void *user_data,
                        gsize start_search, gsize end_search, gsize * found_len)
 {
-    return mc_search__run_regex (lc_mc_search, user_data, start_search, end_search, found_len);
+    const char *buf;
+    const char *nul;
+    gsize len;
+    gsize best_start = 0, best_end = 0;
+    gboolean found = FALSE;
+    gsize loop;
+
+    /* data is provided by callback byte by byte: search line by line as regex does */
+    if (lc_mc_search->search_fn != NULL)
+        return mc_search__run_regex (lc_mc_search, user_data, start_search, end_search, found_len);
+
+    if (start_search > end_search)
+    {
+        mc_search_set_error (lc_mc_search, MC_SEARCH_E_NOTFOUND, NULL);
+        return FALSE;
+    }
+
+    /* search in whole string at once; like regex search, stop at end_search or at NUL */
+    buf = (const char *) user_data + start_search;
+    if (end_search == G_MAXSIZE)
+        len = strlen (buf);
+    else
+    {
+        len = end_search - start_search + 1;
+        nul = memchr (buf, '\0', len);
+        if (nul != NULL)
+            len = nul - buf;
+    }
+
+    for (loop = 0; loop < lc_mc_search->conditions->len; loop++)
+    {
+        mc_search_cond_t *mc_search_cond;
+        gsize start_pos, end_pos;
+
+        mc_search_cond = (mc_search_cond_t *) g_ptr_array_index (lc_mc_search->conditions, loop);
+
+        if (mc_search__normal_find (mc_search_cond->literal, buf, len, 0, &start_pos, &end_pos)
+            && (!found || start_pos < best_start))
+        {
+            best_start = start_pos;
+            best_end = end_pos;
+            found = TRUE;
+        }
+    }
+
+    if (!found)
+    {
+        mc_search_set_error (lc_mc_search, MC_SEARCH_E_NOTFOUND, NULL);
+        return FALSE;
+    }
+
+    lc_mc_search->start_buffer = start_search;
+    lc_mc_search->normal_offset = start_search + best_start;
+    if (found_len != NULL)
+        *found_len = best_end - best_start;
+
+    return TRUE;
 }
 
 /* --------------------------------------------------------------------------------------------- */
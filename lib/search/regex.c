@@ -42,6 +42,36 @@
 
 /*** file scope macro definitions ****************************************************************/
 
+/* size of data scanned at once by backward search */
+#define BACKWARD_CHUNK_SIZE (64 * 1024)
+
+/* multi-line search: windows grow from the minimal size while nothing is found */
+#define MULTILINE_WINDOW_MIN (4 * 1024)
+#define MULTILINE_WINDOW_SIZE (256 * 1024)
+/* matches longer than this may be not found by multi-line search */
+#define MULTILINE_WINDOW_MAX (4 * 1024 * 1024)
+/* data kept before search position for lookbehind assertions and '^' */
+#define MULTILINE_CONTEXT_SIZE 256
+
+#ifdef SEARCH_TYPE_GLIB
+#if GLIB_CHECK_VERSION (2, 34, 0)
+#define REGEX_MATCH_PARTIAL G_REGEX_MATCH_PARTIAL_HARD
+#else
+/* a complete match is preferred to a partial one which starts before it */
+#define REGEX_MATCH_PARTIAL G_REGEX_MATCH_PARTIAL
+#endif
+#else /* SEARCH_TYPE_GLIB */
+#ifdef PCRE_STUDY_JIT_COMPILE
+#ifdef PCRE_STUDY_JIT_PARTIAL_HARD_COMPILE
+#define REGEX_PCRE_STUDY_OPTIONS (PCRE_STUDY_JIT_COMPILE | PCRE_STUDY_JIT_PARTIAL_HARD_COMPILE)
+#else
+#define REGEX_PCRE_STUDY_OPTIONS PCRE_STUDY_JIT_COMPILE
+#endif
+#else
+#define REGEX_PCRE_STUDY_OPTIONS 0
+#endif
+#endif /* SEARCH_TYPE_GLIB */
+
 #define REPLACE_PREPARE_T_NOTHING_SPECIAL -1
 #define REPLACE_PREPARE_T_REPLACE_FLAG    -2
 #define REPLACE_PREPARE_T_ESCAPE_SEQ      -3
@@ -318,17 +348,40 @@ mc_search__g_regex_match_full_safe (const GRegex * regex,
 
 /* --------------------------------------------------------------------------------------------- */
 
+/**
+ * Run regex of condition on the string.
+ *
+ * @param partial if TRUE, report a match which may continue beyond the end of string
+ *
+ * @return COND__FOUND_OK if found, COND__NOT_ALL_FOUND if partial match is found,
+ *         COND__NOT_FOUND if not found, COND__FOUND_ERROR on error
+ */
+
 static mc_search__found_cond_t
-mc_search__regex_found_cond_one (mc_search_t * lc_mc_search, mc_search_regex_t * regex,
-                                 GString * search_str)
+mc_search__regex_found_cond_one (mc_search_t * lc_mc_search, mc_search_cond_t * mc_search_cond,
+                                 GString * search_str, gsize from, gboolean partial)
 {
 #ifdef SEARCH_TYPE_GLIB
     GError *mcerror = NULL;
+    GRegexMatchFlags match_flags = G_REGEX_MATCH_NEWLINE_ANY;
+
+    if (partial)
+        match_flags |= REGEX_MATCH_PARTIAL;
+
+    if (lc_mc_search->regex_match_info != NULL)
+    {
+        g_match_info_free (lc_mc_search->regex_match_info);
+        lc_mc_search->regex_match_info = NULL;
+    }
 
     if (!mc_search__g_regex_match_full_safe
-        (regex, search_str->str, search_str->len, 0, G_REGEX_MATCH_NEWLINE_ANY,
-         &lc_mc_search->regex_match_info, &mcerror))
+        (mc_search_cond->regex_handle, search_str->str, search_str->len, (gint) from,
+         match_flags, &lc_mc_search->regex_match_info, &mcerror))
     {
+        gboolean is_partial;
+
+        is_partial = lc_mc_search->regex_match_info != NULL
+            && g_match_info_is_partial_match (lc_mc_search->regex_match_info);
         g_match_info_free (lc_mc_search->regex_match_info);
         lc_mc_search->regex_match_info = NULL;
         if (mcerror != NULL)
@@ -340,13 +393,16 @@ mc_search__regex_found_cond_one (mc_search_t * lc_mc_search, mc_search_regex_t *
             g_error_free (mcerror);
             return COND__FOUND_ERROR;
         }
-        return COND__NOT_FOUND;
+        return is_partial ? COND__NOT_ALL_FOUND : COND__NOT_FOUND;
     }
     lc_mc_search->num_results = g_match_info_get_match_count (lc_mc_search->regex_match_info);
 #else /* SEARCH_TYPE_GLIB */
-    lc_mc_search->num_results = pcre_exec (regex, lc_mc_search->regex_match_info,
-                                           search_str->str, search_str->len, 0, 0,
-                                           lc_mc_search->iovector, MC_SEARCH__NUM_REPLACE_ARGS);
+    lc_mc_search->num_results =
+        pcre_exec (mc_search_cond->regex_handle, mc_search_cond->regex_extra, search_str->str,
+                   search_str->len, (int) from, partial ? PCRE_PARTIAL_HARD : 0,
+                   lc_mc_search->iovector, MC_SEARCH__NUM_REPLACE_ARGS);
+    if (lc_mc_search->num_results == PCRE_ERROR_PARTIAL)
+        return COND__NOT_ALL_FOUND;
     if (lc_mc_search->num_results < 0)
     {
         return COND__NOT_FOUND;
@@ -359,7 +415,47 @@ mc_search__regex_found_cond_one (mc_search_t * lc_mc_search, mc_search_regex_t *
 /* --------------------------------------------------------------------------------------------- */
 
 static mc_search__found_cond_t
-mc_search__regex_found_cond (mc_search_t * lc_mc_search, GString * search_str)
+mc_search__regex_found_cond_at (mc_search_t * lc_mc_search, mc_search_cond_t * mc_search_cond,
+                                GString * search_str, gsize from, gint * start_pos,
+                                gint * end_pos)
+{
+    mc_search__found_cond_t ret;
+
+    if (mc_search_cond->literal != NULL)
+    {
+        gsize lit_start, lit_end;
+
+        if (!mc_search__normal_find (mc_search_cond->literal, search_str->str, search_str->len,
+                                     from, &lit_start, &lit_end))
+            return COND__NOT_FOUND;
+
+        *start_pos = (gint) lit_start;
+        *end_pos = (gint) lit_end;
+        return COND__FOUND_OK;
+    }
+
+    if (!mc_search_cond->regex_handle)
+        return COND__NOT_FOUND;
+
+    ret = mc_search__regex_found_cond_one (lc_mc_search, mc_search_cond, search_str, from, FALSE);
+    if (ret == COND__FOUND_OK)
+    {
+#ifdef SEARCH_TYPE_GLIB
+        g_match_info_fetch_pos (lc_mc_search->regex_match_info, 0, start_pos, end_pos);
+#else /* SEARCH_TYPE_GLIB */
+        *start_pos = lc_mc_search->iovector[0];
+        *end_pos = lc_mc_search->iovector[1];
+#endif /* SEARCH_TYPE_GLIB */
+    }
+
+    return ret;
+}
+
+/* --------------------------------------------------------------------------------------------- */
+
+static mc_search__found_cond_t
+mc_search__regex_found_cond (mc_search_t * lc_mc_search, GString * search_str, gint * start_pos,
+                             gint * end_pos)
 {
     gsize loop1;
 
@@ -370,12 +466,9 @@ mc_search__regex_found_cond (mc_search_t * lc_mc_search, GString * search_str)
 
         mc_search_cond = (mc_search_cond_t *) g_ptr_array_index (lc_mc_search->conditions, loop1);
 
-        if (!mc_search_cond->regex_handle)
-            continue;
-
         ret =
-            mc_search__regex_found_cond_one (lc_mc_search, mc_search_cond->regex_handle,
-                                             search_str);
+            mc_search__regex_found_cond_at (lc_mc_search, mc_search_cond, search_str, 0,
+                                            start_pos, end_pos);
         if (ret != COND__NOT_FOUND)
             return ret;
     }
@@ -781,10 +874,578 @@ mc_search_regex__process_escape_sequence (GString * dest_str, const char *from,
     }
 }
 
+/* --------------------------------------------------------------------------------------------- */
+/**
+ * Append data to the regex buffer up to the end of line by contiguous blocks.
+ *
+ * @return FALSE if block provider can't give data at current position and the rest
+ *         of line should be read by search_fn, TRUE otherwise
+ */
+
+static gboolean
+mc_search__regex_append_blocks (mc_search_t * lc_mc_search, const void *user_data,
+                                gsize * current_pos, gsize * virtual_pos, gsize end_search,
+                                mc_search_cbret_t * ret)
+{
+    while (TRUE)
+    {
+        const char *block = NULL;
+        const char *eol;
+        gsize len = 0;
+
+        *ret = lc_mc_search->block_fn (user_data, *current_pos, &block, &len);
+
+        if (*ret == MC_SEARCH_CB_INVALID)
+            return FALSE;
+
+        if (*ret != MC_SEARCH_CB_OK || len == 0)
+        {
+            if (*ret == MC_SEARCH_CB_OK)
+                *ret = MC_SEARCH_CB_NOTFOUND;
+            return TRUE;
+        }
+
+        len = MIN (len, end_search - *virtual_pos + 1);
+        eol = memchr (block, '\n', len);
+        if (eol != NULL)
+            len = eol - block + 1;
+
+        g_string_append_len (lc_mc_search->regex_buffer, block, len);
+        *current_pos += len;
+        *virtual_pos += len;
+
+        if (eol != NULL || *virtual_pos > end_search)
+            return TRUE;
+    }
+}
+
+/* --------------------------------------------------------------------------------------------- */
+/**
+ * Read one line (with terminating newline if any) into the regex buffer.
+ */
+
+static void
+mc_search__regex_read_line (mc_search_t * lc_mc_search, const void *user_data, gsize * current_pos,
+                            gsize * virtual_pos, gsize end_search, mc_search_cbret_t * ret)
+{
+    g_string_set_size (lc_mc_search->regex_buffer, 0);
+    lc_mc_search->start_buffer = *current_pos;
+
+    if (lc_mc_search->search_fn != NULL)
+    {
+        if (lc_mc_search->block_fn == NULL
+            || !mc_search__regex_append_blocks (lc_mc_search, user_data, current_pos,
+                                                virtual_pos, end_search, ret))
+            while (TRUE)
+            {
+                int current_chr = '\n'; /* stop search symbol */
+
+                *ret = lc_mc_search->search_fn (user_data, *current_pos, &current_chr);
+
+                if (*ret == MC_SEARCH_CB_ABORT)
+                    break;
+
+                if (*ret == MC_SEARCH_CB_INVALID)
+                    continue;
+
+                (*current_pos)++;
+
+                if (*ret == MC_SEARCH_CB_SKIP)
+                    continue;
+
+                (*virtual_pos)++;
+
+                g_string_append_c (lc_mc_search->regex_buffer, (char) current_chr);
+
+                if ((char) current_chr == '\n' || *virtual_pos > end_search)
+                    break;
+            }
+    }
+    else
+    {
+        /* optimization for standard case (for search from file manager)
+         *  where there is no MC_SEARCH_CB_INVALID or MC_SEARCH_CB_SKIP
+         *  return codes, so we can copy line at regex buffer all at once
+         */
+        while (TRUE)
+        {
+            const char current_chr = ((const char *) user_data)[*current_pos];
+
+            if (current_chr == '\0')
+                break;
+
+            (*current_pos)++;
+
+            if (current_chr == '\n' || *current_pos > end_search)
+                break;
+        }
+
+        /* use virtual_pos as index of start of current chunk */
+        g_string_append_len (lc_mc_search->regex_buffer,
+                             (const char *) user_data + *virtual_pos, *current_pos - *virtual_pos);
+        *virtual_pos = *current_pos;
+    }
+
+
+}
+
+/* --------------------------------------------------------------------------------------------- */
+/**
+ * Find beginning of line which contains byte at pos.
+ */
+
+static gsize
+mc_search__regex_line_start (mc_search_t * lc_mc_search, const void *user_data, gsize start_search,
+                             gsize pos)
+{
+    for (; pos > start_search; pos--)
+    {
+        int current_chr;
+
+        if (lc_mc_search->search_fn == NULL)
+            current_chr = ((const char *) user_data)[pos - 1];
+        else if (lc_mc_search->search_fn (user_data, pos - 1, &current_chr) != MC_SEARCH_CB_OK)
+            break;
+
+        if ((char) current_chr == '\n')
+            break;
+    }
+
+    return pos;
+}
+
+/* --------------------------------------------------------------------------------------------- */
+/**
+ * Find the last match which starts in [start_search, last_start] and lies before end_search.
+ * Lines are read forward from start_search, start_search must be the beginning of line.
+ *
+ * @return COND__FOUND_OK if found, COND__NOT_ALL_FOUND if not found, COND__FOUND_ERROR on error
+ *         or if search is aborted
+ */
+
+static mc_search__found_cond_t
+mc_search__regex_find_last (mc_search_t * lc_mc_search, const void *user_data, gsize start_search,
+                            gsize last_start, gsize end_search, gsize * found_pos,
+                            gsize * found_len)
+{
+    mc_search_cbret_t ret = MC_SEARCH_CB_OK;
+    gsize current_pos, virtual_pos;
+    gsize best_line = 0;
+    gsize best_cond = 0;
+    gint best_start = -1, best_end = 0;
+    gint start_pos, end_pos;
+    gsize loop;
+
+    virtual_pos = current_pos = start_search;
+    while (virtual_pos <= last_start && virtual_pos <= end_search)
+    {
+        gsize line_start = virtual_pos;
+
+        mc_search__regex_read_line (lc_mc_search, user_data, &current_pos, &virtual_pos,
+                                    end_search, &ret);
+        if (ret == MC_SEARCH_CB_ABORT)
+            return COND__FOUND_ERROR;
+        /* end of string */
+        if (virtual_pos == line_start)
+            break;
+
+        for (loop = 0; loop < lc_mc_search->conditions->len; loop++)
+        {
+            mc_search_cond_t *mc_search_cond;
+            gsize from = 0;
+
+            mc_search_cond =
+                (mc_search_cond_t *) g_ptr_array_index (lc_mc_search->conditions, loop);
+
+            while (from <= lc_mc_search->regex_buffer->len)
+            {
+                switch (mc_search__regex_found_cond_at
+                        (lc_mc_search, mc_search_cond, lc_mc_search->regex_buffer, from,
+                         &start_pos, &end_pos))
+                {
+                case COND__FOUND_OK:
+                    break;
+                case COND__FOUND_ERROR:
+                    return COND__FOUND_ERROR;
+                default:
+                    /* try next condition */
+                    from = lc_mc_search->regex_buffer->len + 1;
+                    continue;
+                }
+
+                if (lc_mc_search->start_buffer + start_pos > last_start)
+                    break;
+
+                if (best_start < 0
+                    || lc_mc_search->start_buffer + start_pos > best_line + best_start)
+                {
+                    best_line = lc_mc_search->start_buffer;
+                    best_cond = loop;
+                    best_start = start_pos;
+                    best_end = end_pos;
+                }
+
+                from = start_pos + 1;
+            }
+        }
+
+        if (ret == MC_SEARCH_CB_NOTFOUND)
+            break;
+    }
+
+    if (best_start < 0)
+        return COND__NOT_ALL_FOUND;
+
+    /* match info of the found match is used to prepare replacement */
+    if (lc_mc_search->start_buffer != best_line)
+    {
+        virtual_pos = current_pos = best_line;
+        mc_search__regex_read_line (lc_mc_search, user_data, &current_pos, &virtual_pos,
+                                    end_search, &ret);
+    }
+    mc_search__regex_found_cond_at (lc_mc_search,
+                                    g_ptr_array_index (lc_mc_search->conditions, best_cond),
+                                    lc_mc_search->regex_buffer, best_start, &start_pos, &end_pos);
+    *found_pos = best_line + best_start;
+    *found_len = best_end - best_start;
+    return COND__FOUND_OK;
+}
+
+/* --------------------------------------------------------------------------------------------- */
+/**
+ * Find the first match in the regex buffer which starts at from or later.
+ *
+ * @param partial TRUE if more data may follow the buffer
+ *
+ * @return the same as mc_search__regex_found_cond_one()
+ */
+
+static mc_search__found_cond_t
+mc_search__regex_found_cond_window (mc_search_t * lc_mc_search, gsize from, gboolean partial,
+                                    gint * start_pos, gint * end_pos)
+{
+    GString *buf = lc_mc_search->regex_buffer;
+    gsize loop;
+
+    for (loop = 0; loop < lc_mc_search->conditions->len; loop++)
+    {
+        mc_search_cond_t *mc_search_cond;
+        mc_search__found_cond_t ret;
+
+        mc_search_cond = (mc_search_cond_t *) g_ptr_array_index (lc_mc_search->conditions, loop);
+        if (mc_search_cond->regex_handle == NULL)
+            continue;
+
+        ret = mc_search__regex_found_cond_one (lc_mc_search, mc_search_cond, buf, from, partial);
+        if (ret == COND__FOUND_OK)
+        {
+#ifdef SEARCH_TYPE_GLIB
+            g_match_info_fetch_pos (lc_mc_search->regex_match_info, 0, start_pos, end_pos);
+#else /* SEARCH_TYPE_GLIB */
+            *start_pos = lc_mc_search->iovector[0];
+            *end_pos = lc_mc_search->iovector[1];
+#endif /* SEARCH_TYPE_GLIB */
+            /* greedy match may become longer */
+            if (partial && (gsize) * end_pos == buf->len)
+                ret = COND__NOT_ALL_FOUND;
+        }
+
+        if (ret != COND__NOT_FOUND)
+            return ret;
+    }
+
+    return COND__NOT_FOUND;
+}
+
+/* --------------------------------------------------------------------------------------------- */
+/**
+ * Find a match of multi-line regex. Data is read into the regex buffer by windows of many
+ * lines, so regex runs once per window instead of once per line. If a match may continue
+ * beyond the end of window, the window is enlarged and searched again.
+ *
+ * @param context_start data from this offset up to pos is used by lookbehind assertions and '^'
+ * @param pos offset where the match may start
+ * @param last_start the match must start not after it
+ * @param find_last if TRUE, find the match with the greatest start, otherwise the first one
+ *
+ * @return COND__FOUND_OK if found, COND__NOT_FOUND if not found, COND__FOUND_ERROR on error
+ *         (error of search is set then) or if search is aborted
+ */
+
+static mc_search__found_cond_t
+mc_search__regex_window_find (mc_search_t * lc_mc_search, const void *user_data,
+                              gsize context_start, gsize pos, gsize last_start, gsize end_search,
+                              gboolean find_last, gsize * found_pos, gsize * found_len)
+{
+    GString *buf = lc_mc_search->regex_buffer;
+    mc_search_cbret_t ret = MC_SEARCH_CB_OK;
+    gsize current_pos, virtual_pos;
+    gsize want = MULTILINE_WINDOW_MIN;
+    gboolean more = TRUE;
+    gboolean found = FALSE;
+
+    g_string_set_size (buf, 0);
+    lc_mc_search->start_buffer = pos - MIN (pos - context_start, MULTILINE_CONTEXT_SIZE);
+    current_pos = virtual_pos = lc_mc_search->start_buffer;
+
+    while (pos <= last_start)
+    {
+        mc_search__found_cond_t cond;
+        gsize from;
+        gint start_pos, end_pos;
+
+        /* drop data which is far before pos */
+        from = pos - lc_mc_search->start_buffer;
+        if (from > MULTILINE_CONTEXT_SIZE)
+        {
+            gsize drop;
+
+            drop = MIN (from - MULTILINE_CONTEXT_SIZE, buf->len);
+            g_string_erase (buf, 0, drop);
+            lc_mc_search->start_buffer += drop;
+            from -= drop;
+        }
+
+        if (more && buf->len < from + want)
+            more =
+                mc_search__read_window (lc_mc_search, buf, user_data, &current_pos, &virtual_pos,
+                                        end_search, from + want - buf->len, &ret);
+        if (ret == MC_SEARCH_CB_ABORT)
+            return COND__FOUND_ERROR;
+        if (from > buf->len)
+            break;
+
+        cond = mc_search__regex_found_cond_window (lc_mc_search, from, more, &start_pos, &end_pos);
+        if (cond == COND__NOT_ALL_FOUND)
+        {
+            if (buf->len - from < MULTILINE_WINDOW_MAX)
+            {
+                /* read more data and try again */
+                want = MAX (want, buf->len - from) * 2;
+                continue;
+            }
+
+            /* match is too long, take complete matches only */
+            cond =
+                mc_search__regex_found_cond_window (lc_mc_search, from, FALSE, &start_pos,
+                                                    &end_pos);
+        }
+
+        if (cond == COND__FOUND_ERROR)
+            return COND__FOUND_ERROR;
+
+        if (cond == COND__FOUND_OK)
+        {
+            gsize match_pos;
+
+            match_pos = lc_mc_search->start_buffer + start_pos;
+            if (match_pos > last_start)
+                break;
+
+            *found_pos = match_pos;
+            *found_len = end_pos - start_pos;
+            found = TRUE;
+            if (!find_last)
+                break;
+
+            /* try the next character */
+            if (lc_mc_search->is_utf8 && (gsize) start_pos < buf->len)
+                pos = match_pos + MIN ((gsize) g_utf8_skip[(guchar) buf->str[start_pos]],
+                                       buf->len - start_pos);
+            else
+                pos = match_pos + 1;
+        }
+        else
+        {
+            if (!more)
+                break;
+
+            pos = lc_mc_search->start_buffer + buf->len;
+            want = MIN (want * 2, MULTILINE_WINDOW_SIZE);
+        }
+
+        if (lc_mc_search->update_fn != NULL
+            && lc_mc_search->update_fn (user_data, current_pos) == MC_SEARCH_CB_ABORT)
+            return COND__FOUND_ERROR;
+    }
+
+    return found ? COND__FOUND_OK : COND__NOT_FOUND;
+}
+
+/* --------------------------------------------------------------------------------------------- */
+
+static gboolean
+mc_search__regex_window_result (mc_search_t * lc_mc_search, mc_search__found_cond_t cond,
+                                gsize found_pos, gsize len, gsize * found_len)
+{
+    if (cond == COND__FOUND_OK)
+    {
+        if (found_len != NULL)
+            *found_len = len;
+        lc_mc_search->normal_offset = found_pos;
+        return TRUE;
+    }
+
+    g_string_free (lc_mc_search->regex_buffer, TRUE);
+    lc_mc_search->regex_buffer = NULL;
+
+    /* error of regex is already set */
+    if (cond == COND__FOUND_ERROR && lc_mc_search->error != MC_SEARCH_E_OK)
+        return FALSE;
+
+    MC_PTR_FREE (lc_mc_search->error_str);
+    lc_mc_search->error = cond == COND__FOUND_ERROR ? MC_SEARCH_E_ABORT : MC_SEARCH_E_NOTFOUND;
+
+    return FALSE;
+}
+
+/* --------------------------------------------------------------------------------------------- */
+
+static gboolean
+mc_search__run_regex_multiline (mc_search_t * lc_mc_search, const void *user_data,
+                                gsize start_search, gsize end_search, gsize * found_len)
+{
+    mc_search__found_cond_t cond;
+    gsize found_pos = 0, len = 0;
+
+    cond =
+        mc_search__regex_window_find (lc_mc_search, user_data, start_search, start_search,
+                                      end_search, end_search, FALSE, &found_pos, &len);
+
+    return mc_search__regex_window_result (lc_mc_search, cond, found_pos, len, found_len);
+}
+
+/* --------------------------------------------------------------------------------------------- */
+/**
+ * Backward multi-line search: chunks are taken from the end, each chunk is searched for
+ * the last match which starts in it.
+ */
+
+static gboolean
+mc_search__run_regex_multiline_backward (mc_search_t * lc_mc_search, const void *user_data,
+                                         gsize start_search, gsize last_start, gsize end_search,
+                                         gsize * found_len)
+{
+    mc_search__found_cond_t cond = COND__NOT_FOUND;
+    gsize chunk_end = last_start;
+    gsize found_pos = 0, len = 0;
+
+    while (start_search <= chunk_end)
+    {
+        gsize chunk_start;
+
+        chunk_start = chunk_end - start_search > BACKWARD_CHUNK_SIZE
+            ? chunk_end - BACKWARD_CHUNK_SIZE : start_search;
+
+        cond =
+            mc_search__regex_window_find (lc_mc_search, user_data, start_search, chunk_start,
+                                          chunk_end, end_search, TRUE, &found_pos, &len);
+        if (cond != COND__NOT_FOUND || chunk_start == start_search)
+            break;
+
+        chunk_end = chunk_start - 1;
+    }
+
+    /* match info of the found match is used to prepare replacement */
+    if (cond == COND__FOUND_OK)
+        cond =
+            mc_search__regex_window_find (lc_mc_search, user_data, start_search, found_pos,
+                                          found_pos, end_search, FALSE, &found_pos, &len);
+
+    return mc_search__regex_window_result (lc_mc_search, cond, found_pos, len, found_len);
+}
+
 /* --------------------------------------------------------------------------------------------- */
 /*** public functions ****************************************************************************/
 /* --------------------------------------------------------------------------------------------- */
 
+/**
+ * Append up to size bytes of data to the buffer regardless of lines.
+ *
+ * @return TRUE if more data may follow
+ */
+
+gboolean
+mc_search__read_window (mc_search_t * lc_mc_search, GString * buf, const void *user_data,
+                        gsize * current_pos, gsize * virtual_pos, gsize end_search, gsize size,
+                        mc_search_cbret_t * ret)
+{
+    gboolean use_blocks = lc_mc_search->block_fn != NULL;
+    gsize limit;
+
+    if (*virtual_pos > end_search)
+        return FALSE;
+
+    limit = buf->len + MIN (size, end_search - *virtual_pos + 1);
+
+    if (lc_mc_search->search_fn == NULL)
+    {
+        const char *data = (const char *) user_data + *current_pos;
+        const char *nul;
+        gsize len = limit - buf->len;
+
+        nul = memchr (data, '\0', len);
+        if (nul != NULL)
+            len = nul - data;
+
+        g_string_append_len (buf, data, len);
+        *current_pos += len;
+        *virtual_pos += len;
+
+        return nul == NULL && *virtual_pos <= end_search;
+    }
+
+    while (buf->len < limit)
+    {
+        if (use_blocks)
+        {
+            const char *block = NULL;
+            gsize len = 0;
+
+            *ret = lc_mc_search->block_fn (user_data, *current_pos, &block, &len);
+
+            if (*ret == MC_SEARCH_CB_INVALID)
+            {
+                /* read the rest by search_fn */
+                use_blocks = FALSE;
+                continue;
+            }
+
+            if (*ret != MC_SEARCH_CB_OK || len == 0)
+                return FALSE;
+
+            len = MIN (len, limit - buf->len);
+            g_string_append_len (buf, block, len);
+            *current_pos += len;
+            *virtual_pos += len;
+        }
+        else
+        {
+            int current_chr = '\n';
+
+            *ret = lc_mc_search->search_fn (user_data, *current_pos, &current_chr);
+
+            if (*ret == MC_SEARCH_CB_ABORT || *ret == MC_SEARCH_CB_NOTFOUND)
+                return FALSE;
+
+            if (*ret == MC_SEARCH_CB_INVALID)
+                continue;
+
+            (*current_pos)++;
+
+            if (*ret == MC_SEARCH_CB_SKIP)
+                continue;
+
+            (*virtual_pos)++;
+            g_string_append_c (buf, (char) current_chr);
+        }
+    }
+
+    return *virtual_pos <= end_search;
+}
+
+/* --------------------------------------------------------------------------------------------- */
+
 void
 mc_search__cond_struct_new_init_regex (const char *charset, mc_search_t * lc_mc_search,
                                        mc_search_cond_t * mc_search_cond)
@@ -801,7 +1462,13 @@ mc_search__cond_struct_new_init_regex (const char *charset, mc_search_t * lc_mc_
     {
 #ifdef SEARCH_TYPE_GLIB
         GError *mcerror = NULL;
-        GRegexCompileFlags g_regex_options = G_REGEX_OPTIMIZE | G_REGEX_DOTALL;
+        GRegexCompileFlags g_regex_options = G_REGEX_OPTIMIZE;
+
+        /* '.' doesn't match newline if text of many lines is searched at once */
+        if (lc_mc_search->multiline && lc_mc_search->search_type == MC_SEARCH_T_REGEX)
+            g_regex_options |= G_REGEX_MULTILINE;
+        else
+            g_regex_options |= G_REGEX_DOTALL;
 
         if (str_isutf8 (charset) && mc_global.utf8_display)
         {
@@ -865,8 +1532,10 @@ mc_search__cond_struct_new_init_regex (const char *charset, mc_search_t * lc_mc_
             mc_search_set_error (lc_mc_search, MC_SEARCH_E_REGEX_COMPILE, "%s", error);
             return;
         }
-        lc_mc_search->regex_match_info = pcre_study (mc_search_cond->regex_handle, 0, &error);
-        if (lc_mc_search->regex_match_info == NULL && error != NULL)
+        /* JIT compilation if PCRE supports it */
+        mc_search_cond->regex_extra =
+            pcre_study (mc_search_cond->regex_handle, REGEX_PCRE_STUDY_OPTIONS, &error);
+        if (mc_search_cond->regex_extra == NULL && error != NULL)
         {
             mc_search_set_error (lc_mc_search, MC_SEARCH_E_REGEX_COMPILE, "%s", error);
             MC_PTR_FREE (mc_search_cond->regex_handle);
@@ -894,73 +1563,20 @@ mc_search__run_regex (mc_search_t * lc_mc_search, const void *user_data,
     else
         lc_mc_search->regex_buffer = g_string_sized_new (64);
 
+    if (lc_mc_search->multiline && lc_mc_search->search_type == MC_SEARCH_T_REGEX)
+        return mc_search__run_regex_multiline (lc_mc_search, user_data, start_search, end_search,
+                                               found_len);
+
     virtual_pos = current_pos = start_search;
     while (virtual_pos <= end_search)
     {
-        g_string_set_size (lc_mc_search->regex_buffer, 0);
-        lc_mc_search->start_buffer = current_pos;
+        mc_search__regex_read_line (lc_mc_search, user_data, &current_pos, &virtual_pos,
+                                    end_search, &ret);
 
-        if (lc_mc_search->search_fn != NULL)
-        {
-            while (TRUE)
-            {
-                int current_chr = '\n'; /* stop search symbol */
-
-                ret = lc_mc_search->search_fn (user_data, current_pos, &current_chr);
-
-                if (ret == MC_SEARCH_CB_ABORT)
-                    break;
-
-                if (ret == MC_SEARCH_CB_INVALID)
-                    continue;
-
-                current_pos++;
-
-                if (ret == MC_SEARCH_CB_SKIP)
-                    continue;
-
-                virtual_pos++;
-
-                g_string_append_c (lc_mc_search->regex_buffer, (char) current_chr);
-
-                if ((char) current_chr == '\n' || virtual_pos > end_search)
-                    break;
-            }
-        }
-        else
-        {
-            /* optimization for standard case (for search from file manager)
-             *  where there is no MC_SEARCH_CB_INVALID or MC_SEARCH_CB_SKIP
-             *  return codes, so we can copy line at regex buffer all at once
-             */
-            while (TRUE)
-            {
-                const char current_chr = ((const char *) user_data)[current_pos];
-
-                if (current_chr == '\0')
-                    break;
-
-                current_pos++;
-
-                if (current_chr == '\n' || current_pos > end_search)
-                    break;
-            }
-
-            /* use virtual_pos as index of start of current chunk */
-            g_string_append_len (lc_mc_search->regex_buffer, (const char *) user_data + virtual_pos,
-                                 current_pos - virtual_pos);
-            virtual_pos = current_pos;
-        }
-
-        switch (mc_search__regex_found_cond (lc_mc_search, lc_mc_search->regex_buffer))
+        switch (mc_search__regex_found_cond
+                (lc_mc_search, lc_mc_search->regex_buffer, &start_pos, &end_pos))
         {
         case COND__FOUND_OK:
-#ifdef SEARCH_TYPE_GLIB
-            g_match_info_fetch_pos (lc_mc_search->regex_match_info, 0, &start_pos, &end_pos);
-#else /* SEARCH_TYPE_GLIB */
-            start_pos = lc_mc_search->iovector[0];
-            end_pos = lc_mc_search->iovector[1];
-#endif /* SEARCH_TYPE_GLIB */
             if (found_len != NULL)
                 *found_len = end_pos - start_pos;
             lc_mc_search->normal_offset = lc_mc_search->start_buffer + start_pos;
@@ -990,6 +1606,78 @@ mc_search__run_regex (mc_search_t * lc_mc_search, const void *user_data,
     return FALSE;
 }
 
+/* --------------------------------------------------------------------------------------------- */
+/**
+ * Search backward: find the match with the greatest start offset in [start_search, last_start].
+ * Data is scanned by chunks from the end; each chunk starts at the beginning of line
+ * and is searched forward for its last match.
+ */
+
+gboolean
+mc_search__run_regex_backward (mc_search_t * lc_mc_search, const void *user_data,
+                               gsize start_search, gsize last_start, gsize end_search,
+                               gsize * found_len)
+{
+    mc_search__found_cond_t ret = COND__NOT_ALL_FOUND;
+    gboolean aborted = FALSE;
+    gsize chunk_end = last_start;
+
+    if (lc_mc_search->regex_buffer != NULL)
+        g_string_set_size (lc_mc_search->regex_buffer, 0);
+    else
+        lc_mc_search->regex_buffer = g_string_sized_new (64);
+
+    if (lc_mc_search->multiline && lc_mc_search->search_type == MC_SEARCH_T_REGEX)
+        return mc_search__run_regex_multiline_backward (lc_mc_search, user_data, start_search,
+                                                        last_start, end_search, found_len);
+
+    while (start_search <= chunk_end)
+    {
+        gsize chunk_start, found_pos, len;
+
+        chunk_start = chunk_end - start_search > BACKWARD_CHUNK_SIZE
+            ? chunk_end - BACKWARD_CHUNK_SIZE : start_search;
+        chunk_start =
+            mc_search__regex_line_start (lc_mc_search, user_data, start_search, chunk_start);
+
+        ret =
+            mc_search__regex_find_last (lc_mc_search, user_data, chunk_start, chunk_end,
+                                        end_search, &found_pos, &len);
+        if (ret == COND__FOUND_OK)
+        {
+            if (found_len != NULL)
+                *found_len = len;
+            lc_mc_search->normal_offset = found_pos;
+            return TRUE;
+        }
+
+        if (ret == COND__FOUND_ERROR || chunk_start == start_search)
+            break;
+
+        if (lc_mc_search->update_fn != NULL
+            && lc_mc_search->update_fn (user_data, chunk_start) == MC_SEARCH_CB_ABORT)
+        {
+            aborted = TRUE;
+            break;
+        }
+
+        chunk_end = chunk_start - 1;
+    }
+
+    g_string_free (lc_mc_search->regex_buffer, TRUE);
+    lc_mc_search->regex_buffer = NULL;
+
+    /* error of regex is already set */
+    if (ret == COND__FOUND_ERROR && lc_mc_search->error != MC_SEARCH_E_OK)
+        return FALSE;
+
+    MC_PTR_FREE (lc_mc_search->error_str);
+    lc_mc_search->error = (aborted || ret == COND__FOUND_ERROR) ? MC_SEARCH_E_ABORT
+        : MC_SEARCH_E_NOTFOUND;
+
+    return FALSE;
+}
+
 /* --------------------------------------------------------------------------------------------- */
 
 GString *
@@ -108,8 +108,16 @@ mc_search__cond_struct_free (mc_search_cond_t * mc_search_cond)
         g_regex_unref (mc_search_cond->regex_handle);
 #else /* SEARCH_TYPE_GLIB */
     g_free (mc_search_cond->regex_handle);
+#ifdef PCRE_STUDY_JIT_COMPILE
+    pcre_free_study (mc_search_cond->regex_extra);
+#else
+    g_free (mc_search_cond->regex_extra);
+#endif
 #endif /* SEARCH_TYPE_GLIB */
 
+    mc_search__normal_literal_free (mc_search_cond->literal);
+    mc_search__hex_free (mc_search_cond->hex);
+
     g_free (mc_search_cond);
 }
 
@@ -122,6 +130,29 @@ mc_search__conditions_free (GPtrArray * array)
     g_ptr_array_free (array, TRUE);
 }
 
+/* --------------------------------------------------------------------------------------------- */
+
+static gboolean
+mc_search__run_prepare (mc_search_t * lc_mc_search)
+{
+    if (!mc_search_is_type_avail (lc_mc_search->search_type))
+    {
+        mc_search_set_error (lc_mc_search, MC_SEARCH_E_INPUT, "%s", _(STR_E_UNKNOWN_TYPE));
+        return FALSE;
+    }
+#ifdef SEARCH_TYPE_GLIB
+    if (lc_mc_search->regex_match_info != NULL)
+    {
+        g_match_info_free (lc_mc_search->regex_match_info);
+        lc_mc_search->regex_match_info = NULL;
+    }
+#endif /* SEARCH_TYPE_GLIB */
+
+    mc_search_set_error (lc_mc_search, MC_SEARCH_E_OK, NULL);
+
+    return (lc_mc_search->conditions != NULL || mc_search_prepare (lc_mc_search));
+}
+
 /* --------------------------------------------------------------------------------------------- */
 /*** public functions ****************************************************************************/
 /* --------------------------------------------------------------------------------------------- */
@@ -282,24 +313,7 @@ mc_search_run (mc_search_t * lc_mc_search, const void *user_data,
 {
     gboolean ret = FALSE;
 
-    if (lc_mc_search == NULL || user_data == NULL)
-        return FALSE;
-    if (!mc_search_is_type_avail (lc_mc_search->search_type))
-    {
-        mc_search_set_error (lc_mc_search, MC_SEARCH_E_INPUT, "%s", _(STR_E_UNKNOWN_TYPE));
-        return FALSE;
-    }
-#ifdef SEARCH_TYPE_GLIB
-    if (lc_mc_search->regex_match_info != NULL)
-    {
-        g_match_info_free (lc_mc_search->regex_match_info);
-        lc_mc_search->regex_match_info = NULL;
-    }
-#endif /* SEARCH_TYPE_GLIB */
-
-    mc_search_set_error (lc_mc_search, MC_SEARCH_E_OK, NULL);
-
-    if ((lc_mc_search->conditions == NULL) && !mc_search_prepare (lc_mc_search))
+    if (lc_mc_search == NULL || user_data == NULL || !mc_search__run_prepare (lc_mc_search))
         return FALSE;
 
     switch (lc_mc_search->search_type)
@@ -322,6 +336,29 @@ mc_search_run (mc_search_t * lc_mc_search, const void *user_data,
     return ret;
 }
 
+/* --------------------------------------------------------------------------------------------- */
+/**
+ * Carries out the backward search: finds the match which starts at the greatest offset
+ * in [start_search, last_start]. The match may end beyond last_start but not beyond end_search.
+ *
+ * Return value and error codes are the same as of #mc_search_run().
+ */
+
+gboolean
+mc_search_run_backward (mc_search_t * lc_mc_search, const void *user_data, gsize start_search,
+                        gsize last_start, gsize end_search, gsize * found_len)
+{
+    if (lc_mc_search == NULL || user_data == NULL || !mc_search__run_prepare (lc_mc_search))
+        return FALSE;
+
+    if (lc_mc_search->search_type == MC_SEARCH_T_HEX)
+        return mc_search__run_hex_backward (lc_mc_search, user_data, start_search, last_start,
+                                            end_search, found_len);
+
+    return mc_search__run_regex_backward (lc_mc_search, user_data, start_search, last_start,
+                                          end_search, found_len);
+}
+
 /* --------------------------------------------------------------------------------------------- */
 
 gboolean
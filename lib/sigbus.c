@@ -0,0 +1,140 @@
+/*
+   Shared handler of SIGBUS raised by access to mapped files.
+
+   Copyright (C) 2017
+   Free Software Foundation, Inc.
+
+   This file is part of the Midnight Commander.
+
+   The Midnight Commander is free software: you can redistribute it
+   and/or modify it under the terms of the GNU General Public License as
+   published by the Free Software Foundation, either version 3 of the License,
+   or (at your option) any later version.
+
+   The Midnight Commander is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/** \file
+ *  \brief Source: shared handler of SIGBUS raised by access to mapped files
+ *
+ *  Access to pages of mapped file beyond the end of the file, if it is truncated by another
+ *  program, raises SIGBUS. Modules which map files add their handlers here instead of
+ *  installing own signal handlers, which would replace each other.
+ *
+ *  The signal handler is installed once and is never removed. Added handlers are called in
+ *  order of adding until one of them handles the fault. Faults which aren't handled by them
+ *  are passed to the signal handler which was installed before.
+ */
+
+#include <config.h>
+
+#include <signal.h>
+#include <string.h>
+
+#include "lib/global.h"
+#include "lib/sigbus.h"
+
+/*** global variables ****************************************************************************/
+
+/*** file scope macro definitions ****************************************************************/
+
+#define MC_SIGBUS_HANDLERS_MAX 8
+
+/*** file scope type declarations ****************************************************************/
+
+typedef struct
+{
+    mc_sigbus_handler_fn handler;
+    void *data;
+} mc_sigbus_entry_t;
+
+/*** file scope variables ************************************************************************/
+
+static mc_sigbus_entry_t handlers[MC_SIGBUS_HANDLERS_MAX];
+/* entries are filled before they are counted, so signal handler can read them without lock */
+static volatile gint handlers_num = 0;
+static struct sigaction old_sigbus;
+
+G_LOCK_DEFINE_STATIC (handlers);
+
+/* --------------------------------------------------------------------------------------------- */
+/*** file scope functions ************************************************************************/
+/* --------------------------------------------------------------------------------------------- */
+
+static void
+mc_sigbus_handler (int sig, siginfo_t * info, void *context)
+{
+    gint i, n;
+
+    n = g_atomic_int_get (&handlers_num);
+    for (i = 0; i < n; i++)
+        if (handlers[i].handler (info->si_addr, handlers[i].data))
+            return;
+
+    if ((old_sigbus.sa_flags & SA_SIGINFO) != 0)
+        old_sigbus.sa_sigaction (sig, info, context);
+    else if (old_sigbus.sa_handler == SIG_DFL)
+    {
+        /* the process is terminated by the default action when handler returns */
+        signal (sig, SIG_DFL);
+        raise (sig);
+    }
+    else if (old_sigbus.sa_handler != SIG_IGN)
+        old_sigbus.sa_handler (sig);
+}
+
+/* --------------------------------------------------------------------------------------------- */
+/*** public functions ****************************************************************************/
+/* --------------------------------------------------------------------------------------------- */
+/**
+ * Add handler of SIGBUS. The handler is called from signal handler in the thread which has
+ * raised the signal, so it must be async-signal-safe. Handlers can't be removed: they should
+ * check whether the fault address belongs to their data.
+ *
+ * @param handler handler of fault address
+ * @param data user data of handler
+ *
+ * @return FALSE if too many handlers are added
+ */
+
+gboolean
+mc_sigbus_add_handler (mc_sigbus_handler_fn handler, void *data)
+{
+    gboolean ret = FALSE;
+    gint n;
+
+    G_LOCK (handlers);
+
+    n = g_atomic_int_get (&handlers_num);
+    if (n < MC_SIGBUS_HANDLERS_MAX)
+    {
+        handlers[n].handler = handler;
+        handlers[n].data = data;
+        g_atomic_int_set (&handlers_num, n + 1);
+
+        if (n == 0)
+        {
+            struct sigaction sa;
+
+            memset (&sa, 0, sizeof (sa));
+            sa.sa_sigaction = mc_sigbus_handler;
+            sa.sa_flags = SA_SIGINFO;
+            sigemptyset (&sa.sa_mask);
+            sigaction (SIGBUS, &sa, &old_sigbus);
+        }
+
+        ret = TRUE;
+    }
+
+    G_UNLOCK (handlers);
+
+    return ret;
+}
+
+/* --------------------------------------------------------------------------------------------- */
@@ -0,0 +1,25 @@
+/** \file sigbus.h
+ *  \brief Header: shared handler of SIGBUS raised by access to mapped files
+ */
+
+#ifndef MC__SIGBUS_H
+#define MC__SIGBUS_H
+
+/*** typedefs(not structures) and defined constants **********************************************/
+
+/* returns TRUE if fault at address is handled; it's called from signal handler */
+typedef gboolean (*mc_sigbus_handler_fn) (void *addr, void *data);
+
+/*** enums ***************************************************************************************/
+
+/*** structures declarations (and typedefs of structures)*****************************************/
+
+/*** global variables defined in .c file *********************************************************/
+
+/*** declarations of public functions ************************************************************/
+
+gboolean mc_sigbus_add_handler (mc_sigbus_handler_fn handler, void *data);
+
+/*** inline functions ****************************************************************************/
+
+#endif /* MC__SIGBUS_H */
@@ -869,6 +869,10 @@ get_compression_type (int fd, const char *name)
     if (magic[0] == 0x04 && magic[1] == 0x22 && magic[2] == 0x4d && magic[3] == 0x18)
         return COMPRESSION_LZ4;
 
+    /* ZSTD frame magic - 0xFD2FB528 (little endian) */
+    if (magic[0] == 0x28 && magic[1] == 0xB5 && magic[2] == 0x2F && magic[3] == 0xFD)
+        return COMPRESSION_ZSTD;
+
     if (mc_read (fd, (char *) magic + 4, 2) != 2)
         return COMPRESSION_NONE;
 
@@ -921,6 +925,8 @@ decompress_extension (int type)
         return "/ulzma" VFS_PATH_URL_DELIMITER;
     case COMPRESSION_XZ:
         return "/uxz" VFS_PATH_URL_DELIMITER;
+    case COMPRESSION_ZSTD:
+        return "/uzst" VFS_PATH_URL_DELIMITER;
     default:
         break;
     }
@@ -60,7 +60,8 @@ enum compression_type
     COMPRESSION_LZIP,
     COMPRESSION_LZ4,
     COMPRESSION_LZMA,
-    COMPRESSION_XZ
+    COMPRESSION_XZ,
+    COMPRESSION_ZSTD
 };
 
 /* stdout or stderr stream of child process */
@@ -107,6 +108,9 @@ typedef struct
     char *sort_key;
     /* key used for comparing extensions */
     char *second_sort_key;
+    /* color computed by file highlighting and id of the rules used for that, 0 if not computed */
+    int fhl_color;
+    unsigned int fhl_id;
 
     /* Flags */
     struct
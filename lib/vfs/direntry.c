@@ -95,13 +95,85 @@ struct dirhandle
 /*** file scope functions ************************************************************************/
 /* --------------------------------------------------------------------------------------------- */
 
-static int
-vfs_s_entry_compare (const void *a, const void *b)
+/**
+ * Add entry to the name index of its directory.
+ * If the name is already indexed, the first entry wins like in the linear scan of subdir.
+ */
+
+static void
+vfs_s_index_entry (struct vfs_s_inode *dir, struct vfs_s_entry *ent)
+{
+    if (ent->name != NULL && g_hash_table_lookup (dir->subdir_index, ent->name) == NULL)
+        g_hash_table_insert (dir->subdir_index, ent->name, ent);
+}
+
+/* --------------------------------------------------------------------------------------------- */
+
+static void
+vfs_s_unindex_entry (struct vfs_s_inode *dir, struct vfs_s_entry *ent)
 {
-    const struct vfs_s_entry *e = (const struct vfs_s_entry *) a;
-    const char *name = (const char *) b;
+    GList *iter;
+
+    if (ent->name == NULL || g_hash_table_lookup (dir->subdir_index, ent->name) != ent)
+        return;
+
+    g_hash_table_remove (dir->subdir_index, ent->name);
+
+    /* entry with the same name could be hidden by removed one */
+    for (iter = dir->subdir; iter != NULL; iter = g_list_next (iter))
+    {
+        struct vfs_s_entry *e = (struct vfs_s_entry *) iter->data;
+
+        if (e != ent && e->name != NULL && strcmp (e->name, ent->name) == 0)
+        {
+            g_hash_table_insert (dir->subdir_index, e->name, e);
+            break;
+        }
+    }
+}
+
+/* --------------------------------------------------------------------------------------------- */
+
+static void
+vfs_s_free_subdir_index (struct vfs_s_inode *dir)
+{
+    if (dir->subdir_index != NULL)
+    {
+        g_hash_table_destroy (dir->subdir_index);
+        dir->subdir_index = NULL;
+    }
+}
+
+/* --------------------------------------------------------------------------------------------- */
+/**
+ * Find entry by name in the directory.
+ * Small directories are scanned linearly. Large ones get the hash index on first lookup
+ * which is kept in sync by vfs_s_insert_entry() and vfs_s_free_entry() then.
+ */
+
+static struct vfs_s_entry *
+vfs_s_find_entry_by_name (struct vfs_s_inode *dir, const char *name)
+{
+    GList *iter;
+    size_t count = 0;
 
-    return strcmp (e->name, name);
+    if (dir->subdir_index != NULL)
+        return (struct vfs_s_entry *) g_hash_table_lookup (dir->subdir_index, name);
+
+    for (iter = dir->subdir; iter != NULL; iter = g_list_next (iter), count++)
+        if (strcmp (((struct vfs_s_entry *) iter->data)->name, name) == 0)
+            break;
+
+    if (count >= VFS_S_SUBDIR_INDEX_MIN)
+    {
+        GList *i;
+
+        dir->subdir_index = g_hash_table_new (g_str_hash, g_str_equal);
+        for (i = dir->subdir; i != NULL; i = g_list_next (i))
+            vfs_s_index_entry (dir, (struct vfs_s_entry *) i->data);
+    }
+
+    return iter != NULL ? (struct vfs_s_entry *) iter->data : NULL;
 }
 
 /* --------------------------------------------------------------------------------------------- */
@@ -189,7 +261,7 @@ vfs_s_find_entry_tree (struct vfs_class *me, struct vfs_s_inode *root,
 
     while (root != NULL)
     {
-        GList *iter;
+        char c;
 
         while (IS_PATH_SEP (*path))     /* Strip leading '/' */
             path++;
@@ -203,15 +275,11 @@ vfs_s_find_entry_tree (struct vfs_class *me, struct vfs_s_inode *root,
         for (pseg = 0; path[pseg] != '\0' && !IS_PATH_SEP (path[pseg]); pseg++)
             ;
 
-        for (iter = root->subdir; iter != NULL; iter = g_list_next (iter))
-        {
-            ent = (struct vfs_s_entry *) iter->data;
-            if (strlen (ent->name) == pseg && strncmp (ent->name, path, pseg) == 0)
-                /* FOUND! */
-                break;
-        }
-
-        ent = iter != NULL ? (struct vfs_s_entry *) iter->data : NULL;
+        /* path is our own copy: terminate the segment temporarily */
+        c = path[pseg];
+        path[pseg] = '\0';
+        ent = vfs_s_find_entry_by_name (root, path);
+        path[pseg] = c;
 
         if (ent == NULL && (flags & (FL_MKFILE | FL_MKDIR)) != 0)
             ent = vfs_s_automake (me, root, path, flags);
@@ -243,7 +311,6 @@ vfs_s_find_entry_linear (struct vfs_class *me, struct vfs_s_inode *root,
 {
     struct vfs_s_entry *ent = NULL;
     char *const path = g_strdup (a_path);
-    GList *iter;
 
     if (root->super->root != root)
         vfs_die ("We have to use _real_ root. Always. Sorry.");
@@ -266,8 +333,7 @@ vfs_s_find_entry_linear (struct vfs_class *me, struct vfs_s_inode *root,
         return ent;
     }
 
-    iter = g_list_find_custom (root->subdir, path, (GCompareFunc) vfs_s_entry_compare);
-    ent = iter != NULL ? (struct vfs_s_entry *) iter->data : NULL;
+    ent = vfs_s_find_entry_by_name (root, path);
 
     if (ent != NULL && !MEDATA->dir_uptodate (me, ent->ino))
     {
@@ -293,8 +359,7 @@ vfs_s_find_entry_linear (struct vfs_class *me, struct vfs_s_inode *root,
 
         vfs_s_insert_entry (me, root, ent);
 
-        iter = g_list_find_custom (root->subdir, path, (GCompareFunc) vfs_s_entry_compare);
-        ent = iter != NULL ? (struct vfs_s_entry *) iter->data : NULL;
+        ent = vfs_s_find_entry_by_name (root, path);
     }
     if (ent == NULL)
         vfs_die ("find_linear: success but directory is not there\n");
@@ -358,6 +423,7 @@ vfs_s_free_super (struct vfs_class *me, struct vfs_s_super *super)
     CALL (free_archive) (me, super);
 #ifdef ENABLE_VFS_NET
     vfs_path_element_free (super->path_element);
+    g_free (super->rbuf);
 #endif
     g_free (super->name);
     g_free (super);
@@ -454,6 +520,43 @@ vfs_s_readdir (void *data)
 
 /* --------------------------------------------------------------------------------------------- */
 
+static int
+vfs_s_readdir_plus (void *data, vfs_dirent_plus_t * entries, int count)
+{
+    struct dirhandle *info = (struct dirhandle *) data;
+    struct vfs_class *me = info->dir->super->me;
+    int n;
+
+    for (n = 0; n < count && info->cur != NULL; info->cur = g_list_next (info->cur), n++)
+    {
+        struct vfs_s_entry *ent = (struct vfs_s_entry *) info->cur->data;
+        vfs_dirent_plus_t *de = &entries[n];
+
+        if (ent->name == NULL)
+            vfs_die ("Null in structure-cannot happen");
+
+        de->name = g_strdup (ent->name);
+        de->st = ent->ino->st;
+        de->link_to_dir = FALSE;
+        de->stale_link = FALSE;
+
+        if (S_ISLNK (de->st.st_mode))
+        {
+            struct vfs_s_entry *target;
+
+            target = vfs_s_resolve_symlink (me, ent, LINK_FOLLOW);
+            if (target != NULL)
+                de->link_to_dir = S_ISDIR (target->ino->st.st_mode);
+            else
+                de->stale_link = TRUE;
+        }
+    }
+
+    return n;
+}
+
+/* --------------------------------------------------------------------------------------------- */
+
 static int
 vfs_s_closedir (void *data)
 {
@@ -844,6 +947,49 @@ vfs_s_dir_uptodate (struct vfs_class *me, struct vfs_s_inode *ino)
 }
 
 
+#ifdef ENABLE_VFS_NET
+/* --------------------------------------------------------------------------------------------- */
+/**
+ * Refill empty receive buffer from its socket.
+ *
+ * @return TRUE if some data was received, FALSE on EOF or error. errno is kept from read()
+ */
+
+static gboolean
+vfs_s_rbuf_fill (vfs_s_rbuf_t * rbuf)
+{
+    ssize_t n;
+
+    rbuf->pos = 0;
+    rbuf->len = 0;
+
+    errno = 0;
+    n = read (rbuf->sock, rbuf->data, sizeof (rbuf->data));
+    if (n <= 0)
+        return FALSE;
+
+    rbuf->len = (size_t) n;
+    return TRUE;
+}
+
+/* --------------------------------------------------------------------------------------------- */
+
+static void
+vfs_s_log_received (FILE * logfile, const char *data, size_t len)
+{
+    if (logfile != NULL)
+    {
+        size_t ret1;
+        int ret2;
+
+        ret1 = fwrite (data, 1, len, logfile);
+        ret2 = fflush (logfile);
+        (void) ret1;
+        (void) ret2;
+    }
+}
+#endif /* ENABLE_VFS_NET */
+
 /* --------------------------------------------------------------------------------------------- */
 /*** public functions ****************************************************************************/
 /* --------------------------------------------------------------------------------------------- */
@@ -886,6 +1032,8 @@ vfs_s_free_inode (struct vfs_class *me, struct vfs_s_inode *ino)
         return;
     }
 
+    /* whole directory goes away, don't keep index in sync entry by entry */
+    vfs_s_free_subdir_index (ino);
     while (ino->subdir != NULL)
         vfs_s_free_entry (me, (struct vfs_s_entry *) ino->subdir->data);
 
@@ -924,7 +1072,11 @@ void
 vfs_s_free_entry (struct vfs_class *me, struct vfs_s_entry *ent)
 {
     if (ent->dir != NULL)
+    {
+        if (ent->dir->subdir_index != NULL)
+            vfs_s_unindex_entry (ent->dir, ent);
         ent->dir->subdir = g_list_remove (ent->dir->subdir, ent);
+    }
 
     MC_PTR_FREE (ent->name);
 
@@ -948,6 +1100,8 @@ vfs_s_insert_entry (struct vfs_class *me, struct vfs_s_inode *dir, struct vfs_s_
 
     ent->ino->st.st_nlink++;
     dir->subdir = g_list_append (dir->subdir, ent);
+    if (dir->subdir_index != NULL)
+        vfs_s_index_entry (dir, ent);
 }
 
 /* --------------------------------------------------------------------------------------------- */
@@ -1455,6 +1609,8 @@ vfs_s_init_class (struct vfs_class *vclass, struct vfs_s_subclass *sub)
     }
     vclass->opendir = vfs_s_opendir;
     vclass->readdir = vfs_s_readdir;
+    /* reads directories opened by vfs_s_opendir(): reset it if opendir is replaced */
+    vclass->readdir_plus = vfs_s_readdir_plus;
     vclass->closedir = vfs_s_closedir;
     vclass->stat = vfs_s_stat;
     vclass->lstat = vfs_s_lstat;
@@ -1524,91 +1680,184 @@ vfs_s_select_on_two (int fd1, int fd2)
 
 /* --------------------------------------------------------------------------------------------- */
 
+/**
+ * Create receive buffer for the socket.
+ *
+ * @param sock socket descriptor, -1 if not connected yet
+ * @return newly allocated buffer, free it with g_free()
+ */
+
+vfs_s_rbuf_t *
+vfs_s_rbuf_new (int sock)
+{
+    vfs_s_rbuf_t *rbuf;
+
+    rbuf = g_new (vfs_s_rbuf_t, 1);
+    vfs_s_rbuf_reset (rbuf, sock);
+    return rbuf;
+}
+
+/* --------------------------------------------------------------------------------------------- */
+/**
+ * Bind receive buffer to the (new) socket. Data received before is discarded.
+ */
+
+void
+vfs_s_rbuf_reset (vfs_s_rbuf_t * rbuf, int sock)
+{
+    rbuf->sock = sock;
+    rbuf->pos = 0;
+    rbuf->len = 0;
+}
+
+/* --------------------------------------------------------------------------------------------- */
+/**
+ * Read raw data from the connection. Data which is already in the receive buffer is returned first,
+ * so protocols can mix line replies and binary transfers on the same socket.
+ *
+ * @return number of bytes read, 0 on EOF or -1 on error (errno is set by read())
+ */
+
+ssize_t
+vfs_s_rbuf_read (vfs_s_rbuf_t * rbuf, void *buf, size_t count)
+{
+    size_t avail;
+
+    avail = rbuf->len - rbuf->pos;
+    if (avail == 0)
+        return read (rbuf->sock, buf, count);
+
+    count = MIN (count, avail);
+    memcpy (buf, rbuf->data + rbuf->pos, count);
+    rbuf->pos += count;
+    return (ssize_t) count;
+}
+
+/* --------------------------------------------------------------------------------------------- */
+/**
+ * Get one line from the connection.
+ *
+ * @param me VFS class. Received data is written to its log file, if any
+ * @param rbuf receive buffer of the connection
+ * @param buf buffer for line
+ * @param buf_len size of @buf. Rest of longer line is discarded up to '\n'
+ * @param term line terminator. It is not stored in @buf
+ * @return 1 if line is read, 0 on EOF or error
+ */
+
 int
-vfs_s_get_line (struct vfs_class *me, int sock, char *buf, int buf_len, char term)
+vfs_s_get_line (struct vfs_class *me, vfs_s_rbuf_t * rbuf, char *buf, int buf_len, char term)
 {
     FILE *logfile = MEDATA->logfile;
-    int i;
-    char c;
+    size_t max_len = (size_t) buf_len - 1;
+    size_t i = 0;
 
-    for (i = 0; i < buf_len - 1; i++, buf++)
+    while (i < max_len)
     {
-        if (read (sock, buf, sizeof (char)) <= 0)
-            return 0;
-        if (logfile)
+        const char *start;
+        const char *eol;
+        size_t n;
+
+        if (rbuf->pos == rbuf->len && !vfs_s_rbuf_fill (rbuf))
         {
-            size_t ret1;
-            int ret2;
-            ret1 = fwrite (buf, 1, 1, logfile);
-            ret2 = fflush (logfile);
-            (void) ret1;
-            (void) ret2;
+            buf[i] = '\0';
+            return 0;
         }
-        if (*buf == term)
+
+        start = rbuf->data + rbuf->pos;
+        n = MIN (rbuf->len - rbuf->pos, max_len - i);
+        eol = memchr (start, term, n);
+        if (eol != NULL)
+            n = (size_t) (eol - start) + 1;
+
+        vfs_s_log_received (logfile, start, n);
+        memcpy (buf + i, start, n);
+        rbuf->pos += n;
+        i += n;
+
+        if (eol != NULL)
         {
-            *buf = 0;
+            buf[i - 1] = '\0';
             return 1;
         }
     }
 
     /* Line is too long - terminate buffer and discard the rest of line */
-    *buf = 0;
-    while (read (sock, &c, sizeof (c)) > 0)
+    buf[i] = '\0';
+    while (TRUE)
     {
-        if (logfile)
-        {
-            size_t ret1;
-            int ret2;
-            ret1 = fwrite (&c, 1, 1, logfile);
-            ret2 = fflush (logfile);
-            (void) ret1;
-            (void) ret2;
-        }
-        if (c == '\n')
+        const char *start;
+        const char *eol;
+        size_t n;
+
+        if (rbuf->pos == rbuf->len && !vfs_s_rbuf_fill (rbuf))
+            return 0;
+
+        start = rbuf->data + rbuf->pos;
+        n = rbuf->len - rbuf->pos;
+        eol = memchr (start, '\n', n);
+        if (eol != NULL)
+            n = (size_t) (eol - start) + 1;
+
+        vfs_s_log_received (logfile, start, n);
+        rbuf->pos += n;
+
+        if (eol != NULL)
             return 1;
     }
-    return 0;
 }
 
 /* --------------------------------------------------------------------------------------------- */
+/**
+ * Get one '\n'-terminated line from the connection. Reading can be interrupted by user.
+ *
+ * @return 1 if line is read, EINTR if interrupted, 0 on EOF, error or too long line
+ */
 
 int
-vfs_s_get_line_interruptible (struct vfs_class *me, char *buffer, int size, int fd)
+vfs_s_get_line_interruptible (struct vfs_class *me, vfs_s_rbuf_t * rbuf, char *buffer, int size)
 {
-    int i;
+    size_t max_len = (size_t) size - 1;
+    size_t i = 0;
     int res = 0;
 
     (void) me;
 
     tty_enable_interrupt_key ();
 
-    for (i = 0; i < size - 1; i++)
+    while (i < max_len)
     {
-        ssize_t n;
+        const char *start;
+        const char *eol;
+        size_t n;
 
-        n = read (fd, &buffer[i], 1);
-        if (n == -1 && errno == EINTR)
-        {
-            buffer[i] = '\0';
-            res = EINTR;
-            goto ret;
-        }
-        if (n == 0)
+        if (rbuf->pos == rbuf->len && !vfs_s_rbuf_fill (rbuf))
         {
-            buffer[i] = '\0';
-            goto ret;
+            if (errno == EINTR)
+                res = EINTR;
+            break;
         }
-        if (buffer[i] == '\n')
+
+        start = rbuf->data + rbuf->pos;
+        n = MIN (rbuf->len - rbuf->pos, max_len - i);
+        eol = memchr (start, '\n', n);
+        if (eol != NULL)
+            n = (size_t) (eol - start) + 1;
+
+        memcpy (buffer + i, start, n);
+        rbuf->pos += n;
+        i += n;
+
+        if (eol != NULL)
         {
-            buffer[i] = '\0';
+            i--;
             res = 1;
-            goto ret;
+            break;
         }
     }
 
-    buffer[size - 1] = '\0';
+    buffer[i] = '\0';
 
-  ret:
     tty_disable_interrupt_key ();
 
     return res;
@@ -1625,6 +1874,9 @@ vfs_s_normalize_filename_leading_spaces (struct vfs_s_inode *root_inode, size_t
 {
     GList *iter;
 
+    /* entries are renamed here */
+    vfs_s_free_subdir_index (root_inode);
+
     for (iter = root_inode->subdir; iter != NULL; iter = g_list_next (iter))
     {
         struct vfs_s_entry *entry = (struct vfs_s_entry *) iter->data;
@@ -517,6 +517,72 @@ mc_readdir (DIR * dirp)
     return (entry != NULL) ? mc_readdir_result : NULL;
 }
 
+/* --------------------------------------------------------------------------------------------- */
+/**
+ * Read next entries of directory together with their attributes.
+ * Entry names are converted from VFS encoding and must be freed by caller.
+ *
+ * @param dirp directory opened by mc_opendir()
+ * @param entries array to store entries to
+ * @param count size of @entries
+ *
+ * @return number of entries stored, 0 at the end of directory, -1 on error.
+ *         If VFS class doesn't support this method, errno is E_NOTSUPP: use mc_readdir() then
+ */
+
+int
+mc_readdir_plus (DIR * dirp, vfs_dirent_plus_t * entries, int count)
+{
+    int handle;
+    struct vfs_class *vfs;
+    void *fsinfo = NULL;
+    vfs_path_element_t *vfs_path_element;
+    int n;
+
+    if (dirp == NULL)
+    {
+        errno = EFAULT;
+        return -1;
+    }
+    handle = *(int *) dirp;
+
+    vfs = vfs_class_find_by_handle (handle, &fsinfo);
+    if (vfs == NULL || fsinfo == NULL)
+        return -1;
+
+    if (vfs->readdir_plus == NULL)
+    {
+        errno = E_NOTSUPP;
+        return -1;
+    }
+
+    vfs_path_element = (vfs_path_element_t *) fsinfo;
+    n = (*vfs->readdir_plus) (vfs_path_element->dir.info, entries, count);
+    if (n == -1)
+    {
+        errno = vfs_ferrno (vfs);
+        return -1;
+    }
+
+#ifdef HAVE_CHARSET
+    if (vfs_path_element->dir.converter != str_cnv_not_convert)
+    {
+        int i;
+
+        for (i = 0; i < n; i++)
+        {
+            g_string_set_size (vfs_str_buffer, 0);
+            str_vfs_convert_from (vfs_path_element->dir.converter, entries[i].name,
+                                  vfs_str_buffer);
+            g_free (entries[i].name);
+            entries[i].name = g_strndup (vfs_str_buffer->str, vfs_str_buffer->len);
+        }
+    }
+#endif
+
+    return n;
+}
+
 /* --------------------------------------------------------------------------------------------- */
 
 int
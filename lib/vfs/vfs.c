@@ -44,6 +44,15 @@
 
 #include <errno.h>
 #include <stdlib.h>
+#ifdef HAVE_SYS_IOCTL_H
+#include <sys/ioctl.h>
+#endif
+#ifdef HAVE_LINUX_FS_H
+#include <linux/fs.h>           /* FICLONE */
+#endif
+#ifdef HAVE_SYS_SENDFILE_H
+#include <sys/sendfile.h>
+#endif
 
 #include "lib/global.h"
 #include "lib/strutil.h"
@@ -212,6 +221,22 @@ vfs_test_current_dir (const vfs_path_t * vpath)
             && my_stat.st_ino == my_stat2.st_ino && my_stat.st_dev == my_stat2.st_dev);
 }
 
+/* --------------------------------------------------------------------------------------------- */
+/**
+ * Get descriptors of local files underlying VFS handles.
+ *
+ * @return TRUE if both handles belong to local filesystem
+ */
+
+static gboolean
+vfs_get_local_fds (int dest_vfs_fd, int src_vfs_fd, int *dest_fd, int *src_fd)
+{
+    *dest_fd = vfs_local_fd (dest_vfs_fd);
+    *src_fd = vfs_local_fd (src_vfs_fd);
+
+    return (*dest_fd != -1 && *src_fd != -1);
+}
+
 
 /* --------------------------------------------------------------------------------------------- */
 /*** public functions ****************************************************************************/
@@ -615,6 +640,26 @@ _vfs_get_cwd (void)
     return g_strdup (vfs_path_as_str (current_dir_vpath));
 }
 
+/* --------------------------------------------------------------------------------------------- */
+/**
+ * Get descriptor of local file underlying VFS handle.
+ *
+ * @return file descriptor, -1 if handle doesn't belong to local filesystem
+ */
+
+int
+vfs_local_fd (int handle)
+{
+    struct vfs_class *vclass;
+    void *fsinfo = NULL;
+
+    vclass = vfs_class_find_by_handle (handle, &fsinfo);
+    if (vclass == NULL || (vclass->flags & VFSF_LOCAL) == 0 || fsinfo == NULL)
+        return -1;
+
+    return *(int *) fsinfo;
+}
+
 /* --------------------------------------------------------------------------------------------- */
 /**
  * Preallocate space for file in new place for ensure that file
@@ -657,3 +702,112 @@ vfs_preallocate (int dest_vfs_fd, off_t src_fsize, off_t dest_fsize)
 }
 
 /* --------------------------------------------------------------------------------------------- */
+/**
+ * Make the destination file share data blocks with the source file (reflink).
+ * Both files must be local and reside on the same filesystem which supports
+ * cloning (btrfs, XFS, ...). The whole content of destination is replaced.
+ *
+ * @return 0 on success, -1 otherwise
+ */
+
+int
+vfs_clone_file (int dest_vfs_fd, int src_vfs_fd)
+{
+#ifdef FICLONE
+    int dest_fd, src_fd;
+
+    if (!vfs_get_local_fds (dest_vfs_fd, src_vfs_fd, &dest_fd, &src_fd))
+        return -1;
+
+    return ioctl (dest_fd, FICLONE, src_fd) == 0 ? 0 : -1;
+#else
+    (void) dest_vfs_fd;
+    (void) src_vfs_fd;
+
+    return -1;
+#endif /* FICLONE */
+}
+
+/* --------------------------------------------------------------------------------------------- */
+/**
+ * Get the best method of copying data between files in the kernel.
+ *
+ * @return VFS_COPY_NONE if files should be copied through user space buffer
+ */
+
+vfs_copy_method_t
+vfs_copy_method (int dest_vfs_fd, int src_vfs_fd)
+{
+    int dest_fd, src_fd;
+
+    if (!vfs_get_local_fds (dest_vfs_fd, src_vfs_fd, &dest_fd, &src_fd))
+        return VFS_COPY_NONE;
+
+#if defined (HAVE_COPY_FILE_RANGE)
+    return VFS_COPY_RANGE;
+#elif defined (HAVE_SENDFILE) && defined (HAVE_SYS_SENDFILE_H)
+    return VFS_COPY_SENDFILE;
+#else
+    return VFS_COPY_NONE;
+#endif
+}
+
+/* --------------------------------------------------------------------------------------------- */
+/**
+ * Copy next chunk of data from current position of source file to current position
+ * of destination file in the kernel, without bouncing data through user space.
+ *
+ * If current method is not supported for these files (cross-device copy, old kernel,
+ * special filesystem), next one is tried and @method is updated.
+ *
+ * @param method in: method returned by vfs_copy_method(); out: method which works
+ * @return number of copied bytes, 0 at end of source file, -1 on error or
+ *         if no method works (*method is VFS_COPY_NONE then).
+ *         Nothing is copied if -1 is returned.
+ *         Some filesystems return 0 before end of file: if less data than expected has been
+ *         copied, caller should continue with mc_read().
+ */
+
+ssize_t
+vfs_copy_chunk (int dest_vfs_fd, int src_vfs_fd, size_t count, vfs_copy_method_t * method)
+{
+    int dest_fd, src_fd;
+    ssize_t ret = -1;
+
+    if (!vfs_get_local_fds (dest_vfs_fd, src_vfs_fd, &dest_fd, &src_fd))
+    {
+        *method = VFS_COPY_NONE;
+        return -1;
+    }
+
+#ifdef HAVE_COPY_FILE_RANGE
+    if (*method == VFS_COPY_RANGE)
+    {
+        ret = copy_file_range (src_fd, NULL, dest_fd, NULL, count, 0);
+        if (ret >= 0)
+            return ret;
+
+        if (errno != EXDEV && errno != ENOSYS && errno != EINVAL && errno != EOPNOTSUPP)
+            return -1;
+
+        *method = VFS_COPY_SENDFILE;
+    }
+#endif /* HAVE_COPY_FILE_RANGE */
+
+#if defined (HAVE_SENDFILE) && defined (HAVE_SYS_SENDFILE_H)
+    if (*method == VFS_COPY_SENDFILE)
+    {
+        ret = sendfile (dest_fd, src_fd, NULL, count);
+        if (ret >= 0)
+            return ret;
+
+        if (errno != ENOSYS && errno != EINVAL)
+            return -1;
+    }
+#endif /* HAVE_SENDFILE && HAVE_SYS_SENDFILE_H */
+
+    *method = VFS_COPY_NONE;
+    return ret;
+}
+
+/* --------------------------------------------------------------------------------------------- */
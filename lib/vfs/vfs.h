@@ -115,6 +115,14 @@ typedef enum
     VFSF_NOLINKS = 1 << 1       /* Hard links not supported */
 } vfs_class_flags_t;
 
+/* Methods of copying data between local files in the kernel, see vfs_copy_chunk() */
+typedef enum
+{
+    VFS_COPY_NONE = 0,          /* Copy through user space buffer */
+    VFS_COPY_RANGE,             /* copy_file_range() */
+    VFS_COPY_SENDFILE           /* sendfile() */
+} vfs_copy_method_t;
+
 /* Operations for mc_ctl - on open file */
 enum
 {
@@ -136,6 +144,15 @@ enum
 
 /*** structures declarations (and typedefs of structures)*****************************************/
 
+/* Directory entry together with its attributes, see readdir_plus method of vfs_class */
+typedef struct
+{
+    char *name;                 /* Entry name, newly allocated */
+    struct stat st;             /* lstat() of entry, zeroed if it isn't available */
+    gboolean link_to_dir;       /* Entry is a symlink to directory */
+    gboolean stale_link;        /* Entry is a symlink to nowhere */
+} vfs_dirent_plus_t;
+
 typedef struct vfs_class
 {
     const char *name;           /* "FIles over SHell" */
@@ -169,6 +186,14 @@ typedef struct vfs_class
     void *(*readdir) (void *vfs_info);
     int (*closedir) (void *vfs_info);
 
+    /**
+     * Optional. The readdir_plus() method shall read up to count next entries of
+     * directory opened by opendir() together with their attributes, so caller doesn't
+     * need to stat each entry by path. "." and ".." are not reported.
+     * Returns number of entries stored, 0 at the end of directory or -1 on error.
+     */
+    int (*readdir_plus) (void *vfs_info, vfs_dirent_plus_t * entries, int count);
+
     int (*stat) (const vfs_path_t * vpath, struct stat * buf);
     int (*lstat) (const vfs_path_t * vpath, struct stat * buf);
     int (*fstat) (void *vfs_info, struct stat * buf);
@@ -285,7 +310,12 @@ void vfs_free_handle (int handle);
 void vfs_setup_cwd (void);
 char *_vfs_get_cwd (void);
 
+int vfs_local_fd (int handle);
 int vfs_preallocate (int dest_desc, off_t src_fsize, off_t dest_fsize);
+int vfs_clone_file (int dest_vfs_fd, int src_vfs_fd);
+vfs_copy_method_t vfs_copy_method (int dest_vfs_fd, int src_vfs_fd);
+ssize_t vfs_copy_chunk (int dest_vfs_fd, int src_vfs_fd, size_t count,
+                        vfs_copy_method_t * method);
 
 /**
  * Interface functions described in interface.c
@@ -298,6 +328,7 @@ int mc_close (int handle);
 off_t mc_lseek (int fd, off_t offset, int whence);
 DIR *mc_opendir (const vfs_path_t * vpath);
 struct dirent *mc_readdir (DIR * dirp);
+int mc_readdir_plus (DIR * dirp, vfs_dirent_plus_t * entries, int count);
 int mc_closedir (DIR * dir);
 int mc_stat (const vfs_path_t * vpath, struct stat *buf);
 int mc_mknod (const vfs_path_t * vpath, mode_t mode, dev_t dev);
@@ -46,6 +46,9 @@
 #define LS_LINEAR_OPEN 2
 #define LS_LINEAR_PREOPEN 3
 
+/* Directories with more entries than this get a name->entry hash index on first lookup */
+#define VFS_S_SUBDIR_INDEX_MIN 16
+
 /*** enums ***************************************************************************************/
 
 /* For vfs_s_subclass->flags */
@@ -58,6 +61,15 @@ typedef enum
 
 /*** structures declarations (and typedefs of structures)*****************************************/
 
+/* Receive buffer of network connection. Filled by large reads and split into lines */
+typedef struct
+{
+    int sock;                   /* Socket the data is received from */
+    size_t pos;                 /* Start of not consumed data */
+    size_t len;                 /* End of received data */
+    char data[BUF_8K];
+} vfs_s_rbuf_t;
+
 /* Single connection or archive */
 struct vfs_s_super
 {
@@ -69,6 +81,7 @@ struct vfs_s_super
     int want_stale;             /* If set, we do not flush cache properly */
 #ifdef ENABLE_VFS_NET
     vfs_path_element_t *path_element;
+    vfs_s_rbuf_t *rbuf;         /* Receive buffer of control connection */
 #endif                          /* ENABLE_VFS_NET */
 
     void *data;                 /* This is for filesystem-specific use */
@@ -93,6 +106,7 @@ struct vfs_s_inode
                                    use only for directories because they
                                    cannot be hardlinked */
     GList *subdir;              /* If this is a directory, its entry. List of vfs_s_entry */
+    GHashTable *subdir_index;   /* Optional name -> vfs_s_entry index of subdir, built lazily */
     struct stat st;             /* Parameters of this inode */
     char *linkname;             /* Symlink's contents */
     char *localname;            /* Filename of local file, if we have one */
@@ -185,8 +199,12 @@ char *vfs_s_fullpath (struct vfs_class *me, struct vfs_s_inode *ino);
 
 /* network filesystems support */
 int vfs_s_select_on_two (int fd1, int fd2);
-int vfs_s_get_line (struct vfs_class *me, int sock, char *buf, int buf_len, char term);
-int vfs_s_get_line_interruptible (struct vfs_class *me, char *buffer, int size, int fd);
+vfs_s_rbuf_t *vfs_s_rbuf_new (int sock);
+void vfs_s_rbuf_reset (vfs_s_rbuf_t * rbuf, int sock);
+ssize_t vfs_s_rbuf_read (vfs_s_rbuf_t * rbuf, void *buf, size_t count);
+int vfs_s_get_line (struct vfs_class *me, vfs_s_rbuf_t * rbuf, char *buf, int buf_len, char term);
+int vfs_s_get_line_interruptible (struct vfs_class *me, vfs_s_rbuf_t * rbuf, char *buffer,
+                                  int size);
 /* misc */
 int vfs_s_retrieve_file (struct vfs_class *me, struct vfs_s_inode *ino);
 
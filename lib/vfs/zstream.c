@@ -0,0 +1,1066 @@
+/*
+   Virtual File System: in-process decompression of archives
+
+   Copyright (C) 2017
+   Free Software Foundation, Inc.
+
+   This file is part of the Midnight Commander.
+
+   The Midnight Commander is free software: you can redistribute it
+   and/or modify it under the terms of the GNU General Public License as
+   published by the Free Software Foundation, either version 3 of the License,
+   or (at your option) any later version.
+
+   The Midnight Commander is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/**
+ * \file
+ * \brief Source: Virtual File System: in-process decompression of archives
+ *
+ * Compressed archive is decompressed on the fly while it is read, so archive
+ * filesystems can parse headers without unpacking the whole archive to
+ * a temporary file first.
+ *
+ * Decompressed data can be read in any order. Decoder state is saved at
+ * checkpoints while data is decompressed for the first time: at start of each
+ * compressed stream (gzip member, xz stream, bzip2 stream, zstd frame) and,
+ * if decoder is able to copy its state (zlib), after each ZSTREAM_CHECKPOINT_SPAN
+ * bytes. Seek restores the nearest checkpoint before the requested position
+ * and decompresses the rest. Recently decompressed data is kept, so short seeks
+ * backward (cpio looks for headers so) don't need decompression at all.
+ *
+ * Cost of seek is bounded:
+ * - no more than ZSTREAM_STATES_MAX decoder states are kept. When there are more,
+ *   every other one is freed and the distance between them is doubled, so seek
+ *   decompresses at most MAX (ZSTREAM_CHECKPOINT_SPAN, 2 * size / ZSTREAM_STATES_MAX)
+ *   bytes of data decompressed so far;
+ * - decoders which can't copy their state (xz, lzma, bzip2, zstd) restart at
+ *   the start of stream. If the target is farther than ZSTREAM_CHECKPOINT_SPAN from it,
+ *   data is decompressed from the beginning once more into a temporary file, and
+ *   afterwards all data before decoder position is read from that file. So each
+ *   byte is decompressed at most twice, no matter how the archive is read.
+ */
+
+#include <config.h>
+
+#include <errno.h>
+#include <string.h>
+#include <unistd.h>
+
+#ifdef HAVE_ZLIB
+#include <zlib.h>
+#endif
+#ifdef HAVE_LZMA
+#include <lzma.h>
+#endif
+#ifdef HAVE_BZLIB
+#include <bzlib.h>
+#endif
+#ifdef HAVE_ZSTD
+#include <zstd.h>
+#endif
+
+#include "lib/global.h"
+#include "lib/util.h"           /* enum compression_type */
+
+#include "vfs.h"
+#include "zstream.h"
+
+/*** global variables ****************************************************************************/
+
+/*** file scope macro definitions ****************************************************************/
+
+#define ZSTREAM_BUF_SIZE (64 * 1024)
+
+/* Maximal amount of data decompressed by one call of decoder */
+#define ZSTREAM_MAX_CHUNK (1024 * 1024)
+
+/* Initial distance between checkpoints with saved decoder state */
+#define ZSTREAM_CHECKPOINT_SPAN (4 * 1024 * 1024)
+
+/* Maximal number of saved decoder states (about 40K each for zlib) */
+#define ZSTREAM_STATES_MAX 64
+
+/* Amount of recently decompressed data kept for seeks backward */
+#define ZSTREAM_HISTORY_SIZE (64 * 1024)
+
+/*** file scope type declarations ****************************************************************/
+
+typedef enum
+{
+    ZSTREAM_OK,
+    ZSTREAM_END,                /* end of compressed stream */
+    ZSTREAM_ERROR
+} zstream_status_t;
+
+typedef struct
+{
+    off_t pos;                  /* position in decompressed data */
+    off_t in_offset;            /* offset of the next byte of compressed data */
+    void *state;                /* saved decoder state, NULL at start of compressed stream */
+} zstream_checkpoint_t;
+
+typedef struct
+{
+    size_t decoder_size;
+    gboolean (*init) (vfs_zstream_t * zs);
+    zstream_status_t (*decode) (vfs_zstream_t * zs, char *out, size_t out_len, size_t * produced);
+    void (*end) (vfs_zstream_t * zs);
+    /* optional, NULL if decoder is not able to copy its state */
+    void *(*save) (vfs_zstream_t * zs);
+    gboolean (*restore) (vfs_zstream_t * zs, const void *state);
+    void (*free_state) (void *state);
+} zstream_codec_t;
+
+struct vfs_zstream_struct
+{
+    int fd;                     /* VFS handle of compressed file */
+    const zstream_codec_t *codec;       /* NULL if file is not compressed */
+    void *decoder;
+    gboolean active;            /* decoder is initialized */
+    gboolean stream_start;      /* nothing is decompressed from current stream yet */
+
+    char *in;                   /* buffer of compressed data */
+    const char *in_next;
+    size_t in_avail;
+    gboolean in_eof;
+    off_t in_offset;            /* offset of in_next in compressed file */
+
+    off_t pos;                  /* position in decompressed data */
+    off_t dec_pos;              /* position of data which decoder produces next */
+    gboolean eof;
+
+    char *history;              /* ring of recently decompressed data before dec_pos */
+    size_t history_len;
+
+    GArray *checkpoints;        /* sorted by position */
+    guint states_num;           /* number of checkpoints with saved decoder state */
+    off_t checkpoint_span;      /* distance between checkpoints with saved decoder state */
+    char *skip;                 /* buffer for data skipped by seek */
+
+    int spill_fd;               /* temporary file with all data before dec_pos, or -1 */
+};
+
+/*** file scope variables ************************************************************************/
+
+/*** file scope functions ************************************************************************/
+/* --------------------------------------------------------------------------------------------- */
+
+static void
+zstream_consumed (vfs_zstream_t * zs, size_t n)
+{
+    zs->in_next += n;
+    zs->in_avail -= n;
+    zs->in_offset += n;
+}
+
+/* --------------------------------------------------------------------------------------------- */
+
+static zstream_status_t
+zstream_error_if (gboolean error)
+{
+    return error ? ZSTREAM_ERROR : ZSTREAM_OK;
+}
+
+/* --------------------------------------------------------------------------------------------- */
+
+#ifdef HAVE_ZLIB
+static gboolean
+zstream_gzip_init (vfs_zstream_t * zs)
+{
+    z_stream *s = (z_stream *) zs->decoder;
+
+    memset (s, 0, sizeof (*s));
+    /* accept gzip header only */
+    return (inflateInit2 (s, MAX_WBITS + 16) == Z_OK);
+}
+
+/* --------------------------------------------------------------------------------------------- */
+
+static zstream_status_t
+zstream_gzip_decode (vfs_zstream_t * zs, char *out, size_t out_len, size_t * produced)
+{
+    z_stream *s = (z_stream *) zs->decoder;
+    int r;
+
+    s->next_in = (Bytef *) zs->in_next;
+    s->avail_in = (uInt) zs->in_avail;
+    s->next_out = (Bytef *) out;
+    s->avail_out = (uInt) out_len;
+
+    r = inflate (s, Z_NO_FLUSH);
+
+    zstream_consumed (zs, zs->in_avail - s->avail_in);
+    *produced = out_len - s->avail_out;
+
+    if (r == Z_STREAM_END)
+        return ZSTREAM_END;
+    return zstream_error_if (r != Z_OK && r != Z_BUF_ERROR);
+}
+
+/* --------------------------------------------------------------------------------------------- */
+
+static void
+zstream_gzip_end (vfs_zstream_t * zs)
+{
+    inflateEnd ((z_stream *) zs->decoder);
+}
+
+/* --------------------------------------------------------------------------------------------- */
+
+static void *
+zstream_gzip_save (vfs_zstream_t * zs)
+{
+    z_stream *copy;
+
+    copy = g_new0 (z_stream, 1);
+    if (inflateCopy (copy, (z_stream *) zs->decoder) != Z_OK)
+        MC_PTR_FREE (copy);
+
+    return copy;
+}
+
+/* --------------------------------------------------------------------------------------------- */
+
+static gboolean
+zstream_gzip_restore (vfs_zstream_t * zs, const void *state)
+{
+    return (inflateCopy ((z_stream *) zs->decoder, (z_stream *) state) == Z_OK);
+}
+
+/* --------------------------------------------------------------------------------------------- */
+
+static void
+zstream_gzip_free_state (void *state)
+{
+    inflateEnd ((z_stream *) state);
+    g_free (state);
+}
+#endif /* HAVE_ZLIB */
+
+/* --------------------------------------------------------------------------------------------- */
+
+#ifdef HAVE_LZMA
+static gboolean
+zstream_xz_init (vfs_zstream_t * zs)
+{
+    lzma_stream *s = (lzma_stream *) zs->decoder;
+
+    memset (s, 0, sizeof (*s));
+    return (lzma_stream_decoder (s, UINT64_MAX, 0) == LZMA_OK);
+}
+
+/* --------------------------------------------------------------------------------------------- */
+
+static gboolean
+zstream_lzma_init (vfs_zstream_t * zs)
+{
+    lzma_stream *s = (lzma_stream *) zs->decoder;
+
+    memset (s, 0, sizeof (*s));
+    return (lzma_alone_decoder (s, UINT64_MAX) == LZMA_OK);
+}
+
+/* --------------------------------------------------------------------------------------------- */
+
+static zstream_status_t
+zstream_xz_decode (vfs_zstream_t * zs, char *out, size_t out_len, size_t * produced)
+{
+    lzma_stream *s = (lzma_stream *) zs->decoder;
+    lzma_ret r;
+
+    s->next_in = (const uint8_t *) zs->in_next;
+    s->avail_in = zs->in_avail;
+    s->next_out = (uint8_t *) out;
+    s->avail_out = out_len;
+
+    r = lzma_code (s, LZMA_RUN);
+
+    zstream_consumed (zs, zs->in_avail - s->avail_in);
+    *produced = out_len - s->avail_out;
+
+    if (r == LZMA_STREAM_END)
+        return ZSTREAM_END;
+    return zstream_error_if (r != LZMA_OK && r != LZMA_BUF_ERROR);
+}
+
+/* --------------------------------------------------------------------------------------------- */
+
+static void
+zstream_xz_end (vfs_zstream_t * zs)
+{
+    lzma_end ((lzma_stream *) zs->decoder);
+}
+#endif /* HAVE_LZMA */
+
+/* --------------------------------------------------------------------------------------------- */
+
+#ifdef HAVE_BZLIB
+static gboolean
+zstream_bzip2_init (vfs_zstream_t * zs)
+{
+    bz_stream *s = (bz_stream *) zs->decoder;
+
+    memset (s, 0, sizeof (*s));
+    return (BZ2_bzDecompressInit (s, 0, 0) == BZ_OK);
+}
+
+/* --------------------------------------------------------------------------------------------- */
+
+static zstream_status_t
+zstream_bzip2_decode (vfs_zstream_t * zs, char *out, size_t out_len, size_t * produced)
+{
+    bz_stream *s = (bz_stream *) zs->decoder;
+    int r;
+
+    s->next_in = (char *) zs->in_next;
+    s->avail_in = (unsigned int) zs->in_avail;
+    s->next_out = out;
+    s->avail_out = (unsigned int) out_len;
+
+    r = BZ2_bzDecompress (s);
+
+    zstream_consumed (zs, zs->in_avail - s->avail_in);
+    *produced = out_len - s->avail_out;
+
+    if (r == BZ_STREAM_END)
+        return ZSTREAM_END;
+    return zstream_error_if (r != BZ_OK);
+}
+
+/* --------------------------------------------------------------------------------------------- */
+
+static void
+zstream_bzip2_end (vfs_zstream_t * zs)
+{
+    BZ2_bzDecompressEnd ((bz_stream *) zs->decoder);
+}
+#endif /* HAVE_BZLIB */
+
+/* --------------------------------------------------------------------------------------------- */
+
+#ifdef HAVE_ZSTD
+static gboolean
+zstream_zstd_init (vfs_zstream_t * zs)
+{
+    ZSTD_DStream **ds = (ZSTD_DStream **) zs->decoder;
+
+    *ds = ZSTD_createDStream ();
+    if (*ds != NULL && ZSTD_isError (ZSTD_initDStream (*ds)))
+    {
+        ZSTD_freeDStream (*ds);
+        *ds = NULL;
+    }
+
+    return (*ds != NULL);
+}
+
+/* --------------------------------------------------------------------------------------------- */
+
+static zstream_status_t
+zstream_zstd_decode (vfs_zstream_t * zs, char *out, size_t out_len, size_t * produced)
+{
+    ZSTD_DStream *ds = *(ZSTD_DStream **) zs->decoder;
+    ZSTD_inBuffer in = { zs->in_next, zs->in_avail, 0 };
+    ZSTD_outBuffer o = { out, out_len, 0 };
+    size_t r;
+
+    r = ZSTD_decompressStream (ds, &o, &in);
+
+    zstream_consumed (zs, in.pos);
+    *produced = o.pos;
+
+    if (ZSTD_isError (r))
+        return ZSTREAM_ERROR;
+    /* frame is decoded and flushed */
+    return (r == 0) ? ZSTREAM_END : ZSTREAM_OK;
+}
+
+/* --------------------------------------------------------------------------------------------- */
+
+static void
+zstream_zstd_end (vfs_zstream_t * zs)
+{
+    ZSTD_DStream **ds = (ZSTD_DStream **) zs->decoder;
+
+    ZSTD_freeDStream (*ds);
+    *ds = NULL;
+}
+#endif /* HAVE_ZSTD */
+
+/* --------------------------------------------------------------------------------------------- */
+
+static const zstream_codec_t *
+zstream_get_codec (int type)
+{
+    /* *INDENT-OFF* */
+#ifdef HAVE_ZLIB
+    static const zstream_codec_t gzip_codec = {
+        sizeof (z_stream), zstream_gzip_init, zstream_gzip_decode, zstream_gzip_end,
+        zstream_gzip_save, zstream_gzip_restore, zstream_gzip_free_state
+    };
+#endif
+#ifdef HAVE_LZMA
+    static const zstream_codec_t xz_codec = {
+        sizeof (lzma_stream), zstream_xz_init, zstream_xz_decode, zstream_xz_end,
+        NULL, NULL, NULL
+    };
+    static const zstream_codec_t lzma_codec = {
+        sizeof (lzma_stream), zstream_lzma_init, zstream_xz_decode, zstream_xz_end,
+        NULL, NULL, NULL
+    };
+#endif
+#ifdef HAVE_BZLIB
+    static const zstream_codec_t bzip2_codec = {
+        sizeof (bz_stream), zstream_bzip2_init, zstream_bzip2_decode, zstream_bzip2_end,
+        NULL, NULL, NULL
+    };
+#endif
+#ifdef HAVE_ZSTD
+    static const zstream_codec_t zstd_codec = {
+        sizeof (ZSTD_DStream *), zstream_zstd_init, zstream_zstd_decode, zstream_zstd_end,
+        NULL, NULL, NULL
+    };
+#endif
+    /* *INDENT-ON* */
+
+    switch (type)
+    {
+#ifdef HAVE_ZLIB
+    case COMPRESSION_GZIP:
+        return &gzip_codec;
+#endif
+#ifdef HAVE_LZMA
+    case COMPRESSION_XZ:
+        return &xz_codec;
+    case COMPRESSION_LZMA:
+        return &lzma_codec;
+#endif
+#ifdef HAVE_BZLIB
+    case COMPRESSION_BZIP2:
+        return &bzip2_codec;
+#endif
+#ifdef HAVE_ZSTD
+    case COMPRESSION_ZSTD:
+        return &zstd_codec;
+#endif
+    default:
+        return NULL;
+    }
+}
+
+/* --------------------------------------------------------------------------------------------- */
+/**
+ * Free every other saved decoder state and double the distance between checkpoints,
+ * so saved states stay spread evenly over decompressed data. The last state is kept.
+ */
+
+static void
+zstream_thin_checkpoints (vfs_zstream_t * zs)
+{
+    gboolean drop;
+    guint i, j;
+
+    /* odd number of states: drop the second, the fourth, ... */
+    drop = (zs->states_num % 2) == 0;
+
+    for (i = 0, j = 0; i < zs->checkpoints->len; i++)
+    {
+        zstream_checkpoint_t *cp;
+
+        cp = &g_array_index (zs->checkpoints, zstream_checkpoint_t, i);
+        if (cp->state != NULL)
+        {
+            drop = !drop;
+            if (drop)
+            {
+                zs->codec->free_state (cp->state);
+                zs->states_num--;
+                continue;
+            }
+        }
+
+        g_array_index (zs->checkpoints, zstream_checkpoint_t, j++) = *cp;
+    }
+
+    g_array_set_size (zs->checkpoints, j);
+    zs->checkpoint_span *= 2;
+}
+
+/* --------------------------------------------------------------------------------------------- */
+/**
+ * Remember current position if it is start of compressed stream (boundary is TRUE)
+ * or if it is far enough from the previous checkpoint and decoder state can be saved.
+ */
+
+static void
+zstream_checkpoint (vfs_zstream_t * zs, gboolean boundary)
+{
+    zstream_checkpoint_t cp;
+
+    if (zs->checkpoints->len != 0)
+    {
+        const zstream_checkpoint_t *last;
+
+        last = &g_array_index (zs->checkpoints, zstream_checkpoint_t, zs->checkpoints->len - 1);
+        /* this part of data was already decompressed */
+        if (zs->dec_pos <= last->pos)
+            return;
+        if (!boundary && zs->dec_pos - last->pos < zs->checkpoint_span)
+            return;
+    }
+
+    cp.pos = zs->dec_pos;
+    cp.in_offset = zs->in_offset;
+    cp.state = NULL;
+
+    if (!boundary)
+    {
+        if (zs->codec->save == NULL)
+            return;
+        cp.state = zs->codec->save (zs);
+        if (cp.state == NULL)
+            return;
+    }
+
+    g_array_append_val (zs->checkpoints, cp);
+
+    if (cp.state != NULL)
+    {
+        zs->states_num++;
+        if (zs->states_num > ZSTREAM_STATES_MAX)
+            zstream_thin_checkpoints (zs);
+    }
+}
+
+/* --------------------------------------------------------------------------------------------- */
+/**
+ * Find the last checkpoint not after the position.
+ *
+ * @return checkpoint, NULL if there is no such one
+ */
+
+static const zstream_checkpoint_t *
+zstream_find_checkpoint (const vfs_zstream_t * zs, off_t pos)
+{
+    guint lo = 0, hi;
+
+    hi = zs->checkpoints->len;
+    while (lo < hi)
+    {
+        guint mid = (lo + hi) / 2;
+
+        if (g_array_index (zs->checkpoints, zstream_checkpoint_t, mid).pos <= pos)
+            lo = mid + 1;
+        else
+            hi = mid;
+    }
+
+    return (lo != 0) ? &g_array_index (zs->checkpoints, zstream_checkpoint_t, lo - 1) : NULL;
+}
+/* --------------------------------------------------------------------------------------------- */
+
+static gboolean
+zstream_restore (vfs_zstream_t * zs, const zstream_checkpoint_t * cp)
+{
+    if (mc_lseek (zs->fd, cp->in_offset, SEEK_SET) != cp->in_offset)
+        return FALSE;
+
+    zs->in_avail = 0;
+    zs->in_eof = FALSE;
+    zs->in_offset = cp->in_offset;
+    zs->pos = cp->pos;
+    zs->dec_pos = cp->pos;
+    zs->history_len = 0;
+    zs->eof = FALSE;
+
+    if (zs->active)
+    {
+        zs->codec->end (zs);
+        zs->active = FALSE;
+    }
+
+    /* without saved state decoder is started from scratch by zstream_decode() */
+    if (cp->state != NULL)
+    {
+        if (!zs->codec->restore (zs, cp->state))
+            return FALSE;
+        zs->active = TRUE;
+        zs->stream_start = FALSE;
+    }
+
+    return TRUE;
+}
+
+/* --------------------------------------------------------------------------------------------- */
+
+static void
+zstream_history_add (vfs_zstream_t * zs, const char *data, size_t len)
+{
+    off_t pos;
+
+    zs->history_len = MIN (zs->history_len + len, ZSTREAM_HISTORY_SIZE);
+
+    /* only the tail fits */
+    if (len > ZSTREAM_HISTORY_SIZE)
+    {
+        data += len - ZSTREAM_HISTORY_SIZE;
+        len = ZSTREAM_HISTORY_SIZE;
+    }
+
+    for (pos = zs->dec_pos - len; len != 0;)
+    {
+        size_t idx = (size_t) (pos % ZSTREAM_HISTORY_SIZE);
+        size_t chunk = MIN (len, ZSTREAM_HISTORY_SIZE - idx);
+
+        memcpy (zs->history + idx, data, chunk);
+        data += chunk;
+        len -= chunk;
+        pos += chunk;
+    }
+}
+
+/* --------------------------------------------------------------------------------------------- */
+/**
+ * Read data before decoder position from the history.
+ */
+
+static size_t
+zstream_history_read (vfs_zstream_t * zs, char *out, size_t count)
+{
+    size_t done = 0;
+
+    while (done < count && zs->pos < zs->dec_pos)
+    {
+        size_t idx = (size_t) (zs->pos % ZSTREAM_HISTORY_SIZE);
+        size_t chunk;
+
+        chunk = MIN (count - done, ZSTREAM_HISTORY_SIZE - idx);
+        chunk = MIN (chunk, (size_t) (zs->dec_pos - zs->pos));
+        memcpy (out + done, zs->history + idx, chunk);
+        done += chunk;
+        zs->pos += chunk;
+    }
+
+    return done;
+}
+
+/* --------------------------------------------------------------------------------------------- */
+/**
+ * Read data before decoder position from the temporary file.
+ */
+
+static ssize_t
+zstream_spill_read (vfs_zstream_t * zs, char *out, size_t count)
+{
+    size_t done = 0;
+
+    count = MIN (count, (size_t) (zs->dec_pos - zs->pos));
+    if (count == 0)
+        return 0;
+
+    if (lseek (zs->spill_fd, zs->pos, SEEK_SET) != zs->pos)
+        return -1;
+
+    while (done < count)
+    {
+        ssize_t n;
+
+        n = read (zs->spill_fd, out + done, count - done);
+        if (n <= 0)
+        {
+            if (n == 0)
+                errno = EIO;
+            return -1;
+        }
+        done += (size_t) n;
+    }
+
+    zs->pos += (off_t) done;
+    return (ssize_t) done;
+}
+
+/* --------------------------------------------------------------------------------------------- */
+/**
+ * Append just decompressed data to the temporary file.
+ */
+
+static gboolean
+zstream_spill_write (vfs_zstream_t * zs, const char *data, size_t len)
+{
+    off_t offset = zs->dec_pos - (off_t) len;
+
+    if (lseek (zs->spill_fd, offset, SEEK_SET) != offset)
+        return FALSE;
+
+    while (len != 0)
+    {
+        ssize_t n;
+
+        n = write (zs->spill_fd, data, len);
+        if (n <= 0)
+            return FALSE;
+        data += n;
+        len -= (size_t) n;
+    }
+
+    return TRUE;
+}
+
+/* --------------------------------------------------------------------------------------------- */
+/**
+ * Restart decompression from the beginning and keep all decompressed data
+ * in a temporary file from now on.
+ *
+ * @return TRUE on success, FALSE if stream is left as it was
+ */
+
+static gboolean
+zstream_spill_start (vfs_zstream_t * zs)
+{
+    vfs_path_t *tmp_vpath = NULL;
+    const zstream_checkpoint_t *first;
+    int fd;
+
+    first = &g_array_index (zs->checkpoints, zstream_checkpoint_t, 0);
+    if (first->pos != 0)
+        return FALSE;
+
+    fd = mc_mkstemps (&tmp_vpath, "zstream", NULL);
+    if (fd == -1)
+        return FALSE;
+
+    /* nobody else needs the name */
+    unlink (vfs_path_as_str (tmp_vpath));
+    vfs_path_free (tmp_vpath);
+
+    if (!zstream_restore (zs, first))
+    {
+        close (fd);
+        return FALSE;
+    }
+
+    zs->spill_fd = fd;
+    return TRUE;
+}
+
+/* --------------------------------------------------------------------------------------------- */
+
+static gboolean
+zstream_fill (vfs_zstream_t * zs)
+{
+    ssize_t n;
+
+    n = mc_read (zs->fd, zs->in, ZSTREAM_BUF_SIZE);
+    if (n < 0)
+        return FALSE;
+
+    zs->in_next = zs->in;
+    zs->in_avail = (size_t) n;
+    zs->in_eof = (n == 0);
+    return TRUE;
+}
+
+/* --------------------------------------------------------------------------------------------- */
+
+/**
+ * Decompress data at decoder position.
+ */
+
+static ssize_t
+zstream_decode (vfs_zstream_t * zs, char *out, size_t count)
+{
+    size_t done = 0;
+
+    while (done < count && !zs->eof)
+    {
+        size_t produced = 0;
+        zstream_status_t status;
+
+        if (zs->in_avail == 0 && !zs->in_eof && !zstream_fill (zs))
+            return (done != 0) ? (ssize_t) done : -1;
+
+        if (!zs->active)
+        {
+            if (zs->in_avail == 0)
+            {
+                zs->eof = TRUE;
+                break;
+            }
+            if (!zs->codec->init (zs))
+            {
+                errno = ENOMEM;
+                return (done != 0) ? (ssize_t) done : -1;
+            }
+            zs->active = TRUE;
+            zs->stream_start = TRUE;
+            zstream_checkpoint (zs, TRUE);
+        }
+
+        status = zs->codec->decode (zs, out + done, MIN (count - done, ZSTREAM_MAX_CHUNK),
+                                    &produced);
+        zs->dec_pos += produced;
+        zstream_history_add (zs, out + done, produced);
+        if (zs->spill_fd != -1 && produced != 0
+            && !zstream_spill_write (zs, out + done, produced))
+        {
+            /* data before dec_pos must be in the file */
+            zs->dec_pos -= produced;
+            zs->eof = TRUE;
+            errno = EIO;
+            return (done != 0) ? (ssize_t) done : -1;
+        }
+        done += produced;
+        if (produced != 0)
+            zs->stream_start = FALSE;
+
+        if (status == ZSTREAM_OK && produced == 0 && zs->in_avail == 0 && zs->in_eof)
+            status = ZSTREAM_ERROR;     /* truncated stream */
+
+        if (status == ZSTREAM_OK)
+            zstream_checkpoint (zs, FALSE);
+        else
+        {
+            zs->codec->end (zs);
+            zs->active = FALSE;
+
+            if (status == ZSTREAM_ERROR)
+            {
+                zs->eof = TRUE;
+                /* like gzip -d, ignore trailing garbage after the last stream */
+                if (!zs->stream_start || zs->dec_pos == 0)
+                {
+                    errno = EIO;
+                    return (done != 0) ? (ssize_t) done : -1;
+                }
+            }
+        }
+    }
+
+    return (ssize_t) done;
+}
+
+/* --------------------------------------------------------------------------------------------- */
+
+static gboolean
+zstream_is_gzip (int fd)
+{
+    unsigned char magic[2];
+
+    /* get_compression_type() returns COMPRESSION_GZIP for zip and compress files too */
+    return (mc_lseek (fd, 0, SEEK_SET) == 0 && mc_read (fd, (char *) magic, 2) == 2
+            && magic[0] == 037 && magic[1] == 0213);
+}
+
+/* --------------------------------------------------------------------------------------------- */
+/*** public functions ****************************************************************************/
+/* --------------------------------------------------------------------------------------------- */
+/**
+ * Start decompression of the file.
+ *
+ * @param fd VFS handle of the file, the stream takes ownership of it on success
+ * @param type compression type returned by get_compression_type()
+ *
+ * @return new stream positioned at start of decompressed data, NULL if this type
+ *         of compression is not supported (never for COMPRESSION_NONE).
+ *         Use #vfs_zstream_free() to free it.
+ */
+
+vfs_zstream_t *
+vfs_zstream_new (int fd, int type)
+{
+    const zstream_codec_t *codec = NULL;
+    vfs_zstream_t *zs;
+
+    if (type != COMPRESSION_NONE)
+    {
+        codec = zstream_get_codec (type);
+        if (codec == NULL || (type == COMPRESSION_GZIP && !zstream_is_gzip (fd)))
+            return NULL;
+    }
+
+    if (mc_lseek (fd, 0, SEEK_SET) != 0 && codec != NULL)
+        return NULL;
+
+    zs = g_new0 (vfs_zstream_t, 1);
+    zs->fd = fd;
+    zs->codec = codec;
+    zs->spill_fd = -1;
+
+    if (codec != NULL)
+    {
+        zs->decoder = g_malloc0 (codec->decoder_size);
+        zs->in = g_malloc (ZSTREAM_BUF_SIZE);
+        zs->in_next = zs->in;
+        zs->history = g_malloc (ZSTREAM_HISTORY_SIZE);
+        zs->checkpoints = g_array_new (FALSE, FALSE, sizeof (zstream_checkpoint_t));
+        zs->checkpoint_span = ZSTREAM_CHECKPOINT_SPAN;
+    }
+
+    return zs;
+}
+
+/* --------------------------------------------------------------------------------------------- */
+/**
+ * Free the stream and close the file.
+ */
+
+void
+vfs_zstream_free (vfs_zstream_t * zs)
+{
+    if (zs == NULL)
+        return;
+
+    if (zs->codec != NULL)
+    {
+        guint i;
+
+        if (zs->active)
+            zs->codec->end (zs);
+
+        for (i = 0; i < zs->checkpoints->len; i++)
+        {
+            zstream_checkpoint_t *cp;
+
+            cp = &g_array_index (zs->checkpoints, zstream_checkpoint_t, i);
+            if (cp->state != NULL)
+                zs->codec->free_state (cp->state);
+        }
+
+        g_array_free (zs->checkpoints, TRUE);
+        g_free (zs->decoder);
+        g_free (zs->in);
+        g_free (zs->history);
+        g_free (zs->skip);
+
+        if (zs->spill_fd != -1)
+            close (zs->spill_fd);
+    }
+
+    mc_close (zs->fd);
+    g_free (zs);
+}
+
+/* --------------------------------------------------------------------------------------------- */
+/**
+ * Read decompressed data like mc_read() does.
+ */
+
+ssize_t
+vfs_zstream_read (vfs_zstream_t * zs, void *buf, size_t count)
+{
+    size_t done;
+    ssize_t n;
+
+    if (zs->codec == NULL)
+        return mc_read (zs->fd, buf, count);
+
+    if (zs->spill_fd == -1)
+        done = zstream_history_read (zs, (char *) buf, count);
+    else
+    {
+        n = zstream_spill_read (zs, (char *) buf, count);
+        if (n < 0)
+            return -1;
+        done = (size_t) n;
+    }
+
+    if (done == count)
+        return (ssize_t) done;
+
+    n = zstream_decode (zs, (char *) buf + done, count - done);
+    if (n < 0)
+        return (done != 0) ? (ssize_t) done : -1;
+
+    zs->pos = zs->dec_pos;
+    return (ssize_t) done + n;
+}
+
+/* --------------------------------------------------------------------------------------------- */
+/**
+ * Set position in decompressed data like mc_lseek() does.
+ * SEEK_END is supported for uncompressed files only.
+ *
+ * @return new position, which is less than requested one if it is beyond end of data,
+ *         -1 on error
+ */
+
+off_t
+vfs_zstream_seek (vfs_zstream_t * zs, off_t offset, int whence)
+{
+    const zstream_checkpoint_t *cp;
+    off_t target;
+
+    if (zs->codec == NULL)
+        return mc_lseek (zs->fd, offset, whence);
+
+    switch (whence)
+    {
+    case SEEK_SET:
+        target = offset;
+        break;
+    case SEEK_CUR:
+        target = zs->pos + offset;
+        break;
+    default:
+        errno = EINVAL;
+        return -1;
+    }
+
+    if (target < 0)
+    {
+        errno = EINVAL;
+        return -1;
+    }
+
+    if (target <= zs->dec_pos
+        && (zs->spill_fd != -1 || target >= zs->dec_pos - (off_t) zs->history_len))
+    {
+        zs->pos = target;
+        return target;
+    }
+
+    /* with the temporary file, all data before decoder position is in it */
+    cp = (zs->spill_fd == -1) ? zstream_find_checkpoint (zs, target) : NULL;
+
+    /* decoder state can't be restored in the middle of stream: don't decompress much again */
+    if (cp != NULL && cp->state == NULL && zs->codec->save == NULL && target < zs->dec_pos
+        && target - cp->pos > ZSTREAM_CHECKPOINT_SPAN && zstream_spill_start (zs))
+        cp = NULL;
+
+    /* go back, or jump forward over already decompressed data */
+    if (cp != NULL && (target < zs->dec_pos || cp->pos > zs->dec_pos) && !zstream_restore (zs, cp))
+    {
+        zs->eof = TRUE;
+        errno = EIO;
+        return -1;
+    }
+
+    if (target < zs->dec_pos)
+    {
+        errno = EIO;
+        return -1;
+    }
+
+    while (zs->dec_pos < target)
+    {
+        if (zs->skip == NULL)
+            zs->skip = g_malloc (ZSTREAM_BUF_SIZE);
+
+        if (zstream_decode (zs, zs->skip, (size_t) MIN (target - zs->dec_pos, ZSTREAM_BUF_SIZE))
+            <= 0)
+            break;
+    }
+
+    zs->pos = zs->dec_pos;
+    return zs->pos;
+}
+
+/* --------------------------------------------------------------------------------------------- */
@@ -0,0 +1,32 @@
+/**
+ * \file
+ * \brief Header: Virtual File System: in-process decompression of archives
+ */
+
+#ifndef MC__VFS_ZSTREAM_H
+#define MC__VFS_ZSTREAM_H
+
+#include <sys/types.h>
+
+#include "lib/global.h"
+
+/*** typedefs(not structures) and defined constants **********************************************/
+
+typedef struct vfs_zstream_struct vfs_zstream_t;
+
+/*** enums ***************************************************************************************/
+
+/*** structures declarations (and typedefs of structures)*****************************************/
+
+/*** global variables defined in .c file *********************************************************/
+
+/*** declarations of public functions ************************************************************/
+
+vfs_zstream_t *vfs_zstream_new (int fd, int type);
+void vfs_zstream_free (vfs_zstream_t * zs);
+
+ssize_t vfs_zstream_read (vfs_zstream_t * zs, void *buf, size_t count);
+off_t vfs_zstream_seek (vfs_zstream_t * zs, off_t offset, int whence);
+
+/*** inline functions ****************************************************************************/
+#endif /* MC__VFS_ZSTREAM_H */
@@ -17,6 +17,7 @@ m4_include([m4.include/vfs/mc-vfs-fish.m4])
 m4_include([m4.include/vfs/mc-vfs-undelfs.m4])
 m4_include([m4.include/vfs/mc-vfs-tarfs.m4])
 m4_include([m4.include/vfs/mc-vfs-cpiofs.m4])
+m4_include([m4.include/vfs/mc-vfs-decompress.m4])
 m4_include([m4.include/vfs/mc-vfs-samba.m4])
 
 dnl mc_VFS_CHECKS
@@ -78,6 +79,7 @@ AC_DEFUN([mc_VFS_CHECKS],
     mc_VFS_SMB
     mc_VFS_TARFS
     mc_VFS_UNDELFS
+    mc_VFS_DECOMPRESS
 
     AM_CONDITIONAL(ENABLE_VFS, [test x"$enable_vfs" = x"yes"])
 
@@ -0,0 +1,36 @@
+dnl In-process decompression of tar and cpio archives
+AC_DEFUN([mc_VFS_DECOMPRESS],
+[
+    AC_ARG_WITH([decompress-libs],
+		AS_HELP_STRING([--with-decompress-libs], [Decompress tar and cpio archives by zlib, liblzma, libbz2 and libzstd if available @<:@yes@:>@]))
+
+    if test x"$enable_vfs_tar" = x"yes" -o x"$enable_vfs_cpio" = x"yes"; then
+	if test x"$with_decompress_libs" != x"no"; then
+	    PKG_CHECK_MODULES(ZLIB, [zlib], [found_zlib=yes], [:])
+	    if test x"$found_zlib" = x"yes"; then
+		AC_DEFINE([HAVE_ZLIB], [1], [Define to decompress gzip archives by zlib])
+		MCLIBS="$MCLIBS $ZLIB_LIBS"
+	    fi
+
+	    PKG_CHECK_MODULES(LZMA, [liblzma], [found_lzma=yes], [:])
+	    if test x"$found_lzma" = x"yes"; then
+		AC_DEFINE([HAVE_LZMA], [1], [Define to decompress xz and lzma archives by liblzma])
+		MCLIBS="$MCLIBS $LZMA_LIBS"
+	    fi
+
+	    PKG_CHECK_MODULES(ZSTD, [libzstd], [found_zstd=yes], [:])
+	    if test x"$found_zstd" = x"yes"; then
+		AC_DEFINE([HAVE_ZSTD], [1], [Define to decompress zstd archives by libzstd])
+		MCLIBS="$MCLIBS $ZSTD_LIBS"
+	    fi
+
+	    dnl libbz2 has no pkg-config file
+	    AC_CHECK_HEADER([bzlib.h],
+		[AC_CHECK_LIB([bz2], [BZ2_bzDecompressInit],
+		    [
+			AC_DEFINE([HAVE_BZLIB], [1], [Define to decompress bzip2 archives by libbz2])
+			MCLIBS="$MCLIBS -lbz2"
+		    ])])
+	fi
+    fi
+])
@@ -104,6 +104,7 @@ typedef struct edit_search_options_t
     gboolean backwards;
     gboolean only_in_selection;
     gboolean whole_words;
+    gboolean multiline;
     gboolean all_codepages;
 } edit_search_options_t;
 
@@ -160,6 +161,7 @@ void edit_update_curs_row (WEdit * edit);
 void edit_update_curs_col (WEdit * edit);
 void edit_find_bracket (WEdit * edit);
 gboolean edit_reload_line (WEdit * edit, const vfs_path_t * filename_vpath, long line);
+void edit_check_mapped_file (WEdit * edit);
 void edit_set_codeset (WEdit * edit);
 
 void edit_block_copy_cmd (WEdit * edit);
@@ -198,6 +200,8 @@ void edit_replace_cmd (WEdit * edit, gboolean again);
 void edit_search_cmd (WEdit * edit, gboolean again);
 mc_search_cbret_t edit_search_cmd_callback (const void *user_data, gsize char_offset,
                                             int *current_char);
+mc_search_cbret_t edit_search_block_callback (const void *user_data, gsize char_offset,
+                                              const char **block, gsize * block_len);
 mc_search_cbret_t edit_search_update_callback (const void *user_data, gsize char_offset);
 
 void edit_complete_word_cmd (WEdit * edit);
@@ -259,6 +263,8 @@ void edit_set_filename (WEdit * edit, const vfs_path_t * name_vpath);
 void edit_load_syntax (WEdit * edit, GPtrArray * pnames, const char *type);
 void edit_free_syntax_rules (WEdit * edit);
 int edit_get_syntax_color (WEdit * edit, off_t byte_index);
+void edit_syntax_changed (WEdit * edit, long line, int newlines);
+void edit_syntax_reset (WEdit * edit);
 
 void book_mark_insert (WEdit * edit, long line, int c);
 gboolean book_mark_query_color (WEdit * edit, long line, int c);
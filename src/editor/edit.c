@@ -95,6 +95,7 @@ gboolean option_state_full_filename = FALSE;
 gboolean enable_show_tabs_tws = TRUE;
 gboolean option_check_nl_at_eof = FALSE;
 gboolean option_group_undo = FALSE;
+gboolean option_piece_table = FALSE;
 gboolean show_right_margin = FALSE;
 
 char *option_backup_ext = NULL;
@@ -195,6 +196,24 @@ edit_load_file_fast (edit_buffer_t * buf, const vfs_path_t * filename_vpath)
         return FALSE;
     }
 
+    /* don't read local file, map it */
+    if (buf->pieces != NULL)
+    {
+        int fd;
+
+        fd = open (vfs_path_get_last_path_str (filename_vpath), O_RDONLY | O_BINARY);
+        if (fd >= 0)
+        {
+            ret = edit_buffer_map_file (buf, fd, buf->size);
+            close (fd);
+            if (ret)
+            {
+                mc_close (file);
+                return TRUE;
+            }
+        }
+    }
+
     rsm.first = TRUE;
     rsm.buf = buf;
     rsm.loaded = 0;
@@ -619,8 +638,6 @@ get_prev_undo_action (WEdit * edit)
 static void
 edit_modification (WEdit * edit)
 {
-    edit->caches_valid = FALSE;
-
     /* raise lock when file modified */
     if (!edit->modified && !edit->delete_file)
         edit->locked = lock_file (edit->filename_vpath);
@@ -676,60 +693,6 @@ is_blank (const edit_buffer_t * buf, off_t offset)
     return TRUE;
 }
 
-/* --------------------------------------------------------------------------------------------- */
-/** returns the offset of line i */
-
-static off_t
-edit_find_line (WEdit * edit, long line)
-{
-    long i, j = 0;
-    long m = 2000000000;        /* what is the magic number? */
-
-    if (!edit->caches_valid)
-    {
-        memset (edit->line_numbers, 0, sizeof (edit->line_numbers));
-        memset (edit->line_offsets, 0, sizeof (edit->line_offsets));
-        /* three offsets that we *know* are line 0 at 0 and these two: */
-        edit->line_numbers[1] = edit->buffer.curs_line;
-        edit->line_offsets[1] = edit_buffer_get_current_bol (&edit->buffer);
-        edit->line_numbers[2] = edit->buffer.lines;
-        edit->line_offsets[2] = edit_buffer_get_bol (&edit->buffer, edit->buffer.size);
-        edit->caches_valid = TRUE;
-    }
-    if (line >= edit->buffer.lines)
-        return edit->line_offsets[2];
-    if (line <= 0)
-        return 0;
-    /* find the closest known point */
-    for (i = 0; i < N_LINE_CACHES; i++)
-    {
-        long n;
-
-        n = labs (edit->line_numbers[i] - line);
-        if (n < m)
-        {
-            m = n;
-            j = i;
-        }
-    }
-    if (m == 0)
-        return edit->line_offsets[j];   /* know the offset exactly */
-    if (m == 1 && j >= 3)
-        i = j;                  /* one line different - caller might be looping, so stay in this cache */
-    else
-        i = 3 + (rand () % (N_LINE_CACHES - 3));
-    if (line > edit->line_numbers[j])
-        edit->line_offsets[i] =
-            edit_buffer_get_forward_offset (&edit->buffer, edit->line_offsets[j],
-                                            line - edit->line_numbers[j], 0);
-    else
-        edit->line_offsets[i] =
-            edit_buffer_get_backward_offset (&edit->buffer, edit->line_offsets[j],
-                                             edit->line_numbers[j] - line);
-    edit->line_numbers[i] = line;
-    return edit->line_offsets[i];
-}
-
 /* --------------------------------------------------------------------------------------------- */
 /** moves up until a blank line is reached, or until just
    before a non-blank line is reached */
@@ -776,6 +739,8 @@ edit_move_down_paragraph (WEdit * edit, gboolean do_scroll)
 {
     long i;
 
+    edit_buffer_count_pending_lines (&edit->buffer, edit->buffer.size, 0);
+
     if (edit->buffer.curs_line >= edit->buffer.lines - 1)
         i = edit->buffer.lines;
     else if (!edit_line_is_blank (edit, edit->buffer.curs_line))
@@ -843,6 +808,8 @@ edit_move_to_top (WEdit * edit)
 static void
 edit_move_to_bottom (WEdit * edit)
 {
+    edit_buffer_count_pending_lines (&edit->buffer, edit->buffer.size, 0);
+
     if (edit->buffer.curs_line < edit->buffer.lines)
     {
         edit_move_down (edit, edit->buffer.lines - edit->curs_row, FALSE);
@@ -1059,8 +1026,15 @@ static void
 edit_move_updown (WEdit * edit, long lines, gboolean do_scroll, gboolean direction)
 {
     long p;
-    long l = direction ? edit->buffer.curs_line : edit->buffer.lines - edit->buffer.curs_line;
+    long l;
+
+    if (!direction)
+        edit_buffer_count_pending_lines (&edit->buffer,
+                                         edit_buffer_get_forward_offset (&edit->buffer,
+                                                                         edit->buffer.curs1,
+                                                                         lines, 0), 0);
 
+    l = direction ? edit->buffer.curs_line : edit->buffer.lines - edit->buffer.curs_line;
     if (lines > l)
         lines = l;
 
@@ -1756,6 +1730,43 @@ edit_insert_column_from_file (WEdit * edit, int file, off_t * start_pos, off_t *
     return blocklen;
 }
 
+/* --------------------------------------------------------------------------------------------- */
+/**
+ * Push the same undo action several times.
+ * Repeated action is kept on the stack as the action and the counter, so after the push
+ * which has created the counter it is enough to increase it.
+ */
+
+static void
+edit_push_undo_action_repeat (WEdit * edit, long c, off_t count)
+{
+    while (count-- > 0)
+    {
+        unsigned long sp, spm1, spm2;
+
+        edit_push_undo_action (edit, c);
+
+        if (count == 0 || edit->undo_stack_disable)
+            continue;
+
+        sp = edit->undo_stack_pointer;
+        spm1 = (sp - 1) & edit->undo_stack_size_mask;
+        spm2 = (sp - 2) & edit->undo_stack_size_mask;
+
+        /* the same conditions as in edit_push_undo_action() */
+        if (edit->undo_stack_bottom != sp && spm1 != edit->undo_stack_bottom
+            && spm2 != edit->undo_stack_bottom && edit->undo_stack[spm1] < 0
+            && edit->undo_stack[spm2] == c)
+        {
+            off_t n;
+
+            n = MIN (count, edit->undo_stack[spm1] + 1000000000);
+            edit->undo_stack[spm1] -= n;
+            count -= n;
+        }
+    }
+}
+
 /* --------------------------------------------------------------------------------------------- */
 /*** public functions ****************************************************************************/
 /* --------------------------------------------------------------------------------------------- */
@@ -2259,6 +2270,29 @@ edit_reload_line (WEdit * edit, const vfs_path_t * filename_vpath, long line)
     return TRUE;
 }
 
+/* --------------------------------------------------------------------------------------------- */
+/**
+ * Check whether lazily loaded file is changed by another program while it is edited.
+ * If it is, the text is read into memory as it is now and the user is warned.
+ */
+
+void
+edit_check_mapped_file (WEdit * edit)
+{
+    if (!edit_buffer_check_mapped (&edit->buffer))
+        return;
+
+    /* line numbers and syntax states are not valid anymore */
+    edit->start_display = edit_buffer_get_bol (&edit->buffer, edit->start_display);
+    edit->start_line = edit_buffer_count_lines (&edit->buffer, 0, edit->start_display);
+    edit_syntax_reset (edit);
+    edit->force |= REDRAW_COMPLETELY;
+
+    edit_error_dialog (_("Warning"),
+                       _("File was changed by another program while it was edited.\n"
+                         "Text in the editor may be damaged."));
+}
+
 /* --------------------------------------------------------------------------------------------- */
 
 #ifdef HAVE_CHARSET
@@ -2524,6 +2558,7 @@ edit_insert (WEdit * edit, int c)
         edit_modification (edit);
 
     /* now we must update some info on the file and check if a redraw is required */
+    edit_syntax_changed (edit, edit->buffer.curs_line, c == '\n' ? 1 : 0);
     if (c == '\n')
     {
         book_mark_inc (edit, edit->buffer.curs_line);
@@ -2541,7 +2576,6 @@ edit_insert (WEdit * edit, int c)
     /* update markers */
     edit->mark1 += (edit->mark1 > edit->buffer.curs1) ? 1 : 0;
     edit->mark2 += (edit->mark2 > edit->buffer.curs1) ? 1 : 0;
-    edit->last_get_rule += (edit->last_get_rule > edit->buffer.curs1) ? 1 : 0;
 
     edit_buffer_insert (&edit->buffer, c);
 }
@@ -2559,6 +2593,7 @@ edit_insert_ahead (WEdit * edit, int c)
             edit->start_line++;
     }
     edit_modification (edit);
+    edit_syntax_changed (edit, edit->buffer.curs_line, c == '\n' ? 1 : 0);
     if (c == '\n')
     {
         book_mark_inc (edit, edit->buffer.curs_line);
@@ -2573,7 +2608,6 @@ edit_insert_ahead (WEdit * edit, int c)
 
     edit->mark1 += (edit->mark1 >= edit->buffer.curs1) ? 1 : 0;
     edit->mark2 += (edit->mark2 >= edit->buffer.curs1) ? 1 : 0;
-    edit->last_get_rule += (edit->last_get_rule >= edit->buffer.curs1) ? 1 : 0;
 
     edit_buffer_insert_ahead (&edit->buffer, c);
 }
@@ -2627,8 +2661,6 @@ edit_delete (WEdit * edit, gboolean byte_delete)
         }
         if (edit->mark2 > edit->buffer.curs1)
             edit->mark2--;
-        if (edit->last_get_rule > edit->buffer.curs1)
-            edit->last_get_rule--;
 
         p = edit_buffer_delete (&edit->buffer);
 
@@ -2636,6 +2668,7 @@ edit_delete (WEdit * edit, gboolean byte_delete)
     }
 
     edit_modification (edit);
+    edit_syntax_changed (edit, edit->buffer.curs_line, p == '\n' ? -1 : 0);
     if (p == '\n')
     {
         book_mark_dec (edit, edit->buffer.curs_line);
@@ -2687,8 +2720,6 @@ edit_backspace (WEdit * edit, gboolean byte_delete)
         }
         if (edit->mark2 >= edit->buffer.curs1)
             edit->mark2--;
-        if (edit->last_get_rule >= edit->buffer.curs1)
-            edit->last_get_rule--;
 
         p = edit_buffer_backspace (&edit->buffer);
 
@@ -2702,6 +2733,7 @@ edit_backspace (WEdit * edit, gboolean byte_delete)
         edit->buffer.lines--;
         edit->force |= REDRAW_AFTER_CURSOR;
     }
+    edit_syntax_changed (edit, edit->buffer.curs_line, p == '\n' ? -1 : 0);
 
     if (edit->buffer.curs1 < edit->start_display)
     {
@@ -2719,42 +2751,38 @@ edit_backspace (WEdit * edit, gboolean byte_delete)
 void
 edit_cursor_move (WEdit * edit, off_t increment)
 {
+    off_t curs1 = edit->buffer.curs1;
+    long lines;
+
+    increment = CLAMP (increment, -curs1, edit->buffer.curs2);
+    if (increment == 0)
+        return;
+
     if (increment < 0)
     {
-        for (; increment < 0 && edit->buffer.curs1 != 0; increment++)
-        {
-            int c;
+        edit_push_undo_action_repeat (edit, CURS_RIGHT, -increment);
 
-            edit_push_undo_action (edit, CURS_RIGHT);
-
-            c = edit_buffer_get_previous_byte (&edit->buffer);
-            edit_buffer_insert_ahead (&edit->buffer, c);
-            c = edit_buffer_backspace (&edit->buffer);
-            if (c == '\n')
-            {
-                edit->buffer.curs_line--;
-                edit->force |= REDRAW_LINE_BELOW;
-            }
+        lines = edit_buffer_count_lines (&edit->buffer, curs1 + increment, curs1);
+        if (lines != 0)
+        {
+            edit->buffer.curs_line -= lines;
+            edit->force |= REDRAW_LINE_BELOW;
         }
     }
     else
     {
-        for (; increment > 0 && edit->buffer.curs2 != 0; increment--)
-        {
-            int c;
+        edit_push_undo_action_repeat (edit, CURS_LEFT, increment);
 
-            edit_push_undo_action (edit, CURS_LEFT);
-
-            c = edit_buffer_get_current_byte (&edit->buffer);
-            edit_buffer_insert (&edit->buffer, c);
-            c = edit_buffer_delete (&edit->buffer);
-            if (c == '\n')
-            {
-                edit->buffer.curs_line++;
-                edit->force |= REDRAW_LINE_ABOVE;
-            }
+        lines = edit_buffer_count_lines (&edit->buffer, curs1, curs1 + increment);
+        if (lines != 0)
+        {
+            edit->buffer.curs_line += lines;
+            edit->force |= REDRAW_LINE_ABOVE;
         }
     }
+
+    /* with piece table, the cursor jumps at once */
+    edit_buffer_set_cursor (&edit->buffer, curs1 + increment);
 }
 
 /* --------------------------------------------------------------------------------------------- */
@@ -2894,6 +2922,12 @@ edit_scroll_downward (WEdit * edit, long i)
 {
     long lines_below;
 
+    edit_buffer_count_pending_lines (&edit->buffer,
+                                     edit_buffer_get_forward_offset (&edit->buffer,
+                                                                     edit->start_display,
+                                                                     i + WIDGET (edit)->lines,
+                                                                     0), 0);
+
     lines_below = edit->buffer.lines - edit->start_line - (WIDGET (edit)->lines - 1);
     if (lines_below > 0)
     {
@@ -3005,7 +3039,7 @@ edit_move_to_prev_col (WEdit * edit, off_t p)
 gboolean
 edit_line_is_blank (WEdit * edit, long line)
 {
-    return is_blank (&edit->buffer, edit_find_line (edit, line));
+    return is_blank (&edit->buffer, edit_buffer_find_line (&edit->buffer, line));
 }
 
 /* --------------------------------------------------------------------------------------------- */
@@ -82,6 +82,14 @@
 /*
  * The editor keeps data in two arrays of buffers.
  * All buffers have the same size, which must be a power of 2.
+ *
+ * If editor_piece_table option is set, data is kept in piece table (see editpiece.c) instead:
+ * curs1 and curs2 are just offsets there, so the cursor jumps without moving data.
+ *
+ * Newlines are indexed: b1_lines and b2_lines keep numbers of newlines in all buffers before
+ * each buffer of b1 and after each buffer of b2. Only the last buffer of b1 and b2 is changed
+ * by editing, so these numbers remain valid. Line of any offset and offset of any line are
+ * found with at most one buffer scan.
  */
 
 /* Configurable: log2 of the buffer size in bytes */
@@ -95,6 +103,9 @@
 /* Buffer mask (used to find cursor position relative to the buffer) */
 #define M_EDIT_BUF_SIZE (EDIT_BUF_SIZE - 1)
 
+/* Moving by so many lines at most, lines are scanned instead of using the newline index */
+#define EDIT_SCAN_LINES 4
+
 /*** file scope type declarations ****************************************************************/
 
 /*** file scope variables ************************************************************************/
@@ -110,7 +121,7 @@
   *
   * @return NULL if byte_index is negative or larger than file size; pointer to byte otherwise.
   */
-static char *
+static const char *
 edit_buffer_get_byte_ptr (const edit_buffer_t * buf, off_t byte_index)
 {
     void *b;
@@ -118,6 +129,13 @@ edit_buffer_get_byte_ptr (const edit_buffer_t * buf, off_t byte_index)
     if (byte_index >= (buf->curs1 + buf->curs2) || byte_index < 0)
         return NULL;
 
+    if (buf->pieces != NULL)
+    {
+        size_t len;
+
+        return edit_piece_table_get_block (buf->pieces, byte_index, &len);
+    }
+
     if (byte_index >= buf->curs1)
     {
         off_t p;
@@ -131,6 +149,237 @@ edit_buffer_get_byte_ptr (const edit_buffer_t * buf, off_t byte_index)
     return (char *) b + (byte_index & M_EDIT_BUF_SIZE);
 }
 
+/* --------------------------------------------------------------------------------------------- */
+/**
+ * Count newlines before specified offset.
+ *
+ * @param buf pointer to editor buffer
+ * @param offset byte offset
+ *
+ * @return number of newlines in [0, offset)
+ */
+
+static long
+edit_buffer_lines_before (const edit_buffer_t * buf, off_t offset)
+{
+    off_t i;
+    const char *b;
+    long lines;
+
+    if (buf->pieces != NULL)
+        return edit_piece_table_count_lines (buf->pieces, offset);
+
+    if (offset <= 0)
+        return 0;
+
+    if (offset >= buf->size)
+        return buf->lines1 + buf->lines2;
+
+    if (offset == buf->curs1)
+        return buf->lines1;
+
+    if (offset < buf->curs1)
+    {
+        i = offset >> S_EDIT_BUF_SIZE;
+        b = g_ptr_array_index (buf->b1, i);
+        return g_array_index (buf->b1_lines, long, i)
+            + edit_count_newlines (b, offset & M_EDIT_BUF_SIZE);
+    }
+
+    /* count newlines after offset */
+    offset = buf->size - offset;
+    i = offset >> S_EDIT_BUF_SIZE;
+    b = g_ptr_array_index (buf->b2, i);
+    lines = g_array_index (buf->b2_lines, long, i)
+        + edit_count_newlines (b + EDIT_BUF_SIZE - (offset & M_EDIT_BUF_SIZE),
+                               offset & M_EDIT_BUF_SIZE);
+
+    return buf->lines1 + buf->lines2 - lines;
+}
+
+/* --------------------------------------------------------------------------------------------- */
+/**
+ * Find buffer of b1 or b2 containing the line-th newline.
+ *
+ * @param lines newline index of b1 or b2
+ * @param line newline number, from 1
+ *
+ * @return index of buffer
+ */
+
+static guint
+edit_buffer_find_lines_part (const GArray * lines, long line)
+{
+    guint lo = 0, hi = lines->len;
+
+    /* the last part which has less than line newlines before it */
+    while (hi - lo > 1)
+    {
+        guint mid = lo + (hi - lo) / 2;
+
+        if (g_array_index (lines, long, mid) < line)
+            lo = mid;
+        else
+            hi = mid;
+    }
+
+    return lo;
+}
+
+/* --------------------------------------------------------------------------------------------- */
+/**
+ * Get offset of the beginning of line.
+ *
+ * @param buf pointer to editor buffer
+ * @param line line number, from 1
+ *
+ * @return offset of the byte after the line-th newline or after the last newline
+ *         if there are less newlines
+ */
+
+static off_t
+edit_buffer_get_line_offset (const edit_buffer_t * buf, long line)
+{
+    guint i;
+    const char *b, *nl;
+    off_t len;
+
+    if (buf->pieces != NULL)
+        return edit_piece_table_find_line (buf->pieces, line);
+
+    line = MIN (line, buf->lines1 + buf->lines2);
+    if (line <= 0)
+        return 0;
+
+    if (line <= buf->lines1)
+    {
+        i = edit_buffer_find_lines_part (buf->b1_lines, line);
+        b = g_ptr_array_index (buf->b1, i);
+        len = MIN (EDIT_BUF_SIZE, buf->curs1 - ((off_t) i << S_EDIT_BUF_SIZE));
+
+        nl = b - 1;
+        for (line -= g_array_index (buf->b1_lines, long, i); line > 0; line--)
+            nl = memchr (nl + 1, '\n', b + len - nl - 1);
+
+        return ((off_t) i << S_EDIT_BUF_SIZE) + (nl - b) + 1;
+    }
+
+    /* count newlines from the end of file */
+    line = buf->lines2 - (line - buf->lines1) + 1;
+    i = edit_buffer_find_lines_part (buf->b2_lines, line);
+    b = g_ptr_array_index (buf->b2, i);
+
+    nl = b + EDIT_BUF_SIZE;
+    for (line -= g_array_index (buf->b2_lines, long, i); line > 0; line--)
+        while (*--nl != '\n')
+            ;
+
+    return buf->size - ((off_t) i << S_EDIT_BUF_SIZE) - (b + EDIT_BUF_SIZE - 1 - nl);
+}
+
+/* --------------------------------------------------------------------------------------------- */
+/**
+ * Rebuild newline index of b2.
+ */
+
+static void
+edit_buffer_index_b2 (edit_buffer_t * buf)
+{
+    guint i;
+
+    g_array_set_size (buf->b2_lines, 0);
+    buf->lines2 = 0;
+
+    for (i = 0; i < buf->b2->len; i++)
+    {
+        off_t len;
+
+        len = MIN (EDIT_BUF_SIZE, buf->curs2 - ((off_t) i << S_EDIT_BUF_SIZE));
+        g_array_append_val (buf->b2_lines, buf->lines2);
+        buf->lines2 +=
+            edit_count_newlines ((char *) g_ptr_array_index (buf->b2, i) + EDIT_BUF_SIZE - len,
+                                 len);
+    }
+}
+
+/* --------------------------------------------------------------------------------------------- */
+/**
+ * Load file into piece table: whole file becomes the first piece.
+ */
+
+static off_t
+edit_buffer_read_pieces (edit_buffer_t * buf, int fd, off_t size,
+                         edit_buffer_read_file_status_msg_t * sm, gboolean * aborted)
+{
+    off_t ret = 0;
+    char *data;
+    status_msg_t *s = STATUS_MSG (sm);
+    unsigned short update_cnt = 0;
+
+    buf->lines = 0;
+    data = g_malloc (size);
+
+    while (ret < size)
+    {
+        ssize_t sz;
+
+        sz = mc_read (fd, data + ret, MIN (size - ret, EDIT_BUF_SIZE));
+        if (sz <= 0)
+            break;
+
+        ret += sz;
+
+        if (s != NULL && s->update != NULL)
+        {
+            update_cnt = (update_cnt + 1) & 0xf;
+            if (update_cnt == 0)
+            {
+                if (sm->buf == NULL)
+                    sm->buf = buf;
+
+                sm->loaded = ret;
+                if (s->update (s) == B_CANCEL)
+                {
+                    g_free (data);
+                    *aborted = TRUE;
+                    return (-1);
+                }
+            }
+        }
+    }
+
+    edit_piece_table_load (buf->pieces, data, ret);
+    buf->curs2 = ret;
+    buf->lines = edit_piece_table_count_lines (buf->pieces, ret);
+
+    return ret;
+}
+
+/* --------------------------------------------------------------------------------------------- */
+
+static off_t
+edit_buffer_write_pieces (edit_buffer_t * buf, int fd)
+{
+    off_t ret = 0;
+
+    while (ret < buf->size)
+    {
+        const char *b;
+        size_t data_size;
+        ssize_t sz;
+
+        b = edit_piece_table_get_block (buf->pieces, ret, &data_size);
+        sz = mc_write (fd, b, data_size);
+        if (sz < 0)
+            return (ret == 0) ? sz : ret;
+        ret += sz;
+        if ((size_t) sz != data_size)
+            break;
+    }
+
+    return ret;
+}
+
 /* --------------------------------------------------------------------------------------------- */
 /*** public functions ****************************************************************************/
 /* --------------------------------------------------------------------------------------------- */
@@ -145,6 +394,11 @@ edit_buffer_init (edit_buffer_t * buf, off_t size)
 {
     buf->b1 = g_ptr_array_sized_new (32);
     buf->b2 = g_ptr_array_sized_new (32);
+    buf->pieces = option_piece_table ? edit_piece_table_new () : NULL;
+    buf->b1_lines = g_array_sized_new (FALSE, FALSE, sizeof (long), 32);
+    buf->b2_lines = g_array_sized_new (FALSE, FALSE, sizeof (long), 32);
+    buf->lines1 = 0;
+    buf->lines2 = 0;
 
     buf->curs1 = 0;
     buf->curs2 = 0;
@@ -174,6 +428,24 @@ edit_buffer_clean (edit_buffer_t * buf)
         g_ptr_array_foreach (buf->b2, (GFunc) g_free, NULL);
         g_ptr_array_free (buf->b2, TRUE);
     }
+
+    if (buf->pieces != NULL)
+    {
+        edit_piece_table_free (buf->pieces);
+        buf->pieces = NULL;
+    }
+
+    if (buf->b1_lines != NULL)
+    {
+        g_array_free (buf->b1_lines, TRUE);
+        buf->b1_lines = NULL;
+    }
+
+    if (buf->b2_lines != NULL)
+    {
+        g_array_free (buf->b2_lines, TRUE);
+        buf->b2_lines = NULL;
+    }
 }
 
 /* --------------------------------------------------------------------------------------------- */
@@ -189,13 +461,46 @@ edit_buffer_clean (edit_buffer_t * buf)
 int
 edit_buffer_get_byte (const edit_buffer_t * buf, off_t byte_index)
 {
-    char *p;
+    const char *p;
 
     p = edit_buffer_get_byte_ptr (buf, byte_index);
 
     return (p != NULL) ? *(unsigned char *) p : '\n';
 }
 
+/* --------------------------------------------------------------------------------------------- */
+/**
+  * Get pointer to contiguous block of bytes started at specified index.
+  * Bytes after cursor are stored in reverse order of chunks, but each chunk
+  * keeps them in forward order, so block never crosses chunk boundary.
+  * In piece table block never crosses piece boundary.
+  *
+  * @param buf pointer to editor buffer
+  * @param byte_index byte index
+  * @param len length of block
+  *
+  * @return NULL if byte_index is negative or larger than file size; pointer to block otherwise.
+  */
+
+const char *
+edit_buffer_get_block (const edit_buffer_t * buf, off_t byte_index, size_t * len)
+{
+    const char *p;
+
+    if (buf->pieces != NULL)
+        return edit_piece_table_get_block (buf->pieces, byte_index, len);
+
+    p = edit_buffer_get_byte_ptr (buf, byte_index);
+    if (p == NULL)
+        *len = 0;
+    else if (byte_index >= buf->curs1)
+        *len = ((buf->curs1 + buf->curs2 - byte_index - 1) & M_EDIT_BUF_SIZE) + 1;
+    else
+        *len = MIN (EDIT_BUF_SIZE - (byte_index & M_EDIT_BUF_SIZE), buf->curs1 - byte_index);
+
+    return p;
+}
+
 /* --------------------------------------------------------------------------------------------- */
 
 #ifdef HAVE_CHARSET
@@ -214,10 +519,11 @@ edit_buffer_get_byte (const edit_buffer_t * buf, off_t byte_index)
 int
 edit_buffer_get_utf (const edit_buffer_t * buf, off_t byte_index, int *char_length)
 {
-    gchar *str = NULL;
+    const gchar *str = NULL;
+    size_t len;
     gunichar res;
     gunichar ch;
-    gchar *next_ch = NULL;
+    const gchar *next_ch = NULL;
 
     if (byte_index >= (buf->curs1 + buf->curs2) || byte_index < 0)
     {
@@ -225,14 +531,14 @@ edit_buffer_get_utf (const edit_buffer_t * buf, off_t byte_index, int *char_leng
         return '\n';
     }
 
-    str = edit_buffer_get_byte_ptr (buf, byte_index);
+    str = edit_buffer_get_block (buf, byte_index, &len);
     if (str == NULL)
     {
         *char_length = 0;
         return 0;
     }
 
-    res = g_utf8_get_char_validated (str, -1);
+    res = g_utf8_get_char_validated (str, len);
     if (res == (gunichar) (-2) || res == (gunichar) (-1))
     {
         /* Retry with explicit bytes to make sure it's not a buffer boundary */
@@ -333,13 +639,39 @@ edit_buffer_count_lines (const edit_buffer_t * buf, off_t first, off_t last)
     first = MAX (first, 0);
     last = MIN (last, buf->size);
 
+    if (last - first > EDIT_BUF_SIZE)
+        return edit_buffer_lines_before (buf, last) - edit_buffer_lines_before (buf, first);
+
     while (first < last)
-        if (edit_buffer_get_byte (buf, first++) == '\n')
-            lines++;
+    {
+        const char *p;
+        size_t len;
+
+        p = edit_buffer_get_block (buf, first, &len);
+        len = MIN (len, (size_t) (last - first));
+        first += len;
+        lines += edit_count_newlines (p, len);
+    }
 
     return lines;
 }
 
+/* --------------------------------------------------------------------------------------------- */
+/**
+ * Find the beginning of line.
+ *
+ * @param buf editor buffer
+ * @param line line number, from 0
+ *
+ * @return offset of the first byte of line; the beginning of the last line if line is too large
+ */
+
+off_t
+edit_buffer_find_line (const edit_buffer_t * buf, long line)
+{
+    return (line <= 0) ? 0 : edit_buffer_get_line_offset (buf, line);
+}
+
 /* --------------------------------------------------------------------------------------------- */
 /**
  * Get "begin-of-line" offset of line contained specified byte offset
@@ -445,15 +777,28 @@ edit_buffer_insert (edit_buffer_t * buf, int c)
     void *b;
     off_t i;
 
+    if (buf->pieces != NULL)
+    {
+        edit_piece_table_insert (buf->pieces, buf->curs1, (char) c);
+        buf->curs1++;
+        buf->size++;
+        return;
+    }
+
     i = buf->curs1 & M_EDIT_BUF_SIZE;
 
     /* add a new buffer if we've reached the end of the last one */
     if (i == 0)
+    {
         g_ptr_array_add (buf->b1, g_malloc0 (EDIT_BUF_SIZE));
+        g_array_append_val (buf->b1_lines, buf->lines1);
+    }
 
     /* perform the insertion */
     b = g_ptr_array_index (buf->b1, buf->curs1 >> S_EDIT_BUF_SIZE);
     *((unsigned char *) b + i) = (unsigned char) c;
+    if (c == '\n')
+        buf->lines1++;
 
     /* update cursor position */
     buf->curs1++;
@@ -477,15 +822,28 @@ edit_buffer_insert_ahead (edit_buffer_t * buf, int c)
     void *b;
     off_t i;
 
+    if (buf->pieces != NULL)
+    {
+        edit_piece_table_insert (buf->pieces, buf->curs1, (char) c);
+        buf->curs2++;
+        buf->size++;
+        return;
+    }
+
     i = buf->curs2 & M_EDIT_BUF_SIZE;
 
     /* add a new buffer if we've reached the end of the last one */
     if (i == 0)
+    {
         g_ptr_array_add (buf->b2, g_malloc0 (EDIT_BUF_SIZE));
+        g_array_append_val (buf->b2_lines, buf->lines2);
+    }
 
     /* perform the insertion */
     b = g_ptr_array_index (buf->b2, buf->curs2 >> S_EDIT_BUF_SIZE);
     *((unsigned char *) b + EDIT_BUF_SIZE - 1 - i) = (unsigned char) c;
+    if (c == '\n')
+        buf->lines2++;
 
     /* update cursor position */
     buf->curs2++;
@@ -511,11 +869,20 @@ edit_buffer_delete (edit_buffer_t * buf)
     off_t prev;
     off_t i;
 
+    if (buf->pieces != NULL)
+    {
+        buf->curs2--;
+        buf->size--;
+        return edit_piece_table_delete (buf->pieces, buf->curs1);
+    }
+
     prev = buf->curs2 - 1;
 
     b = g_ptr_array_index (buf->b2, prev >> S_EDIT_BUF_SIZE);
     i = prev & M_EDIT_BUF_SIZE;
     c = *((unsigned char *) b + EDIT_BUF_SIZE - 1 - i);
+    if (c == '\n')
+        buf->lines2--;
 
     if (i == 0)
     {
@@ -524,6 +891,7 @@ edit_buffer_delete (edit_buffer_t * buf)
         j = buf->b2->len - 1;
         b = g_ptr_array_index (buf->b2, j);
         g_ptr_array_remove_index (buf->b2, j);
+        g_array_set_size (buf->b2_lines, j);
         g_free (b);
     }
 
@@ -552,11 +920,20 @@ edit_buffer_backspace (edit_buffer_t * buf)
     off_t prev;
     off_t i;
 
+    if (buf->pieces != NULL)
+    {
+        buf->curs1--;
+        buf->size--;
+        return edit_piece_table_delete (buf->pieces, buf->curs1);
+    }
+
     prev = buf->curs1 - 1;
 
     b = g_ptr_array_index (buf->b1, prev >> S_EDIT_BUF_SIZE);
     i = prev & M_EDIT_BUF_SIZE;
     c = *((unsigned char *) b + i);
+    if (c == '\n')
+        buf->lines1--;
 
     if (i == 0)
     {
@@ -565,6 +942,7 @@ edit_buffer_backspace (edit_buffer_t * buf)
         j = buf->b1->len - 1;
         b = g_ptr_array_index (buf->b1, j);
         g_ptr_array_remove_index (buf->b1, j);
+        g_array_set_size (buf->b1_lines, j);
         g_free (b);
     }
 
@@ -576,6 +954,38 @@ edit_buffer_backspace (edit_buffer_t * buf)
     return c;
 }
 
+/* --------------------------------------------------------------------------------------------- */
+/**
+ * Move cursor to specified offset.
+ *
+ * @param buf pointer to editor buffer
+ * @param offset new cursor position, from 0 to file size
+ */
+
+void
+edit_buffer_set_cursor (edit_buffer_t * buf, off_t offset)
+{
+    if (buf->pieces != NULL)
+    {
+        buf->curs1 = offset;
+        buf->curs2 = buf->size - offset;
+        return;
+    }
+
+    /* move bytes over the gap */
+    while (buf->curs1 > offset)
+    {
+        edit_buffer_insert_ahead (buf, edit_buffer_get_previous_byte (buf));
+        edit_buffer_backspace (buf);
+    }
+
+    while (buf->curs1 < offset)
+    {
+        edit_buffer_insert (buf, edit_buffer_get_current_byte (buf));
+        edit_buffer_delete (buf);
+    }
+}
+
 /* --------------------------------------------------------------------------------------------- */
 /**
  * Calculate forward offset with specified number of lines.
@@ -593,22 +1003,32 @@ edit_buffer_backspace (edit_buffer_t * buf)
 off_t
 edit_buffer_get_forward_offset (const edit_buffer_t * buf, off_t current, long lines, off_t upto)
 {
+    long line;
+
     if (upto != 0)
         return (off_t) edit_buffer_count_lines (buf, current, upto);
 
     lines = MAX (lines, 0);
 
-    while (lines-- != 0)
+    if (lines <= EDIT_SCAN_LINES)
     {
-        long next;
+        while (lines-- != 0)
+        {
+            long next;
 
-        next = edit_buffer_get_eol (buf, current) + 1;
-        if (next > buf->size)
-            break;
-        current = next;
+            next = edit_buffer_get_eol (buf, current) + 1;
+            if (next > buf->size)
+                break;
+            current = next;
+        }
+
+        return current;
     }
 
-    return current;
+    line = edit_buffer_lines_before (buf, current);
+
+    /* stay in the last line */
+    return MAX (current, edit_buffer_get_line_offset (buf, line + lines));
 }
 
 /* --------------------------------------------------------------------------------------------- */
@@ -625,13 +1045,23 @@ edit_buffer_get_forward_offset (const edit_buffer_t * buf, off_t current, long l
 off_t
 edit_buffer_get_backward_offset (const edit_buffer_t * buf, off_t current, long lines)
 {
+    long line;
+
     lines = MAX (lines, 0);
-    current = edit_buffer_get_bol (buf, current);
 
-    while (lines-- != 0 && current != 0)
-        current = edit_buffer_get_bol (buf, current - 1);
+    if (lines <= EDIT_SCAN_LINES)
+    {
+        current = edit_buffer_get_bol (buf, current);
 
-    return current;
+        while (lines-- != 0 && current != 0)
+            current = edit_buffer_get_bol (buf, current - 1);
+
+        return current;
+    }
+
+    line = edit_buffer_lines_before (buf, current) - lines;
+
+    return (line <= 0) ? 0 : edit_buffer_get_line_offset (buf, line);
 }
 
 /* --------------------------------------------------------------------------------------------- */
@@ -650,7 +1080,7 @@ edit_buffer_read_file (edit_buffer_t * buf, int fd, off_t size,
                        edit_buffer_read_file_status_msg_t * sm, gboolean * aborted)
 {
     off_t ret = 0;
-    off_t i, j;
+    off_t i;
     off_t data_size;
     void *b;
     status_msg_t *s = STATUS_MSG (sm);
@@ -658,6 +1088,9 @@ edit_buffer_read_file (edit_buffer_t * buf, int fd, off_t size,
 
     *aborted = FALSE;
 
+    if (buf->pieces != NULL)
+        return edit_buffer_read_pieces (buf, fd, size, sm, aborted);
+
     buf->lines = 0;
     buf->curs2 = size;
     i = buf->curs2 >> S_EDIT_BUF_SIZE;
@@ -670,12 +1103,6 @@ edit_buffer_read_file (edit_buffer_t * buf, int fd, off_t size,
         g_ptr_array_add (buf->b2, b);
         b = (char *) b + EDIT_BUF_SIZE - data_size;
         ret = mc_read (fd, b, data_size);
-
-        /* count lines */
-        for (j = 0; j < ret; j++)
-            if (*((char *) b + j) == '\n')
-                buf->lines++;
-
         if (ret < 0 || ret != data_size)
             return ret;
     }
@@ -692,11 +1119,6 @@ edit_buffer_read_file (edit_buffer_t * buf, int fd, off_t size,
         if (sz >= 0)
             ret += sz;
 
-        /* count lines */
-        for (j = 0; j < sz; j++)
-            if (*((char *) b + j) == '\n')
-                buf->lines++;
-
         if (s != NULL && s->update != NULL)
         {
             update_cnt = (update_cnt + 1) & 0xf;
@@ -746,9 +1168,103 @@ edit_buffer_read_file (edit_buffer_t * buf, int fd, off_t size,
         }
     }
 
+    edit_buffer_index_b2 (buf);
+    buf->lines = buf->lines2;
+
     return ret;
 }
 
+/* --------------------------------------------------------------------------------------------- */
+/**
+ * Load file into editor buffer lazily: map file into memory instead of reading it.
+ * Only piece table can keep mapped file. Lines of mapped file are counted later,
+ * see edit_buffer_count_pending_lines().
+ *
+ * @param buf pointer to editor buffer
+ * @param fd descriptor of local file
+ * @param size file size
+ *
+ * @return TRUE if file is mapped, FALSE if it should be read by edit_buffer_read_file()
+ */
+
+gboolean
+edit_buffer_map_file (edit_buffer_t * buf, int fd, off_t size)
+{
+    if (buf->pieces == NULL || !edit_piece_table_map (buf->pieces, fd, size))
+        return FALSE;
+
+    buf->curs2 = size;
+    buf->lines = 0;
+
+    return TRUE;
+}
+
+/* --------------------------------------------------------------------------------------------- */
+/**
+ * Check whether editor buffer keeps mapped file, which must not be overwritten in place.
+ *
+ * @param buf pointer to editor buffer
+ *
+ * @return TRUE if text of buffer refers to mapped file
+ */
+
+gboolean
+edit_buffer_is_mapped (const edit_buffer_t * buf)
+{
+    return buf->pieces != NULL && edit_piece_table_is_mapped (buf->pieces);
+}
+
+/* --------------------------------------------------------------------------------------------- */
+/**
+ * Check whether mapped file of editor buffer is changed by another program.
+ * If it is, the file is read into memory and all lines are counted again.
+ *
+ * @param buf pointer to editor buffer
+ *
+ * @return TRUE if text of buffer is changed, FALSE otherwise
+ */
+
+gboolean
+edit_buffer_check_mapped (edit_buffer_t * buf)
+{
+    if (buf->pieces == NULL || !edit_piece_table_check_mapped (buf->pieces))
+        return FALSE;
+
+    buf->lines = edit_piece_table_count_lines (buf->pieces, buf->size);
+    buf->curs_line = edit_piece_table_count_lines (buf->pieces, buf->curs1);
+
+    return TRUE;
+}
+
+/* --------------------------------------------------------------------------------------------- */
+/**
+ * Count lines of mapped file which are not counted yet and add them to buf->lines.
+ * Until all lines are counted, buf->lines is the number of counted newlines only.
+ *
+ * @param buf pointer to editor buffer
+ * @param offset count newlines at least before this offset, 0 to check only
+ * @param limit approximate number of bytes to count, 0 to count all up to offset
+ *
+ * @return TRUE if some lines are not counted yet
+ */
+
+gboolean
+edit_buffer_count_pending_lines (edit_buffer_t * buf, off_t offset, off_t limit)
+{
+    gboolean pending;
+
+    if (buf->pieces == NULL)
+        return FALSE;
+
+    if (limit == 0)
+        limit = buf->size;
+
+    pending = edit_piece_table_count_pending (buf->pieces, offset, limit);
+    buf->lines += edit_piece_table_take_counted (buf->pieces);
+
+    return pending;
+}
+
 /* --------------------------------------------------------------------------------------------- */
 /**
  * Write editor buffer content to file
@@ -767,6 +1283,9 @@ edit_buffer_write_file (edit_buffer_t * buf, int fd)
     off_t data_size, sz;
     void *b;
 
+    if (buf->pieces != NULL)
+        return edit_buffer_write_pieces (buf, fd);
+
     /* write all fulfilled parts of b1 from begin to end */
     if (buf->b1->len != 0)
     {
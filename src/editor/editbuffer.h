@@ -5,6 +5,8 @@
 #ifndef MC__EDIT_BUFFER_H
 #define MC__EDIT_BUFFER_H
 
+#include "editpiece.h"
+
 /*** typedefs(not structures) and defined constants **********************************************/
 
 /*** enums ***************************************************************************************/
@@ -17,8 +19,13 @@ typedef struct edit_buffer_struct
     off_t curs2;                /* position from the end of the file */
     GPtrArray *b1;              /* all data up to curs1 */
     GPtrArray *b2;              /* all data from end of file down to curs2 */
+    edit_piece_table_t *pieces; /* if not NULL, all data is here instead of b1 and b2 */
+    GArray *b1_lines;           /* number of newlines before each part of b1 */
+    GArray *b2_lines;           /* number of newlines after each part of b2 */
+    long lines1;                /* number of newlines in b1 */
+    long lines2;                /* number of newlines in b2 */
     off_t size;                 /* file size */
-    long lines;                 /* total lines in the file */
+    long lines;                 /* total lines in the file, see edit_buffer_count_pending_lines() */
     long curs_line;             /* line number of the cursor. */
 } edit_buffer_t;
 
@@ -39,11 +46,13 @@ void edit_buffer_init (edit_buffer_t * buf, off_t size);
 void edit_buffer_clean (edit_buffer_t * buf);
 
 int edit_buffer_get_byte (const edit_buffer_t * buf, off_t byte_index);
+const char *edit_buffer_get_block (const edit_buffer_t * buf, off_t byte_index, size_t * len);
 #ifdef HAVE_CHARSET
 int edit_buffer_get_utf (const edit_buffer_t * buf, off_t byte_index, int *char_length);
 int edit_buffer_get_prev_utf (const edit_buffer_t * buf, off_t byte_index, int *char_length);
 #endif
 long edit_buffer_count_lines (const edit_buffer_t * buf, off_t first, off_t last);
+off_t edit_buffer_find_line (const edit_buffer_t * buf, long line);
 off_t edit_buffer_get_bol (const edit_buffer_t * buf, off_t current);
 off_t edit_buffer_get_eol (const edit_buffer_t * buf, off_t current);
 GString *edit_buffer_get_word_from_pos (const edit_buffer_t * buf, off_t start_pos, off_t * start,
@@ -53,6 +62,7 @@ void edit_buffer_insert (edit_buffer_t * buf, int c);
 void edit_buffer_insert_ahead (edit_buffer_t * buf, int c);
 int edit_buffer_delete (edit_buffer_t * buf);
 int edit_buffer_backspace (edit_buffer_t * buf);
+void edit_buffer_set_cursor (edit_buffer_t * buf, off_t offset);
 
 off_t edit_buffer_get_forward_offset (const edit_buffer_t * buf, off_t current, long lines,
                                       off_t upto);
@@ -60,7 +70,11 @@ off_t edit_buffer_get_backward_offset (const edit_buffer_t * buf, off_t current,
 
 off_t edit_buffer_read_file (edit_buffer_t * buf, int fd, off_t size,
                              edit_buffer_read_file_status_msg_t * sm, gboolean * aborted);
+gboolean edit_buffer_map_file (edit_buffer_t * buf, int fd, off_t size);
 off_t edit_buffer_write_file (edit_buffer_t * buf, int fd);
+gboolean edit_buffer_is_mapped (const edit_buffer_t * buf);
+gboolean edit_buffer_check_mapped (edit_buffer_t * buf);
+gboolean edit_buffer_count_pending_lines (edit_buffer_t * buf, off_t offset, off_t limit);
 
 int edit_buffer_calc_percent (const edit_buffer_t * buf, off_t offset);
 
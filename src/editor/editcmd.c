@@ -206,6 +206,11 @@ edit_save_file (WEdit * edit, const vfs_path_t * filename_vpath)
         real_filename_vpath = vfs_path_clone (filename_vpath);
 
     this_save_mode = option_save_mode;
+
+    /* mapped file must not be truncated while its text is used */
+    if (this_save_mode == EDIT_QUICK_SAVE && edit_buffer_is_mapped (&edit->buffer))
+        this_save_mode = EDIT_SAFE_SAVE;
+
     if (this_save_mode != EDIT_QUICK_SAVE)
     {
         if (!vfs_file_is_local (real_filename_vpath)
@@ -855,34 +860,14 @@ editcmd_find (edit_search_status_msg_t * esm, gsize * len)
                 edit_calculate_start_of_current_line (&edit->buffer, search_start,
                                                       end_string_symbol);
 
-        while (search_start >= start_mark)
+        if (search_start < start_mark)
         {
-            gboolean ok;
-
-            if (search_end > (off_t) (search_start + edit->search->original_len)
-                && mc_search_is_fixed_search_str (edit->search))
-                search_end = search_start + edit->search->original_len;
-
-            ok = mc_search_run (edit->search, (void *) esm, search_start, search_end, len);
-
-            if (ok && edit->search->normal_offset == search_start)
-                return TRUE;
-
-            /* We abort the search in case of a pattern error, or if the user aborts
-               the search. In other words: in all cases except "string not found". */
-            if (!ok && edit->search->error != MC_SEARCH_E_NOTFOUND)
-                return FALSE;
-
-            if ((edit->search_line_type & AT_START_LINE) != 0)
-                search_start =
-                    edit_calculate_start_of_previous_line (&edit->buffer, search_start,
-                                                           end_string_symbol);
-            else
-                search_start--;
+            mc_search_set_error (edit->search, MC_SEARCH_E_NOTFOUND, "%s", _(STR_E_NOTFOUND));
+            return FALSE;
         }
 
-        mc_search_set_error (edit->search, MC_SEARCH_E_NOTFOUND, "%s", _(STR_E_NOTFOUND));
-        return FALSE;
+        return mc_search_run_backward (edit->search, (void *) esm, start_mark, search_start,
+                                       search_end, len);
     }
 
     /* forward search */
@@ -1240,6 +1225,7 @@ edit_collect_completions (WEdit * edit, off_t word_start, gsize word_len,
     srch->search_type = MC_SEARCH_T_REGEX;
     srch->is_case_sensitive = TRUE;
     srch->search_fn = edit_search_cmd_callback;
+    srch->block_fn = edit_search_block_callback;
     srch->update_fn = edit_search_update_callback;
 
     esm.first = TRUE;
@@ -2583,7 +2569,9 @@ edit_replace_cmd (WEdit * edit, gboolean again)
 #endif
         edit->search->is_case_sensitive = edit_search_options.case_sens;
         edit->search->whole_words = edit_search_options.whole_words;
+        edit->search->multiline = edit_search_options.multiline;
         edit->search->search_fn = edit_search_cmd_callback;
+        edit->search->block_fn = edit_search_block_callback;
         edit->search->update_fn = edit_search_update_callback;
         edit->search_line_type = edit_get_search_line_type (edit->search);
         edit_search_fix_search_start_if_selection (edit);
@@ -2752,6 +2740,20 @@ edit_search_cmd_callback (const void *user_data, gsize char_offset, int *current
 
 /* --------------------------------------------------------------------------------------------- */
 
+mc_search_cbret_t
+edit_search_block_callback (const void *user_data, gsize char_offset, const char **block,
+                            gsize * block_len)
+{
+    WEdit *edit = ((const edit_search_status_msg_t *) user_data)->edit;
+    size_t len;
+
+    *block = edit_buffer_get_block (&edit->buffer, (off_t) char_offset, &len);
+    *block_len = len;
+    return (*block != NULL) ? MC_SEARCH_CB_OK : MC_SEARCH_CB_NOTFOUND;
+}
+
+/* --------------------------------------------------------------------------------------------- */
+
 mc_search_cbret_t
 edit_search_update_callback (const void *user_data, gsize char_offset)
 {
@@ -2807,7 +2809,9 @@ edit_search_cmd (WEdit * edit, gboolean again)
 #endif
                 edit->search->is_case_sensitive = edit_search_options.case_sens;
                 edit->search->whole_words = edit_search_options.whole_words;
+                edit->search->multiline = edit_search_options.multiline;
                 edit->search->search_fn = edit_search_cmd_callback;
+                edit->search->block_fn = edit_search_block_callback;
                 edit->search->update_fn = edit_search_update_callback;
                 edit->search_line_type = edit_get_search_line_type (edit->search);
                 edit_do_search (edit);
@@ -3054,7 +3058,10 @@ edit_goto_cmd (WEdit * edit)
     }
 
     if (l < 0)
+    {
+        edit_buffer_count_pending_lines (&edit->buffer, edit->buffer.size, 0);
         l = edit->buffer.lines + l + 2;
+    }
     edit_move_display (edit, l - WIDGET (edit)->lines / 2 - 1);
     edit_move_to_line (edit, l - 1);
     edit->force |= REDRAW_COMPLETELY;
@@ -55,6 +55,7 @@ edit_search_options_t edit_search_options = {
     .backwards = FALSE,
     .only_in_selection = FALSE,
     .whole_words = FALSE,
+    .multiline = FALSE,
     .all_codepages = FALSE
 };
 
@@ -113,6 +114,7 @@ editcmd_dialog_search_show (WEdit * edit)
                 QUICK_CHECKBOX (N_("&Backwards"), &edit_search_options.backwards, NULL),
                 QUICK_CHECKBOX (N_("In se&lection"), &edit_search_options.only_in_selection, NULL),
                 QUICK_CHECKBOX (N_("&Whole words"), &edit_search_options.whole_words, NULL),
+                QUICK_CHECKBOX (N_("&Multi-line regex"), &edit_search_options.multiline, NULL),
 #ifdef HAVE_CHARSET
                 QUICK_CHECKBOX (N_("&All charsets"), &edit_search_options.all_codepages, NULL),
 #endif
@@ -175,7 +177,9 @@ editcmd_dialog_search_show (WEdit * edit)
 #endif
         edit->search->is_case_sensitive = edit_search_options.case_sens;
         edit->search->whole_words = edit_search_options.whole_words;
+        edit->search->multiline = edit_search_options.multiline;
         edit->search->search_fn = edit_search_cmd_callback;
+        edit->search->block_fn = edit_search_block_callback;
         edit->search->update_fn = edit_search_update_callback;
     }
 
@@ -213,6 +217,7 @@ editcmd_dialog_replace_show (WEdit * edit, const char *search_default, const cha
                 QUICK_CHECKBOX (N_("&Backwards"), &edit_search_options.backwards, NULL),
                 QUICK_CHECKBOX (N_("In se&lection"), &edit_search_options.only_in_selection, NULL),
                 QUICK_CHECKBOX (N_("&Whole words"), &edit_search_options.whole_words, NULL),
+                QUICK_CHECKBOX (N_("&Multi-line regex"), &edit_search_options.multiline, NULL),
 #ifdef HAVE_CHARSET
                 QUICK_CHECKBOX (N_("&All charsets"), &edit_search_options.all_codepages, NULL),
 #endif
@@ -921,6 +921,10 @@ render_edit_text (WEdit * edit, long start_row, long start_column, long end_row,
         long row = 0;
         long b;
 
+        /* lines of window are compared with total lines */
+        b = edit_buffer_get_forward_offset (&edit->buffer, edit->start_display, end_row + 1, 0);
+        edit_buffer_count_pending_lines (&edit->buffer, b, 0);
+
         if ((force & REDRAW_PAGE) != 0)
         {
             row = start_row;
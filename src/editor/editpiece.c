@@ -0,0 +1,1044 @@
+/*
+   Editor text keep buffer based on piece table.
+
+   Copyright (C) 2017
+   Free Software Foundation, Inc.
+
+   This file is part of the Midnight Commander.
+
+   The Midnight Commander is free software: you can redistribute it
+   and/or modify it under the terms of the GNU General Public License as
+   published by the Free Software Foundation, either version 3 of the License,
+   or (at your option) any later version.
+
+   The Midnight Commander is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/** \file
+ *  \brief Source: editor text keep buffer based on piece table.
+ */
+
+#include <config.h>
+
+#include <errno.h>
+#include <string.h>
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#ifdef HAVE_MMAP
+#include <signal.h>
+#include <sys/mman.h>
+#endif
+
+#include "lib/global.h"
+#include "lib/sigbus.h"
+
+#include "editpiece.h"
+
+/* --------------------------------------------------------------------------------------------- */
+/*-
+ * Text is a sequence of pieces. Each piece refers to bytes of the loaded file or of the add
+ * buffer, which keeps all inserted bytes. Neither of them is ever modified: insertion appends
+ * a byte to the add buffer and splits the piece at the insertion point, deletion splits
+ * pieces and drops the deleted one.
+ *
+ * Pieces are kept in a treap (randomized balanced binary tree) in order of text. Each node
+ * keeps the length of its subtree, so the piece containing any offset is found in O(log n),
+ * where n is the number of pieces, regardless of the distance from the previous edit.
+ * Each node keeps the number of newlines of its subtree as well, so the line containing
+ * any offset and the offset of any line are found in O(log n) too.
+ *
+ * Pieces are not longer than EDIT_PIECE_MAX_LEN, so newlines of a piece are counted quickly
+ * when it is split.
+ *
+ * Mapped file is not read on load: newlines of its pieces are counted when some lookup needs
+ * them or by edit_piece_table_count_pending() step by step. Until then the number of newlines
+ * of piece is unknown and the piece is counted in "pending" of all subtrees containing it.
+ * Newlines counted since the last call of edit_piece_table_take_counted() are accumulated
+ * in "counted" of the table.
+ *
+ * Typing is cheap: a byte inserted right after the last inserted one extends the same piece,
+ * a byte deleted at the edge of a piece shrinks it.
+ *
+ * Mapped file can be changed by another program. Pages beyond the end of truncated file are
+ * replaced by zero pages in SIGBUS handler, so the editor doesn't crash on them.
+ * edit_piece_table_check_mapped() notices the change and reads the file into memory.
+ */
+
+/*** global variables ****************************************************************************/
+
+/*** file scope macro definitions ****************************************************************/
+
+/* size of chunks of the add buffer */
+#define EDIT_PIECE_ADD_SIZE (64 * 1024)
+
+/* loaded file is split to pieces of this size */
+#define EDIT_PIECE_MAX_LEN EDIT_PIECE_ADD_SIZE
+
+#if defined(HAVE_MMAP) && !defined(MAP_ANONYMOUS)
+#define MAP_ANONYMOUS MAP_ANON
+#endif
+
+/*** file scope type declarations ****************************************************************/
+
+typedef struct edit_piece_struct
+{
+    struct edit_piece_struct *left;
+    struct edit_piece_struct *right;
+    guint32 priority;
+    const char *data;
+    off_t len;                  /* length of piece */
+    off_t total;                /* length of all pieces of subtree */
+    long newlines;              /* number of newlines in piece, -1 if not counted yet */
+    long lines;                 /* number of newlines in all counted pieces of subtree */
+    long pending;               /* number of not counted pieces of subtree */
+} edit_piece_t;
+
+struct edit_piece_table_struct
+{
+    edit_piece_t *root;
+    char *original;             /* loaded file */
+    off_t original_size;
+    gboolean mapped;            /* original is mapped file */
+#ifdef HAVE_MMAP
+    int fd;                     /* mapped file */
+    struct stat st;             /* mapped file when it was mapped */
+    volatile sig_atomic_t truncated;    /* pages beyond the end of mapped file are accessed */
+#endif
+    long counted;               /* newlines counted lazily and not taken yet */
+    GPtrArray *added;           /* chunks of the add buffer */
+    size_t added_len;           /* used bytes of the last chunk */
+    guint32 seed;               /* state of generator of priorities */
+
+    /* last found piece */
+    edit_piece_t *cache;
+    off_t cache_start;
+};
+
+/*** file scope variables ************************************************************************/
+
+#ifdef HAVE_MMAP
+/* piece tables of mapped files */
+static GSList *mapped_tables = NULL;
+static long page_size;
+#endif
+
+/* --------------------------------------------------------------------------------------------- */
+/*** file scope functions ************************************************************************/
+/* --------------------------------------------------------------------------------------------- */
+
+static inline off_t
+piece_total (const edit_piece_t * p)
+{
+    return (p == NULL) ? 0 : p->total;
+}
+
+/* --------------------------------------------------------------------------------------------- */
+
+static inline long
+piece_lines (const edit_piece_t * p)
+{
+    return (p == NULL) ? 0 : p->lines;
+}
+
+/* --------------------------------------------------------------------------------------------- */
+
+static inline long
+piece_pending (const edit_piece_t * p)
+{
+    return (p == NULL) ? 0 : p->pending;
+}
+
+/* --------------------------------------------------------------------------------------------- */
+
+static inline void
+piece_update (edit_piece_t * p)
+{
+    p->total = piece_total (p->left) + p->len + piece_total (p->right);
+    p->lines = piece_lines (p->left) + MAX (p->newlines, 0) + piece_lines (p->right);
+    p->pending = piece_pending (p->left) + (p->newlines < 0 ? 1 : 0) + piece_pending (p->right);
+}
+
+/* --------------------------------------------------------------------------------------------- */
+
+static edit_piece_t *
+piece_new (edit_piece_table_t * pt, const char *data, off_t len, long newlines)
+{
+    edit_piece_t *p;
+
+    /* xorshift32 */
+    pt->seed ^= pt->seed << 13;
+    pt->seed ^= pt->seed >> 17;
+    pt->seed ^= pt->seed << 5;
+
+    p = g_new0 (edit_piece_t, 1);
+    p->priority = pt->seed;
+    p->data = data;
+    p->len = len;
+    p->total = len;
+    p->newlines = newlines;
+    piece_update (p);
+
+    return p;
+}
+
+/* --------------------------------------------------------------------------------------------- */
+
+static void
+piece_free_tree (edit_piece_t * p)
+{
+    if (p != NULL)
+    {
+        piece_free_tree (p->left);
+        piece_free_tree (p->right);
+        g_free (p);
+    }
+}
+
+/* --------------------------------------------------------------------------------------------- */
+/**
+ * Split tree into two ones: the first @offset bytes and the rest. Piece containing the split
+ * point is split into two pieces.
+ */
+
+static void
+piece_split (edit_piece_table_t * pt, edit_piece_t * p, off_t offset, edit_piece_t ** l,
+             edit_piece_t ** r)
+{
+    off_t left_total;
+
+    if (p == NULL)
+    {
+        *l = NULL;
+        *r = NULL;
+        return;
+    }
+
+    left_total = piece_total (p->left);
+
+    if (offset <= left_total)
+    {
+        piece_split (pt, p->left, offset, l, &p->left);
+        piece_update (p);
+        *r = p;
+    }
+    else if (offset >= left_total + p->len)
+    {
+        piece_split (pt, p->right, offset - left_total - p->len, &p->right, r);
+        piece_update (p);
+        *l = p;
+    }
+    else
+    {
+        off_t cut;
+        long newlines;
+        edit_piece_t *tail;
+
+        cut = offset - left_total;
+
+        /* count newlines in the shorter part */
+        if (p->newlines < 0)
+            newlines = -1;
+        else if (cut < p->len / 2)
+            newlines = p->newlines - edit_count_newlines (p->data, cut);
+        else
+            newlines = edit_count_newlines (p->data + cut, p->len - cut);
+
+        tail = piece_new (pt, p->data + cut, p->len - cut, newlines);
+        tail->priority = p->priority;
+        tail->right = p->right;
+        piece_update (tail);
+
+        p->len = cut;
+        if (newlines >= 0)
+            p->newlines -= newlines;
+        p->right = NULL;
+        piece_update (p);
+
+        *l = p;
+        *r = tail;
+    }
+}
+
+/* --------------------------------------------------------------------------------------------- */
+/**
+ * Concatenate two trees.
+ */
+
+static edit_piece_t *
+piece_merge (edit_piece_t * l, edit_piece_t * r)
+{
+    if (l == NULL)
+        return r;
+    if (r == NULL)
+        return l;
+
+    if (l->priority >= r->priority)
+    {
+        l->right = piece_merge (l->right, r);
+        piece_update (l);
+        return l;
+    }
+
+    r->left = piece_merge (l, r->left);
+    piece_update (r);
+    return r;
+}
+
+/* --------------------------------------------------------------------------------------------- */
+/**
+ * Find piece containing byte at specified offset.
+ *
+ * @param p root of tree
+ * @param offset byte offset, less than the length of tree
+ * @param delta value to add to the length of each subtree on the path to found piece
+ * @param delta_lines value to add to the number of newlines of each subtree on the path
+ * @param start offset of the first byte of found piece
+ *
+ * @return found piece
+ */
+
+static edit_piece_t *
+piece_find (edit_piece_t * p, off_t offset, off_t delta, long delta_lines, off_t * start)
+{
+    off_t base = 0;
+
+    while (TRUE)
+    {
+        off_t left_total;
+
+        p->total += delta;
+        p->lines += delta_lines;
+        left_total = piece_total (p->left);
+
+        if (offset < left_total)
+            p = p->left;
+        else if (offset >= left_total + p->len)
+        {
+            offset -= left_total + p->len;
+            base += left_total + p->len;
+            p = p->right;
+        }
+        else
+        {
+            *start = base + left_total;
+            return p;
+        }
+    }
+}
+
+/* --------------------------------------------------------------------------------------------- */
+/**
+ * Count newlines of not counted pieces started before specified offset.
+ *
+ * @param pt piece table
+ * @param p root of subtree
+ * @param offset byte offset relative to subtree
+ * @param limit number of bytes which can be counted yet, it is decreased by counted bytes
+ */
+
+static void
+piece_count (edit_piece_table_t * pt, edit_piece_t * p, off_t offset, off_t * limit)
+{
+    if (p == NULL || p->pending == 0 || offset <= 0 || *limit <= 0)
+        return;
+
+    piece_count (pt, p->left, offset, limit);
+    offset -= piece_total (p->left);
+
+    if (p->newlines < 0 && offset > 0 && *limit > 0)
+    {
+        p->newlines = edit_count_newlines (p->data, p->len);
+        pt->counted += p->newlines;
+        *limit -= p->len;
+    }
+
+    piece_count (pt, p->right, offset - p->len, limit);
+    piece_update (p);
+}
+
+/* --------------------------------------------------------------------------------------------- */
+/**
+ * Find the beginning of line counting newlines of pieces on the way.
+ *
+ * @param pt piece table
+ * @param p root of subtree
+ * @param line line number relative to subtree, it is decreased by newlines of passed pieces
+ * @param offset offset of subtree, it is increased by length of passed pieces
+ *
+ * @return TRUE if line is found in subtree
+ */
+
+static gboolean
+piece_find_line (edit_piece_table_t * pt, edit_piece_t * p, long *line, off_t * offset)
+{
+    gboolean found;
+
+    if (p == NULL)
+        return FALSE;
+
+    if (p->pending == 0 && *line > p->lines)
+    {
+        *line -= p->lines;
+        *offset += p->total;
+        return FALSE;
+    }
+
+    found = piece_find_line (pt, p->left, line, offset);
+    if (!found)
+    {
+        if (p->newlines < 0)
+        {
+            p->newlines = edit_count_newlines (p->data, p->len);
+            pt->counted += p->newlines;
+        }
+
+        if (*line <= p->newlines)
+        {
+            const char *nl = p->data - 1;
+
+            for (; *line > 0; (*line)--)
+            {
+                const char *next;
+
+                next = memchr (nl + 1, '\n', p->data + p->len - nl - 1);
+                /* mapped file is changed and newlines are counted wrong */
+                if (next == NULL)
+                    break;
+                nl = next;
+            }
+
+            *offset += (nl - p->data) + 1;
+            found = TRUE;
+        }
+        else
+        {
+            *line -= p->newlines;
+            *offset += p->len;
+            found = piece_find_line (pt, p->right, line, offset);
+        }
+    }
+
+    piece_update (p);
+    return found;
+}
+
+/* --------------------------------------------------------------------------------------------- */
+/**
+ * Get pointer to the first free byte of the add buffer.
+ *
+ * @return NULL if the last chunk is empty or full
+ */
+
+static const char *
+piece_table_add_tail (const edit_piece_table_t * pt)
+{
+    /* pieces of other memory blocks may end at the start of empty chunk */
+    if (pt->added->len == 0 || pt->added_len == 0 || pt->added_len == EDIT_PIECE_ADD_SIZE)
+        return NULL;
+
+    return (const char *) g_ptr_array_index (pt->added, pt->added->len - 1) + pt->added_len;
+}
+
+/* --------------------------------------------------------------------------------------------- */
+
+static const char *
+piece_table_add_byte (edit_piece_table_t * pt, char c)
+{
+    char *chunk;
+
+    if (pt->added->len == 0 || pt->added_len == EDIT_PIECE_ADD_SIZE)
+    {
+        g_ptr_array_add (pt->added, g_malloc (EDIT_PIECE_ADD_SIZE));
+        pt->added_len = 0;
+    }
+
+    chunk = (char *) g_ptr_array_index (pt->added, pt->added->len - 1) + pt->added_len;
+    *chunk = c;
+    pt->added_len++;
+
+    return chunk;
+}
+
+/* --------------------------------------------------------------------------------------------- */
+
+#ifdef HAVE_MMAP
+/**
+ * Replace page of truncated mapped file by zero page, other faults are left to other handlers.
+ */
+
+static gboolean
+piece_table_sigbus_handler (void *addr, void *data)
+{
+    const char *a = (const char *) addr;
+    GSList *l;
+
+    (void) data;
+
+    for (l = mapped_tables; l != NULL; l = g_slist_next (l))
+    {
+        edit_piece_table_t *pt = (edit_piece_table_t *) l->data;
+
+        if (a >= pt->original && a < pt->original + pt->original_size)
+        {
+            char *page;
+
+            page = pt->original + ((a - pt->original) & ~(page_size - 1));
+            if (mmap (page, (size_t) page_size, PROT_READ, MAP_PRIVATE | MAP_ANONYMOUS | MAP_FIXED,
+                      -1, 0) == MAP_FAILED)
+                return FALSE;
+
+            pt->truncated = 1;
+            return TRUE;
+        }
+    }
+
+    return FALSE;
+}
+
+/* --------------------------------------------------------------------------------------------- */
+
+/**
+ * Add SIGBUS handler of mapped tables once.
+ *
+ * @return TRUE if handler is added, FALSE if files must not be mapped
+ */
+
+static gboolean
+piece_table_sigbus_init (void)
+{
+    static gboolean handler_added = FALSE;
+
+    if (!handler_added)
+    {
+        page_size = sysconf (_SC_PAGESIZE);
+        handler_added = mc_sigbus_add_handler (piece_table_sigbus_handler, NULL);
+    }
+
+    return handler_added;
+}
+
+/* --------------------------------------------------------------------------------------------- */
+
+static void
+piece_table_watch_sigbus (edit_piece_table_t * pt)
+{
+    mapped_tables = g_slist_prepend (mapped_tables, pt);
+}
+
+/* --------------------------------------------------------------------------------------------- */
+
+static void
+piece_table_unwatch_sigbus (edit_piece_table_t * pt)
+{
+    mapped_tables = g_slist_remove (mapped_tables, pt);
+}
+
+/* --------------------------------------------------------------------------------------------- */
+
+static gboolean
+piece_table_file_is_changed (const edit_piece_table_t * pt)
+{
+    struct stat st;
+
+    if (pt->truncated != 0 || fstat (pt->fd, &st) != 0)
+        return TRUE;
+
+    return st.st_size != pt->st.st_size || st.st_mtime != pt->st.st_mtime
+        || st.st_ctime != pt->st.st_ctime
+#ifdef HAVE_STRUCT_STAT_ST_MTIM
+        || st.st_mtim.tv_nsec != pt->st.st_mtim.tv_nsec
+        || st.st_ctim.tv_nsec != pt->st.st_ctim.tv_nsec
+#endif
+        ;
+}
+
+/* --------------------------------------------------------------------------------------------- */
+/**
+ * Move pieces of the original text to its copy.
+ */
+
+static void
+piece_rebase (edit_piece_t * p, const char *from, off_t size, const char *to)
+{
+    for (; p != NULL; p = p->right)
+    {
+        piece_rebase (p->left, from, size, to);
+
+        if (p->data >= from && p->data < from + size)
+        {
+            p->data = to + (p->data - from);
+            p->newlines = edit_count_newlines (p->data, p->len);
+        }
+    }
+}
+
+/* --------------------------------------------------------------------------------------------- */
+
+static void
+piece_update_tree (edit_piece_t * p)
+{
+    if (p != NULL)
+    {
+        piece_update_tree (p->left);
+        piece_update_tree (p->right);
+        piece_update (p);
+    }
+}
+#endif /* HAVE_MMAP */
+
+/* --------------------------------------------------------------------------------------------- */
+
+static void
+piece_table_free_original (edit_piece_table_t * pt)
+{
+#ifdef HAVE_MMAP
+    if (pt->mapped)
+    {
+        munmap (pt->original, pt->original_size);
+        close (pt->fd);
+        piece_table_unwatch_sigbus (pt);
+    }
+    else
+#endif
+        g_free (pt->original);
+
+    pt->original = NULL;
+    pt->original_size = 0;
+    pt->mapped = FALSE;
+}
+
+/* --------------------------------------------------------------------------------------------- */
+/**
+ * Replace content of piece table by the original text.
+ *
+ * @param pt piece table
+ * @param data original text
+ * @param size size of data
+ * @param count_lines whether to count newlines now or later
+ */
+
+static void
+piece_table_set_original (edit_piece_table_t * pt, char *data, off_t size, gboolean count_lines)
+{
+    pt->original = data;
+    pt->original_size = size;
+
+    piece_free_tree (pt->root);
+    pt->root = NULL;
+    pt->cache = NULL;
+    pt->counted = 0;
+
+    while (size > 0)
+    {
+        off_t len;
+
+        len = MIN (size, EDIT_PIECE_MAX_LEN);
+        pt->root =
+            piece_merge (pt->root,
+                         piece_new (pt, data, len,
+                                    count_lines ? edit_count_newlines (data, len) : -1));
+        data += len;
+        size -= len;
+    }
+}
+
+/* --------------------------------------------------------------------------------------------- */
+/*** public functions ****************************************************************************/
+/* --------------------------------------------------------------------------------------------- */
+
+edit_piece_table_t *
+edit_piece_table_new (void)
+{
+    edit_piece_table_t *pt;
+
+    pt = g_new0 (edit_piece_table_t, 1);
+    pt->added = g_ptr_array_new_with_free_func (g_free);
+    pt->seed = 2463534242U;
+
+    return pt;
+}
+
+/* --------------------------------------------------------------------------------------------- */
+
+void
+edit_piece_table_free (edit_piece_table_t * pt)
+{
+    piece_free_tree (pt->root);
+    piece_table_free_original (pt);
+    g_ptr_array_free (pt->added, TRUE);
+    g_free (pt);
+}
+
+/* --------------------------------------------------------------------------------------------- */
+/**
+ * Set content of empty piece table.
+ *
+ * @param pt piece table
+ * @param data file content, it is owned by piece table since now
+ * @param size size of data
+ */
+
+void
+edit_piece_table_load (edit_piece_table_t * pt, char *data, off_t size)
+{
+    piece_table_free_original (pt);
+    piece_table_set_original (pt, data, size, TRUE);
+}
+
+/* --------------------------------------------------------------------------------------------- */
+/**
+ * Set content of empty piece table to the file mapped into memory. File is not read here:
+ * its pages are read by the system when they are accessed and newlines are counted lazily.
+ *
+ * @param pt piece table
+ * @param fd descriptor of regular local file, piece table keeps its duplicate
+ * @param size expected size of file
+ *
+ * @return TRUE if file is mapped, FALSE if it cannot be mapped and should be read
+ */
+
+gboolean
+edit_piece_table_map (edit_piece_table_t * pt, int fd, off_t size)
+{
+#ifdef HAVE_MMAP
+    struct stat st;
+    char *data;
+
+    if (fstat (fd, &st) != 0 || !S_ISREG (st.st_mode) || st.st_size != size || size <= 0
+        || (off_t) (size_t) size != size || !piece_table_sigbus_init ())
+        return FALSE;
+
+    fd = dup (fd);
+    if (fd < 0)
+        return FALSE;
+
+    data = mmap (NULL, (size_t) size, PROT_READ, MAP_FILE | MAP_PRIVATE, fd, 0);
+    if (data == (char *) MAP_FAILED)
+    {
+        close (fd);
+        return FALSE;
+    }
+
+    piece_table_free_original (pt);
+    piece_table_set_original (pt, data, size, FALSE);
+    pt->mapped = TRUE;
+    pt->fd = fd;
+    pt->st = st;
+    pt->truncated = 0;
+    piece_table_watch_sigbus (pt);
+
+    return TRUE;
+#else
+    (void) pt;
+    (void) fd;
+    (void) size;
+
+    return FALSE;
+#endif /* HAVE_MMAP */
+}
+
+/* --------------------------------------------------------------------------------------------- */
+
+gboolean
+edit_piece_table_is_mapped (const edit_piece_table_t * pt)
+{
+    return pt->mapped;
+}
+
+/* --------------------------------------------------------------------------------------------- */
+/**
+ * Check whether mapped file is changed by another program. If it is, text can't be kept
+ * consistent anymore: the file is read into memory as it is now, bytes beyond its new end
+ * are zeros, and newlines of all pieces are counted again.
+ *
+ * @param pt piece table
+ *
+ * @return TRUE if the file is changed and read, FALSE otherwise
+ */
+
+gboolean
+edit_piece_table_check_mapped (edit_piece_table_t * pt)
+{
+#ifdef HAVE_MMAP
+    char *data;
+    off_t done = 0;
+
+    if (!pt->mapped || !piece_table_file_is_changed (pt))
+        return FALSE;
+
+    data = g_malloc0 (pt->original_size);
+
+    if (lseek (pt->fd, 0, SEEK_SET) == 0)
+        while (done < pt->original_size)
+        {
+            ssize_t n;
+
+            n = read (pt->fd, data + done, pt->original_size - done);
+            if (n < 0 && errno == EINTR)
+                continue;
+            if (n <= 0)
+                break;
+            done += n;
+        }
+
+    piece_rebase (pt->root, pt->original, pt->original_size, data);
+    piece_update_tree (pt->root);
+
+    munmap (pt->original, pt->original_size);
+    close (pt->fd);
+    piece_table_unwatch_sigbus (pt);
+
+    pt->original = data;
+    pt->mapped = FALSE;
+    pt->counted = 0;
+    pt->cache = NULL;
+
+    return TRUE;
+#else
+    (void) pt;
+
+    return FALSE;
+#endif /* HAVE_MMAP */
+}
+
+/* --------------------------------------------------------------------------------------------- */
+/**
+ * Get pointer to contiguous block of bytes started at specified offset.
+ *
+ * @param pt piece table
+ * @param offset byte offset
+ * @param len length of block
+ *
+ * @return NULL if offset is negative or not less than text length; pointer to block otherwise.
+ */
+
+const char *
+edit_piece_table_get_block (edit_piece_table_t * pt, off_t offset, size_t * len)
+{
+    if (offset < 0 || offset >= piece_total (pt->root))
+    {
+        *len = 0;
+        return NULL;
+    }
+
+    /* sequential access usually stays in the same piece */
+    if (pt->cache == NULL || offset < pt->cache_start
+        || offset >= pt->cache_start + pt->cache->len)
+        pt->cache = piece_find (pt->root, offset, 0, 0, &pt->cache_start);
+
+    offset -= pt->cache_start;
+    *len = (size_t) (pt->cache->len - offset);
+
+    return pt->cache->data + offset;
+}
+
+/* --------------------------------------------------------------------------------------------- */
+/**
+ * Insert byte at specified offset.
+ *
+ * @param pt piece table
+ * @param offset byte offset, not greater than text length
+ * @param c byte to insert
+ */
+
+void
+edit_piece_table_insert (edit_piece_table_t * pt, off_t offset, char c)
+{
+    const char *tail;
+    edit_piece_t *p, *l, *r;
+    long nl = (c == '\n') ? 1 : 0;
+
+    pt->cache = NULL;
+
+    tail = piece_table_add_tail (pt);
+    if (offset > 0 && tail != NULL)
+    {
+        off_t start;
+
+        p = piece_find (pt->root, offset - 1, 0, 0, &start);
+        if (start + p->len == offset && p->data + p->len == tail)
+        {
+            /* continue the last insertion */
+            piece_table_add_byte (pt, c);
+            piece_find (pt->root, offset - 1, 1, nl, &start);
+            p->len++;
+            p->newlines += nl;
+            return;
+        }
+    }
+
+    p = piece_new (pt, piece_table_add_byte (pt, c), 1, nl);
+    piece_split (pt, pt->root, offset, &l, &r);
+    pt->root = piece_merge (piece_merge (l, p), r);
+}
+
+/* --------------------------------------------------------------------------------------------- */
+/**
+ * Delete byte at specified offset.
+ *
+ * @param pt piece table
+ * @param offset byte offset, less than text length
+ *
+ * @return deleted byte
+ */
+
+int
+edit_piece_table_delete (edit_piece_table_t * pt, off_t offset)
+{
+    edit_piece_t *p, *l, *m, *r;
+    off_t start;
+    unsigned char c;
+
+    pt->cache = NULL;
+
+    p = piece_find (pt->root, offset, 0, 0, &start);
+    c = (unsigned char) p->data[offset - start];
+
+    if (p->len > 1 && (offset == start || offset == start + p->len - 1))
+    {
+        long nl = (c == '\n') ? 1 : 0;
+
+        if (p->newlines < 0)
+        {
+            /* the caller counts deleted newline anyway */
+            pt->counted += nl;
+            nl = 0;
+        }
+
+        /* shrink piece */
+        piece_find (pt->root, offset, -1, -nl, &start);
+        p->newlines -= nl;
+
+        if (offset == start)
+            p->data++;
+        else if (p->data + p->len == piece_table_add_tail (pt))
+            pt->added_len--;    /* the last inserted byte is deleted: reuse its place */
+
+        p->len--;
+        return c;
+    }
+
+    piece_split (pt, pt->root, offset, &l, &r);
+    piece_split (pt, r, 1, &m, &r);
+    if (m->newlines < 0 && c == '\n')
+        pt->counted++;
+    piece_free_tree (m);
+    pt->root = piece_merge (l, r);
+
+    return c;
+}
+
+/* --------------------------------------------------------------------------------------------- */
+/**
+ * Count newlines before specified offset.
+ *
+ * @param pt piece table
+ * @param offset byte offset
+ *
+ * @return number of newlines in [0, offset)
+ */
+
+long
+edit_piece_table_count_lines (edit_piece_table_t * pt, off_t offset)
+{
+    const edit_piece_t *p;
+    long lines = 0;
+    off_t limit = offset;
+
+    piece_count (pt, pt->root, offset, &limit);
+    p = pt->root;
+
+    while (p != NULL)
+    {
+        off_t left_total;
+
+        left_total = piece_total (p->left);
+
+        if (offset < left_total)
+            p = p->left;
+        else if (offset >= left_total + p->len)
+        {
+            offset -= left_total + p->len;
+            lines += piece_lines (p->left) + p->newlines;
+            p = p->right;
+        }
+        else
+            return lines + piece_lines (p->left)
+                + edit_count_newlines (p->data, offset - left_total);
+    }
+
+    return lines;
+}
+
+/* --------------------------------------------------------------------------------------------- */
+/**
+ * Find the beginning of line.
+ *
+ * @param pt piece table
+ * @param line line number, from 1
+ *
+ * @return offset of the byte after the line-th newline or after the last newline
+ *         if there are less newlines
+ */
+
+off_t
+edit_piece_table_find_line (edit_piece_table_t * pt, long line)
+{
+    off_t offset = 0;
+
+    if (!piece_find_line (pt, pt->root, &line, &offset))
+    {
+        /* all pieces are counted now */
+        line = piece_lines (pt->root);
+        offset = 0;
+        if (line == 0 || !piece_find_line (pt, pt->root, &line, &offset))
+            return 0;
+    }
+
+    return offset;
+}
+
+/* --------------------------------------------------------------------------------------------- */
+/**
+ * Count newlines of pieces which are not counted yet.
+ *
+ * @param pt piece table
+ * @param offset count pieces started before this offset
+ * @param limit approximate number of bytes to count
+ *
+ * @return TRUE if some pieces are not counted yet
+ */
+
+gboolean
+edit_piece_table_count_pending (edit_piece_table_t * pt, off_t offset, off_t limit)
+{
+    piece_count (pt, pt->root, offset, &limit);
+    return piece_pending (pt->root) != 0;
+}
+
+/* --------------------------------------------------------------------------------------------- */
+/**
+ * Get number of newlines counted lazily since the previous call.
+ *
+ * @param pt piece table
+ *
+ * @return number of newlines
+ */
+
+long
+edit_piece_table_take_counted (edit_piece_table_t * pt)
+{
+    long counted = pt->counted;
+
+    pt->counted = 0;
+    return counted;
+}
+
+/* --------------------------------------------------------------------------------------------- */
@@ -0,0 +1,55 @@
+/** \file
+ *  \brief Header: piece table text keep buffer for WEdit
+ */
+
+#ifndef MC__EDIT_PIECE_H
+#define MC__EDIT_PIECE_H
+
+#include <string.h>             /* memchr() */
+
+/*** typedefs(not structures) and defined constants **********************************************/
+
+typedef struct edit_piece_table_struct edit_piece_table_t;
+
+/*** enums ***************************************************************************************/
+
+/*** structures declarations (and typedefs of structures)*****************************************/
+
+/*** global variables defined in .c file *********************************************************/
+
+/*** declarations of public functions ************************************************************/
+
+edit_piece_table_t *edit_piece_table_new (void);
+void edit_piece_table_free (edit_piece_table_t * pt);
+
+void edit_piece_table_load (edit_piece_table_t * pt, char *data, off_t size);
+gboolean edit_piece_table_map (edit_piece_table_t * pt, int fd, off_t size);
+gboolean edit_piece_table_is_mapped (const edit_piece_table_t * pt);
+gboolean edit_piece_table_check_mapped (edit_piece_table_t * pt);
+
+const char *edit_piece_table_get_block (edit_piece_table_t * pt, off_t offset, size_t * len);
+void edit_piece_table_insert (edit_piece_table_t * pt, off_t offset, char c);
+int edit_piece_table_delete (edit_piece_table_t * pt, off_t offset);
+
+long edit_piece_table_count_lines (edit_piece_table_t * pt, off_t offset);
+off_t edit_piece_table_find_line (edit_piece_table_t * pt, long line);
+gboolean edit_piece_table_count_pending (edit_piece_table_t * pt, off_t offset, off_t limit);
+long edit_piece_table_take_counted (edit_piece_table_t * pt);
+
+/*** inline functions ****************************************************************************/
+
+static inline long
+edit_count_newlines (const char *p, size_t len)
+{
+    const char *end = p + len;
+    long lines = 0;
+
+    for (; (p = memchr (p, '\n', end - p)) != NULL; p++)
+        lines++;
+
+    return lines;
+}
+
+/* --------------------------------------------------------------------------------------------- */
+
+#endif /* MC__EDIT_PIECE_H */
@@ -77,6 +77,9 @@ char *edit_window_close_char = NULL;
 #define WINDOW_MIN_LINES (2 + 2)
 #define WINDOW_MIN_COLS (2 + LINE_STATE_WIDTH + 2)
 
+/* bytes of mapped file which are counted for newlines in one idle step */
+#define EDIT_COUNT_LINES_STEP (4 * 1024 * 1024)
+
 /*** file scope type declarations ****************************************************************/
 
 /*** file scope variables ************************************************************************/
@@ -631,6 +634,34 @@ edit_translate_key (WEdit * edit, long x_key, int *cmd, int *ch)
 }
 
 
+/* --------------------------------------------------------------------------------------------- */
+/**
+ * Count next part of lines of lazily loaded files in background.
+ *
+ * @param h editor dialog
+ *
+ * @return TRUE if some lines are not counted yet
+ */
+
+static gboolean
+edit_count_pending_lines (WDialog * h)
+{
+    GList *l;
+    gboolean pending = FALSE;
+
+    for (l = h->widgets; l != NULL && !pending; l = g_list_next (l))
+        if (edit_widget_is_editor (CONST_WIDGET (l->data)))
+        {
+            WEdit *e = (WEdit *) l->data;
+
+            edit_check_mapped_file (e);
+            pending = edit_buffer_count_pending_lines (&e->buffer, e->buffer.size,
+                                                       EDIT_COUNT_LINES_STEP);
+        }
+
+    return pending;
+}
+
 /* --------------------------------------------------------------------------------------------- */
 
 static inline void
@@ -851,7 +882,7 @@ edit_dialog_callback (Widget * w, Widget * sender, widget_msg_t msg, int parm, v
         return MSG_HANDLED;
 
     case MSG_IDLE:
-        widget_idle (w, FALSE);
+        widget_idle (w, edit_count_pending_lines (h));
         return send_message (h->current->data, NULL, MSG_IDLE, 0, NULL);
 
     default:
@@ -948,6 +979,8 @@ edit_callback (Widget * w, Widget * sender, widget_msg_t msg, int parm, void *da
             int cmd, ch;
             cb_ret_t ret = MSG_NOT_HANDLED;
 
+            edit_check_mapped_file (e);
+
             /* The user may override the access-keys for the menu bar. */
             if (macro_index == -1 && edit_execute_macro (e, parm))
             {
@@ -966,6 +999,7 @@ edit_callback (Widget * w, Widget * sender, widget_msg_t msg, int parm, void *da
 
     case MSG_ACTION:
         /* command from menubar or buttonbar */
+        edit_check_mapped_file (e);
         edit_execute_key_command (e, parm, -1);
         edit_update_screen (e);
         return MSG_HANDLED;
@@ -983,6 +1017,7 @@ edit_callback (Widget * w, Widget * sender, widget_msg_t msg, int parm, void *da
         }
 
     case MSG_IDLE:
+        edit_check_mapped_file (e);
         edit_update_screen (e);
         return MSG_HANDLED;
 
@@ -1077,6 +1112,8 @@ edit_mouse_callback (Widget * w, mouse_msg_t msg, mouse_event_t * event)
         return;
     }
 
+    edit_check_mapped_file (edit);
+
     switch (msg)
     {
     case MSG_MOUSE_DOWN:
@@ -1293,6 +1330,10 @@ edit_update_screen (WEdit * e)
     edit_update_curs_col (e);
     edit_status (e, widget_get_state (WIDGET (e), WST_FOCUSED));
 
+    /* count the rest of lines when user is idle */
+    if (edit_buffer_count_pending_lines (&e->buffer, 0, 0))
+        widget_idle (WIDGET (h), TRUE);
+
     /* pop all events for this window for internal handling */
     if (!is_idle ())
         e->force |= REDRAW_PAGE;
@@ -13,8 +13,6 @@
 
 /*** typedefs(not structures) and defined constants **********************************************/
 
-#define N_LINE_CACHES 32
-
 /*** enums ***************************************************************************************/
 
 /**
@@ -125,11 +123,6 @@ struct WEdit
     off_t bracket;              /* position of a matching bracket */
     off_t last_bracket;         /* previous position of a matching bracket */
 
-    /* cache speedup for line lookups */
-    gboolean caches_valid;
-    long line_numbers[N_LINE_CACHES];
-    off_t line_offsets[N_LINE_CACHES];
-
     edit_book_mark_t *book_mark;
     GArray *serialized_bookmarks;
 
@@ -152,9 +145,12 @@ struct WEdit
     unsigned int skip_detach_prompt:1;  /* Do not prompt whether to detach a file anymore */
 
     /* syntax higlighting */
-    GSList *syntax_marker;
+    GArray *syntax_lines;       /* syntax states at the beginning of lines */
+    long syntax_valid;          /* number of valid states in syntax_lines */
+    long syntax_dirty;          /* states of lines before this one are not compared */
     GPtrArray *rules;
     off_t last_get_rule;
+    long syntax_line;           /* line containing byte after last_get_rule */
     edit_syntax_rule_t rule;
     char *syntax_type;          /* description of syntax highlighting type being used */
     GTree *defines;             /* List of defines */
@@ -151,6 +151,8 @@ end_paragraph (WEdit * edit, gboolean force)
 {
     long i;
 
+    edit_buffer_count_pending_lines (&edit->buffer, edit->buffer.size, 0);
+
     for (i = edit->buffer.curs_line + 1; i <= edit->buffer.lines; i++)
         if (edit_line_is_blank (edit, i) ||
             (force && bad_line_start (&edit->buffer, line_start (&edit->buffer, i))))
@@ -71,8 +71,8 @@ gboolean option_auto_syntax = TRUE;
 
 /*** file scope macro definitions ****************************************************************/
 
-/* bytes */
-#define SYNTAX_MARKER_DENSITY 512
+/* bytes which are lexed forward instead of using the state of line */
+#define SYNTAX_LEX_AHEAD 4096
 
 #define RULE_ON_LEFT_BORDER 1
 #define RULE_ON_RIGHT_BORDER 2
@@ -90,6 +90,13 @@ gboolean option_auto_syntax = TRUE;
 #define SYNTAX_KEYWORD(x) ((syntax_keyword_t *) (x))
 #define CONTEXT_RULE(x) ((context_rule_t *) (x))
 
+/* sets of bytes for whole word checks */
+#define SYNTAX_CHARSET_SIZE 32
+#define SYNTAX_CHARSET_ADD(set, c) \
+    ((set)[(unsigned char) (c) >> 3] |= 1 << ((unsigned char) (c) & 7))
+#define SYNTAX_CHARSET_HAS(set, c) \
+    (((set)[(unsigned char) (c) >> 3] & (1 << ((unsigned char) (c) & 7))) != 0)
+
 /*** file scope type declarations ****************************************************************/
 
 typedef struct
@@ -99,8 +106,22 @@ typedef struct
     char *whole_word_chars_right;
     long line_start;
     int color;
+    /* compiled keyword */
+    size_t literal;             /* length of prefix before the first wildcard */
+    int next;                   /* next keyword with the same literal prefix */
+    unsigned char whole_left[SYNTAX_CHARSET_SIZE];
+    unsigned char whole_right[SYNTAX_CHARSET_SIZE];
 } syntax_keyword_t;
 
+/* node of trie of literal prefixes of keywords */
+typedef struct
+{
+    unsigned char c;            /* byte leading to this node */
+    int next;                   /* next sibling node */
+    int child;                  /* first child node */
+    int keyword;                /* first keyword with this literal prefix */
+} syntax_trie_node_t;
+
 typedef struct
 {
     char *left;
@@ -112,18 +133,14 @@ typedef struct
     int between_delimiters;
     char *whole_word_chars_left;
     char *whole_word_chars_right;
-    char *keyword_first_chars;
     gboolean spelling;
     /* first word is word[1] */
     GPtrArray *keyword;
+    /* trie of keywords, root is node 0; nodes for the first byte are looked up directly */
+    GArray *keyword_trie;
+    int *keyword_first;
 } context_rule_t;
 
-typedef struct
-{
-    off_t offset;
-    edit_syntax_rule_t rule;
-} syntax_marker_t;
-
 /*** file scope variables ************************************************************************/
 
 static char *error_file_name = NULL;
@@ -154,7 +171,10 @@ context_rule_free (gpointer rule)
     g_free (r->right);
     g_free (r->whole_word_chars_left);
     g_free (r->whole_word_chars_right);
-    g_free (r->keyword_first_chars);
+    g_free (r->keyword_first);
+
+    if (r->keyword_trie != NULL)
+        g_array_free (r->keyword_trie, TRUE);
 
     if (r->keyword != NULL)
     {
@@ -350,14 +370,123 @@ compare_word_to_right (const WEdit * edit, off_t i, const char *text,
 }
 
 /* --------------------------------------------------------------------------------------------- */
+/**
+ * Check whether keyword matches text at specified offset, whose literal prefix is already matched.
+ *
+ * @param edit editor object
+ * @param k keyword
+ * @param i offset of the beginning of keyword
+ * @param left byte before keyword, in lower case in case insensitive mode
+ * @param end offset after literal prefix of keyword
+ *
+ * @return offset after keyword, -1 if keyword doesn't match
+ */
 
-static const char *
-xx_strchr (const WEdit * edit, const unsigned char *s, int char_byte)
+static off_t
+syntax_keyword_match (const WEdit * edit, const syntax_keyword_t * k, off_t i, int left, off_t end)
 {
-    while (*s >= '\005' && xx_tolower (edit, *s) != char_byte)
-        s++;
+    int c;
+
+    if (k->keyword[k->literal] != '\0')
+        return compare_word_to_right (edit, i, k->keyword, k->whole_word_chars_left,
+                                      k->whole_word_chars_right, k->line_start);
+
+    if (k->literal == 0 || (k->line_start != 0 && left != '\n')
+        || SYNTAX_CHARSET_HAS (k->whole_left, left))
+        return -1;
 
-    return (const char *) s;
+    c = xx_tolower (edit, edit_buffer_get_byte (&edit->buffer, end));
+
+    return SYNTAX_CHARSET_HAS (k->whole_right, c) ? -1 : end;
+}
+
+/* --------------------------------------------------------------------------------------------- */
+
+static inline int
+syntax_trie_next (const context_rule_t * r, int node, int c)
+{
+    const syntax_trie_node_t *trie = (const syntax_trie_node_t *) r->keyword_trie->data;
+
+    if (node == 0)
+        return r->keyword_first[c];
+
+    for (node = trie[node].child; node != 0 && trie[node].c != c; node = trie[node].next)
+        ;
+
+    return node;
+}
+
+/* --------------------------------------------------------------------------------------------- */
+/**
+ * Find the first keyword of context which matches text at specified offset.
+ * Literal prefixes of all keywords are matched at once by walking the trie over contiguous
+ * blocks of buffer, so the cost doesn't depend on the number of keywords.
+ *
+ * @param edit editor object
+ * @param r context rule
+ * @param i offset
+ * @param c byte at offset, in lower case in case insensitive mode
+ * @param end offset after found keyword
+ *
+ * @return index of keyword in context, 0 if no keyword is found
+ */
+
+static int
+syntax_find_keyword (const WEdit * edit, const context_rule_t * r, off_t i, int c, off_t * end)
+{
+    const unsigned char *p = NULL;
+    size_t len = 0;
+    off_t j;
+    int left, node;
+    int found = 0;
+
+    if (r->keyword_trie == NULL)
+        return 0;
+
+    left = xx_tolower (edit, edit_buffer_get_byte (&edit->buffer, i - 1));
+
+    /* keywords started with wildcard are in the root */
+    for (node = 0, j = i; TRUE; j++)
+    {
+        int k;
+
+        /* keywords with the same prefix are sorted, the first matched one wins */
+        for (k = g_array_index (r->keyword_trie, syntax_trie_node_t, node).keyword;
+             k != 0 && (found == 0 || k < found);
+             k = SYNTAX_KEYWORD (g_ptr_array_index (r->keyword, k))->next)
+        {
+            off_t e;
+
+            e = syntax_keyword_match (edit, SYNTAX_KEYWORD (g_ptr_array_index (r->keyword, k)),
+                                      i, left, j);
+            if (e > 0)
+            {
+                found = k;
+                *end = e;
+                break;
+            }
+        }
+
+        if (j != i)
+        {
+            if (len == 0)
+                p = (const unsigned char *) edit_buffer_get_block (&edit->buffer, j, &len);
+
+            if (p == NULL)
+                c = '\n';
+            else
+            {
+                c = xx_tolower (edit, *p++);
+                len--;
+            }
+        }
+
+        node = syntax_trie_next (r, node, c);
+        if (node == 0)
+            break;
+    }
+
+    return found;
 }
 
 /* --------------------------------------------------------------------------------------------- */
@@ -428,31 +557,18 @@ apply_rules_going_right (WEdit * edit, off_t i)
     /* check to turn on a keyword */
     if (_rule.keyword == 0)
     {
-        const char *p;
+        int count;
+        off_t e;
 
         r = CONTEXT_RULE (g_ptr_array_index (edit->rules, _rule.context));
-        p = r->keyword_first_chars;
-
-        if (p != NULL)
-            while (*(p = xx_strchr (edit, (const unsigned char *) p + 1, c)) != '\0')
-            {
-                syntax_keyword_t *k;
-                int count;
-                off_t e;
-
-                count = p - r->keyword_first_chars;
-                k = SYNTAX_KEYWORD (g_ptr_array_index (r->keyword, count));
-                e = compare_word_to_right (edit, i, k->keyword, k->whole_word_chars_left,
-                                           k->whole_word_chars_right, k->line_start);
-                if (e > 0)
-                {
-                    end = e;
-                    _rule.end = e;
-                    _rule.keyword = count;
-                    keyword_foundright = TRUE;
-                    break;
-                }
-            }
+        count = syntax_find_keyword (edit, r, i, c, &e);
+        if (count != 0)
+        {
+            end = e;
+            _rule.end = e;
+            _rule.keyword = count;
+            keyword_foundright = TRUE;
+        }
     }
 
     /* check to turn on a context */
@@ -530,27 +646,15 @@ apply_rules_going_right (WEdit * edit, off_t i)
     /* check again to turn on a keyword if the context switched */
     if (contextchanged && _rule.keyword == 0)
     {
-        const char *p;
+        int count;
+        off_t e;
 
         r = CONTEXT_RULE (g_ptr_array_index (edit->rules, _rule.context));
-        p = r->keyword_first_chars;
-
-        while (*(p = xx_strchr (edit, (const unsigned char *) p + 1, c)) != '\0')
+        count = syntax_find_keyword (edit, r, i, c, &e);
+        if (count != 0)
         {
-            syntax_keyword_t *k;
-            int count;
-            off_t e;
-
-            count = p - r->keyword_first_chars;
-            k = SYNTAX_KEYWORD (g_ptr_array_index (r->keyword, count));
-            e = compare_word_to_right (edit, i, k->keyword, k->whole_word_chars_left,
-                                       k->whole_word_chars_right, k->line_start);
-            if (e > 0)
-            {
-                _rule.end = e;
-                _rule.keyword = count;
-                break;
-            }
+            _rule.end = e;
+            _rule.keyword = count;
         }
     }
 
@@ -559,61 +663,146 @@ apply_rules_going_right (WEdit * edit, off_t i)
 
 /* --------------------------------------------------------------------------------------------- */
 
-static void
-edit_get_rule (WEdit * edit, off_t byte_index)
+/**
+ * Save syntax state at the beginning of line edit->syntax_line into the line cache.
+ * The end of rule is saved relative to the beginning of line.
+ *
+ * @param edit editor object
+ * @param bol offset of the beginning of line
+ *
+ * @return TRUE if saved state is equal to the cached one which was computed before editing,
+ *         so states of all following lines are valid again
+ */
+
+static gboolean
+syntax_save_line (WEdit * edit, off_t bol)
 {
-    off_t i;
+    long line = edit->syntax_line;
+    edit_syntax_rule_t rule = edit->rule;
+    edit_syntax_rule_t *cached;
+
+    if (line != edit->syntax_valid)
+        return FALSE;
 
-    if (byte_index > edit->last_get_rule)
+    rule.end = (rule.end < bol) ? -1 : rule.end - bol;
+
+    if (line >= (long) edit->syntax_lines->len)
     {
-        for (i = edit->last_get_rule + 1; i <= byte_index; i++)
+        g_array_append_val (edit->syntax_lines, rule);
+        edit->syntax_valid++;
+        return FALSE;
+    }
+
+    cached = &g_array_index (edit->syntax_lines, edit_syntax_rule_t, line);
+
+    if (line >= edit->syntax_dirty)
+    {
+        if (cached->keyword == rule.keyword && cached->end == rule.end
+            && cached->context == rule.context && cached->_context == rule._context
+            && cached->border == rule.border)
         {
-            off_t d = SYNTAX_MARKER_DENSITY;
+            /* text after this line is not changed and is lexed in the same way */
+            edit->syntax_valid = edit->syntax_lines->len;
+            edit->syntax_dirty = 0;
+            return TRUE;
+        }
 
-            apply_rules_going_right (edit, i);
+        /* states of following lines were computed before editing, but this one is not */
+        edit->syntax_dirty = line + 1;
+    }
 
-            if (edit->syntax_marker != NULL)
-                d += ((syntax_marker_t *) edit->syntax_marker->data)->offset;
+    *cached = rule;
+    edit->syntax_valid++;
+    return FALSE;
+}
 
-            if (i > d)
-            {
-                syntax_marker_t *s;
+/* --------------------------------------------------------------------------------------------- */
+/**
+ * Restore syntax state at the beginning of line from the line cache.
+ *
+ * @param edit editor object
+ * @param line line number, less than edit->syntax_valid
+ */
 
-                s = g_new (syntax_marker_t, 1);
-                s->offset = i;
-                s->rule = edit->rule;
-                edit->syntax_marker = g_slist_prepend (edit->syntax_marker, s);
-            }
-        }
+static void
+syntax_restore_line (WEdit * edit, long line)
+{
+    off_t bol;
+
+    bol = edit_buffer_find_line (&edit->buffer, line);
+
+    edit->rule = g_array_index (edit->syntax_lines, edit_syntax_rule_t, line);
+    edit->rule.end = (edit->rule.end < 0) ? -1 : bol + edit->rule.end;
+    edit->last_get_rule = bol - 1;
+    edit->syntax_line = line;
+}
+
+/* --------------------------------------------------------------------------------------------- */
+/**
+ * Start lexing from the nearest valid line before specified offset, unless the current
+ * state is closer to it.
+ *
+ * @param edit editor object
+ * @param byte_index byte offset
+ */
+
+static void
+syntax_restore (WEdit * edit, off_t byte_index)
+{
+    long line;
+
+    line = edit_buffer_count_lines (&edit->buffer, 0, byte_index);
+    line = MIN (line, edit->syntax_valid - 1);
+
+    if (edit->last_get_rule > byte_index || edit->syntax_line < line)
+        syntax_restore_line (edit, line);
+}
+
+/* --------------------------------------------------------------------------------------------- */
+
+static void
+edit_get_rule (WEdit * edit, off_t byte_index)
+{
+    off_t i;
+
+    if (edit->syntax_lines == NULL)
+    {
+        edit->syntax_lines = g_array_new (FALSE, FALSE, sizeof (edit_syntax_rule_t));
+        edit->syntax_valid = 0;
+        edit->syntax_dirty = 0;
     }
-    else if (byte_index < edit->last_get_rule)
+
+    if (edit->syntax_valid == 0)
     {
-        while (TRUE)
-        {
-            syntax_marker_t *s;
+        /* state of the first line: before the beginning of file */
+        edit->syntax_line = 0;
+        memset (&edit->rule, 0, sizeof (edit->rule));
+        apply_rules_going_right (edit, -1);
+        syntax_save_line (edit, 0);
+        edit->last_get_rule = -1;
+    }
 
-            if (edit->syntax_marker == NULL)
-            {
-                memset (&edit->rule, 0, sizeof (edit->rule));
-                for (i = -1; i <= byte_index; i++)
-                    apply_rules_going_right (edit, i);
-                break;
-            }
+    if (byte_index < edit->last_get_rule || byte_index > edit->last_get_rule + SYNTAX_LEX_AHEAD)
+        syntax_restore (edit, byte_index);
+
+    for (i = edit->last_get_rule + 1; i <= byte_index; i++)
+    {
+        apply_rules_going_right (edit, i);
 
-            s = (syntax_marker_t *) edit->syntax_marker->data;
+        if (edit_buffer_get_byte (&edit->buffer, i) == '\n')
+        {
+            edit->syntax_line++;
+            edit->last_get_rule = i;
 
-            if (byte_index >= s->offset)
+            /* skip lines lexed before editing */
+            if (syntax_save_line (edit, i + 1))
             {
-                edit->rule = s->rule;
-                for (i = s->offset + 1; i <= byte_index; i++)
-                    apply_rules_going_right (edit, i);
-                break;
+                syntax_restore (edit, byte_index);
+                i = edit->last_get_rule;
             }
-
-            g_free (s);
-            edit->syntax_marker = g_slist_delete_link (edit->syntax_marker, edit->syntax_marker);
         }
     }
+
     edit->last_get_rule = byte_index;
 }
 
@@ -905,6 +1094,90 @@ xx_lowerize_line (WEdit * edit, char *line, size_t len)
     }
 }
 
+/* --------------------------------------------------------------------------------------------- */
+
+static void
+syntax_charset_fill (unsigned char *set, const char *chars)
+{
+    if (chars == NULL)
+        return;
+
+    /* strchr() finds terminating '\0' too */
+    SYNTAX_CHARSET_ADD (set, 0);
+    for (; *chars != '\0'; chars++)
+        SYNTAX_CHARSET_ADD (set, (unsigned char) *chars);
+}
+
+/* --------------------------------------------------------------------------------------------- */
+
+static int
+syntax_trie_add (context_rule_t * r, int node, unsigned char c)
+{
+    syntax_trie_node_t n;
+    int child;
+
+    child = syntax_trie_next (r, node, c);
+    if (child != 0)
+        return child;
+
+    memset (&n, 0, sizeof (n));
+    n.c = c;
+    child = r->keyword_trie->len;
+
+    if (node == 0)
+        r->keyword_first[c] = child;
+    else
+    {
+        syntax_trie_node_t *parent;
+
+        parent = &g_array_index (r->keyword_trie, syntax_trie_node_t, node);
+        n.next = parent->child;
+        parent->child = child;
+    }
+
+    g_array_append_val (r->keyword_trie, n);
+
+    return child;
+}
+
+/* --------------------------------------------------------------------------------------------- */
+/**
+ * Compile keywords of context: build the trie of literal prefixes of keywords and sets of
+ * whole word characters.
+ *
+ * @param r context rule
+ */
+
+static void
+context_rule_compile_keywords (context_rule_t * r)
+{
+    guint i;
+
+    r->keyword_trie = g_array_new (FALSE, TRUE, sizeof (syntax_trie_node_t));
+    g_array_set_size (r->keyword_trie, 1);
+    r->keyword_first = g_new0 (int, 256);
+
+    /* add keywords in reverse order to keep lists of keywords with the same prefix sorted */
+    for (i = r->keyword->len - 1; i > 0; i--)
+    {
+        syntax_keyword_t *k;
+        const unsigned char *p;
+        int node = 0;
+
+        k = SYNTAX_KEYWORD (g_ptr_array_index (r->keyword, i));
+
+        syntax_charset_fill (k->whole_left, k->whole_word_chars_left);
+        syntax_charset_fill (k->whole_right, k->whole_word_chars_right);
+
+        for (p = (const unsigned char *) k->keyword; *p > SYNTAX_TOKEN_BRACE; p++)
+            node = syntax_trie_add (r, node, *p);
+
+        k->literal = (const char *) p - k->keyword;
+        k->next = g_array_index (r->keyword_trie, syntax_trie_node_t, node).keyword;
+        g_array_index (r->keyword_trie, syntax_trie_node_t, node).keyword = i;
+    }
+}
+
 /* --------------------------------------------------------------------------------------------- */
 /** returns line number on error */
 
@@ -1207,35 +1480,10 @@ edit_read_syntax_rules (WEdit * edit, FILE * f, char **args, int args_size)
 
     if (result == 0)
     {
-        size_t i;
-        GString *first_chars;
-
         if (edit->rules == NULL)
             return line;
 
-        first_chars = g_string_sized_new (32);
-
-        /* collect first character of keywords */
-        for (i = 0; i < edit->rules->len; i++)
-        {
-            size_t j;
-
-            g_string_set_size (first_chars, 0);
-            c = CONTEXT_RULE (g_ptr_array_index (edit->rules, i));
-
-            g_string_append_c (first_chars, (char) 1);
-            for (j = 1; j < c->keyword->len; j++)
-            {
-                syntax_keyword_t *k;
-
-                k = SYNTAX_KEYWORD (g_ptr_array_index (c->keyword, j));
-                g_string_append_c (first_chars, k->keyword[0]);
-            }
-
-            c->keyword_first_chars = g_strndup (first_chars->str, first_chars->len);
-        }
-
-        g_string_free (first_chars, TRUE);
+        g_ptr_array_foreach (edit->rules, (GFunc) context_rule_compile_keywords, NULL);
     }
 
     return result;
@@ -1419,6 +1667,77 @@ edit_get_syntax_color (WEdit * edit, off_t byte_index)
     return EDITOR_NORMAL_COLOR;
 }
 
+/* --------------------------------------------------------------------------------------------- */
+/**
+ * Invalidate syntax states from the changed line forward. States of following lines are kept
+ * to be compared with new ones: once the state at the beginning of unchanged line is the same
+ * as before, states of all following lines are valid again.
+ *
+ * @param edit editor object
+ * @param line line containing changed text
+ * @param newlines 1 if newline is inserted, -1 if newline at the end of line is deleted
+ */
+
+void
+edit_syntax_changed (WEdit * edit, long line, int newlines)
+{
+    GArray *lines = edit->syntax_lines;
+
+    if (lines == NULL)
+        return;
+
+    if (newlines > 0 && line < (long) lines->len)
+    {
+        /* array can be reallocated while inserting */
+        edit_syntax_rule_t rule = g_array_index (lines, edit_syntax_rule_t, line);
+
+        g_array_insert_val (lines, line + 1, rule);
+    }
+    else if (newlines < 0 && line + 1 < (long) lines->len)
+        g_array_remove_index (lines, line + 1);
+
+    /* states of lines after the changed ones can be compared */
+    if (edit->syntax_dirty < edit->syntax_valid)
+        edit->syntax_dirty = 0;
+    else if (edit->syntax_dirty > line)
+        edit->syntax_dirty += newlines;
+    edit->syntax_dirty = MAX (edit->syntax_dirty, line + 1 + MAX (newlines, 0));
+
+    /* state at the beginning of line depends on text of line due to look-ahead of rules */
+    edit->syntax_valid = MIN (edit->syntax_valid, line);
+
+    if (edit->syntax_line < line)
+        return;
+
+    if (edit->syntax_valid != 0)
+        syntax_restore_line (edit, edit->syntax_valid - 1);
+    else
+    {
+        /* recompute state of the first line on next request */
+        edit->syntax_line = 0;
+        edit->last_get_rule = -1;
+    }
+}
+
+/* --------------------------------------------------------------------------------------------- */
+/**
+ * Forget syntax states of all lines when whole text is changed.
+ *
+ * @param edit editor object
+ */
+
+void
+edit_syntax_reset (WEdit * edit)
+{
+    if (edit->syntax_lines != NULL)
+        g_array_set_size (edit->syntax_lines, 0);
+
+    edit->syntax_valid = 0;
+    edit->syntax_dirty = 0;
+    edit->syntax_line = 0;
+    edit->last_get_rule = -1;
+}
+
 /* --------------------------------------------------------------------------------------------- */
 
 void
@@ -1433,14 +1752,16 @@ edit_free_syntax_rules (WEdit * edit)
     if (edit->rules == NULL)
         return;
 
-    edit_get_rule (edit, -1);
     MC_PTR_FREE (edit->syntax_type);
 
     g_ptr_array_foreach (edit->rules, (GFunc) context_rule_free, NULL);
     g_ptr_array_free (edit->rules, TRUE);
     edit->rules = NULL;
-    g_slist_free_full (edit->syntax_marker, g_free);
-    edit->syntax_marker = NULL;
+    if (edit->syntax_lines != NULL)
+    {
+        g_array_free (edit->syntax_lines, TRUE);
+        edit->syntax_lines = NULL;
+    }
     tty_color_free_all_tmp ();
 }
 
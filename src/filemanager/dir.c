@@ -32,6 +32,7 @@
 
 #include <stdio.h>
 #include <stdlib.h>
+#include <errno.h>
 #include <string.h>
 #include <sys/stat.h>
 
@@ -59,8 +60,21 @@
         ? 1 \
         : ( (S_ISDIR (x->st.st_mode) || link_isdir (x)) ? 2 : 0) )
 
+/* Number of entries requested from VFS by one mc_readdir_plus() call */
+#define DIR_READ_BATCH 64
+
 /*** file scope type declarations ****************************************************************/
 
+/* Directory reader which uses batched readdir_plus method of VFS if it is available */
+typedef struct
+{
+    DIR *dirp;
+    gboolean plus;              /* VFS supports mc_readdir_plus() */
+    vfs_dirent_plus_t batch[DIR_READ_BATCH];
+    int len;                    /* number of entries in batch */
+    int pos;                    /* next entry in batch */
+} dir_reader_t;
+
 /*** file scope variables ************************************************************************/
 
 /* Reverse flag */
@@ -139,6 +153,48 @@ clean_sort_keys (dir_list * list, int start, int count)
     }
 }
 
+/* --------------------------------------------------------------------------------------------- */
+/**
+ * Check whether file name matches the filter.
+ * @return TRUE if name matches or there is no filter
+ */
+
+static gboolean
+dir_filter_match (dir_filter_t * fltr, const char *name)
+{
+    size_t len;
+
+    if (fltr == NULL)
+        return TRUE;
+
+    if (fltr->search != NULL)
+        return mc_search_run (fltr->search, name, 0, strlen (name), NULL);
+
+    /* empty pattern matches nothing */
+    if (fltr->suffix == NULL)
+        return FALSE;
+
+    /* simple "*suffix" pattern */
+    len = strlen (name);
+    return (len >= fltr->suffix_len
+            && memcmp (name + len - fltr->suffix_len, fltr->suffix, fltr->suffix_len) == 0);
+}
+
+/* --------------------------------------------------------------------------------------------- */
+
+static gboolean
+dirent_name_is_shown (const char *name)
+{
+    if (DIR_IS_DOT (name) || DIR_IS_DOTDOT (name))
+        return FALSE;
+    if (!panels_options.show_dot_files && (name[0] == '.'))
+        return FALSE;
+    if (!panels_options.show_backups && name[strlen (name) - 1] == '~')
+        return FALSE;
+
+    return TRUE;
+}
+
 /* --------------------------------------------------------------------------------------------- */
 /**
  * If you change handle_dirent then check also handle_path.
@@ -146,16 +202,12 @@ clean_sort_keys (dir_list * list, int start, int count)
  */
 
 static gboolean
-handle_dirent (struct dirent *dp, const char *fltr, struct stat *buf1, int *link_to_dir,
+handle_dirent (struct dirent *dp, dir_filter_t * fltr, struct stat *buf1, int *link_to_dir,
                int *stale_link)
 {
     vfs_path_t *vpath;
 
-    if (DIR_IS_DOT (dp->d_name) || DIR_IS_DOTDOT (dp->d_name))
-        return FALSE;
-    if (!panels_options.show_dot_files && (dp->d_name[0] == '.'))
-        return FALSE;
-    if (!panels_options.show_backups && dp->d_name[strlen (dp->d_name) - 1] == '~')
+    if (!dirent_name_is_shown (dp->d_name))
         return FALSE;
 
     vpath = vfs_path_from_str (dp->d_name);
@@ -187,8 +239,114 @@ handle_dirent (struct dirent *dp, const char *fltr, struct stat *buf1, int *link
 
     vfs_path_free (vpath);
 
-    return (S_ISDIR (buf1->st_mode) || *link_to_dir != 0 || fltr == NULL
-            || mc_search (fltr, NULL, dp->d_name, MC_SEARCH_T_GLOB));
+    return (S_ISDIR (buf1->st_mode) || *link_to_dir != 0 || dir_filter_match (fltr, dp->d_name));
+}
+
+/* --------------------------------------------------------------------------------------------- */
+/**
+ * The same as handle_dirent, but attributes of entry are already got from VFS.
+ * @return FALSE = don't add, TRUE = add to the list
+ */
+
+static gboolean
+handle_dirent_plus (const vfs_dirent_plus_t * de, dir_filter_t * fltr)
+{
+    if (!dirent_name_is_shown (de->name))
+        return FALSE;
+
+    if (S_ISDIR (de->st.st_mode))
+        tree_store_mark_checked (de->name);
+
+    return (S_ISDIR (de->st.st_mode) || de->link_to_dir || dir_filter_match (fltr, de->name));
+}
+
+/* --------------------------------------------------------------------------------------------- */
+
+static DIR *
+dir_reader_open (dir_reader_t * reader, const vfs_path_t * vpath)
+{
+    reader->dirp = mc_opendir (vpath);
+    reader->plus = TRUE;
+    reader->len = 0;
+    reader->pos = 0;
+
+    return reader->dirp;
+}
+
+/* --------------------------------------------------------------------------------------------- */
+/**
+ * Get next directory entry which should be added to the list.
+ * Name of entry is valid until next call.
+ *
+ * @return FALSE at the end of directory
+ */
+
+static gboolean
+dir_reader_next (dir_reader_t * reader, dir_filter_t * fltr, const char **name, struct stat *st,
+                 int *link_to_dir, int *stale_link)
+{
+    struct dirent *dp;
+
+    while (reader->plus)
+    {
+        vfs_dirent_plus_t *de;
+
+        if (reader->pos == reader->len)
+        {
+            int i;
+
+            for (i = 0; i < reader->len; i++)
+                g_free (reader->batch[i].name);
+            reader->pos = 0;
+            reader->len = mc_readdir_plus (reader->dirp, reader->batch, DIR_READ_BATCH);
+
+            if (reader->len == -1)
+            {
+                reader->len = 0;
+                if (errno != E_NOTSUPP)
+                    return FALSE;
+                /* fallback to entry-by-entry reading */
+                reader->plus = FALSE;
+                break;
+            }
+
+            if (reader->len == 0)
+                return FALSE;
+        }
+
+        de = &reader->batch[reader->pos++];
+        if (handle_dirent_plus (de, fltr))
+        {
+            *name = de->name;
+            *st = de->st;
+            *link_to_dir = de->link_to_dir ? 1 : 0;
+            *stale_link = de->stale_link ? 1 : 0;
+            return TRUE;
+        }
+    }
+
+    while ((dp = mc_readdir (reader->dirp)) != NULL)
+        if (handle_dirent (dp, fltr, st, link_to_dir, stale_link))
+        {
+            *name = dp->d_name;
+            return TRUE;
+        }
+
+    return FALSE;
+}
+
+/* --------------------------------------------------------------------------------------------- */
+
+static void
+dir_reader_close (dir_reader_t * reader)
+{
+    int i;
+
+    for (i = 0; i < reader->len; i++)
+        g_free (reader->batch[i].name);
+    reader->len = 0;
+
+    mc_closedir (reader->dirp);
 }
 
 /* --------------------------------------------------------------------------------------------- */
@@ -325,6 +483,7 @@ dir_list_append (dir_list * list, const char *fname, const struct stat * st,
     fentry->st = *st;
     fentry->sort_key = NULL;
     fentry->second_sort_key = NULL;
+    fentry->fhl_id = 0;
 
     list->len++;
 
@@ -622,10 +781,10 @@ handle_path (const char *path, struct stat * buf1, int *link_to_dir, int *stale_
 
 void
 dir_list_load (dir_list * list, const vfs_path_t * vpath, GCompareFunc sort,
-               const dir_sort_options_t * sort_op, const char *fltr)
+               const dir_sort_options_t * sort_op, dir_filter_t * fltr)
 {
-    DIR *dirp;
-    struct dirent *dp;
+    dir_reader_t reader;
+    const char *name;
     int link_to_dir, stale_link;
     struct stat st;
     file_entry_t *fentry;
@@ -639,8 +798,7 @@ dir_list_load (dir_list * list, const vfs_path_t * vpath, GCompareFunc sort,
     if (dir_get_dotdot_stat (vpath, &st))
         fentry->st = st;
 
-    dirp = mc_opendir (vpath);
-    if (dirp == NULL)
+    if (dir_reader_open (&reader, vpath) == NULL)
     {
         message (D_ERROR, MSG_ERROR, _("Cannot read directory contents"));
         return;
@@ -653,12 +811,9 @@ dir_list_load (dir_list * list, const vfs_path_t * vpath, GCompareFunc sort,
     if (IS_PATH_SEP (vpath_str[0]) && vpath_str[1] == '\0')
         dir_list_clean (list);
 
-    while ((dp = mc_readdir (dirp)) != NULL)
+    while (dir_reader_next (&reader, fltr, &name, &st, &link_to_dir, &stale_link))
     {
-        if (!handle_dirent (dp, fltr, &st, &link_to_dir, &stale_link))
-            continue;
-
-        if (!dir_list_append (list, dp->d_name, &st, link_to_dir != 0, stale_link != 0))
+        if (!dir_list_append (list, name, &st, link_to_dir != 0, stale_link != 0))
             goto ret;
 
         if ((list->len & 31) == 0)
@@ -668,7 +823,7 @@ dir_list_load (dir_list * list, const vfs_path_t * vpath, GCompareFunc sort,
     dir_list_sort (list, sort, sort_op);
 
   ret:
-    mc_closedir (dirp);
+    dir_reader_close (&reader);
     tree_store_end_check ();
     rotate_dash (FALSE);
 }
@@ -685,23 +840,74 @@ if_link_is_exe (const vfs_path_t * full_name_vpath, const file_entry_t * file)
     return TRUE;
 }
 
+/* --------------------------------------------------------------------------------------------- */
+/**
+ * Compile the shell pattern used to filter directory listing.
+ * Patterns like "*.ext" don't need a regular expression and matched by file name suffix.
+ *
+ * @param pattern shell pattern
+ * @return compiled filter, NULL if pattern is NULL. Use #dir_filter_free() to free it.
+ */
+
+dir_filter_t *
+dir_filter_new (const char *pattern)
+{
+    dir_filter_t *fltr;
+
+    if (pattern == NULL)
+        return NULL;
+
+    fltr = g_new0 (dir_filter_t, 1);
+
+    /* chars which have special meaning in glob or are passed as is into regex */
+    if (pattern[0] == '*' && strpbrk (pattern + 1, "*?{}[]|\\") == NULL)
+    {
+        fltr->suffix = g_strdup (pattern + 1);
+        fltr->suffix_len = strlen (fltr->suffix);
+    }
+    else
+    {
+        fltr->search = mc_search_new (pattern, NULL);
+        if (fltr->search != NULL)
+        {
+            fltr->search->search_type = MC_SEARCH_T_GLOB;
+            fltr->search->is_case_sensitive = TRUE;
+            fltr->search->is_entire_line = TRUE;
+        }
+    }
+
+    return fltr;
+}
+
+/* --------------------------------------------------------------------------------------------- */
+
+void
+dir_filter_free (dir_filter_t * fltr)
+{
+    if (fltr != NULL)
+    {
+        mc_search_free (fltr->search);
+        g_free (fltr->suffix);
+        g_free (fltr);
+    }
+}
+
 /* --------------------------------------------------------------------------------------------- */
 /** If fltr is null, then it is a match */
 
 void
 dir_list_reload (dir_list * list, const vfs_path_t * vpath, GCompareFunc sort,
-                 const dir_sort_options_t * sort_op, const char *fltr)
+                 const dir_sort_options_t * sort_op, dir_filter_t * fltr)
 {
-    DIR *dirp;
-    struct dirent *dp;
+    dir_reader_t reader;
+    const char *name;
     int i, link_to_dir, stale_link;
     struct stat st;
     int marked_cnt;
     GHashTable *marked_files;
     const char *tmp_path;
 
-    dirp = mc_opendir (vpath);
-    if (dirp == NULL)
+    if (dir_reader_open (&reader, vpath) == NULL)
     {
         message (D_ERROR, MSG_ERROR, _("Cannot read directory contents"));
         dir_list_clean (list);
@@ -764,16 +970,13 @@ dir_list_reload (dir_list * list, const vfs_path_t * vpath, GCompareFunc sort,
         }
     }
 
-    while ((dp = mc_readdir (dirp)) != NULL)
+    while (dir_reader_next (&reader, fltr, &name, &st, &link_to_dir, &stale_link))
     {
         file_entry_t *fentry;
 
-        if (!handle_dirent (dp, fltr, &st, &link_to_dir, &stale_link))
-            continue;
-
-        if (!dir_list_append (list, dp->d_name, &st, link_to_dir != 0, stale_link != 0))
+        if (!dir_list_append (list, name, &st, link_to_dir != 0, stale_link != 0))
         {
-            mc_closedir (dirp);
+            dir_reader_close (&reader);
             /* Norbert (Feb 12, 1997):
                Just in case someone finds this memory leak:
                -1 means big trouble (at the moment no memory left),
@@ -797,7 +1000,7 @@ dir_list_reload (dir_list * list, const vfs_path_t * vpath, GCompareFunc sort,
          * to find matching file.  Decrease number of remaining marks if
          * we copied one.
          */
-        if (marked_cnt > 0 && g_hash_table_lookup (marked_files, dp->d_name) != NULL)
+        if (marked_cnt > 0 && g_hash_table_lookup (marked_files, name) != NULL)
         {
             fentry->f.marked = 1;
             marked_cnt--;
@@ -806,7 +1009,7 @@ dir_list_reload (dir_list * list, const vfs_path_t * vpath, GCompareFunc sort,
         if ((list->len & 15) == 0)
             rotate_dash (TRUE);
     }
-    mc_closedir (dirp);
+    dir_reader_close (&reader);
     tree_store_end_check ();
     g_hash_table_destroy (marked_files);
 
@@ -9,6 +9,7 @@
 
 #include "lib/global.h"
 #include "lib/util.h"
+#include "lib/search.h"
 #include "lib/vfs/vfs.h"
 
 /*** typedefs(not structures) and defined constants **********************************************/
@@ -40,6 +41,16 @@ typedef struct dir_sort_options_struct
     gboolean exec_first;        /**< executables are at top of list */
 } dir_sort_options_t;
 
+/**
+ * Compiled filter of directory content
+ */
+typedef struct
+{
+    mc_search_t *search;        /**< compiled glob pattern or NULL */
+    char *suffix;               /**< fixed suffix if pattern is "*suffix" */
+    size_t suffix_len;          /**< length of suffix */
+} dir_filter_t;
+
 /*** global variables defined in .c file *********************************************************/
 
 /*** declarations of public functions ************************************************************/
@@ -49,12 +60,14 @@ gboolean dir_list_append (dir_list * list, const char *fname, const struct stat
                           gboolean link_to_dir, gboolean stale_link);
 
 void dir_list_load (dir_list * list, const vfs_path_t * vpath, GCompareFunc sort,
-                    const dir_sort_options_t * sort_op, const char *fltr);
+                    const dir_sort_options_t * sort_op, dir_filter_t * fltr);
 void dir_list_reload (dir_list * list, const vfs_path_t * vpath, GCompareFunc sort,
-                      const dir_sort_options_t * sort_op, const char *fltr);
+                      const dir_sort_options_t * sort_op, dir_filter_t * fltr);
 void dir_list_sort (dir_list * list, GCompareFunc sort, const dir_sort_options_t * sort_op);
 gboolean dir_list_init (dir_list * list);
 void dir_list_clean (dir_list * list);
+dir_filter_t *dir_filter_new (const char *pattern);
+void dir_filter_free (dir_filter_t * fltr);
 gboolean handle_path (const char *path, struct stat *buf1, int *link_to_dir, int *stale_link);
 
 /* Sorting functions */
@@ -83,6 +83,8 @@
 #include "midnight.h"           /* current_panel */
 #include "layout.h"             /* rotate_dash() */
 #include "ioblksize.h"          /* io_blksize() */
+#include "filereadahead.h"
+#include "filequeue.h"
 
 #include "file.h"
 
@@ -105,6 +107,12 @@ const char *op_names[3] = {
 #define FILEOP_UPDATE_INTERVAL 2
 #define FILEOP_STALLING_INTERVAL 4
 
+/* Size of data copied by one call when file is copied in the kernel */
+#define FILEOP_KERNEL_COPY_CHUNK (4 * 1024 * 1024)
+
+/* Files not larger than this are copied by worker threads if copy_threads > 1 */
+#define FILEOP_QUEUE_MAX_SIZE (1024 * 1024)
+
 /*** file scope type declarations ****************************************************************/
 
 /* This is a hard link cache */
@@ -673,6 +681,106 @@ get_times (const struct stat *sb, mc_timesbuf_t * times)
 #endif
 }
 
+/* --------------------------------------------------------------------------------------------- */
+/**
+ * Pass regular local file to the worker threads.
+ *
+ * @return TRUE if file is queued, FALSE if it should be copied by copy_file_file() itself
+ */
+
+static gboolean
+copy_queue_push (file_op_context_t * ctx, const vfs_path_t * src_vpath,
+                 const vfs_path_t * dst_vpath, const struct stat *src_stat, gboolean dst_exists)
+{
+    const char *src, *dst;
+    file_queue_job_t *job;
+
+    if (vfs_path_elements_count (src_vpath) != 1 || vfs_path_elements_count (dst_vpath) != 1
+        || !vfs_file_is_local (src_vpath) || !vfs_file_is_local (dst_vpath))
+        return FALSE;
+
+    /* workers don't follow changes of current directory */
+    src = vfs_path_get_by_index (src_vpath, -1)->path;
+    dst = vfs_path_get_by_index (dst_vpath, -1)->path;
+    if (!g_path_is_absolute (src) || !g_path_is_absolute (dst))
+        return FALSE;
+
+    job = g_new0 (file_queue_job_t, 1);
+    job->src_path = g_strdup (src);
+    job->dst_path = g_strdup (dst);
+    job->overwrite = dst_exists;
+    job->open_mode = src_stat->st_mode;
+    job->do_chown = ctx->preserve_uidgid;
+    job->uid = src_stat->st_uid;
+    job->gid = src_stat->st_gid;
+    if (ctx->preserve)
+    {
+        job->do_chmod = TRUE;
+        job->chmod_mode = src_stat->st_mode & ctx->umask_kill;
+    }
+    else if (!dst_exists)
+    {
+        mode_t mask;
+
+        mask = umask (-1);
+        umask (mask);
+        job->do_chmod = TRUE;
+        job->chmod_mode = (0100666 & ~mask) & ctx->umask_kill;
+    }
+    get_times (src_stat, &job->times);
+    job->size = src_stat->st_size;
+
+    file_queue_push (ctx->copy_queue, job);
+
+    return TRUE;
+}
+
+/* --------------------------------------------------------------------------------------------- */
+/**
+ * Account files copied by the worker threads. Files which workers failed to copy are
+ * copied again by copy_file_file() to report errors.
+ *
+ * @param max_length wait until no more than max_length files are being copied
+ */
+
+static FileProgressStatus
+copy_queue_collect (file_op_total_context_t * tctx, file_op_context_t * ctx, int max_length)
+{
+    file_queue_t *q = ctx->copy_queue;
+    FileProgressStatus status = FILE_CONT;
+
+    if (q == NULL)
+        return FILE_CONT;
+
+    while (status != FILE_ABORT)
+    {
+        file_queue_job_t *job;
+
+        job = file_queue_pop (q, file_queue_length (q) > max_length);
+        if (job == NULL)
+            break;
+
+        if (job->error == 0)
+            status = progress_update_one (tctx, ctx, job->size);
+        else
+        {
+            gboolean ask_overwrite = tctx->ask_overwrite;
+
+            ctx->copy_queue = NULL;
+            /* overwrite was confirmed already */
+            if (job->overwrite)
+                tctx->ask_overwrite = FALSE;
+            status = copy_file_file (tctx, ctx, job->src_path, job->dst_path);
+            tctx->ask_overwrite = ask_overwrite;
+            ctx->copy_queue = q;
+        }
+
+        file_queue_job_free (job);
+    }
+
+    return status;
+}
+
 /* --------------------------------------------------------------------------------------------- */
 /* {{{ Query/status report routines */
 
@@ -1507,6 +1615,9 @@ copy_file_file (file_op_total_context_t * tctx, file_op_context_t * ctx,
     int open_flags;
     vfs_path_t *src_vpath = NULL, *dst_vpath = NULL;
     char *buf = NULL;
+    gboolean cloned = FALSE;
+    vfs_copy_method_t copy_method = VFS_COPY_NONE;
+    file_readahead_t *ra = NULL;
 
     /* FIXME: We should not be using global variables! */
     ctx->do_reget = 0;
@@ -1655,6 +1766,20 @@ copy_file_file (file_op_total_context_t * tctx, file_op_context_t * ctx,
         }
     }
 
+    /* small files are copied by worker threads: copying is bound by latency of syscalls */
+    if (ctx->copy_queue != NULL && !ctx->do_append && ctx->do_reget == 0
+        && S_ISREG (src_stat.st_mode) && src_stat.st_size <= FILEOP_QUEUE_MAX_SIZE
+        && (ctx->follow_links || src_stat.st_nlink <= 1)
+        && copy_queue_push (ctx, src_vpath, dst_vpath, &src_stat, dst_exists))
+    {
+        /* results of other files don't affect this one, except abort */
+        return_status =
+            copy_queue_collect (tctx, ctx, 2 * file_queue_threads (ctx->copy_queue));
+        if (return_status != FILE_ABORT)
+            return_status = FILE_CONT;
+        goto ret_fast;
+    }
+
     gettimeofday (&tv_transfer_start, (struct timezone *) NULL);
 
     while ((src_desc = mc_open (src_vpath, O_RDONLY | O_LINEAR)) < 0 && !ctx->skip_all)
@@ -1754,8 +1879,18 @@ copy_file_file (file_op_total_context_t * tctx, file_op_context_t * ctx,
         goto ret;
     }
 
+    /* files of zero size can have contents (procfs, sysfs): copy them through user space buffer */
+    if (!appending && file_size > 0)
+    {
+        /* try to share data blocks with source file (reflink) */
+        if (vfs_clone_file (dest_desc, src_desc) == 0)
+            cloned = TRUE;
+        else
+            copy_method = vfs_copy_method (dest_desc, src_desc);
+    }
+
     /* try preallocate space; if fail, try copy anyway */
-    while (vfs_preallocate (dest_desc, file_size, appending ? dst_stat.st_size : 0) != 0)
+    while (!cloned && vfs_preallocate (dest_desc, file_size, appending ? dst_stat.st_size : 0) != 0)
     {
         if (ctx->skip_all)
         {
@@ -1811,14 +1946,57 @@ copy_file_file (file_op_total_context_t * tctx, file_op_context_t * ctx,
         tv_last_update = tv_transfer_start;
 
         bufsize = io_blksize (dst_stat);
-        buf = g_malloc (bufsize);
 
-        while (TRUE)
+        /* read source file in the separate thread while target file is being written */
+        if (!cloned && copy_method == VFS_COPY_NONE)
+            ra = file_readahead_new (src_desc, file_size, bufsize, copy_read_ahead);
+
+        if (cloned)
+        {
+            /* nothing to copy */
+            n_read_total = file_size;
+            tctx->copied_bytes = tctx->progress_bytes + n_read_total;
+            file_progress_show (ctx, n_read_total, file_size, "", TRUE);
+        }
+
+        while (!cloned)
         {
             ssize_t n_read = -1, n_written;
+            gboolean copied = FALSE;    /* data is written to target file by kernel */
+            const char *data = NULL;
 
             /* src_read */
-            if (mc_ctl (src_desc, VFS_CTL_IS_NOTREADY, 0) == 0)
+            if (copy_method != VFS_COPY_NONE)
+            {
+                n_read = vfs_copy_chunk (dest_desc, src_desc, FILEOP_KERNEL_COPY_CHUNK,
+                                         &copy_method);
+                /* on error, continue through user space buffer: it reports what has failed.
+                   Kernel can report end of file too early (file is shorter than stat said or
+                   filesystem doesn't support kernel copy): make sure with read() */
+                if (n_read > 0 || (n_read == 0 && n_read_total >= file_size))
+                    copied = TRUE;
+                else
+                    copy_method = VFS_COPY_NONE;
+            }
+
+            if (ra != NULL)
+            {
+                while ((n_read = file_readahead_get (ra, &data)) < 0 && !ctx->skip_all)
+                {
+                    return_status = file_error (_("Cannot read source file \"%s\"\n%s"), src_path);
+                    if (return_status == FILE_RETRY)
+                        continue;
+                    if (return_status == FILE_SKIPALL)
+                        ctx->skip_all = TRUE;
+                    goto ret;
+                }
+            }
+            else if (!copied && mc_ctl (src_desc, VFS_CTL_IS_NOTREADY, 0) == 0)
+            {
+                if (buf == NULL)
+                    buf = g_malloc (bufsize);
+                data = buf;
+
                 while ((n_read = mc_read (src_desc, buf, bufsize)) < 0 && !ctx->skip_all)
                 {
                     return_status = file_error (_("Cannot read source file \"%s\"\n%s"), src_path);
@@ -1828,6 +2006,7 @@ copy_file_file (file_op_total_context_t * tctx, file_op_context_t * ctx,
                         ctx->skip_all = TRUE;
                     goto ret;
                 }
+            }
 
             if (n_read == 0)
                 break;
@@ -1836,7 +2015,7 @@ copy_file_file (file_op_total_context_t * tctx, file_op_context_t * ctx,
 
             if (n_read > 0)
             {
-                char *t = buf;
+                const char *t = data;
 
                 n_read_total += n_read;
 
@@ -1849,7 +2028,7 @@ copy_file_file (file_op_total_context_t * tctx, file_op_context_t * ctx,
                 gettimeofday (&tv_last_input, NULL);
 
                 /* dst_write */
-                while ((n_written = mc_write (dest_desc, t, (size_t) n_read)) < n_read)
+                while (!copied && (n_written = mc_write (dest_desc, t, (size_t) n_read)) < n_read)
                 {
                     gboolean write_errno_nospace;
 
@@ -1883,6 +2062,9 @@ copy_file_file (file_op_total_context_t * tctx, file_op_context_t * ctx,
                     if (return_status != FILE_RETRY)
                         goto ret;
                 }
+
+                if (ra != NULL)
+                    file_readahead_release (ra);
             }
 
             tctx->copied_bytes = tctx->progress_bytes + n_read_total + ctx->do_reget;
@@ -1935,6 +2117,7 @@ copy_file_file (file_op_total_context_t * tctx, file_op_context_t * ctx,
 
   ret:
     g_free (buf);
+    file_readahead_free (ra);
 
     rotate_dash (FALSE);
     while (src_desc != -1 && mc_close (src_desc) < 0 && !ctx->skip_all)
@@ -2274,6 +2457,10 @@ copy_dir_dir (file_op_total_context_t * tctx, file_op_context_t * ctx, const cha
     }
     mc_closedir (reading);
 
+    /* set attributes of directory after files are copied into it by worker threads */
+    if (return_status != FILE_ABORT && copy_queue_collect (tctx, ctx, 0) == FILE_ABORT)
+        return_status = FILE_ABORT;
+
     if (ctx->preserve)
     {
         mc_timesbuf_t times;
@@ -2627,7 +2814,7 @@ panel_operate (void *source_panel, FileOperation operation, gboolean force_singl
     struct stat src_stat;
     gboolean ret_val = TRUE;
     int i;
-    FileProgressStatus value;
+    FileProgressStatus value = FILE_CONT;
     file_op_context_t *ctx;
     file_op_total_context_t *tctx;
     vfs_path_t *tmp_vpath;
@@ -2836,6 +3023,9 @@ panel_operate (void *source_panel, FileOperation operation, gboolean force_singl
 
     /* Now, let's do the job */
 
+    if (operation == OP_COPY)
+        ctx->copy_queue = file_queue_new (copy_threads);
+
     /* This code is only called by the tree and panel code */
     if (single_entry)
     {
@@ -3075,6 +3265,14 @@ panel_operate (void *source_panel, FileOperation operation, gboolean force_singl
 
   clean_up:
     /* Clean up */
+    if (ctx->copy_queue != NULL)
+    {
+        if (value != FILE_ABORT)
+            copy_queue_collect (tctx, ctx, 0);
+        file_queue_free (ctx->copy_queue);
+        ctx->copy_queue = NULL;
+    }
+
     if (save_cwd != NULL)
     {
         tmp_vpath = vfs_path_from_str (save_cwd);
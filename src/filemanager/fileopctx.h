@@ -67,6 +67,7 @@ enum OperationMode
 /*** structures declarations (and typedefs of structures)*****************************************/
 
 struct mc_search_struct;
+struct file_queue_struct;
 
 /* This structure describes a context for file operations.  It is used to update
  * the progress windows and pass around options.
@@ -137,6 +138,9 @@ typedef struct
     /* search handler */
     struct mc_search_struct *search_handle;
 
+    /* Small files copied by worker threads, NULL if they are copied one by one */
+    struct file_queue_struct *copy_queue;
+
     /* Whether to dive into subdirectories for recursive operations */
     gboolean dive_into_subdirs;
 
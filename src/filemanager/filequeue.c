@@ -0,0 +1,361 @@
+/*
+   Concurrent copying of small local files.
+
+   Copyright (C) 2017
+   Free Software Foundation, Inc.
+
+   This file is part of the Midnight Commander.
+
+   The Midnight Commander is free software: you can redistribute it
+   and/or modify it under the terms of the GNU General Public License as
+   published by the Free Software Foundation, either version 3 of the License,
+   or (at your option) any later version.
+
+   The Midnight Commander is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/** \file  filequeue.c
+ *  \brief Source: concurrent copying of small local files
+ *
+ *  Copying of many small files is bound by latency of open/create/chmod/utime
+ *  calls rather than by bandwidth. Worker threads copy several such files at
+ *  the same time while the main thread walks directories, creates them and asks
+ *  the user about conflicts.
+ *
+ *  Workers use plain system calls on local paths only and never touch VFS or UI.
+ *  A failed job is given back to the main thread, which copies the file again
+ *  in the usual way and so reports the error with the usual dialogs.
+ */
+
+#include <config.h>
+
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#ifndef HAVE_UTIMENSAT
+#ifdef HAVE_UTIME_H
+#include <utime.h>
+#endif
+#endif
+
+#include "lib/global.h"
+
+#include "ioblksize.h"          /* io_blksize() */
+#include "filequeue.h"
+
+/*** global variables ****************************************************************************/
+
+/*** file scope macro definitions ****************************************************************/
+
+/* GThreadPool and GAsyncQueue don't need g_thread_init() since glib 2.32 */
+#if GLIB_CHECK_VERSION (2, 32, 0)
+#define FILE_QUEUE_THREADS 1
+#endif
+
+/*** file scope type declarations ****************************************************************/
+
+struct file_queue_struct
+{
+#ifdef FILE_QUEUE_THREADS
+    GThreadPool *pool;
+    GAsyncQueue *done;          /* finished jobs */
+    int threads;
+    int length;                 /* number of jobs pushed and not popped yet */
+    volatile gint cancelled;    /* queue is being freed, don't start new jobs */
+#else
+    int dummy;
+#endif                          /* FILE_QUEUE_THREADS */
+};
+
+/*** file scope variables ************************************************************************/
+
+/*** file scope functions ************************************************************************/
+/* --------------------------------------------------------------------------------------------- */
+
+#ifdef FILE_QUEUE_THREADS
+static int
+file_queue_copy_data (int src_fd, int dst_fd, size_t bufsize)
+{
+    char *buf;
+    int ret = 0;
+
+    buf = g_malloc (bufsize);
+
+    while (ret == 0)
+    {
+        ssize_t n_read;
+        char *t = buf;
+
+        n_read = read (src_fd, buf, bufsize);
+        if (n_read == 0)
+            break;
+        if (n_read < 0)
+        {
+            if (errno != EINTR)
+                ret = errno;
+            continue;
+        }
+
+        while (n_read > 0)
+        {
+            ssize_t n_written;
+
+            n_written = write (dst_fd, t, (size_t) n_read);
+            if (n_written < 0)
+            {
+                if (errno == EINTR)
+                    continue;
+                ret = errno;
+                break;
+            }
+            n_read -= n_written;
+            t += n_written;
+        }
+    }
+
+    g_free (buf);
+    return ret;
+}
+
+/* --------------------------------------------------------------------------------------------- */
+
+static int
+file_queue_copy (file_queue_job_t * job)
+{
+    int src_fd, dst_fd;
+    int flags;
+    struct stat dst_stat;
+    int ret;
+
+    src_fd = open (job->src_path, O_RDONLY);
+    if (src_fd == -1)
+        return errno;
+
+    flags = O_WRONLY | O_CREAT | (job->overwrite ? O_TRUNC : O_EXCL);
+    dst_fd = open (job->dst_path, flags, job->open_mode);
+    if (dst_fd == -1)
+    {
+        ret = errno;
+        close (src_fd);
+        return ret;
+    }
+
+    ret = (fstat (dst_fd, &dst_stat) == 0) ? 0 : errno;
+    if (ret == 0)
+        ret = file_queue_copy_data (src_fd, dst_fd, io_blksize (dst_stat));
+    if (ret == 0 && job->do_chown && fchown (dst_fd, job->uid, job->gid) != 0)
+        ret = errno;
+    /* like copy_file_file(), don't check result of chmod and utime */
+    if (ret == 0 && job->do_chmod)
+        (void) fchmod (dst_fd, job->chmod_mode);
+#ifdef HAVE_UTIMENSAT
+    if (ret == 0)
+        (void) futimens (dst_fd, job->times);
+#endif
+
+    close (src_fd);
+    if (close (dst_fd) != 0 && ret == 0)
+        ret = errno;
+
+#ifndef HAVE_UTIMENSAT
+    if (ret == 0)
+        (void) utime (job->dst_path, &job->times);
+#endif
+
+    /* the file will be copied again by main thread, don't leave incomplete new file */
+    if (ret != 0 && !job->overwrite)
+        unlink (job->dst_path);
+
+    return ret;
+}
+
+/* --------------------------------------------------------------------------------------------- */
+
+static void
+file_queue_worker (gpointer data, gpointer user_data)
+{
+    file_queue_job_t *job = (file_queue_job_t *) data;
+    file_queue_t *q = (file_queue_t *) user_data;
+
+    if (g_atomic_int_get (&q->cancelled) != 0)
+        job->error = ECANCELED;
+    else
+        job->error = file_queue_copy (job);
+    g_async_queue_push (q->done, job);
+}
+#endif /* FILE_QUEUE_THREADS */
+
+/* --------------------------------------------------------------------------------------------- */
+/*** public functions ****************************************************************************/
+/* --------------------------------------------------------------------------------------------- */
+/**
+ * Create queue of files copied by worker threads.
+ *
+ * @param threads number of worker threads
+ * @return new queue, NULL if threads are not available or number of threads is less than 2.
+ *         Use #file_queue_free() to free it.
+ */
+
+file_queue_t *
+file_queue_new (int threads)
+{
+#ifdef FILE_QUEUE_THREADS
+    file_queue_t *q;
+
+    if (threads < 2)
+        return NULL;
+
+    q = g_new0 (file_queue_t, 1);
+    q->threads = threads;
+    q->done = g_async_queue_new ();
+    q->pool = g_thread_pool_new (file_queue_worker, q, threads, FALSE, NULL);
+    if (q->pool == NULL)
+    {
+        file_queue_free (q);
+        q = NULL;
+    }
+
+    return q;
+#else
+    (void) threads;
+
+    return NULL;
+#endif /* FILE_QUEUE_THREADS */
+}
+
+/* --------------------------------------------------------------------------------------------- */
+/**
+ * Free the queue. Jobs which were not started yet are dropped, running ones are waited for.
+ * Jobs which were not popped are freed without reporting.
+ */
+
+void
+file_queue_free (file_queue_t * q)
+{
+#ifdef FILE_QUEUE_THREADS
+    file_queue_job_t *job;
+
+    if (q == NULL)
+        return;
+
+    if (q->pool != NULL)
+    {
+        /* queued jobs are given to workers which only drop them: they are freed below */
+        g_atomic_int_set (&q->cancelled, 1);
+        g_thread_pool_free (q->pool, FALSE, TRUE);
+    }
+
+    while ((job = (file_queue_job_t *) g_async_queue_try_pop (q->done)) != NULL)
+        file_queue_job_free (job);
+
+    g_async_queue_unref (q->done);
+    g_free (q);
+#else
+    (void) q;
+#endif /* FILE_QUEUE_THREADS */
+}
+
+/* --------------------------------------------------------------------------------------------- */
+/**
+ * @return number of jobs pushed into the queue and not popped yet
+ */
+
+int
+file_queue_length (const file_queue_t * q)
+{
+#ifdef FILE_QUEUE_THREADS
+    return q->length;
+#else
+    (void) q;
+
+    return 0;
+#endif /* FILE_QUEUE_THREADS */
+}
+
+/* --------------------------------------------------------------------------------------------- */
+
+int
+file_queue_threads (const file_queue_t * q)
+{
+#ifdef FILE_QUEUE_THREADS
+    return q->threads;
+#else
+    (void) q;
+
+    return 0;
+#endif /* FILE_QUEUE_THREADS */
+}
+
+/* --------------------------------------------------------------------------------------------- */
+/**
+ * Start copying the file. Queue takes ownership of the job.
+ */
+
+void
+file_queue_push (file_queue_t * q, file_queue_job_t * job)
+{
+#ifdef FILE_QUEUE_THREADS
+    q->length++;
+    g_thread_pool_push (q->pool, job, NULL);
+#else
+    (void) q;
+    (void) job;
+#endif /* FILE_QUEUE_THREADS */
+}
+
+/* --------------------------------------------------------------------------------------------- */
+/**
+ * Get finished job.
+ *
+ * @param wait if TRUE, wait until some job is finished
+ * @return finished job, NULL if there are no finished jobs (or no jobs at all if wait is TRUE).
+ *         Use #file_queue_job_free() to free it.
+ */
+
+file_queue_job_t *
+file_queue_pop (file_queue_t * q, gboolean wait)
+{
+#ifdef FILE_QUEUE_THREADS
+    file_queue_job_t *job;
+
+    if (q->length == 0)
+        return NULL;
+
+    if (wait)
+        job = (file_queue_job_t *) g_async_queue_pop (q->done);
+    else
+        job = (file_queue_job_t *) g_async_queue_try_pop (q->done);
+
+    if (job != NULL)
+        q->length--;
+
+    return job;
+#else
+    (void) q;
+    (void) wait;
+
+    return NULL;
+#endif /* FILE_QUEUE_THREADS */
+}
+
+/* --------------------------------------------------------------------------------------------- */
+
+void
+file_queue_job_free (file_queue_job_t * job)
+{
+    if (job != NULL)
+    {
+        g_free (job->src_path);
+        g_free (job->dst_path);
+        g_free (job);
+    }
+}
+
+/* --------------------------------------------------------------------------------------------- */
@@ -0,0 +1,57 @@
+/** \file  filequeue.h
+ *  \brief Header: concurrent copying of small local files
+ */
+
+#ifndef MC__FILEQUEUE_H
+#define MC__FILEQUEUE_H
+
+#include <sys/types.h>
+
+#include "lib/global.h"
+#include "lib/vfs/vfs.h"        /* mc_timesbuf_t */
+
+/*** typedefs(not structures) and defined constants **********************************************/
+
+typedef struct file_queue_struct file_queue_t;
+
+/*** enums ***************************************************************************************/
+
+/*** structures declarations (and typedefs of structures)*****************************************/
+
+/* One file to be copied by worker thread */
+typedef struct
+{
+    /* input */
+    char *src_path;             /* local absolute path of source file */
+    char *dst_path;             /* local absolute path of target file */
+    gboolean overwrite;         /* truncate existing target file, else create new one */
+    mode_t open_mode;           /* mode of created target file */
+    gboolean do_chown;
+    uid_t uid;
+    gid_t gid;
+    gboolean do_chmod;
+    mode_t chmod_mode;
+    mc_timesbuf_t times;
+    off_t size;                 /* size of source file, for progress */
+
+    /* output */
+    int error;                  /* errno of failed operation, 0 on success */
+} file_queue_job_t;
+
+/*** global variables defined in .c file *********************************************************/
+
+/*** declarations of public functions ************************************************************/
+
+file_queue_t *file_queue_new (int threads);
+void file_queue_free (file_queue_t * q);
+
+int file_queue_length (const file_queue_t * q);
+int file_queue_threads (const file_queue_t * q);
+void file_queue_push (file_queue_t * q, file_queue_job_t * job);
+file_queue_job_t *file_queue_pop (file_queue_t * q, gboolean wait);
+
+void file_queue_job_free (file_queue_job_t * job);
+
+/*** inline functions ****************************************************************************/
+
+#endif /* MC__FILEQUEUE_H */
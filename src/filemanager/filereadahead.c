@@ -0,0 +1,304 @@
+/*
+   Asynchronous read-ahead of source file for copy operation.
+
+   Copyright (C) 2017
+   Free Software Foundation, Inc.
+
+   This file is part of the Midnight Commander.
+
+   The Midnight Commander is free software: you can redistribute it
+   and/or modify it under the terms of the GNU General Public License as
+   published by the Free Software Foundation, either version 3 of the License,
+   or (at your option) any later version.
+
+   The Midnight Commander is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/** \file  filereadahead.c
+ *  \brief Source: asynchronous read-ahead of source file for copy operation
+ *
+ *  The reader thread fills a ring of buffers from the source file while the main
+ *  thread writes previously read buffers to the target file, so both devices
+ *  are busy at the same time.
+ *
+ *  Only the main thread calls VFS and UI functions: the reader thread uses
+ *  read(2) on the descriptor of local source file. Read errors are passed
+ *  to the main thread through the ring; the reader waits until the error
+ *  is taken and then reads the same block again, so the main thread can
+ *  handle them with the usual retry/skip/abort dialog.
+ */
+
+#include <config.h>
+
+#include <errno.h>
+#include <unistd.h>
+
+#include "lib/global.h"
+#include "lib/vfs/vfs.h"
+
+#include "filereadahead.h"
+
+/*** global variables ****************************************************************************/
+
+/*** file scope macro definitions ****************************************************************/
+
+/* GThread API without g_thread_init() is available since glib 2.32 */
+#if GLIB_CHECK_VERSION (2, 32, 0)
+#define FILE_READAHEAD_THREAD 1
+#endif
+
+/* Smaller files are read in the main thread: starting the reader costs more than it saves */
+#define FILE_READAHEAD_MIN_SIZE (1024 * 1024)
+
+/*** file scope type declarations ****************************************************************/
+
+struct file_readahead_struct
+{
+#ifdef FILE_READAHEAD_THREAD
+    int fd;                     /* local descriptor of source file */
+    size_t bufsize;
+    int depth;                  /* number of buffers in the ring */
+    char **bufs;
+    ssize_t *lens;              /* result of read() for each buffer */
+    int *errnos;                /* errno of failed read() for each buffer */
+    int head;                   /* next buffer to be filled by reader */
+    int tail;                   /* next buffer to be taken by main thread */
+    int filled;                 /* number of filled buffers */
+    gboolean paused;            /* reader waits until error is taken */
+    gboolean eof;               /* reader reached end of file */
+    gboolean stop;              /* reader should exit */
+    GMutex lock;
+    GCond cond;
+    GThread *thread;
+#else
+    int dummy;
+#endif                          /* FILE_READAHEAD_THREAD */
+};
+
+/*** file scope variables ************************************************************************/
+
+/*** file scope functions ************************************************************************/
+/* --------------------------------------------------------------------------------------------- */
+
+#ifdef FILE_READAHEAD_THREAD
+static gpointer
+file_readahead_thread (gpointer data)
+{
+    file_readahead_t *ra = (file_readahead_t *) data;
+
+    g_mutex_lock (&ra->lock);
+
+    while (!ra->stop && !ra->eof)
+    {
+        int slot;
+        ssize_t n;
+        int err = 0;
+
+        if (ra->paused || ra->filled == ra->depth)
+        {
+            g_cond_wait (&ra->cond, &ra->lock);
+            continue;
+        }
+
+        slot = ra->head;
+        g_mutex_unlock (&ra->lock);
+
+        do
+            n = read (ra->fd, ra->bufs[slot], ra->bufsize);
+        while (n < 0 && errno == EINTR);
+
+        if (n < 0)
+            err = errno;
+
+        g_mutex_lock (&ra->lock);
+
+        ra->lens[slot] = n;
+        ra->errnos[slot] = err;
+        ra->head = (ra->head + 1) % ra->depth;
+        ra->filled++;
+        ra->eof = (n == 0);
+        ra->paused = (n < 0);
+        g_cond_signal (&ra->cond);
+    }
+
+    g_mutex_unlock (&ra->lock);
+
+    return NULL;
+}
+#endif /* FILE_READAHEAD_THREAD */
+
+/* --------------------------------------------------------------------------------------------- */
+/*** public functions ****************************************************************************/
+/* --------------------------------------------------------------------------------------------- */
+/**
+ * Start reading the source file from its current position in the separate thread.
+ *
+ * @param src_vfs_fd VFS handle of source file
+ * @param size size of source file
+ * @param bufsize size of one buffer
+ * @param depth number of buffers in the ring
+ *
+ * @return read-ahead object, NULL if read-ahead isn't possible (source file is not local,
+ *         threads are not available, depth is less than 2) or isn't worth it (file is small).
+ *         Use #file_readahead_free() to stop reading and free it.
+ */
+
+file_readahead_t *
+file_readahead_new (int src_vfs_fd, off_t size, size_t bufsize, int depth)
+{
+#ifdef FILE_READAHEAD_THREAD
+    file_readahead_t *ra;
+    int fd, i;
+
+    if (depth < 2 || size < FILE_READAHEAD_MIN_SIZE || size <= (off_t) bufsize)
+        return NULL;
+
+    fd = vfs_local_fd (src_vfs_fd);
+    if (fd == -1)
+        return NULL;
+
+    ra = g_new0 (file_readahead_t, 1);
+    ra->fd = fd;
+    ra->bufsize = bufsize;
+    ra->depth = depth;
+    ra->bufs = g_new (char *, depth);
+    for (i = 0; i < depth; i++)
+        ra->bufs[i] = g_malloc (bufsize);
+    ra->lens = g_new (ssize_t, depth);
+    ra->errnos = g_new (int, depth);
+    g_mutex_init (&ra->lock);
+    g_cond_init (&ra->cond);
+
+    ra->thread = g_thread_try_new ("readahead", file_readahead_thread, ra, NULL);
+    if (ra->thread == NULL)
+    {
+        file_readahead_free (ra);
+        ra = NULL;
+    }
+
+    return ra;
+#else
+    (void) src_vfs_fd;
+    (void) size;
+    (void) bufsize;
+    (void) depth;
+
+    return NULL;
+#endif /* FILE_READAHEAD_THREAD */
+}
+
+/* --------------------------------------------------------------------------------------------- */
+/**
+ * Wait for the next block of source file.
+ *
+ * Data block should be given back with #file_readahead_release() after it is written.
+ * End of file and error are given back immediately: after error, the next call reads
+ * the same block again.
+ *
+ * @param data pointer to read data
+ * @return number of bytes read, 0 at end of file, -1 on error (errno is set)
+ */
+
+ssize_t
+file_readahead_get (file_readahead_t * ra, const char **data)
+{
+#ifdef FILE_READAHEAD_THREAD
+    ssize_t n;
+    int err;
+
+    g_mutex_lock (&ra->lock);
+
+    while (ra->filled == 0)
+        g_cond_wait (&ra->cond, &ra->lock);
+
+    n = ra->lens[ra->tail];
+    err = ra->errnos[ra->tail];
+    *data = ra->bufs[ra->tail];
+
+    if (n <= 0)
+    {
+        ra->tail = (ra->tail + 1) % ra->depth;
+        ra->filled--;
+        ra->paused = FALSE;
+        g_cond_signal (&ra->cond);
+    }
+
+    g_mutex_unlock (&ra->lock);
+
+    if (n < 0)
+        errno = err;
+
+    return n;
+#else
+    (void) ra;
+    (void) data;
+
+    errno = ENOSYS;
+    return -1;
+#endif /* FILE_READAHEAD_THREAD */
+}
+
+/* --------------------------------------------------------------------------------------------- */
+/**
+ * Give back the data block got by #file_readahead_get() to be filled again.
+ */
+
+void
+file_readahead_release (file_readahead_t * ra)
+{
+#ifdef FILE_READAHEAD_THREAD
+    g_mutex_lock (&ra->lock);
+    ra->tail = (ra->tail + 1) % ra->depth;
+    ra->filled--;
+    g_cond_signal (&ra->cond);
+    g_mutex_unlock (&ra->lock);
+#else
+    (void) ra;
+#endif /* FILE_READAHEAD_THREAD */
+}
+
+/* --------------------------------------------------------------------------------------------- */
+/**
+ * Stop reading and free read-ahead object.
+ * Position of source file is undefined after that.
+ */
+
+void
+file_readahead_free (file_readahead_t * ra)
+{
+#ifdef FILE_READAHEAD_THREAD
+    int i;
+
+    if (ra == NULL)
+        return;
+
+    if (ra->thread != NULL)
+    {
+        g_mutex_lock (&ra->lock);
+        ra->stop = TRUE;
+        g_cond_signal (&ra->cond);
+        g_mutex_unlock (&ra->lock);
+
+        g_thread_join (ra->thread);
+    }
+
+    for (i = 0; i < ra->depth; i++)
+        g_free (ra->bufs[i]);
+    g_free (ra->bufs);
+    g_free (ra->lens);
+    g_free (ra->errnos);
+    g_cond_clear (&ra->cond);
+    g_mutex_clear (&ra->lock);
+    g_free (ra);
+#else
+    (void) ra;
+#endif /* FILE_READAHEAD_THREAD */
+}
+
+/* --------------------------------------------------------------------------------------------- */
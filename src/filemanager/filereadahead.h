@@ -0,0 +1,29 @@
+/** \file  filereadahead.h
+ *  \brief Header: asynchronous read-ahead of source file for copy operation
+ */
+
+#ifndef MC__FILEREADAHEAD_H
+#define MC__FILEREADAHEAD_H
+
+#include "lib/global.h"
+
+/*** typedefs(not structures) and defined constants **********************************************/
+
+typedef struct file_readahead_struct file_readahead_t;
+
+/*** enums ***************************************************************************************/
+
+/*** structures declarations (and typedefs of structures)*****************************************/
+
+/*** global variables defined in .c file *********************************************************/
+
+/*** declarations of public functions ************************************************************/
+
+file_readahead_t *file_readahead_new (int src_vfs_fd, off_t size, size_t bufsize, int depth);
+ssize_t file_readahead_get (file_readahead_t * ra, const char **data);
+void file_readahead_release (file_readahead_t * ra);
+void file_readahead_free (file_readahead_t * ra);
+
+/*** inline functions ****************************************************************************/
+
+#endif /* MC__FILEREADAHEAD_H */
@@ -32,9 +32,11 @@
 #include <config.h>
 
 #include <ctype.h>
+#include <fcntl.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <unistd.h>
 #include <sys/stat.h>
 #include <sys/time.h>
 
@@ -50,7 +52,7 @@
 #include "lib/widget.h"
 #include "lib/util.h"           /* canonicalize_pathname() */
 
-#include "src/setup.h"          /* verbose */
+#include "src/setup.h"          /* verbose, find_content_threads */
 #include "src/history.h"        /* MC_HISTORY_SHARED_SEARCH */
 
 #include "dir.h"
@@ -58,6 +60,8 @@
 #include "midnight.h"           /* current_panel */
 #include "boxes.h"
 #include "panelize.h"
+#include "findgrep.h"
+#include "findindex.h"
 
 #include "find.h"
 
@@ -68,6 +72,15 @@
 #define MAX_REFRESH_INTERVAL (G_USEC_PER_SEC / 20)      /* 50 ms */
 #define MIN_REFRESH_FILE_SIZE (256 * 1024)      /* 256 KB */
 
+/* amount of mapped file searched between checks for events */
+#define MAPPED_SEARCH_STEP (256 * 1024)
+
+/* number of lines of read file searched between checks for events */
+#define READ_SEARCH_LINES 256
+
+/* maximal number of files which wait for content search in worker threads */
+#define GREP_QUEUE_LENGTH(q) (4 * find_grep_threads (q))
+
 /*** file scope type declarations ****************************************************************/
 
 /* A couple of extra messages we need */
@@ -161,9 +174,11 @@ static struct timeval last_refresh;
 /* Where did we stop */
 static gboolean resuming;
 static int last_line;
-static int last_pos;
 static off_t last_off;
-static int last_i;
+static gsize last_len;
+/* resume search in mapped file: last_off is offset of search, last_line is counted up to this */
+static gboolean last_mapped;
+static size_t last_line_off;
 
 static size_t ignore_count = 0;
 
@@ -213,6 +228,8 @@ static char *in_start_dir = INPUT_LAST_TEXT;
 
 static mc_search_t *search_file_handle = NULL;
 static mc_search_t *search_content_handle = NULL;
+/* content search in worker threads, NULL if content is searched in main thread */
+static find_grep_t *grep_queue = NULL;
 
 /* --------------------------------------------------------------------------------------------- */
 /*** file scope functions ************************************************************************/
@@ -974,6 +991,151 @@ check_find_events (WDialog * h)
     return FIND_CONT;
 }
 
+/* --------------------------------------------------------------------------------------------- */
+/**
+ * Add matches from files searched by worker threads to the find listbox.
+ *
+ * @param wait if TRUE, wait a bit for the oldest file if it is not searched yet
+ */
+
+static void
+find_grep_collect (gboolean wait)
+{
+    find_grep_job_t *job;
+
+    while ((job = find_grep_pop (grep_queue, wait)) != NULL)
+    {
+        guint i;
+
+        for (i = 0; i < job->matches->len; i++)
+        {
+            const find_grep_match_t *m;
+            char result[BUF_MEDIUM];
+
+            m = &g_array_index (job->matches, find_grep_match_t, i);
+            g_snprintf (result, sizeof (result), "%d:%s", m->line, job->filename);
+            find_add_match (job->directory, result, m->start, m->end);
+        }
+
+        find_grep_job_free (job);
+        wait = FALSE;
+    }
+}
+
+/* --------------------------------------------------------------------------------------------- */
+/**
+ * Give local file to worker threads.
+ *
+ * returns TRUE if file is queued
+ *         FALSE if content of file should be searched in main thread
+ */
+
+static gboolean
+find_grep_push_file (const char *directory, const char *filename)
+{
+    vfs_path_t *vpath;
+    gboolean ret;
+
+    vpath = vfs_path_build_filename (directory, filename, (char *) NULL);
+    ret = vfs_file_is_local (vpath);
+
+    if (ret)
+        find_grep_push (grep_queue,
+                        find_grep_job_new (directory, filename, vfs_path_get_last_path_str (vpath)));
+    else
+    {
+        /* keep order of results */
+        while (find_grep_length (grep_queue) != 0)
+            find_grep_collect (TRUE);
+    }
+
+    vfs_path_free (vpath);
+    return ret;
+}
+
+/* --------------------------------------------------------------------------------------------- */
+
+static void
+search_content_add_match (WDialog * h, const char *directory, const char *filename, int line,
+                          gsize start, gsize end, const struct timeval *tv,
+                          gboolean * status_updated)
+{
+    char result[BUF_MEDIUM];
+
+    if (!*status_updated)
+    {
+        /* if we add results for a file, we have to ensure that
+           name of this file is shown in status bar */
+        g_snprintf (result, sizeof (result), _("Grepping in %s"), filename);
+        status_update (str_trunc (result, WIDGET (h)->cols - 8));
+        mc_refresh ();
+        last_refresh = *tv;
+        *status_updated = TRUE;
+    }
+
+    g_snprintf (result, sizeof (result), "%d:%s", line, filename);
+    find_add_match (directory, result, start, end);
+}
+
+/* --------------------------------------------------------------------------------------------- */
+/**
+ * Search in local file mapped to memory. Lines are counted only when a match is found,
+ * the suspended search is resumed from the saved offset.
+ *
+ * returns FALSE if do_search should look for another file
+ *         TRUE if do_search should exit and proceed to the event handler
+ */
+
+static gboolean
+search_content_mapped (WDialog * h, const char *directory, const char *filename,
+                       const char *data, size_t size, const struct timeval *tv,
+                       gboolean * status_updated)
+{
+    find_grep_scan_t scan;
+
+    find_grep_scan_init (&scan, data, size);
+
+    if (resuming)
+    {
+        /* We've been previously suspended, start from the previous position */
+        resuming = FALSE;
+        scan.pos = (size_t) last_off;
+        scan.line = last_line;
+        scan.line_pos = last_line_off;
+    }
+
+    while (scan.pos < size)
+    {
+        find_grep_match_t match;
+
+        if (find_grep_scan (&scan, search_content_handle, scan.pos + MAPPED_SEARCH_STEP, &match))
+        {
+            search_content_add_match (h, directory, filename, match.line, match.start, match.end,
+                                      tv, status_updated);
+            if (options.content_first_hit)
+                break;
+        }
+
+        switch (check_find_events (h))
+        {
+        case FIND_ABORT:
+            stop_idle (h);
+            return TRUE;
+        case FIND_SUSPEND:
+            resuming = TRUE;
+            last_mapped = TRUE;
+            last_off = (off_t) scan.pos;
+            last_line = scan.line;
+            last_line_off = scan.line_pos;
+            return TRUE;
+        default:
+            break;
+        }
+    }
+
+    return FALSE;
+}
+
 /* --------------------------------------------------------------------------------------------- */
 /**
  * search_content:
@@ -990,7 +1152,9 @@ search_content (WDialog * h, const char *directory, const char *filename)
 {
     struct stat s;
     char buffer[BUF_4K];        /* raw input buffer */
-    int file_fd;
+    int file_fd = -1;
+    char *mapped = NULL;        /* content of local file */
+    size_t mapped_size = 0;
     gboolean ret_val = FALSE;
     vfs_path_t *vpath;
     struct timeval tv;
@@ -1006,10 +1170,32 @@ search_content (WDialog * h, const char *directory, const char *filename)
         return FALSE;
     }
 
-    file_fd = mc_open (vpath, O_RDONLY);
+    /* search is resumed in the same way as it was started */
+    if (vfs_file_is_local (vpath) && (!resuming || last_mapped))
+    {
+        int fd;
+
+        fd = open (vfs_path_get_last_path_str (vpath), O_RDONLY);
+        if (fd != -1)
+        {
+            mapped = find_grep_map_file (fd, &mapped_size);
+            close (fd);
+        }
+    }
+
+    if (mapped == NULL)
+    {
+        if (resuming && last_mapped)
+        {
+            /* cannot continue in the same way, start again */
+            resuming = FALSE;
+        }
+
+        file_fd = mc_open (vpath, O_RDONLY);
+    }
     vfs_path_free (vpath);
 
-    if (file_fd == -1)
+    if (mapped == NULL && file_fd == -1)
         return FALSE;
 
     /* get time elapsed from last refresh */
@@ -1039,141 +1225,64 @@ search_content (WDialog * h, const char *directory, const char *filename)
     tty_enable_interrupt_key ();
     tty_got_interrupt ();
 
+    if (mapped != NULL)
+        ret_val =
+            search_content_mapped (h, directory, filename, mapped, mapped_size, &tv,
+                                   &status_updated);
+    else
     {
-        int line = 1;
-        int pos = 0;
-        int n_read = 0;
-        off_t off = 0;          /* file_fd's offset corresponding to strbuf[0] */
-        gboolean found = FALSE;
-        gsize found_len;
-        gsize found_start;
-        char result[BUF_MEDIUM];
-        char *strbuf = NULL;    /* buffer for fetched string */
-        int strbuf_size = 0;
-        int i = -1;             /* compensate for a newline we'll add when we first enter the loop */
+        find_grep_lines_t lines;
+
+        find_grep_lines_init (&lines, file_fd, mc_read, buffer, sizeof (buffer));
 
         if (resuming)
         {
             /* We've been previously suspended, start from the previous position */
             resuming = FALSE;
-            line = last_line;
-            pos = last_pos;
-            off = last_off;
-            i = last_i;
+            lines.line = last_line;
+            lines.off = last_off;
+            lines.len = last_len;
         }
 
-        while (!ret_val)
+        while (!ret_val && !lines.eof)
         {
-            char ch = '\0';
-            off += i + 1;       /* the previous line, plus a newline character */
-            i = 0;
-
-            /* read to buffer and get line from there */
-            while (TRUE)
-            {
-                if (pos >= n_read)
-                {
-                    pos = 0;
-                    n_read = mc_read (file_fd, buffer, sizeof (buffer));
-                    if (n_read <= 0)
-                        break;
-                }
-
-                ch = buffer[pos++];
-                if (ch == '\0')
-                {
-                    /* skip possible leading zero(s) */
-                    if (i == 0)
-                    {
-                        off++;
-                        continue;
-                    }
-                    break;
-                }
-
-                if (i >= strbuf_size - 1)
-                {
-                    strbuf_size += 128;
-                    strbuf = g_realloc (strbuf, strbuf_size);
-                }
+            find_grep_match_t match;
 
-                /* Strip newline */
-                if (ch == '\n')
-                    break;
-
-                strbuf[i++] = ch;
-            }
-
-            if (i == 0)
+            if (find_grep_lines_next (&lines, search_content_handle, READ_SEARCH_LINES, &match))
             {
-                if (ch == '\0')
+                search_content_add_match (h, directory, filename, match.line, match.start,
+                                          match.end, &tv, &status_updated);
+                if (options.content_first_hit)
                     break;
-
-                /* if (ch == '\n'): do not search in empty strings */
-                goto skip_search;
             }
 
-            strbuf[i] = '\0';
-
-            if (!found          /* Search in binary line once */
-                && mc_search_run (search_content_handle, (const void *) strbuf, 0, i, &found_len))
+            switch (check_find_events (h))
             {
-                if (!status_updated)
-                {
-                    /* if we add results for a file, we have to ensure that
-                       name of this file is shown in status bar */
-                    g_snprintf (result, sizeof (result), _("Grepping in %s"), filename);
-                    status_update (str_trunc (result, WIDGET (h)->cols - 8));
-                    mc_refresh ();
-                    last_refresh = tv;
-                    status_updated = TRUE;
-                }
-
-                g_snprintf (result, sizeof (result), "%d:%s", line, filename);
-                found_start = off + search_content_handle->normal_offset + 1;   /* off by one: ticket 3280 */
-                find_add_match (directory, result, found_start, found_start + found_len);
-                found = TRUE;
-            }
-
-            if (found && options.content_first_hit)
+            case FIND_ABORT:
+                stop_idle (h);
+                ret_val = TRUE;
+                break;
+            case FIND_SUSPEND:
+                resuming = TRUE;
+                last_mapped = FALSE;
+                last_line = lines.line;
+                last_off = lines.off;
+                last_len = lines.len;
+                ret_val = TRUE;
+                break;
+            default:
                 break;
-
-            if (ch == '\n')
-            {
-              skip_search:
-                found = FALSE;
-                line++;
-            }
-
-            if ((line & 0xff) == 0)
-            {
-                FindProgressStatus res;
-                res = check_find_events (h);
-                switch (res)
-                {
-                case FIND_ABORT:
-                    stop_idle (h);
-                    ret_val = TRUE;
-                    break;
-                case FIND_SUSPEND:
-                    resuming = TRUE;
-                    last_line = line;
-                    last_pos = pos;
-                    last_off = off;
-                    last_i = i;
-                    ret_val = TRUE;
-                    break;
-                default:
-                    break;
-                }
             }
         }
 
-        g_free (strbuf);
+        find_grep_lines_deinit (&lines);
     }
 
     tty_disable_interrupt_key ();
-    mc_close (file_fd);
+    if (mapped != NULL)
+        find_grep_unmap_file (mapped, mapped_size);
+    else
+        mc_close (file_fd);
     return ret_val;
 }
 
@@ -1257,13 +1366,51 @@ find_rotate_dash (const WDialog * h, gboolean show)
     mc_refresh ();
 }
 
+/* --------------------------------------------------------------------------------------------- */
+/**
+ * Get name of next entry of directory skipping invalid filenames.
+ *
+ * @param index_dir directory from file name index, NULL if dirp is read
+ * @param is_dir set from the index only
+ *
+ * @return name of entry, NULL if there are no more entries
+ */
+
+static const char *
+find_read_entry (DIR * dirp, const find_index_dir_t * index_dir, size_t * index_pos,
+                 gboolean * is_dir)
+{
+    const char *name;
+
+    if (index_dir != NULL)
+    {
+        while ((name = find_index_dir_next (index_dir, index_pos, is_dir)) != NULL
+               && !str_is_valid_string (name))
+            ;
+    }
+    else
+    {
+        struct dirent *dp;
+
+        while ((dp = mc_readdir (dirp)) != NULL && !str_is_valid_string (dp->d_name))
+            ;
+        name = dp != NULL ? dp->d_name : NULL;
+    }
+
+    return name;
+}
+
 /* --------------------------------------------------------------------------------------------- */
 
 static int
 do_search (WDialog * h)
 {
-    static struct dirent *dp = NULL;
+    static const char *d_name = NULL;
     static DIR *dirp = NULL;
+    /* entries of directory are taken from file name index */
+    static const find_index_dir_t *index_dir = NULL;
+    static size_t index_pos = 0;
+    static gboolean index_is_dir = FALSE;
     static char *directory = NULL;
     struct stat tmp_stat;
     gsize bytes_found;
@@ -1276,22 +1423,31 @@ do_search (WDialog * h)
             mc_closedir (dirp);
             dirp = NULL;
         }
+        index_dir = NULL;
         MC_PTR_FREE (directory);
-        dp = NULL;
+        d_name = NULL;
         return 1;
     }
 
+    if (grep_queue != NULL)
+        find_grep_collect (find_grep_length (grep_queue) >= GREP_QUEUE_LENGTH (grep_queue));
+
     for (count = 0; count < 32; count++)
     {
-        while (dp == NULL)
+        /* let workers catch up */
+        if (grep_queue != NULL && find_grep_length (grep_queue) >= GREP_QUEUE_LENGTH (grep_queue))
+            break;
+
+        while (d_name == NULL)
         {
             if (dirp != NULL)
             {
                 mc_closedir (dirp);
                 dirp = NULL;
             }
+            index_dir = NULL;
 
-            while (dirp == NULL)
+            while (dirp == NULL && index_dir == NULL)
             {
                 vfs_path_t *tmp_vpath = NULL;
 
@@ -1300,6 +1456,13 @@ do_search (WDialog * h)
                 while (TRUE)
                 {
                     tmp_vpath = pop_directory ();
+                    if (tmp_vpath == NULL && grep_queue != NULL
+                        && find_grep_length (grep_queue) != 0)
+                    {
+                        /* all files are found, wait for content search */
+                        find_grep_collect (TRUE);
+                        return 1;
+                    }
                     if (tmp_vpath == NULL)
                     {
                         running = FALSE;
@@ -1344,61 +1507,65 @@ do_search (WDialog * h)
                     status_update (str_trunc (directory, WIDGET (h)->cols - 8));
                 }
 
-                dirp = mc_opendir (tmp_vpath);
+                /* name-only search doesn't need to read unchanged local directories */
+                if (content_pattern == NULL && find_index_is_usable (tmp_vpath))
+                {
+                    index_dir = find_index_get_dir (directory);
+                    index_pos = 0;
+                }
+                if (index_dir == NULL)
+                    dirp = mc_opendir (tmp_vpath);
                 vfs_path_free (tmp_vpath);
             }                   /* while (!dirp) */
 
-            /* skip invalid filenames */
-            while ((dp = mc_readdir (dirp)) != NULL && !str_is_valid_string (dp->d_name))
-                ;
-        }                       /* while (!dp) */
+            d_name = find_read_entry (dirp, index_dir, &index_pos, &index_is_dir);
+        }                       /* while (!d_name) */
 
-        if (DIR_IS_DOT (dp->d_name) || DIR_IS_DOTDOT (dp->d_name))
+        if (DIR_IS_DOT (d_name) || DIR_IS_DOTDOT (d_name))
         {
-            /* skip invalid filenames */
-            while ((dp = mc_readdir (dirp)) != NULL && !str_is_valid_string (dp->d_name))
-                ;
-
+            d_name = find_read_entry (dirp, index_dir, &index_pos, &index_is_dir);
             return 1;
         }
 
-        if (!(options.skip_hidden && (dp->d_name[0] == '.')))
+        if (!(options.skip_hidden && (d_name[0] == '.')))
         {
             gboolean search_ok;
 
             if (options.find_recurs && (directory != NULL))
             {                   /* Can directory be NULL ? */
                 /* handle relative ignore dirs here */
-                if (options.ignore_dirs_enable && find_ignore_dir_search (dp->d_name))
+                if (options.ignore_dirs_enable && find_ignore_dir_search (d_name))
                     ignore_count++;
                 else
                 {
                     vfs_path_t *tmp_vpath;
 
-                    tmp_vpath = vfs_path_build_filename (directory, dp->d_name, (char *) NULL);
+                    tmp_vpath = vfs_path_build_filename (directory, d_name, (char *) NULL);
 
-                    if (mc_lstat (tmp_vpath, &tmp_stat) == 0 && S_ISDIR (tmp_stat.st_mode))
+                    if (index_dir != NULL ? index_is_dir
+                        : mc_lstat (tmp_vpath, &tmp_stat) == 0 && S_ISDIR (tmp_stat.st_mode))
                         push_directory (tmp_vpath);
                     else
                         vfs_path_free (tmp_vpath);
                 }
             }
 
-            search_ok = mc_search_run (search_file_handle, dp->d_name,
-                                       0, strlen (dp->d_name), &bytes_found);
+            search_ok = mc_search_run (search_file_handle, d_name,
+                                       0, strlen (d_name), &bytes_found);
 
             if (search_ok)
             {
                 if (content_pattern == NULL)
-                    find_add_match (directory, dp->d_name, 0, 0);
-                else if (search_content (h, directory, dp->d_name))
-                    return 1;
+                    find_add_match (directory, d_name, 0, 0);
+                else if (grep_queue == NULL || !find_grep_push_file (directory, d_name))
+                {
+                    if (search_content (h, directory, d_name))
+                        return 1;
+                }
             }
         }
 
-        /* skip invalid filenames */
-        while ((dp = mc_readdir (dirp)) != NULL && !str_is_valid_string (dp->d_name))
-            ;
+        d_name = find_read_entry (dirp, index_dir, &index_pos, &index_is_dir);
     }                           /* for */
 
     find_rotate_dash (h, TRUE);
@@ -1665,22 +1832,37 @@ setup_gui (void)
 
 /* --------------------------------------------------------------------------------------------- */
 
-static int
-run_process (void)
+static mc_search_t *
+find_content_handle_new (void)
 {
-    int ret;
+    mc_search_t *search;
 
-    search_content_handle = mc_search_new (content_pattern, NULL);
-    if (search_content_handle)
+    search = mc_search_new (content_pattern, NULL);
+    if (search != NULL)
     {
-        search_content_handle->search_type =
-            options.content_regexp ? MC_SEARCH_T_REGEX : MC_SEARCH_T_NORMAL;
-        search_content_handle->is_case_sensitive = options.content_case_sens;
-        search_content_handle->whole_words = options.content_whole_words;
+        search->search_type = options.content_regexp ? MC_SEARCH_T_REGEX : MC_SEARCH_T_NORMAL;
+        search->is_case_sensitive = options.content_case_sens;
+        search->whole_words = options.content_whole_words;
 #ifdef HAVE_CHARSET
-        search_content_handle->is_all_charsets = options.content_all_charsets;
+        search->is_all_charsets = options.content_all_charsets;
 #endif
     }
+
+    return search;
+}
+
+/* --------------------------------------------------------------------------------------------- */
+
+static int
+run_process (void)
+{
+    int ret;
+
+    search_content_handle = find_content_handle_new ();
+    if (search_content_handle != NULL)
+        grep_queue =
+            find_grep_new (find_content_threads, options.content_first_hit,
+                           find_content_handle_new);
     search_file_handle = mc_search_new (find_pattern, NULL);
     search_file_handle->search_type = options.file_pattern ? MC_SEARCH_T_GLOB : MC_SEARCH_T_REGEX;
     search_file_handle->is_case_sensitive = options.file_case_sens;
@@ -1694,6 +1876,8 @@ run_process (void)
     widget_idle (WIDGET (find_dlg), TRUE);
     ret = dlg_run (find_dlg);
 
+    find_grep_free (grep_queue);
+    grep_queue = NULL;
     mc_search_free (search_file_handle);
     search_file_handle = NULL;
     mc_search_free (search_content_handle);
@@ -1735,6 +1919,9 @@ do_find (const char *start_dir, ssize_t start_dir_len, const char *ignore_dirs,
 
     return_value = run_process ();
 
+    /* keep changes of file name index if mc crashes later */
+    find_index_save ();
+
     /* Clear variables */
     init_find_vars ();
 
@@ -1814,6 +2001,7 @@ do_find (const char *start_dir, ssize_t start_dir_len, const char *ignore_dirs,
             list->list[list->len].st = st;
             list->list[list->len].sort_key = NULL;
             list->list[list->len].second_sort_key = NULL;
+            list->list[list->len].fhl_id = 0;
             list->len++;
             g_free (name);
             if ((list->len & 15) == 0)
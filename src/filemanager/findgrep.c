@@ -0,0 +1,812 @@
+/*
+   Concurrent content search of local files for Find File.
+
+   Copyright (C) 2017
+   Free Software Foundation, Inc.
+
+   This file is part of the Midnight Commander.
+
+   The Midnight Commander is free software: you can redistribute it
+   and/or modify it under the terms of the GNU General Public License as
+   published by the Free Software Foundation, either version 3 of the License,
+   or (at your option) any later version.
+
+   The Midnight Commander is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/** \file  findgrep.c
+ *  \brief Source: concurrent content search of local files for Find File
+ *
+ *  The main thread walks directories and matches file names while worker
+ *  threads search the content of found files. Each worker has its own search
+ *  handle because mc_search_t keeps the state of the last match.
+ *
+ *  Workers use plain system calls on local paths only and never touch VFS or UI.
+ *  Jobs are given back to the main thread in the order they were pushed, so
+ *  results are shown in the same order as they are by sequential search.
+ *
+ *  Local files are mapped to memory if possible and searched in place both by
+ *  workers and by the main thread. If the file is truncated by another process
+ *  while it is searched, access to the mapped pages beyond its new end raises
+ *  SIGBUS: find_grep_scan() catches it and stops searching in that file.
+ */
+
+#include <config.h>
+
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#ifdef HAVE_MMAP
+#include <setjmp.h>
+#include <signal.h>
+#include <sys/mman.h>
+#endif
+
+#include "lib/global.h"
+#include "lib/sigbus.h"
+
+#include "findgrep.h"
+
+/*** global variables ****************************************************************************/
+
+/*** file scope macro definitions ****************************************************************/
+
+/* GThreadPool and GAsyncQueue don't need g_thread_init() since glib 2.32 */
+#if GLIB_CHECK_VERSION (2, 32, 0)
+#define FIND_GREP_THREADS 1
+#endif
+
+#define FIND_GREP_BUF_SIZE (64 * 1024)
+
+/* amount of mapped data searched between checks for cancel */
+#define FIND_GREP_SCAN_STEP (4 * 1024 * 1024)
+
+/* number of read lines searched between checks for cancel */
+#define FIND_GREP_LINES_STEP 256
+
+/* files are mapped if SIGBUS can be caught by the thread which searches in them */
+#if defined (HAVE_MMAP) && GLIB_CHECK_VERSION (2, 32, 0)
+#define FIND_GREP_MMAP 1
+#ifndef MAP_FILE
+#define MAP_FILE 0
+#endif
+#endif /* HAVE_MMAP && glib >= 2.32 */
+
+/* how long pop waits for the next job before it gives control back to the UI */
+#define FIND_GREP_WAIT_USEC (G_USEC_PER_SEC / 20)
+
+/*** file scope type declarations ****************************************************************/
+
+struct find_grep_struct
+{
+#ifdef FIND_GREP_THREADS
+    GThreadPool *pool;
+    GAsyncQueue *done;          /* processed jobs in any order */
+    GAsyncQueue *handles;       /* search handles which are not used by workers now */
+    GQueue pending;             /* pushed jobs in order of push */
+    int threads;
+    gboolean first_hit;
+    volatile gint cancelled;
+#else
+    int dummy;
+#endif                          /* FIND_GREP_THREADS */
+};
+
+/*** file scope variables ************************************************************************/
+
+#ifdef FIND_GREP_MMAP
+/* where thread which searches in mapped file returns on SIGBUS, see find_grep_scan() */
+static GPrivate find_grep_sigbus_jmp = G_PRIVATE_INIT (NULL);
+#endif
+
+/*** file scope functions ************************************************************************/
+/* --------------------------------------------------------------------------------------------- */
+
+#ifdef FIND_GREP_MMAP
+static gboolean
+find_grep_sigbus_handler (void *addr, void *data)
+{
+    sigjmp_buf *jmp;
+
+    (void) addr;
+    (void) data;
+
+    jmp = (sigjmp_buf *) g_private_get (&find_grep_sigbus_jmp);
+    if (jmp != NULL)
+        siglongjmp (*jmp, 1);
+
+    /* signal isn't raised by search */
+    return FALSE;
+}
+
+/* --------------------------------------------------------------------------------------------- */
+
+/**
+ * Add SIGBUS handler of search threads once.
+ *
+ * @return TRUE if handler is added, FALSE if files must not be mapped
+ */
+
+static gboolean
+find_grep_sigbus_init (void)
+{
+    static gsize initialized = 0;
+
+    if (g_once_init_enter (&initialized))
+        g_once_init_leave (&initialized,
+                           mc_sigbus_add_handler (find_grep_sigbus_handler, NULL) ? 1 : 2);
+
+    return (initialized == 1);
+}
+#endif /* FIND_GREP_MMAP */
+
+/* --------------------------------------------------------------------------------------------- */
+
+/** Get number of line which contains byte at pos. Lines are counted only when match is found */
+
+static int
+find_grep_scan_line (find_grep_scan_t * scan, size_t pos)
+{
+    while (scan->line_pos < pos)
+    {
+        const char *nl;
+
+        nl = memchr (scan->data + scan->line_pos, '\n', pos - scan->line_pos);
+        if (nl == NULL)
+        {
+            scan->line_pos = pos;
+            break;
+        }
+
+        scan->line++;
+        scan->line_pos = nl - scan->data + 1;
+    }
+
+    return scan->line;
+}
+
+/* --------------------------------------------------------------------------------------------- */
+/** Find the next match in mapped file, see find_grep_scan() */
+
+static gboolean
+find_grep_scan_data (find_grep_scan_t * scan, mc_search_t * search, size_t limit,
+                     find_grep_match_t * match)
+{
+    const char *data = scan->data;
+
+    limit = MIN (limit, scan->size);
+
+    while (scan->pos < limit)
+    {
+        size_t start, end, found_pos;
+        gsize found_len;
+        const char *p;
+
+        /* skip leading NULs */
+        for (start = scan->pos; start < scan->size && data[start] == '\0'; start++)
+            ;
+        if (start >= scan->size)
+        {
+            scan->pos = scan->size;
+            break;
+        }
+
+        if (search->search_type == MC_SEARCH_T_NORMAL)
+        {
+            /* up to the end of line which contains limit */
+            end = MAX (limit, start + 1);
+            p = memchr (data + end, '\n', scan->size - end);
+            end = p != NULL ? (size_t) (p - data) + 1 : scan->size;
+        }
+        else
+        {
+            p = memchr (data + start, '\n', scan->size - start);
+            end = p != NULL ? (size_t) (p - data) : scan->size;
+        }
+
+        p = memchr (data + start, '\0', end - start);
+        if (p != NULL)
+            end = p - data;
+
+        if (end == start)
+        {
+            /* do not search in empty strings */
+            scan->pos = start + 1;
+            continue;
+        }
+
+        if (!mc_search_run (search, data, start, end - 1, &found_len))
+        {
+            scan->pos = end;
+            continue;
+        }
+
+        found_pos = search->normal_offset;
+        match->line = find_grep_scan_line (scan, found_pos);
+        match->start = found_pos + 1;   /* off by one: ticket 3280 */
+        match->end = match->start + found_len;
+
+        /* search in binary line once */
+        p = memchr (data + found_pos, '\n', scan->size - found_pos);
+        scan->pos = p != NULL ? (size_t) (p - data) + 1 : scan->size;
+        return TRUE;
+    }
+
+    return FALSE;
+}
+
+/* --------------------------------------------------------------------------------------------- */
+
+#ifdef FIND_GREP_THREADS
+static void
+find_grep_search_mapped (find_grep_t * g, mc_search_t * search, find_grep_job_t * job,
+                         const char *data, size_t size)
+{
+    find_grep_scan_t scan;
+    find_grep_match_t match;
+
+    find_grep_scan_init (&scan, data, size);
+
+    while (scan.pos < size && g_atomic_int_get (&g->cancelled) == 0)
+    {
+        if (!find_grep_scan (&scan, search, scan.pos + FIND_GREP_SCAN_STEP, &match))
+            continue;
+
+        g_array_append_val (job->matches, match);
+        if (g->first_hit)
+            break;
+    }
+}
+
+/* --------------------------------------------------------------------------------------------- */
+
+static void
+find_grep_search (find_grep_t * g, mc_search_t * search, find_grep_job_t * job)
+{
+    struct stat st;
+    int fd;
+    char *buffer;
+    size_t mapped_size;
+    find_grep_lines_t lines;
+
+    fd = open (job->path, O_RDONLY);
+    if (fd == -1)
+        return;
+
+    if (fstat (fd, &st) != 0 || !S_ISREG (st.st_mode))
+    {
+        close (fd);
+        return;
+    }
+
+    buffer = find_grep_map_file (fd, &mapped_size);
+    if (buffer != NULL)
+    {
+        find_grep_search_mapped (g, search, job, buffer, mapped_size);
+        find_grep_unmap_file (buffer, mapped_size);
+        close (fd);
+        return;
+    }
+
+    buffer = g_malloc (FIND_GREP_BUF_SIZE);
+    find_grep_lines_init (&lines, fd, read, buffer, FIND_GREP_BUF_SIZE);
+
+    while (!lines.eof && g_atomic_int_get (&g->cancelled) == 0)
+    {
+        find_grep_match_t match;
+
+        if (!find_grep_lines_next (&lines, search, FIND_GREP_LINES_STEP, &match))
+            continue;
+
+        g_array_append_val (job->matches, match);
+        if (g->first_hit)
+            break;
+    }
+
+    find_grep_lines_deinit (&lines);
+    g_free (buffer);
+    close (fd);
+}
+
+/* --------------------------------------------------------------------------------------------- */
+
+static void
+find_grep_worker (gpointer data, gpointer user_data)
+{
+    find_grep_job_t *job = (find_grep_job_t *) data;
+    find_grep_t *g = (find_grep_t *) user_data;
+
+    if (g_atomic_int_get (&g->cancelled) == 0)
+    {
+        mc_search_t *search;
+
+        search = (mc_search_t *) g_async_queue_pop (g->handles);
+        find_grep_search (g, search, job);
+        g_async_queue_push (g->handles, search);
+    }
+
+    g_async_queue_push (g->done, job);
+}
+#endif /* FIND_GREP_THREADS */
+
+/* --------------------------------------------------------------------------------------------- */
+/*** public functions ****************************************************************************/
+/* --------------------------------------------------------------------------------------------- */
+/**
+ * Create queue of files searched by worker threads.
+ *
+ * @param threads number of worker threads
+ * @param first_hit stop search in file after the first match
+ * @param handle_new function which creates search handle for each worker
+ * @return new queue, NULL if threads are not available or number of threads is less than 2.
+ *         Use #find_grep_free() to free it.
+ */
+
+find_grep_t *
+find_grep_new (int threads, gboolean first_hit, find_grep_handle_fn handle_new)
+{
+#ifdef FIND_GREP_THREADS
+    find_grep_t *g;
+    int i;
+
+    if (threads < 2)
+        return NULL;
+
+    g = g_new0 (find_grep_t, 1);
+    g->threads = threads;
+    g->first_hit = first_hit;
+    g->done = g_async_queue_new ();
+    g->handles = g_async_queue_new_full ((GDestroyNotify) mc_search_free);
+    g_queue_init (&g->pending);
+
+    for (i = 0; i < threads; i++)
+    {
+        mc_search_t *search;
+
+        /* compile pattern here: workers only run it */
+        search = handle_new ();
+        if (search == NULL || !mc_search_prepare (search))
+        {
+            mc_search_free (search);
+            find_grep_free (g);
+            return NULL;
+        }
+        g_async_queue_push (g->handles, search);
+    }
+
+    g->pool = g_thread_pool_new (find_grep_worker, g, threads, FALSE, NULL);
+    if (g->pool == NULL)
+    {
+        find_grep_free (g);
+        g = NULL;
+    }
+
+    return g;
+#else
+    (void) threads;
+    (void) first_hit;
+    (void) handle_new;
+
+    return NULL;
+#endif /* FIND_GREP_THREADS */
+}
+
+/* --------------------------------------------------------------------------------------------- */
+/**
+ * Stop searching and free the queue.
+ * Jobs which were not popped are freed without reporting.
+ */
+
+void
+find_grep_free (find_grep_t * g)
+{
+#ifdef FIND_GREP_THREADS
+    find_grep_job_t *job;
+
+    if (g == NULL)
+        return;
+
+    g_atomic_int_set (&g->cancelled, 1);
+    if (g->pool != NULL)
+        g_thread_pool_free (g->pool, TRUE, TRUE);
+
+    /* all jobs are in the pending list */
+    while (g_async_queue_try_pop (g->done) != NULL)
+        ;
+    while ((job = (find_grep_job_t *) g_queue_pop_head (&g->pending)) != NULL)
+        find_grep_job_free (job);
+
+    g_async_queue_unref (g->done);
+    g_async_queue_unref (g->handles);
+    g_free (g);
+#else
+    (void) g;
+#endif /* FIND_GREP_THREADS */
+}
+
+/* --------------------------------------------------------------------------------------------- */
+/**
+ * @return number of jobs pushed into the queue and not popped yet
+ */
+
+int
+find_grep_length (const find_grep_t * g)
+{
+#ifdef FIND_GREP_THREADS
+    return (int) g_queue_get_length ((GQueue *) & g->pending);
+#else
+    (void) g;
+
+    return 0;
+#endif /* FIND_GREP_THREADS */
+}
+
+/* --------------------------------------------------------------------------------------------- */
+
+int
+find_grep_threads (const find_grep_t * g)
+{
+#ifdef FIND_GREP_THREADS
+    return g->threads;
+#else
+    (void) g;
+
+    return 0;
+#endif /* FIND_GREP_THREADS */
+}
+
+/* --------------------------------------------------------------------------------------------- */
+/**
+ * Start searching in the file. Queue takes ownership of the job.
+ */
+
+void
+find_grep_push (find_grep_t * g, find_grep_job_t * job)
+{
+#ifdef FIND_GREP_THREADS
+    g_queue_push_tail (&g->pending, job);
+    g_thread_pool_push (g->pool, job, NULL);
+#else
+    (void) g;
+    (void) job;
+#endif /* FIND_GREP_THREADS */
+}
+
+/* --------------------------------------------------------------------------------------------- */
+/**
+ * Get the oldest job if it is processed.
+ *
+ * @param wait if TRUE, wait for a while until the oldest job is processed
+ * @return processed job, NULL if the oldest job is not processed yet or there are no jobs.
+ *         Use #find_grep_job_free() to free it.
+ */
+
+find_grep_job_t *
+find_grep_pop (find_grep_t * g, gboolean wait)
+{
+#ifdef FIND_GREP_THREADS
+    find_grep_job_t *head, *job;
+
+    head = (find_grep_job_t *) g_queue_peek_head (&g->pending);
+    if (head == NULL)
+        return NULL;
+
+    while ((job = (find_grep_job_t *) g_async_queue_try_pop (g->done)) != NULL)
+        job->finished = TRUE;
+
+    if (!head->finished && wait)
+    {
+        gint64 end_time;
+
+        end_time = g_get_monotonic_time () + FIND_GREP_WAIT_USEC;
+
+        while (!head->finished)
+        {
+            gint64 now;
+
+            now = g_get_monotonic_time ();
+            if (now >= end_time)
+                break;
+
+            job = (find_grep_job_t *) g_async_queue_timeout_pop (g->done, end_time - now);
+            if (job != NULL)
+                job->finished = TRUE;
+        }
+    }
+
+    if (!head->finished)
+        return NULL;
+
+    return (find_grep_job_t *) g_queue_pop_head (&g->pending);
+#else
+    (void) g;
+    (void) wait;
+
+    return NULL;
+#endif /* FIND_GREP_THREADS */
+}
+
+/* --------------------------------------------------------------------------------------------- */
+/**
+ * Map content of local regular file to memory for sequential reading.
+ *
+ * @param fd opened file
+ * @param size size of mapped data
+ * @return mapped data, NULL if file is empty or cannot be mapped.
+ *         Use #find_grep_unmap_file() to unmap it.
+ */
+
+char *
+find_grep_map_file (int fd, size_t * size)
+{
+#ifdef FIND_GREP_MMAP
+    struct stat st;
+    char *data;
+
+    if (fstat (fd, &st) != 0 || !S_ISREG (st.st_mode) || st.st_size <= 0
+        || (off_t) (size_t) st.st_size != st.st_size || !find_grep_sigbus_init ())
+        return NULL;
+
+    *size = (size_t) st.st_size;
+    data = mmap (NULL, *size, PROT_READ, MAP_FILE | MAP_PRIVATE, fd, 0);
+    if (data == (char *) MAP_FAILED)
+        return NULL;
+
+#ifdef MADV_SEQUENTIAL
+    (void) madvise (data, *size, MADV_SEQUENTIAL);
+#endif
+
+    return data;
+#else
+    (void) fd;
+    (void) size;
+
+    return NULL;
+#endif /* FIND_GREP_MMAP */
+}
+
+/* --------------------------------------------------------------------------------------------- */
+
+void
+find_grep_unmap_file (char *data, size_t size)
+{
+#ifdef FIND_GREP_MMAP
+    if (data != NULL)
+        munmap (data, size);
+#else
+    (void) data;
+    (void) size;
+#endif /* FIND_GREP_MMAP */
+}
+
+/* --------------------------------------------------------------------------------------------- */
+
+void
+find_grep_scan_init (find_grep_scan_t * scan, const char *data, size_t size)
+{
+    scan->data = data;
+    scan->size = size;
+    scan->pos = 0;
+    scan->line_pos = 0;
+    scan->line = 1;
+}
+
+/* --------------------------------------------------------------------------------------------- */
+/**
+ * Find the next match in mapped file. Results are the same as ones of search_content() in find.c:
+ * lines are split by newline and NUL characters and a line gives one match at most.
+ *
+ * Plain text doesn't contain newlines, so it is searched in many lines at once up to the next NUL.
+ * Regexp is searched in each line.
+ *
+ * If the file is truncated while it is searched, the rest of it is treated as unreadable:
+ * the search is stopped at the end of data. Memory allocated by the search handle for the
+ * interrupted run can be lost then.
+ *
+ * @param limit search is stopped at the end of line which contains this offset
+ * @param match found match
+ * @return TRUE if match is found, FALSE if limit or the end of data is reached
+ */
+
+gboolean
+find_grep_scan (find_grep_scan_t * scan, mc_search_t * search, size_t limit,
+                find_grep_match_t * match)
+{
+#ifdef FIND_GREP_MMAP
+    sigjmp_buf jmp;
+    gboolean found;
+
+    if (sigsetjmp (jmp, 1) != 0)
+    {
+        g_private_set (&find_grep_sigbus_jmp, NULL);
+        scan->pos = scan->size;
+        return FALSE;
+    }
+
+    g_private_set (&find_grep_sigbus_jmp, &jmp);
+    found = find_grep_scan_data (scan, search, limit, match);
+    g_private_set (&find_grep_sigbus_jmp, NULL);
+
+    return found;
+#else
+    return find_grep_scan_data (scan, search, limit, match);
+#endif /* FIND_GREP_MMAP */
+}
+
+/* --------------------------------------------------------------------------------------------- */
+/**
+ * Prepare search in lines of file read by @read_fn. Use #find_grep_lines_deinit() to free it.
+ *
+ * @param buffer raw input buffer, owned by caller
+ */
+
+void
+find_grep_lines_init (find_grep_lines_t * lines, int fd, find_grep_read_fn read_fn,
+                      char *buffer, size_t buffer_size)
+{
+    lines->read = read_fn;
+    lines->fd = fd;
+    lines->buffer = buffer;
+    lines->buffer_size = buffer_size;
+    lines->pos = 0;
+    lines->n_read = 0;
+    lines->off = 0;
+    lines->len = (gsize) (-1);  /* compensate for a newline we'll add when we read the first line */
+    lines->line = 1;
+    lines->found = FALSE;
+    lines->eof = FALSE;
+    lines->strbuf = NULL;
+    lines->strbuf_size = 0;
+}
+
+/* --------------------------------------------------------------------------------------------- */
+
+void
+find_grep_lines_deinit (find_grep_lines_t * lines)
+{
+    g_free (lines->strbuf);
+    lines->strbuf = NULL;
+    lines->strbuf_size = 0;
+}
+
+/* --------------------------------------------------------------------------------------------- */
+/**
+ * Find the next match in file which is read sequentially. This is the search loop of Find File
+ * for files which are not mapped to memory: the search is done in lines split by newline and
+ * NUL characters, leading NULs of line are skipped and a binary line (one which is ended with
+ * NUL) gives one match at most.
+ *
+ * @param count search is stopped after this number of lines
+ * @param match found match
+ * @return TRUE if match is found, FALSE if @count lines are searched or the end of file
+ *         is reached (lines->eof is set then). Read errors are treated as the end of file.
+ */
+
+gboolean
+find_grep_lines_next (find_grep_lines_t * lines, mc_search_t * search, int count,
+                      find_grep_match_t * match)
+{
+    for (; !lines->eof && count > 0; count--)
+    {
+        char ch = '\0';
+        gboolean matched = FALSE;
+
+        lines->off += lines->len + 1;   /* the previous line, plus a newline character */
+        lines->len = 0;
+
+        /* read to buffer and get line from there */
+        while (TRUE)
+        {
+            if (lines->pos >= lines->n_read)
+            {
+                lines->pos = 0;
+                do
+                    lines->n_read = lines->read (lines->fd, lines->buffer, lines->buffer_size);
+                while (lines->n_read < 0 && errno == EINTR);
+                if (lines->n_read <= 0)
+                    break;
+            }
+
+            ch = lines->buffer[lines->pos++];
+            if (ch == '\0')
+            {
+                /* skip possible leading zero(s) */
+                if (lines->len == 0)
+                {
+                    lines->off++;
+                    continue;
+                }
+                break;
+            }
+
+            if (lines->len + 1 >= lines->strbuf_size)
+            {
+                lines->strbuf_size += 128;
+                lines->strbuf = g_realloc (lines->strbuf, lines->strbuf_size);
+            }
+
+            /* Strip newline */
+            if (ch == '\n')
+                break;
+
+            lines->strbuf[lines->len++] = ch;
+        }
+
+        if (lines->len == 0)
+        {
+            if (ch == '\0')
+            {
+                lines->eof = TRUE;
+                break;
+            }
+
+            /* if (ch == '\n'): do not search in empty strings */
+        }
+        else if (!lines->found)        /* Search in binary line once */
+        {
+            gsize found_len;
+
+            lines->strbuf[lines->len] = '\0';
+
+            if (mc_search_run (search, (const void *) lines->strbuf, 0, lines->len, &found_len))
+            {
+                match->line = lines->line;
+                match->start = lines->off + search->normal_offset + 1;  /* off by one: ticket 3280 */
+                match->end = match->start + found_len;
+                lines->found = TRUE;
+                matched = TRUE;
+            }
+        }
+
+        if (ch == '\n')
+        {
+            lines->found = FALSE;
+            lines->line++;
+        }
+
+        if (matched)
+            return TRUE;
+    }
+
+    return FALSE;
+}
+
+/* --------------------------------------------------------------------------------------------- */
+
+find_grep_job_t *
+find_grep_job_new (const char *directory, const char *filename, const char *path)
+{
+    find_grep_job_t *job;
+
+    job = g_new0 (find_grep_job_t, 1);
+    job->directory = g_strdup (directory);
+    job->filename = g_strdup (filename);
+    job->path = g_strdup (path);
+    job->matches = g_array_new (FALSE, FALSE, sizeof (find_grep_match_t));
+
+    return job;
+}
+
+/* --------------------------------------------------------------------------------------------- */
+
+void
+find_grep_job_free (find_grep_job_t * job)
+{
+    if (job != NULL)
+    {
+        g_free (job->directory);
+        g_free (job->filename);
+        g_free (job->path);
+        g_array_free (job->matches, TRUE);
+        g_free (job);
+    }
+}
+
+/* --------------------------------------------------------------------------------------------- */
@@ -0,0 +1,103 @@
+/** \file  findgrep.h
+ *  \brief Header: concurrent content search of local files for Find File
+ */
+
+#ifndef MC__FINDGREP_H
+#define MC__FINDGREP_H
+
+#include "lib/global.h"
+#include "lib/search.h"         /* mc_search_t */
+
+/*** typedefs(not structures) and defined constants **********************************************/
+
+typedef struct find_grep_struct find_grep_t;
+
+/* Create search handle with options of Find File dialog. Called in main thread only */
+typedef mc_search_t *(*find_grep_handle_fn) (void);
+
+/* Read data from file: read() for local files, mc_read() for files on VFS */
+typedef ssize_t (*find_grep_read_fn) (int fd, void *buf, size_t count);
+
+/*** enums ***************************************************************************************/
+
+/*** structures declarations (and typedefs of structures)*****************************************/
+
+/* One match in file */
+typedef struct
+{
+    int line;                   /* number of line, starting from 1 */
+    gsize start;                /* offset of match in file */
+    gsize end;                  /* offset of the end of match in file */
+} find_grep_match_t;
+
+/* One file to be searched by worker thread */
+typedef struct
+{
+    /* input */
+    char *directory;            /* directory as it is shown in the results */
+    char *filename;             /* name of file in directory */
+    char *path;                 /* local absolute path of file */
+
+    /* output */
+    GArray *matches;            /* array of find_grep_match_t in order of lines */
+    gboolean finished;          /* job is processed by worker, set by queue in main thread */
+} find_grep_job_t;
+
+/* State of search in file mapped to memory */
+typedef struct
+{
+    const char *data;           /* content of file */
+    size_t size;                /* size of file */
+    size_t pos;                 /* offset where search continues */
+    size_t line_pos;            /* lines are counted up to this offset */
+    int line;                   /* number of line which contains line_pos */
+} find_grep_scan_t;
+
+/* State of search in lines of file which is read sequentially */
+typedef struct
+{
+    find_grep_read_fn read;
+    int fd;
+    char *buffer;               /* raw input buffer */
+    size_t buffer_size;
+    ssize_t pos;                /* offset of the next character in buffer */
+    ssize_t n_read;             /* number of characters in buffer */
+    off_t off;                  /* file offset corresponding to strbuf[0] */
+    gsize len;                  /* length of the current line */
+    int line;                   /* number of the current line, starting from 1 */
+    gboolean found;             /* match is found in the current line */
+    gboolean eof;               /* end of file is reached */
+    char *strbuf;               /* buffer for fetched line */
+    gsize strbuf_size;
+} find_grep_lines_t;
+
+/*** global variables defined in .c file *********************************************************/
+
+/*** declarations of public functions ************************************************************/
+
+find_grep_t *find_grep_new (int threads, gboolean first_hit, find_grep_handle_fn handle_new);
+void find_grep_free (find_grep_t * g);
+
+int find_grep_length (const find_grep_t * g);
+int find_grep_threads (const find_grep_t * g);
+void find_grep_push (find_grep_t * g, find_grep_job_t * job);
+find_grep_job_t *find_grep_pop (find_grep_t * g, gboolean wait);
+
+char *find_grep_map_file (int fd, size_t * size);
+void find_grep_unmap_file (char *data, size_t size);
+void find_grep_scan_init (find_grep_scan_t * scan, const char *data, size_t size);
+gboolean find_grep_scan (find_grep_scan_t * scan, mc_search_t * search, size_t limit,
+                         find_grep_match_t * match);
+
+void find_grep_lines_init (find_grep_lines_t * lines, int fd, find_grep_read_fn read_fn,
+                          char *buffer, size_t buffer_size);
+void find_grep_lines_deinit (find_grep_lines_t * lines);
+gboolean find_grep_lines_next (find_grep_lines_t * lines, mc_search_t * search, int count,
+                               find_grep_match_t * match);
+
+find_grep_job_t *find_grep_job_new (const char *directory, const char *filename, const char *path);
+void find_grep_job_free (find_grep_job_t * job);
+
+/*** inline functions ****************************************************************************/
+
+#endif /* MC__FINDGREP_H */
@@ -0,0 +1,989 @@
+/*
+   Persistent index of file names for Find File.
+
+   Copyright (C) 2017
+   Free Software Foundation, Inc.
+
+   This file is part of the Midnight Commander.
+
+   The Midnight Commander is free software: you can redistribute it
+   and/or modify it under the terms of the GNU General Public License as
+   published by the Free Software Foundation, either version 3 of the License,
+   or (at your option) any later version.
+
+   The Midnight Commander is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/** \file  findindex.c
+ *  \brief Source: persistent index of file names for Find File
+ *
+ *  The index keeps names and types of entries of local directories visited by
+ *  Find File. A name-only search takes entries of directory from the index
+ *  instead of reading the directory and calling lstat() for each entry.
+ *
+ *  Directory is read again only if it is changed. Changes are detected by
+ *  modification time of directory, which costs one stat() per directory, and
+ *  while mc is running directories are also watched by inotify, so unchanged
+ *  watched directories are not checked at all.
+ *
+ *  The index is loaded from the cache directory on first use. It is a log of
+ *  records: a record of directory replaces an earlier one with the same path
+ *  and a record of removed directory drops it. After Find File only records of
+ *  directories changed since the last save are appended. The file is written
+ *  again from scratch when it becomes twice as large as the index it holds.
+ *
+ *  Size of the index is limited: least recently used directories are dropped
+ *  when the index is saved.
+ */
+
+#include <config.h>
+
+#include <dirent.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#ifdef HAVE_SYS_INOTIFY_H
+#include <poll.h>
+#include <sys/inotify.h>
+#endif
+
+#include "lib/global.h"
+#include "lib/util.h"
+#include "lib/fileloc.h"
+#include "lib/mcconfig.h"       /* mc_config_get_cache_path() */
+
+#include "src/setup.h"          /* find_name_index */
+
+#include "findindex.h"
+
+/*** global variables ****************************************************************************/
+
+/*** file scope macro definitions ****************************************************************/
+
+#define FIND_INDEX_MAGIC "MCFIND2"
+
+/* entries_len of record of removed directory */
+#define FIND_INDEX_REMOVED G_MAXUINT32
+
+/* records of directories kept in the index, in bytes */
+#ifndef FIND_INDEX_MAX_SIZE
+#define FIND_INDEX_MAX_SIZE (32 * 1024 * 1024)
+#endif
+
+/* types of entries */
+#define FIND_INDEX_T_DIR 'd'
+#define FIND_INDEX_T_OTHER 'f'
+
+#ifdef HAVE_SYS_INOTIFY_H
+/* don't take all inotify watches of user from other programs */
+#define FIND_INDEX_MAX_WATCHES 4096
+
+#define FIND_INDEX_WATCH_MASK (IN_CREATE | IN_DELETE | IN_MOVED_FROM | IN_MOVED_TO \
+                               | IN_DELETE_SELF | IN_MOVE_SELF | IN_ONLYDIR)
+#endif
+
+/*** file scope type declarations ****************************************************************/
+
+struct find_index_dir_struct
+{
+    char *path;                 /* absolute path of directory, key in the index */
+    gint64 mtime;               /* modification time of directory when it was read */
+    gint64 scan_time;           /* time when directory was read */
+    guint64 dev;
+    guint64 ino;
+    char *entries;              /* type of each entry followed by its name and NUL */
+    guint32 entries_len;
+    int wd;                     /* inotify watch, -1 if directory isn't watched */
+    gboolean dirty;             /* watched directory may be changed since it was checked */
+    gboolean unsaved;           /* directory is read again since the index was saved */
+    guint64 used;               /* value of use_count when directory was used last time */
+};
+
+/* Index file: header, then records each followed by path and entries of directory */
+typedef struct
+{
+    char magic[8];
+} find_index_header_t;
+
+typedef struct
+{
+    gint64 mtime;
+    gint64 scan_time;
+    guint64 dev;
+    guint64 ino;
+    guint32 path_len;
+    guint32 entries_len;
+} find_index_record_t;
+
+/*** file scope variables ************************************************************************/
+
+/* path -> find_index_dir_t */
+static GHashTable *dirs = NULL;
+static gboolean dirs_changed = FALSE;
+/* paths of directories removed from the index since it was saved */
+static GHashTable *removed = NULL;
+static guint64 use_count = 0;
+
+/* index file as it was read or written last time */
+static gboolean index_known = FALSE;
+static off_t index_len = 0;
+static dev_t index_dev = 0;
+static ino_t index_ino = 0;
+
+#ifdef HAVE_SYS_INOTIFY_H
+static int inotify_fd = -1;
+static gboolean inotify_failed = FALSE;
+/* watch -> find_index_dir_t */
+static GHashTable *watches = NULL;
+/* mount points don't produce inotify events, so changes of mount table are polled */
+static int mounts_fd = -1;
+#endif
+
+/* --------------------------------------------------------------------------------------------- */
+/*** file scope functions ************************************************************************/
+/* --------------------------------------------------------------------------------------------- */
+
+static char *
+find_index_file_name (void)
+{
+    return mc_build_filename (mc_config_get_cache_path (), MC_FIND_INDEX_FILE, (char *) NULL);
+}
+
+/* --------------------------------------------------------------------------------------------- */
+
+static const char *
+find_index_next_entry (const char *entries, size_t len, size_t * pos, gboolean * is_dir)
+{
+    const char *name;
+
+    if (*pos >= len)
+        return NULL;
+
+    *is_dir = entries[*pos] == FIND_INDEX_T_DIR;
+    name = entries + *pos + 1;
+    *pos += strlen (name) + 2;
+
+    return name;
+}
+
+/* --------------------------------------------------------------------------------------------- */
+
+#ifdef HAVE_SYS_INOTIFY_H
+static void
+find_index_unwatch (find_index_dir_t * dir)
+{
+    if (dir->wd < 0)
+        return;
+
+    g_hash_table_remove (watches, GINT_TO_POINTER (dir->wd));
+    inotify_rm_watch (inotify_fd, dir->wd);
+    dir->wd = -1;
+}
+
+/* --------------------------------------------------------------------------------------------- */
+
+static void
+find_index_watch (find_index_dir_t * dir)
+{
+    int wd;
+
+    if (dir->wd >= 0)
+        return;
+
+    if (inotify_fd < 0 && !inotify_failed)
+    {
+        inotify_fd = inotify_init1 (IN_NONBLOCK | IN_CLOEXEC);
+        if (inotify_fd >= 0)
+        {
+            mounts_fd = open ("/proc/self/mountinfo", O_RDONLY);
+            if (mounts_fd < 0)
+            {
+                /* without it directories hidden by mount points can't be noticed */
+                close (inotify_fd);
+                inotify_fd = -1;
+            }
+        }
+        inotify_failed = inotify_fd < 0;
+        if (!inotify_failed)
+            watches = g_hash_table_new (g_direct_hash, g_direct_equal);
+    }
+
+    if (inotify_fd < 0 || g_hash_table_size (watches) >= FIND_INDEX_MAX_WATCHES)
+        return;
+
+    wd = inotify_add_watch (inotify_fd, dir->path, FIND_INDEX_WATCH_MASK);
+    /* same directory can be reached by another path, keep the first one only */
+    if (wd < 0 || g_hash_table_lookup (watches, GINT_TO_POINTER (wd)) != NULL)
+        return;
+
+    dir->wd = wd;
+    g_hash_table_insert (watches, GINT_TO_POINTER (wd), dir);
+}
+
+/* --------------------------------------------------------------------------------------------- */
+
+static void
+find_index_mark_dirty (gpointer key, gpointer value, gpointer user_data)
+{
+    (void) key;
+    (void) user_data;
+
+    ((find_index_dir_t *) value)->dirty = TRUE;
+}
+
+/* --------------------------------------------------------------------------------------------- */
+/**
+ * Mark directories changed since the last call. They will be checked by modification time.
+ */
+
+static void
+find_index_read_events (void)
+{
+    union
+    {
+        struct inotify_event event;
+        char buf[4096];
+    } u;
+    struct pollfd pfd;
+    ssize_t n;
+
+    if (inotify_fd < 0)
+        return;
+
+    pfd.fd = mounts_fd;
+    pfd.events = POLLPRI;
+    pfd.revents = 0;
+    if (poll (&pfd, 1, 0) > 0 && (pfd.revents & (POLLPRI | POLLERR)) != 0)
+        g_hash_table_foreach (watches, find_index_mark_dirty, NULL);
+
+    while ((n = read (inotify_fd, u.buf, sizeof (u.buf))) > 0)
+    {
+        const char *p;
+
+        for (p = u.buf; p < u.buf + n;
+             p += sizeof (struct inotify_event) + ((const struct inotify_event *) p)->len)
+        {
+            const struct inotify_event *event = (const struct inotify_event *) p;
+            find_index_dir_t *dir;
+
+            if ((event->mask & IN_Q_OVERFLOW) != 0)
+            {
+                g_hash_table_foreach (watches, find_index_mark_dirty, NULL);
+                continue;
+            }
+
+            dir = (find_index_dir_t *) g_hash_table_lookup (watches, GINT_TO_POINTER (event->wd));
+            if (dir == NULL)
+                continue;
+
+            dir->dirty = TRUE;
+            /* watch is removed by kernel */
+            if ((event->mask & IN_IGNORED) != 0)
+            {
+                g_hash_table_remove (watches, GINT_TO_POINTER (event->wd));
+                dir->wd = -1;
+            }
+        }
+    }
+}
+#endif /* HAVE_SYS_INOTIFY_H */
+
+/* --------------------------------------------------------------------------------------------- */
+
+static void
+find_index_dir_free (gpointer data)
+{
+    find_index_dir_t *dir = (find_index_dir_t *) data;
+
+#ifdef HAVE_SYS_INOTIFY_H
+    find_index_unwatch (dir);
+#endif
+    g_free (dir->path);
+    g_free (dir->entries);
+    g_free (dir);
+}
+
+/* --------------------------------------------------------------------------------------------- */
+
+static find_index_dir_t *
+find_index_dir_new (char *path)
+{
+    find_index_dir_t *dir;
+
+    dir = g_new0 (find_index_dir_t, 1);
+    dir->path = path;
+    dir->wd = -1;
+    dir->used = ++use_count;
+    g_hash_table_replace (dirs, dir->path, dir);
+    g_hash_table_remove (removed, path);
+
+    return dir;
+}
+
+/* --------------------------------------------------------------------------------------------- */
+
+static void
+find_index_forget (const char *path)
+{
+    char *key;
+
+    /* path can be owned by directory */
+    key = g_strdup (path);
+    if (g_hash_table_remove (dirs, key))
+        g_hash_table_insert (removed, key, NULL);
+    else
+        g_free (key);
+}
+
+/* --------------------------------------------------------------------------------------------- */
+
+static gsize
+find_index_record_size (const find_index_dir_t * dir)
+{
+    return sizeof (find_index_record_t) + strlen (dir->path) + dir->entries_len;
+}
+
+/* --------------------------------------------------------------------------------------------- */
+
+static void
+find_index_append_record (GString * buf, const char *path, const find_index_dir_t * dir)
+{
+    find_index_record_t rec;
+
+    memset (&rec, 0, sizeof (rec));
+    rec.path_len = strlen (path);
+    if (dir == NULL)
+        rec.entries_len = FIND_INDEX_REMOVED;
+    else
+    {
+        rec.mtime = dir->mtime;
+        rec.scan_time = dir->scan_time;
+        rec.dev = dir->dev;
+        rec.ino = dir->ino;
+        rec.entries_len = dir->entries_len;
+    }
+
+    g_string_append_len (buf, (const char *) &rec, sizeof (rec));
+    g_string_append_len (buf, path, rec.path_len);
+    if (dir != NULL)
+        g_string_append_len (buf, dir->entries, rec.entries_len);
+}
+
+/* --------------------------------------------------------------------------------------------- */
+
+static void
+find_index_stat_file (const char *file_name)
+{
+    struct stat st;
+
+    index_known = stat (file_name, &st) == 0;
+    if (index_known)
+    {
+        index_len = st.st_size;
+        index_dev = st.st_dev;
+        index_ino = st.st_ino;
+    }
+}
+
+/* --------------------------------------------------------------------------------------------- */
+
+static void
+find_index_load (void)
+{
+    char *file_name;
+    GMappedFile *mapped;
+    const char *p, *end;
+    find_index_header_t header;
+
+    dirs = g_hash_table_new_full (g_str_hash, g_str_equal, NULL, find_index_dir_free);
+    removed = g_hash_table_new_full (g_str_hash, g_str_equal, g_free, NULL);
+    index_known = FALSE;
+
+    file_name = find_index_file_name ();
+    mapped = g_mapped_file_new (file_name, FALSE, NULL);
+    if (mapped != NULL)
+        find_index_stat_file (file_name);
+    g_free (file_name);
+    if (mapped == NULL)
+        return;
+
+    p = g_mapped_file_get_contents (mapped);
+    end = p + g_mapped_file_get_length (mapped);
+
+    if ((size_t) (end - p) < sizeof (header)
+        || strncmp (p, FIND_INDEX_MAGIC, sizeof (header.magic)) != 0)
+    {
+        /* file of other format is written again on save */
+        index_known = FALSE;
+        p = end;
+    }
+    else
+        p += sizeof (header);
+
+    while (p < end)
+    {
+        find_index_record_t rec;
+        find_index_dir_t *dir;
+        char *path;
+
+        if ((size_t) (end - p) < sizeof (rec))
+            break;
+        memcpy (&rec, p, sizeof (rec));
+
+        if (rec.path_len == 0 || (size_t) (end - p) - sizeof (rec) < rec.path_len
+            || memchr (p + sizeof (rec), '\0', rec.path_len) != NULL)
+            break;
+
+        if (rec.entries_len != FIND_INDEX_REMOVED
+            && ((size_t) (end - p) - sizeof (rec) - rec.path_len < rec.entries_len
+                || (rec.entries_len != 0
+                    && p[sizeof (rec) + rec.path_len + rec.entries_len - 1] != '\0')))
+            break;
+
+        p += sizeof (rec);
+        path = g_strndup (p, rec.path_len);
+        p += rec.path_len;
+
+        if (rec.entries_len == FIND_INDEX_REMOVED)
+        {
+            g_hash_table_remove (dirs, path);
+            g_free (path);
+            continue;
+        }
+
+        dir = (find_index_dir_t *) g_hash_table_lookup (dirs, path);
+        if (dir == NULL)
+            dir = find_index_dir_new (path);
+        else
+        {
+            /* later record replaces earlier one */
+            g_free (path);
+            g_free (dir->entries);
+            dir->used = ++use_count;
+        }
+
+        dir->entries = g_malloc (rec.entries_len);
+        memcpy (dir->entries, p, rec.entries_len);
+        p += rec.entries_len;
+        dir->entries_len = rec.entries_len;
+        dir->mtime = rec.mtime;
+        dir->scan_time = rec.scan_time;
+        dir->dev = rec.dev;
+        dir->ino = rec.ino;
+    }
+
+    /* records before damaged one are kept, the file will be written again */
+    if (p != end || index_len != (off_t) g_mapped_file_get_length (mapped))
+    {
+        index_known = FALSE;
+        dirs_changed = TRUE;
+    }
+
+    g_mapped_file_unref (mapped);
+}
+
+/* --------------------------------------------------------------------------------------------- */
+
+static gboolean
+find_index_forget_in_subtree (gpointer key, gpointer value, gpointer user_data)
+{
+    const char *path = (const char *) key;
+    const char *top = (const char *) user_data;
+    size_t len;
+
+    (void) value;
+
+    len = strlen (top);
+    if (strncmp (path, top, len) != 0 || (path[len] != '\0' && path[len] != PATH_SEP))
+        return FALSE;
+
+    g_hash_table_insert (removed, g_strdup (path), NULL);
+    return TRUE;
+}
+
+/* --------------------------------------------------------------------------------------------- */
+/**
+ * Forget subdirectories which are removed from just read directory.
+ */
+
+static void
+find_index_forget_removed (const find_index_dir_t * dir, const GString * entries)
+{
+    GHashTable *names = NULL;
+    const char *name;
+    gboolean is_dir;
+    size_t pos;
+
+    for (pos = 0; (name = find_index_next_entry (dir->entries, dir->entries_len, &pos, &is_dir))
+         != NULL;)
+    {
+        if (!is_dir)
+            continue;
+
+        if (names == NULL)
+        {
+            const char *n;
+            size_t npos;
+
+            names = g_hash_table_new (g_str_hash, g_str_equal);
+            for (npos = 0;
+                 (n = find_index_next_entry (entries->str, entries->len, &npos, &is_dir)) != NULL;)
+                if (is_dir)
+                    g_hash_table_insert (names, (gpointer) n, (gpointer) n);
+        }
+
+        if (g_hash_table_lookup (names, name) == NULL)
+        {
+            char *path;
+
+            path = mc_build_filename (dir->path, name, (char *) NULL);
+            g_hash_table_foreach_remove (dirs, find_index_forget_in_subtree, path);
+            g_free (path);
+        }
+    }
+
+    if (names != NULL)
+        g_hash_table_destroy (names);
+}
+
+/* --------------------------------------------------------------------------------------------- */
+/**
+ * Read entries of directory and their types.
+ *
+ * @return TRUE on success
+ */
+
+static gboolean
+find_index_read_dir (find_index_dir_t * dir, const struct stat *st)
+{
+    DIR *dirp;
+    struct dirent *dp;
+    GString *entries;
+    gint64 scan_time;
+
+    /* directory changed in the same second as it is read looks unchanged later */
+    scan_time = (gint64) time (NULL);
+
+    dirp = opendir (dir->path);
+    if (dirp == NULL)
+        return FALSE;
+
+    entries = g_string_sized_new (1024);
+
+    while ((dp = readdir (dirp)) != NULL)
+    {
+        gboolean is_dir;
+
+        if (DIR_IS_DOT (dp->d_name) || DIR_IS_DOTDOT (dp->d_name))
+            continue;
+
+#ifdef DT_UNKNOWN
+        if (dp->d_type != DT_UNKNOWN)
+            is_dir = dp->d_type == DT_DIR;
+        else
+#endif
+        {
+            struct stat entry_st;
+            char *path;
+
+            path = mc_build_filename (dir->path, dp->d_name, (char *) NULL);
+            is_dir = lstat (path, &entry_st) == 0 && S_ISDIR (entry_st.st_mode);
+            g_free (path);
+        }
+
+        g_string_append_c (entries, is_dir ? FIND_INDEX_T_DIR : FIND_INDEX_T_OTHER);
+        g_string_append_len (entries, dp->d_name, strlen (dp->d_name) + 1);
+    }
+
+    closedir (dirp);
+
+    find_index_forget_removed (dir, entries);
+
+    g_free (dir->entries);
+    dir->entries_len = entries->len;
+    dir->entries = g_string_free (entries, FALSE);
+    dir->mtime = st->st_mtime;
+    dir->scan_time = scan_time;
+    dir->dev = st->st_dev;
+    dir->ino = st->st_ino;
+    dir->unsaved = TRUE;
+
+    return TRUE;
+}
+
+/* --------------------------------------------------------------------------------------------- */
+
+static int
+find_index_compare_used (gconstpointer a, gconstpointer b)
+{
+    const find_index_dir_t *da = *(const find_index_dir_t * const *) a;
+    const find_index_dir_t *db = *(const find_index_dir_t * const *) b;
+
+    return da->used < db->used ? -1 : (da->used > db->used ? 1 : 0);
+}
+
+/* --------------------------------------------------------------------------------------------- */
+/**
+ * Get directories of the index from least recently used one.
+ */
+
+static GPtrArray *
+find_index_get_sorted (void)
+{
+    GPtrArray *sorted;
+    GHashTableIter iter;
+    gpointer value;
+
+    sorted = g_ptr_array_sized_new (g_hash_table_size (dirs));
+    g_hash_table_iter_init (&iter, dirs);
+    while (g_hash_table_iter_next (&iter, NULL, &value))
+        g_ptr_array_add (sorted, value);
+    g_ptr_array_sort (sorted, find_index_compare_used);
+
+    return sorted;
+}
+
+/* --------------------------------------------------------------------------------------------- */
+/**
+ * Drop least recently used directories if the index is too large.
+ *
+ * @return size of records of the index
+ */
+
+static gsize
+find_index_evict (void)
+{
+    GHashTableIter iter;
+    gpointer value;
+    GPtrArray *sorted;
+    gsize size = 0;
+    guint i;
+
+    g_hash_table_iter_init (&iter, dirs);
+    while (g_hash_table_iter_next (&iter, NULL, &value))
+        size += find_index_record_size ((const find_index_dir_t *) value);
+
+    if (size <= FIND_INDEX_MAX_SIZE)
+        return size;
+
+    sorted = find_index_get_sorted ();
+    for (i = 0; i < sorted->len && size > FIND_INDEX_MAX_SIZE; i++)
+    {
+        const find_index_dir_t *dir = (const find_index_dir_t *) g_ptr_array_index (sorted, i);
+
+        size -= find_index_record_size (dir);
+        find_index_forget (dir->path);
+    }
+    g_ptr_array_free (sorted, TRUE);
+
+    return size;
+}
+
+/* --------------------------------------------------------------------------------------------- */
+/**
+ * Put whole index to buffer. Recently used directories are the last ones, so they are
+ * recently used after the index is loaded.
+ */
+
+static void
+find_index_build (GString * buf)
+{
+    find_index_header_t header;
+    GPtrArray *sorted;
+    guint i;
+
+    memset (&header, 0, sizeof (header));
+    g_strlcpy (header.magic, FIND_INDEX_MAGIC, sizeof (header.magic));
+    g_string_append_len (buf, (const char *) &header, sizeof (header));
+
+    sorted = find_index_get_sorted ();
+    for (i = 0; i < sorted->len; i++)
+    {
+        const find_index_dir_t *dir = (const find_index_dir_t *) g_ptr_array_index (sorted, i);
+
+        find_index_append_record (buf, dir->path, dir);
+    }
+    g_ptr_array_free (sorted, TRUE);
+}
+
+/* --------------------------------------------------------------------------------------------- */
+/**
+ * Write buffer to the index file.
+ *
+ * @param append append buffer to the file if it isn't changed by somebody else since it was
+ *               read or written last time, otherwise replace the file
+ *
+ * @return TRUE on success
+ */
+
+static gboolean
+find_index_write (const GString * buf, gboolean append)
+{
+    char *file_name;
+    gboolean ret = FALSE;
+
+    file_name = find_index_file_name ();
+
+    if (append)
+    {
+        int fd;
+        struct stat st;
+
+        fd = open (file_name, O_WRONLY | O_APPEND);
+        if (fd >= 0)
+        {
+            if (fstat (fd, &st) == 0 && st.st_size == index_len && st.st_dev == index_dev
+                && st.st_ino == index_ino)
+            {
+                gsize written = 0;
+
+                while (written < buf->len)
+                {
+                    ssize_t n;
+
+                    n = write (fd, buf->str + written, buf->len - written);
+                    if (n < 0 && errno == EINTR)
+                        continue;
+                    if (n <= 0)
+                        break;
+                    written += n;
+                }
+
+                ret = written == buf->len;
+                if (ret)
+                    index_len += buf->len;
+                else
+                    index_known = FALSE;
+            }
+
+            close (fd);
+        }
+    }
+    else
+    {
+        char *dir_name;
+
+        dir_name = g_path_get_dirname (file_name);
+        ret = g_mkdir_with_parents (dir_name, 0700) == 0
+            && g_file_set_contents (file_name, buf->str, buf->len, NULL);
+        g_free (dir_name);
+
+        if (ret)
+            find_index_stat_file (file_name);
+    }
+
+    g_free (file_name);
+
+    return ret;
+}
+
+/* --------------------------------------------------------------------------------------------- */
+/*** public functions ****************************************************************************/
+/* --------------------------------------------------------------------------------------------- */
+/**
+ * Check whether directory can be searched using the index.
+ */
+
+gboolean
+find_index_is_usable (const vfs_path_t * vpath)
+{
+    return find_name_index && vfs_file_is_local (vpath)
+        && g_path_is_absolute (vfs_path_as_str (vpath));
+}
+
+/* --------------------------------------------------------------------------------------------- */
+/**
+ * Get entries of directory. Directory is read if it isn't indexed yet or is changed.
+ *
+ * @param path absolute path of local directory
+ *
+ * @return directory owned by the index, valid until the next call or until the index is saved,
+ *         NULL if it can't be read
+ */
+
+const find_index_dir_t *
+find_index_get_dir (const char *path)
+{
+    find_index_dir_t *dir;
+    struct stat st;
+
+    if (dirs == NULL)
+        find_index_load ();
+
+#ifdef HAVE_SYS_INOTIFY_H
+    find_index_read_events ();
+#endif
+
+    dir = (find_index_dir_t *) g_hash_table_lookup (dirs, path);
+    if (dir != NULL)
+        dir->used = ++use_count;
+
+#ifdef HAVE_SYS_INOTIFY_H
+    if (dir != NULL)
+    {
+        if (dir->wd >= 0 && !dir->dirty)
+            return dir;
+
+        /* watch before check, so changes made after check aren't lost */
+        find_index_watch (dir);
+        dir->dirty = FALSE;
+    }
+#endif
+
+    if (stat (path, &st) != 0 || !S_ISDIR (st.st_mode))
+    {
+        if (dir != NULL)
+        {
+            find_index_forget (path);
+            dirs_changed = TRUE;
+        }
+        return NULL;
+    }
+
+    if (dir != NULL && dir->mtime == (gint64) st.st_mtime && dir->mtime < dir->scan_time
+        && dir->dev == (guint64) st.st_dev && dir->ino == (guint64) st.st_ino)
+        return dir;
+
+    if (dir == NULL)
+    {
+        dir = find_index_dir_new (g_strdup (path));
+#ifdef HAVE_SYS_INOTIFY_H
+        find_index_watch (dir);
+#endif
+    }
+
+    dirs_changed = TRUE;
+
+    if (!find_index_read_dir (dir, &st))
+    {
+        find_index_forget (path);
+        return NULL;
+    }
+
+    return dir;
+}
+
+/* --------------------------------------------------------------------------------------------- */
+/**
+ * Get next entry of directory.
+ *
+ * @param pos position of entry, 0 for the first one
+ * @param is_dir set to TRUE if entry is directory, symbolic links aren't followed
+ *
+ * @return name of entry, NULL if there are no more entries
+ */
+
+const char *
+find_index_dir_next (const find_index_dir_t * dir, size_t * pos, gboolean * is_dir)
+{
+    return find_index_next_entry (dir->entries, dir->entries_len, pos, is_dir);
+}
+
+/* --------------------------------------------------------------------------------------------- */
+/**
+ * Store changes of the index in the cache directory.
+ */
+
+void
+find_index_save (void)
+{
+    GString *buf;
+    gsize size;
+    gboolean saved = FALSE;
+
+    if (dirs == NULL || !dirs_changed)
+        return;
+
+    size = sizeof (find_index_header_t) + find_index_evict ();
+
+    buf = g_string_sized_new (64 * 1024);
+
+    if (index_known)
+    {
+        GHashTableIter iter;
+        gpointer key, value;
+
+        g_hash_table_iter_init (&iter, removed);
+        while (g_hash_table_iter_next (&iter, &key, NULL))
+            find_index_append_record (buf, (const char *) key, NULL);
+
+        g_hash_table_iter_init (&iter, dirs);
+        while (g_hash_table_iter_next (&iter, NULL, &value))
+        {
+            const find_index_dir_t *dir = (const find_index_dir_t *) value;
+
+            if (dir->unsaved)
+                find_index_append_record (buf, dir->path, dir);
+        }
+
+        /* too many outdated records: compact the file */
+        if ((gsize) index_len + buf->len <= 2 * size)
+            saved = find_index_write (buf, TRUE);
+    }
+
+    if (!saved)
+    {
+        g_string_truncate (buf, 0);
+        find_index_build (buf);
+        saved = find_index_write (buf, FALSE);
+    }
+
+    g_string_free (buf, TRUE);
+
+    if (saved)
+    {
+        GHashTableIter iter;
+        gpointer value;
+
+        g_hash_table_iter_init (&iter, dirs);
+        while (g_hash_table_iter_next (&iter, NULL, &value))
+            ((find_index_dir_t *) value)->unsaved = FALSE;
+
+        g_hash_table_remove_all (removed);
+        dirs_changed = FALSE;
+    }
+}
+
+/* --------------------------------------------------------------------------------------------- */
+/**
+ * Save the index and free memory used by it.
+ */
+
+void
+find_index_done (void)
+{
+    if (dirs == NULL)
+        return;
+
+    find_index_save ();
+    g_hash_table_destroy (dirs);
+    dirs = NULL;
+    g_hash_table_destroy (removed);
+    removed = NULL;
+    use_count = 0;
+    index_known = FALSE;
+
+#ifdef HAVE_SYS_INOTIFY_H
+    if (inotify_fd >= 0)
+    {
+        g_hash_table_destroy (watches);
+        watches = NULL;
+        close (inotify_fd);
+        inotify_fd = -1;
+        close (mounts_fd);
+        mounts_fd = -1;
+    }
+    inotify_failed = FALSE;
+#endif
+}
+
+/* --------------------------------------------------------------------------------------------- */
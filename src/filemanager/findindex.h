@@ -0,0 +1,32 @@
+/** \file  findindex.h
+ *  \brief Header: persistent index of file names for Find File
+ */
+
+#ifndef MC__FINDINDEX_H
+#define MC__FINDINDEX_H
+
+#include "lib/global.h"
+#include "lib/vfs/vfs.h"        /* vfs_path_t */
+
+/*** typedefs(not structures) and defined constants **********************************************/
+
+typedef struct find_index_dir_struct find_index_dir_t;
+
+/*** enums ***************************************************************************************/
+
+/*** structures declarations (and typedefs of structures)*****************************************/
+
+/*** global variables defined in .c file *********************************************************/
+
+/*** declarations of public functions ************************************************************/
+
+gboolean find_index_is_usable (const vfs_path_t * vpath);
+const find_index_dir_t *find_index_get_dir (const char *path);
+const char *find_index_dir_next (const find_index_dir_t * dir, size_t * pos, gboolean * is_dir);
+
+void find_index_save (void);
+void find_index_done (void);
+
+/*** inline functions ****************************************************************************/
+
+#endif /* MC__FINDINDEX_H */
@@ -3263,6 +3263,7 @@ static gboolean
 _do_panel_cd (WPanel * panel, const vfs_path_t * new_dir_vpath, enum cd_enum cd_type)
 {
     vfs_path_t *olddir_vpath;
+    dir_filter_t *fltr;
 
     /* Convert *new_path to a suitable pathname, handle ~user */
     if (cd_type == cd_parse_command)
@@ -3293,8 +3294,10 @@ _do_panel_cd (WPanel * panel, const vfs_path_t * new_dir_vpath, enum cd_enum cd_
     /* Reload current panel */
     panel_clean_dir (panel);
 
+    fltr = dir_filter_new (panel->filter);
     dir_list_load (&panel->dir, panel->cwd_vpath, panel->sort_field->sort_routine,
-                   &panel->sort_info, panel->filter);
+                   &panel->sort_info, fltr);
+    dir_filter_free (fltr);
     try_to_select (panel, get_parent_dir_name (panel->cwd_vpath, olddir_vpath));
 
     load_hint (FALSE);
@@ -4268,6 +4271,7 @@ panel_new_with_dir (const char *panel_name, const vfs_path_t * vpath)
     char *section;
     int i, err;
     char *curdir = NULL;
+    dir_filter_t *fltr;
 
     panel = g_new0 (WPanel, 1);
     w = WIDGET (panel);
@@ -4361,8 +4365,10 @@ panel_new_with_dir (const char *panel_name, const vfs_path_t * vpath)
     }
 
     /* Load the default format */
+    fltr = dir_filter_new (panel->filter);
     dir_list_load (&panel->dir, panel->cwd_vpath, panel->sort_field->sort_routine,
-                   &panel->sort_info, panel->filter);
+                   &panel->sort_info, fltr);
+    dir_filter_free (fltr);
 
     /* Restore old right path */
     if (curdir != NULL)
@@ -4385,6 +4391,7 @@ panel_reload (WPanel * panel)
 {
     struct stat current_stat;
     vfs_path_t *cwd_vpath;
+    dir_filter_t *fltr;
 
     if (panels_options.fast_reload && stat (vfs_path_as_str (panel->cwd_vpath), &current_stat) == 0
         && current_stat.st_ctime == panel->dir_stat.st_ctime
@@ -4406,8 +4413,10 @@ panel_reload (WPanel * panel)
     memset (&(panel->dir_stat), 0, sizeof (panel->dir_stat));
     show_dir (panel);
 
+    fltr = dir_filter_new (panel->filter);
     dir_list_reload (&panel->dir, panel->cwd_vpath, panel->sort_field->sort_routine,
-                     &panel->sort_info, panel->filter);
+                     &panel->sort_info, fltr);
+    dir_filter_free (fltr);
 
     panel->dirty = 1;
     if (panel->selected >= panel->dir.len)
@@ -431,6 +431,7 @@ do_panelize_cd (WPanel * panel)
         list->list[i].st = panelized_panel.list.list[i].st;
         list->list[i].sort_key = panelized_panel.list.list[i].sort_key;
         list->list[i].second_sort_key = panelized_panel.list.list[i].second_sort_key;
+        list->list[i].fhl_id = 0;
     }
     try_to_select (panel, NULL);
 }
@@ -481,6 +482,7 @@ panelize_save_panel (WPanel * panel)
         panelized_panel.list.list[i].st = list->list[i].st;
         panelized_panel.list.list[i].sort_key = list->list[i].sort_key;
         panelized_panel.list.list[i].second_sort_key = list->list[i].second_sort_key;
+        panelized_panel.list.list[i].fhl_id = 0;
     }
 }
 
@@ -57,6 +57,7 @@
 
 #include "filemanager/midnight.h"       /* current_panel */
 #include "filemanager/treestore.h"      /* tree_store_save */
+#include "filemanager/findindex.h"      /* find_index_done */
 #include "filemanager/layout.h" /* command_prompt */
 #include "filemanager/ext.h"    /* flush_extension_file() */
 #include "filemanager/command.h"        /* cmdline */
@@ -413,6 +414,9 @@ main (int argc, char *argv[])
     /* Save the tree store */
     (void) tree_store_save ();
 
+    /* Save the file name index of Find File */
+    find_index_done ();
+
     free_keymap_defs ();
 
     /* Virtual File System shutdown */
@@ -42,12 +42,17 @@
 #include "lib/util.h"
 #include "lib/widget.h"
 
+#include "src/vfs/local/local.h"        /* local_stat_threads */
+
 #ifdef ENABLE_VFS_FTP
 #include "src/vfs/ftpfs/ftpfs.h"
 #endif
 #ifdef ENABLE_VFS_FISH
 #include "src/vfs/fish/fish.h"
 #endif
+#ifdef ENABLE_VFS_TAR
+#include "src/vfs/tar/tar.h"    /* tar_index_cache */
+#endif
 
 #ifdef HAVE_CHARSET
 #include "lib/charsets.h"
@@ -119,6 +124,18 @@ panel_view_mode_t startup_right_mode;
 
 gboolean copymove_persistent_attr = TRUE;
 
+/* Number of buffers read ahead from source file while copying */
+int copy_read_ahead = 4;
+
+/* Number of threads which copy small files concurrently */
+int copy_threads = 0;
+
+/* Number of threads which search content of files in Find File concurrently */
+int find_content_threads = 0;
+
+/* Take entries of local directories from the index in name-only Find File */
+gboolean find_name_index = FALSE;
+
 /* Tab size */
 int option_tab_spacing = DEFAULT_TAB_SPACING;
 
@@ -323,6 +340,9 @@ static const struct
     { "ftpfs_first_cd_then_ls", &ftpfs_first_cd_then_ls },
     { "ignore_ftp_chattr_errors", & ftpfs_ignore_chattr_errors} ,
 #endif /* ENABLE_VFS_FTP */
+#ifdef ENABLE_VFS_TAR
+    { "tar_index_cache", &tar_index_cache },
+#endif /* ENABLE_VFS_TAR */
 #endif /* ENABLE_VFS */
 #ifdef USE_INTERNAL_EDIT
     { "editor_fill_tabs_with_spaces", &option_fill_tabs_with_spaces },
@@ -345,6 +365,7 @@ static const struct
     { "editor_check_new_line", &option_check_nl_at_eof },
     { "editor_show_right_margin", &show_right_margin },
     { "editor_group_undo", &option_group_undo },
+    { "editor_piece_table", &option_piece_table },
     { "editor_state_full_filename", &option_state_full_filename },
 #endif /* USE_INTERNAL_EDIT */
     { "editor_ask_filename_before_edit", &editor_ask_filename_before_edit },
@@ -352,6 +373,7 @@ static const struct
     { "mcview_remember_file_position", &mcview_remember_file_position },
     { "auto_fill_mkdir_name", &auto_fill_mkdir_name },
     { "copymove_persistent_attr", &copymove_persistent_attr },
+    { "find_name_index", &find_name_index },
     { NULL, NULL }
 };
 
@@ -366,6 +388,10 @@ static const struct
     { "old_esc_mode_timeout", &old_esc_mode_timeout },
     { "max_dirt_limit", &mcview_max_dirt_limit },
     { "num_history_items_recorded", &num_history_items_recorded },
+    { "local_stat_threads", &local_stat_threads },
+    { "copy_read_ahead", &copy_read_ahead },
+    { "copy_threads", &copy_threads },
+    { "find_content_threads", &find_content_threads },
 #ifdef ENABLE_VFS
     { "vfs_timeout", &vfs_timeout },
 #ifdef ENABLE_VFS_FTP
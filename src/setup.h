@@ -97,6 +97,10 @@ extern gboolean auto_fill_mkdir_name;
 extern gboolean output_starts_shell;
 extern gboolean use_file_to_check_type;
 extern gboolean file_op_compute_totals;
+extern int copy_read_ahead;
+extern int copy_threads;
+extern int find_content_threads;
+extern gboolean find_name_index;
 extern gboolean editor_ask_filename_before_edit;
 
 extern panels_options_t panels_options;
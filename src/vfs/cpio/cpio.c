@@ -45,6 +45,7 @@
 #include "lib/vfs/utilvfs.h"
 #include "lib/vfs/xdirentry.h"
 #include "lib/vfs/gc.h"         /* vfs_rmstamp */
+#include "lib/vfs/zstream.h"
 
 #include "cpio.h"
 
@@ -57,11 +58,11 @@
 /* #define CPIO_POS(super) (super)->u.arch.fd */
 
 #define CPIO_SEEK_SET(super, where) \
-        mc_lseek (((cpio_super_data_t *)(super)->data)->fd, \
-                  CPIO_POS(super) = (where), SEEK_SET)
+        vfs_zstream_seek (((cpio_super_data_t *)(super)->data)->stream, \
+                          CPIO_POS(super) = (where), SEEK_SET)
 #define CPIO_SEEK_CUR(super, where) \
-        mc_lseek (((cpio_super_data_t *)(super)->data)->fd, \
-                  CPIO_POS(super) += (where), SEEK_SET)
+        vfs_zstream_seek (((cpio_super_data_t *)(super)->data)->stream, \
+                          CPIO_POS(super) += (where), SEEK_SET)
 
 #define MAGIC_LENGTH (6)        /* How many bytes we have to read ahead */
 #define SEEKBACK CPIO_SEEK_CUR(super, ptr - top)
@@ -135,7 +136,7 @@ typedef struct
 
 typedef struct
 {
-    int fd;
+    vfs_zstream_t *stream;      /* decompressed archive */
     struct stat st;
     int type;                   /* Type of the archive */
     GSList *deferred;           /* List of inodes for which another entries may appear */
@@ -200,9 +201,8 @@ cpio_free_archive (struct vfs_class *me, struct vfs_s_super *super)
     if (super->data == NULL)
         return;
 
-    if (arch->fd != -1)
-        mc_close (arch->fd);
-    arch->fd = -1;
+    vfs_zstream_free (arch->stream);
+    arch->stream = NULL;
     g_slist_free_full (arch->deferred, g_free);
     arch->deferred = NULL;
     MC_PTR_FREE (super->data);
@@ -228,16 +228,16 @@ cpio_open_cpio_file (struct vfs_class *me, struct vfs_s_super *super, const vfs_
     super->name = g_strdup (vfs_path_as_str (vpath));
     super->data = g_new (cpio_super_data_t, 1);
     arch = (cpio_super_data_t *) super->data;
-    arch->fd = -1;              /* for now */
+    arch->stream = NULL;        /* for now */
     mc_stat (vpath, &arch->st);
     arch->type = CPIO_UNKNOWN;
     arch->deferred = NULL;
 
     type = get_compression_type (fd, super->name);
-    if (type == COMPRESSION_NONE)
-        mc_lseek (fd, 0, SEEK_SET);
-    else
+    arch->stream = vfs_zstream_new (fd, type);
+    if (arch->stream == NULL)
     {
+        /* decompress by external program */
         char *s;
         vfs_path_t *tmp_vpath;
 
@@ -254,9 +254,9 @@ cpio_open_cpio_file (struct vfs_class *me, struct vfs_s_super *super, const vfs_
             return -1;
         }
         g_free (s);
+        arch->stream = vfs_zstream_new (fd, COMPRESSION_NONE);
     }
 
-    arch->fd = fd;
     mode = arch->st.st_mode & 07777;
     mode |= (mode & 0444) >> 2; /* set eXec where Read is */
     mode |= S_IFDIR;
@@ -308,7 +308,7 @@ cpio_find_head (struct vfs_class *me, struct vfs_s_super *super)
     ssize_t top;
     ssize_t tmp;
 
-    top = mc_read (arch->fd, buf, sizeof (buf));
+    top = vfs_zstream_read (arch->stream, buf, sizeof (buf));
     if (top > 0)
         CPIO_POS (super) += top;
 
@@ -322,7 +322,7 @@ cpio_find_head (struct vfs_class *me, struct vfs_s_super *super)
                 ptr -= top - sizeof (buf) / 2;
                 top = sizeof (buf) / 2;
             }
-            tmp = mc_read (arch->fd, buf, top);
+            tmp = vfs_zstream_read (arch->stream, buf, top);
             if (tmp == 0 || tmp == -1)
             {
                 message (D_ERROR, MSG_ERROR, _("Premature end of cpio archive\n%s"), super->name);
@@ -509,11 +509,11 @@ cpio_create_entry (struct vfs_class *me, struct vfs_s_super *super, struct stat
         {
             if (inode != NULL)
             {
-                /* FIXME: do we must read from arch->fd in case of inode != NULL only or in any case? */
+                /* FIXME: do we must read from arch->stream in case of inode != NULL only or in any case? */
 
                 inode->linkname = g_malloc (st->st_size + 1);
 
-                if (mc_read (arch->fd, inode->linkname, st->st_size) < st->st_size)
+                if (vfs_zstream_read (arch->stream, inode->linkname, st->st_size) < st->st_size)
                 {
                     inode->linkname[0] = '\0';
                     return STATUS_EOF;
@@ -546,7 +546,7 @@ cpio_read_bin_head (struct vfs_class *me, struct vfs_s_super *super)
     char *name;
     struct stat st;
 
-    len = mc_read (arch->fd, (char *) &u.buf, HEAD_LENGTH);
+    len = vfs_zstream_read (arch->stream, (char *) &u.buf, HEAD_LENGTH);
     if (len < HEAD_LENGTH)
         return STATUS_EOF;
     CPIO_POS (super) += len;
@@ -563,7 +563,7 @@ cpio_read_bin_head (struct vfs_class *me, struct vfs_s_super *super)
         return STATUS_FAIL;
     }
     name = g_malloc (u.buf.c_namesize);
-    len = mc_read (arch->fd, name, u.buf.c_namesize);
+    len = vfs_zstream_read (arch->stream, name, u.buf.c_namesize);
     if (len < u.buf.c_namesize)
     {
         g_free (name);
@@ -612,7 +612,7 @@ cpio_read_oldc_head (struct vfs_class *me, struct vfs_s_super *super)
     ssize_t len;
     char *name;
 
-    if (mc_read (arch->fd, u.buf, HEAD_LENGTH) != HEAD_LENGTH)
+    if (vfs_zstream_read (arch->stream, u.buf, HEAD_LENGTH) != HEAD_LENGTH)
         return STATUS_EOF;
     CPIO_POS (super) += HEAD_LENGTH;
     u.buf[HEAD_LENGTH] = 0;
@@ -632,7 +632,7 @@ cpio_read_oldc_head (struct vfs_class *me, struct vfs_s_super *super)
         return STATUS_FAIL;
     }
     name = g_malloc (hd.c_namesize);
-    len = mc_read (arch->fd, name, hd.c_namesize);
+    len = vfs_zstream_read (arch->stream, name, hd.c_namesize);
     if ((len == -1) || ((unsigned long) len < hd.c_namesize))
     {
         g_free (name);
@@ -681,7 +681,7 @@ cpio_read_crc_head (struct vfs_class *me, struct vfs_s_super *super)
     ssize_t len;
     char *name;
 
-    if (mc_read (arch->fd, u.buf, HEAD_LENGTH) != HEAD_LENGTH)
+    if (vfs_zstream_read (arch->stream, u.buf, HEAD_LENGTH) != HEAD_LENGTH)
         return STATUS_EOF;
 
     CPIO_POS (super) += HEAD_LENGTH;
@@ -709,7 +709,7 @@ cpio_read_crc_head (struct vfs_class *me, struct vfs_s_super *super)
     }
 
     name = g_malloc (hd.c_namesize);
-    len = mc_read (arch->fd, name, hd.c_namesize);
+    len = vfs_zstream_read (arch->stream, name, hd.c_namesize);
 
     if ((len == -1) || ((unsigned long) len < hd.c_namesize))
     {
@@ -828,16 +828,16 @@ static ssize_t
 cpio_read (void *fh, char *buffer, size_t count)
 {
     off_t begin = FH->ino->data_offset;
-    int fd = ((cpio_super_data_t *) FH_SUPER->data)->fd;
+    vfs_zstream_t *stream = ((cpio_super_data_t *) FH_SUPER->data)->stream;
     struct vfs_class *me = FH_SUPER->me;
     ssize_t res;
 
-    if (mc_lseek (fd, begin + FH->pos, SEEK_SET) != begin + FH->pos)
+    if (vfs_zstream_seek (stream, begin + FH->pos, SEEK_SET) != begin + FH->pos)
         ERRNOR (EIO, -1);
 
     count = MIN (count, (size_t) (FH->ino->st.st_size - FH->pos));
 
-    res = mc_read (fd, buffer, count);
+    res = vfs_zstream_read (stream, buffer, count);
     if (res == -1)
         ERRNOR (errno, -1);
 
@@ -1103,6 +1103,43 @@ extfs_stat_move (struct stat *buf, const struct inode *inode)
 
 /* --------------------------------------------------------------------------------------------- */
 
+static int
+extfs_readdir_plus (void *data, vfs_dirent_plus_t * entries, int count)
+{
+    struct entry **info = (struct entry **) data;
+    int n;
+
+    for (n = 0; n < count && *info != NULL; *info = (*info)->next_in_dir)
+    {
+        vfs_dirent_plus_t *de;
+
+        /* "." and ".." are not reported */
+        if (DIR_IS_DOT ((*info)->name) || DIR_IS_DOTDOT ((*info)->name))
+            continue;
+
+        de = &entries[n++];
+        de->name = g_strdup ((*info)->name);
+        extfs_stat_move (&de->st, (*info)->inode);
+        de->link_to_dir = FALSE;
+        de->stale_link = FALSE;
+
+        if (S_ISLNK (de->st.st_mode))
+        {
+            struct entry *target;
+
+            target = extfs_resolve_symlinks (*info);
+            if (target != NULL)
+                de->link_to_dir = S_ISDIR (target->inode->mode);
+            else
+                de->stale_link = TRUE;
+        }
+    }
+
+    return n;
+}
+
+/* --------------------------------------------------------------------------------------------- */
+
 static int
 extfs_internal_stat (const vfs_path_t * vpath, struct stat *buf, gboolean resolve)
 {
@@ -1731,6 +1768,7 @@ init_extfs (void)
     vfs_extfs_ops.opendir = extfs_opendir;
     vfs_extfs_ops.readdir = extfs_readdir;
     vfs_extfs_ops.closedir = extfs_closedir;
+    vfs_extfs_ops.readdir_plus = extfs_readdir_plus;
     vfs_extfs_ops.stat = extfs_stat;
     vfs_extfs_ops.lstat = extfs_lstat;
     vfs_extfs_ops.fstat = extfs_fstat;
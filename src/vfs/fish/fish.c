@@ -236,14 +236,15 @@ fish_decode_reply (char *s, gboolean was_garbage)
 /* Returns a reply code, check /usr/include/arpa/ftp.h for possible values */
 
 static int
-fish_get_reply (struct vfs_class *me, int sock, char *string_buf, int string_len)
+fish_get_reply (struct vfs_class *me, struct vfs_s_super *super, char *string_buf,
+                int string_len)
 {
     char answer[BUF_1K];
     gboolean was_garbage = FALSE;
 
     while (TRUE)
     {
-        if (!vfs_s_get_line (me, sock, answer, sizeof (answer), '\n'))
+        if (!vfs_s_get_line (me, super->rbuf, answer, sizeof (answer), '\n'))
         {
             if (string_buf != NULL)
                 *string_buf = '\0';
@@ -292,7 +293,7 @@ fish_command (struct vfs_class *me, struct vfs_s_super *super, int wait_reply, c
         return TRANSIENT;
 
     if (wait_reply)
-        return fish_get_reply (me, SUP->sockr,
+        return fish_get_reply (me, super,
                                (wait_reply & WANT_STRING) ? reply_str :
                                NULL, sizeof (reply_str) - 1);
     return COMPLETE;
@@ -353,6 +354,7 @@ fish_pipeopen (struct vfs_s_super *super, const char *path, const char *argv[])
         SUP->sockw = fileset1[1];
         close (fileset2[1]);
         SUP->sockr = fileset2[0];
+        super->rbuf = vfs_s_rbuf_new (SUP->sockr);
     }
     else
     {
@@ -416,7 +418,7 @@ fish_info (struct vfs_class *me, struct vfs_s_super *super)
             int res;
             char buffer[BUF_8K];
 
-            res = vfs_s_get_line_interruptible (me, buffer, sizeof (buffer), SUP->sockr);
+            res = vfs_s_get_line_interruptible (me, super->rbuf, buffer, sizeof (buffer));
             if ((res == 0) || (res == EINTR))
                 ERRNOR (ECONNRESET, FALSE);
             if (strncmp (buffer, "### ", 4) == 0)
@@ -483,7 +485,7 @@ fish_open_archive_talk (struct vfs_class *me, struct vfs_s_super *super)
 
     printf ("\n%s\n", _("fish: Waiting for initial line..."));
 
-    if (vfs_s_get_line (me, SUP->sockr, answer, sizeof (answer), ':') == 0)
+    if (vfs_s_get_line (me, super->rbuf, answer, sizeof (answer), ':') == 0)
         return FALSE;
 
     if (strstr (answer, "assword") != NULL)
@@ -704,7 +706,7 @@ fish_dir_load (struct vfs_class *me, struct vfs_s_inode *dir, char *remote_path)
     {
         int res;
 
-        res = vfs_s_get_line_interruptible (me, buffer, sizeof (buffer), SUP->sockr);
+        res = vfs_s_get_line_interruptible (me, super->rbuf, buffer, sizeof (buffer));
 
         if ((res == 0) || (res == EINTR))
         {
@@ -995,13 +997,13 @@ fish_file_store (struct vfs_class *me, vfs_file_handler_t * fh, char *name, char
     }
     close (h);
 
-    if (fish_get_reply (me, SUP->sockr, NULL, 0) != COMPLETE)
+    if (fish_get_reply (me, super, NULL, 0) != COMPLETE)
         ERRNOR (E_REMOTE, -1);
     return 0;
 
   error_return:
     close (h);
-    fish_get_reply (me, SUP->sockr, NULL, 0);
+    fish_get_reply (me, super, NULL, 0);
     return -1;
 }
 
@@ -1073,7 +1075,7 @@ fish_linear_abort (struct vfs_class *me, vfs_file_handler_t * fh)
         n = MIN ((off_t) sizeof (buffer), (fish->total - fish->got));
         if (n != 0)
         {
-            n = read (SUP->sockr, buffer, n);
+            n = vfs_s_rbuf_read (super->rbuf, buffer, n);
             if (n < 0)
                 return;
             fish->got += n;
@@ -1081,7 +1083,7 @@ fish_linear_abort (struct vfs_class *me, vfs_file_handler_t * fh)
     }
     while (n != 0);
 
-    if (fish_get_reply (me, SUP->sockr, NULL, 0) != COMPLETE)
+    if (fish_get_reply (me, super, NULL, 0) != COMPLETE)
         vfs_print_message ("%s", _("Error reported after abort."));
     else
         vfs_print_message ("%s", _("Aborted transfer would be successful."));
@@ -1098,7 +1100,7 @@ fish_linear_read (struct vfs_class *me, vfs_file_handler_t * fh, void *buf, size
 
     len = MIN ((size_t) (fish->total - fish->got), len);
     tty_disable_interrupt_key ();
-    while (len != 0 && ((n = read (SUP->sockr, buf, len)) < 0))
+    while (len != 0 && ((n = vfs_s_rbuf_read (super->rbuf, buf, len)) < 0))
     {
         if ((errno == EINTR) && !tty_got_interrupt ())
             continue;
@@ -1110,7 +1112,7 @@ fish_linear_read (struct vfs_class *me, vfs_file_handler_t * fh, void *buf, size
         fish->got += n;
     else if (n < 0)
         fish_linear_abort (me, fh);
-    else if (fish_get_reply (me, SUP->sockr, NULL, 0) != COMPLETE)
+    else if (fish_get_reply (me, super, NULL, 0) != COMPLETE)
         ERRNOR (E_REMOTE, -1);
     ERRNOR (errno, n);
 }
@@ -390,14 +390,15 @@ ftpfs_correct_url_parameters (const vfs_path_element_t * velement)
 /* Returns a reply code, check /usr/include/arpa/ftp.h for possible values */
 
 static int
-ftpfs_get_reply (struct vfs_class *me, int sock, char *string_buf, int string_len)
+ftpfs_get_reply (struct vfs_class *me, struct vfs_s_super *super, char *string_buf,
+                 int string_len)
 {
     char answer[BUF_1K];
     int i;
 
     while (TRUE)
     {
-        if (!vfs_s_get_line (me, sock, answer, sizeof (answer), '\n'))
+        if (!vfs_s_get_line (me, super->rbuf, answer, sizeof (answer), '\n'))
         {
             if (string_buf != NULL)
                 *string_buf = '\0';
@@ -417,7 +418,7 @@ ftpfs_get_reply (struct vfs_class *me, int sock, char *string_buf, int string_le
             {
                 while (TRUE)
                 {
-                    if (!vfs_s_get_line (me, sock, answer, sizeof (answer), '\n'))
+                    if (!vfs_s_get_line (me, super->rbuf, answer, sizeof (answer), '\n'))
                     {
                         if (string_buf != NULL)
                             *string_buf = '\0';
@@ -452,6 +453,7 @@ ftpfs_reconnect (struct vfs_class *me, struct vfs_s_super *super)
 
         close (SUP->sock);
         SUP->sock = sock;
+        vfs_s_rbuf_reset (super->rbuf, sock);
         SUP->current_dir = NULL;
 
         if (ftpfs_login_server (me, super, super->path_element->password) != 0)
@@ -540,7 +542,7 @@ ftpfs_command (struct vfs_class *me, struct vfs_s_super *super, int wait_reply,
 
     if (wait_reply)
     {
-        status = ftpfs_get_reply (me, SUP->sock,
+        status = ftpfs_get_reply (me, super,
                                   (wait_reply & WANT_STRING) ? reply_str : NULL,
                                   sizeof (reply_str) - 1);
         if ((wait_reply & WANT_STRING) && !retry && !level && code == 421)
@@ -647,7 +649,7 @@ ftpfs_login_server (struct vfs_class *me, struct vfs_s_super *super, const char
     else
         name = g_strdup (super->path_element->user);
 
-    if (ftpfs_get_reply (me, SUP->sock, reply_string, sizeof (reply_string) - 1) == COMPLETE)
+    if (ftpfs_get_reply (me, super, reply_string, sizeof (reply_string) - 1) == COMPLETE)
     {
         char *reply_up;
 
@@ -954,6 +956,8 @@ ftpfs_open_archive_int (struct vfs_class *me, struct vfs_s_super *super)
         if (SUP->sock == -1)
             return -1;
 
+        vfs_s_rbuf_reset (super->rbuf, SUP->sock);
+
         if (ftpfs_login_server (me, super, NULL) != 0)
         {
             /* Logged in, no need to retry the connection */
@@ -1005,6 +1009,7 @@ ftpfs_open_archive (struct vfs_s_super *super,
     (void) vpath;
 
     super->data = g_new0 (ftp_super_data_t, 1);
+    super->rbuf = vfs_s_rbuf_new (-1);
 
     super->path_element = ftpfs_correct_url_parameters (vpath_element);
     SUP->proxy = NULL;
@@ -1053,7 +1058,7 @@ ftpfs_get_current_directory (struct vfs_class *me, struct vfs_s_super *super)
     char buf[MC_MAXPATHLEN + 1];
 
     if (ftpfs_command (me, super, NONE, "PWD") == COMPLETE &&
-        ftpfs_get_reply (me, SUP->sock, buf, sizeof (buf)) == COMPLETE)
+        ftpfs_get_reply (me, super, buf, sizeof (buf)) == COMPLETE)
     {
         char *bufp = NULL;
         char *bufq;
@@ -1497,8 +1502,8 @@ ftpfs_linear_abort (struct vfs_class *me, vfs_file_handler_t * fh)
         }
         close (dsock);
     }
-    if ((ftpfs_get_reply (me, SUP->sock, NULL, 0) == TRANSIENT) && (code == 426))
-        ftpfs_get_reply (me, SUP->sock, NULL, 0);
+    if ((ftpfs_get_reply (me, super, NULL, 0) == TRANSIENT) && (code == 426))
+        ftpfs_get_reply (me, super, NULL, 0);
 }
 
 /* --------------------------------------------------------------------------------------------- */
@@ -1669,7 +1674,7 @@ resolve_symlink_with_ls_options (struct vfs_class *me, struct vfs_s_super *super
     while (fgets (buffer, sizeof (buffer), fp) != NULL);
     tty_disable_interrupt_key ();
     fclose (fp);
-    ftpfs_get_reply (me, SUP->sock, NULL, 0);
+    ftpfs_get_reply (me, super, NULL, 0);
 }
 
 /* --------------------------------------------------------------------------------------------- */
@@ -1694,6 +1699,7 @@ ftpfs_dir_load (struct vfs_class *me, struct vfs_s_inode *dir, char *remote_path
     struct vfs_s_entry *ent;
     struct vfs_s_super *super = dir->super;
     int sock, num_entries = 0;
+    vfs_s_rbuf_t *rbuf;
     gboolean cd_first;
 
     cd_first = ftpfs_first_cd_then_ls || (SUP->strict == RFC_STRICT)
@@ -1737,6 +1743,8 @@ ftpfs_dir_load (struct vfs_class *me, struct vfs_s_inode *dir, char *remote_path
     if (sock == -1)
         goto fallback;
 
+    rbuf = vfs_s_rbuf_new (sock);
+
     /* Clear the interrupt flag */
     tty_enable_interrupt_key ();
 
@@ -1748,17 +1756,18 @@ ftpfs_dir_load (struct vfs_class *me, struct vfs_s_inode *dir, char *remote_path
         int res;
         char lc_buffer[BUF_8K] = "\0";
 
-        res = vfs_s_get_line_interruptible (me, lc_buffer, sizeof (lc_buffer), sock);
+        res = vfs_s_get_line_interruptible (me, rbuf, lc_buffer, sizeof (lc_buffer));
         if (res == 0)
             break;
 
         if (res == EINTR)
         {
             me->verrno = ECONNRESET;
+            g_free (rbuf);
             close (sock);
             SUP->ctl_connection_busy = 0;
             tty_disable_interrupt_key ();
-            ftpfs_get_reply (me, SUP->sock, NULL, 0);
+            ftpfs_get_reply (me, super, NULL, 0);
             vfs_print_message (_("%s: failure"), me->name);
             return -1;
         }
@@ -1784,10 +1793,11 @@ ftpfs_dir_load (struct vfs_class *me, struct vfs_s_inode *dir, char *remote_path
         vfs_s_insert_entry (me, dir, ent);
     }
 
+    g_free (rbuf);
     close (sock);
     SUP->ctl_connection_busy = 0;
     me->verrno = E_REMOTE;
-    if ((ftpfs_get_reply (me, SUP->sock, NULL, 0) != COMPLETE))
+    if ((ftpfs_get_reply (me, super, NULL, 0) != COMPLETE))
         goto fallback;
 
     if (num_entries == 0 && !cd_first)
@@ -1910,7 +1920,7 @@ ftpfs_file_store (struct vfs_class *me, vfs_file_handler_t * fh, char *name, cha
     close (sock);
     SUP->ctl_connection_busy = 0;
     close (h);
-    if (ftpfs_get_reply (me, SUP->sock, NULL, 0) != COMPLETE)
+    if (ftpfs_get_reply (me, super, NULL, 0) != COMPLETE)
         ERRNOR (EIO, -1);
     return 0;
   error_return:
@@ -1918,7 +1928,7 @@ ftpfs_file_store (struct vfs_class *me, vfs_file_handler_t * fh, char *name, cha
     close (sock);
     SUP->ctl_connection_busy = 0;
     close (h);
-    ftpfs_get_reply (me, SUP->sock, NULL, 0);
+    ftpfs_get_reply (me, super, NULL, 0);
     return -1;
 }
 
@@ -1967,7 +1977,7 @@ ftpfs_linear_read (struct vfs_class *me, vfs_file_handler_t * fh, void *buf, siz
         SUP->ctl_connection_busy = 0;
         close (FH_SOCK);
         FH_SOCK = -1;
-        if ((ftpfs_get_reply (me, SUP->sock, NULL, 0) != COMPLETE))
+        if ((ftpfs_get_reply (me, super, NULL, 0) != COMPLETE))
             ERRNOR (E_REMOTE, -1);
         return 0;
     }
@@ -2295,7 +2305,7 @@ ftpfs_fh_close (struct vfs_class *me, vfs_file_handler_t * fh)
          * we prevent MEDATA->ftpfs_file_store() call from vfs_s_close ()
          */
         fh->changed = 0;
-        if (ftpfs_get_reply (me, ftp->sock, NULL, 0) != COMPLETE)
+        if (ftpfs_get_reply (me, FH_SUPER, NULL, 0) != COMPLETE)
             ERRNOR (EIO, -1);
         vfs_s_invalidate (me, FH_SUPER);
     }
@@ -40,14 +40,44 @@
 
 /*** global variables ****************************************************************************/
 
+/* Number of threads used to stat directory entries. 0 or 1: stat entries serially */
+int local_stat_threads = 0;
+
 /*** file scope macro definitions ****************************************************************/
 
+/* stat thread pool embeds GMutex and GCond in stack structures: g_mutex_init() and g_cond_init()
+   are available since glib 2.32 */
+#if defined (HAVE_FSTATAT) && GLIB_CHECK_VERSION (2, 32, 0)
+#define LOCAL_STAT_POOL 1
+#endif
+
 /*** file scope type declarations ****************************************************************/
 
+#ifdef LOCAL_STAT_POOL
+/* Entries of one mc_readdir_plus() call processed by stat thread pool */
+typedef struct
+{
+    int fd;                     /* descriptor of open directory */
+    int pending;                /* number of entries not processed yet */
+    GMutex lock;
+    GCond done;
+} local_stat_batch_t;
+
+typedef struct
+{
+    local_stat_batch_t *batch;
+    vfs_dirent_plus_t *entry;
+} local_stat_task_t;
+#endif /* LOCAL_STAT_POOL */
+
 /*** file scope variables ************************************************************************/
 
 static struct vfs_class vfs_local_ops;
 
+#ifdef LOCAL_STAT_POOL
+static GThreadPool *local_stat_pool = NULL;
+#endif
+
 /*** file scope functions ************************************************************************/
 /* --------------------------------------------------------------------------------------------- */
 
@@ -108,6 +138,143 @@ local_readdir (void *data)
 
 /* --------------------------------------------------------------------------------------------- */
 
+#ifdef HAVE_FSTATAT
+static void
+local_stat_entry (int fd, vfs_dirent_plus_t * de)
+{
+    de->link_to_dir = FALSE;
+    de->stale_link = FALSE;
+
+    /* stat relative to the open directory: no path lookup from the root */
+    if (fstatat (fd, de->name, &de->st, AT_SYMLINK_NOFOLLOW) == -1)
+        memset (&de->st, 0, sizeof (de->st));
+    else if (S_ISLNK (de->st.st_mode))
+    {
+        struct stat st;
+
+        if (fstatat (fd, de->name, &st, 0) == 0)
+            de->link_to_dir = S_ISDIR (st.st_mode);
+        else
+            de->stale_link = TRUE;
+    }
+}
+
+/* --------------------------------------------------------------------------------------------- */
+
+#ifdef LOCAL_STAT_POOL
+static void
+local_stat_worker (gpointer data, gpointer user_data)
+{
+    local_stat_task_t *task = (local_stat_task_t *) data;
+    local_stat_batch_t *batch = task->batch;
+
+    (void) user_data;
+
+    local_stat_entry (batch->fd, task->entry);
+
+    g_mutex_lock (&batch->lock);
+    if (--batch->pending == 0)
+        g_cond_signal (&batch->done);
+    g_mutex_unlock (&batch->lock);
+}
+
+/* --------------------------------------------------------------------------------------------- */
+/**
+ * Stat entries concurrently. Latency of network and FUSE filesystems is hidden
+ * by several requests in flight.
+ *
+ * @return FALSE if thread pool is not available, entries are not processed
+ */
+
+static gboolean
+local_stat_entries_parallel (int fd, vfs_dirent_plus_t * entries, int count)
+{
+    local_stat_batch_t batch;
+    local_stat_task_t *tasks;
+    int i;
+
+    if (local_stat_threads <= 1 || count <= 1)
+        return FALSE;
+
+    if (local_stat_pool == NULL)
+    {
+        local_stat_pool =
+            g_thread_pool_new (local_stat_worker, NULL, local_stat_threads, FALSE, NULL);
+        if (local_stat_pool == NULL)
+            return FALSE;
+    }
+    else if (g_thread_pool_get_max_threads (local_stat_pool) != local_stat_threads)
+        g_thread_pool_set_max_threads (local_stat_pool, local_stat_threads, NULL);
+
+    batch.fd = fd;
+    batch.pending = count;
+    g_mutex_init (&batch.lock);
+    g_cond_init (&batch.done);
+
+    tasks = g_new (local_stat_task_t, count);
+
+    for (i = 0; i < count; i++)
+    {
+        tasks[i].batch = &batch;
+        tasks[i].entry = &entries[i];
+        g_thread_pool_push (local_stat_pool, &tasks[i], NULL);
+    }
+
+    g_mutex_lock (&batch.lock);
+    while (batch.pending != 0)
+        g_cond_wait (&batch.done, &batch.lock);
+    g_mutex_unlock (&batch.lock);
+
+    g_free (tasks);
+    g_cond_clear (&batch.done);
+    g_mutex_clear (&batch.lock);
+
+    return TRUE;
+}
+#endif /* LOCAL_STAT_POOL */
+
+/* --------------------------------------------------------------------------------------------- */
+
+static int
+local_readdir_plus (void *data, vfs_dirent_plus_t * entries, int count)
+{
+    DIR *dir = *(DIR **) data;
+    int fd;
+    int i, n = 0;
+
+    fd = dirfd (dir);
+
+    while (n < count)
+    {
+        struct dirent *dp;
+
+        errno = 0;
+        dp = readdir (dir);
+        if (dp == NULL)
+        {
+            if (n == 0 && errno != 0)
+                return -1;
+            break;
+        }
+
+        if (!DIR_IS_DOT (dp->d_name) && !DIR_IS_DOTDOT (dp->d_name))
+            entries[n++].name = g_strdup (dp->d_name);
+    }
+
+#ifdef LOCAL_STAT_POOL
+    if (local_stat_entries_parallel (fd, entries, n))
+        return n;
+#endif
+
+    for (i = 0; i < n; i++)
+        local_stat_entry (fd, &entries[i]);
+
+    return n;
+}
+#endif /* HAVE_FSTATAT */
+
+/* --------------------------------------------------------------------------------------------- */
+
 static int
 local_closedir (void *data)
 {
@@ -346,6 +513,22 @@ local_which (struct vfs_class *me, const char *path)
     return 0;                   /* Every path which other systems do not like is expected to be ours */
 }
 
+/* --------------------------------------------------------------------------------------------- */
+
+#ifdef LOCAL_STAT_POOL
+static void
+local_done (struct vfs_class *me)
+{
+    (void) me;
+
+    if (local_stat_pool != NULL)
+    {
+        g_thread_pool_free (local_stat_pool, FALSE, TRUE);
+        local_stat_pool = NULL;
+    }
+}
+#endif /* LOCAL_STAT_POOL */
+
 /* --------------------------------------------------------------------------------------------- */
 /*** public functions ****************************************************************************/
 /* --------------------------------------------------------------------------------------------- */
@@ -431,6 +614,12 @@ init_localfs (void)
     vfs_local_ops.opendir = local_opendir;
     vfs_local_ops.readdir = local_readdir;
     vfs_local_ops.closedir = local_closedir;
+#ifdef HAVE_FSTATAT
+    vfs_local_ops.readdir_plus = local_readdir_plus;
+#endif
+#ifdef LOCAL_STAT_POOL
+    vfs_local_ops.done = local_done;
+#endif
     vfs_local_ops.stat = local_stat;
     vfs_local_ops.lstat = local_lstat;
     vfs_local_ops.fstat = local_fstat;
@@ -16,6 +16,8 @@
 
 /*** global variables defined in .c file *********************************************************/
 
+extern int local_stat_threads;
+
 /*** declarations of public functions ************************************************************/
 
 extern void init_localfs (void);
@@ -696,6 +696,8 @@ sftpfs_init_class_callbacks (void)
 
     sftpfs_class.opendir = sftpfs_cb_opendir;
     sftpfs_class.readdir = sftpfs_cb_readdir;
+    /* set by vfs_s_init_class(), but reads directories opened by vfs_s_opendir() only */
+    sftpfs_class.readdir_plus = NULL;
     sftpfs_class.closedir = sftpfs_cb_closedir;
     sftpfs_class.mkdir = sftpfs_cb_mkdir;
     sftpfs_class.rmdir = sftpfs_cb_rmdir;
@@ -49,16 +49,22 @@
 #include "lib/util.h"
 #include "lib/unixcompat.h"     /* makedev() */
 #include "lib/widget.h"         /* message() */
+#include "lib/fileloc.h"
+#include "lib/mcconfig.h"       /* mc_config_get_cache_path() */
 
 #include "lib/vfs/vfs.h"
 #include "lib/vfs/utilvfs.h"
 #include "lib/vfs/xdirentry.h"
 #include "lib/vfs/gc.h"         /* vfs_rmstamp */
+#include "lib/vfs/zstream.h"
 
 #include "tar.h"
 
 /*** global variables ****************************************************************************/
 
+/* Keep index of large local archives in the cache directory */
+gboolean tar_index_cache = TRUE;
+
 /*** file scope macro definitions ****************************************************************/
 
 /*
@@ -132,6 +138,10 @@
 
 #define	isodigit(c)     ( ((c) >= '0') && ((c) <= '7') )
 
+/* Index is kept for archives not smaller than this */
+#define TAR_INDEX_MIN_SIZE (16 * 1024 * 1024)
+#define TAR_INDEX_MAGIC "MCTARI1"
+
 /*** file scope type declarations ****************************************************************/
 
 enum
@@ -215,11 +225,37 @@ typedef enum
 
 typedef struct
 {
-    int fd;
+    vfs_zstream_t *stream;      /* decompressed archive */
     struct stat st;
     int type;                   /* Type of the archive */
 } tar_super_data_t;
 
+/* Index file: header, archive name, then records each followed by name and link name */
+typedef struct
+{
+    char magic[8];
+    gint64 archive_size;
+    gint64 archive_mtime;
+    guint32 name_len;
+    guint32 count;              /* number of records */
+} tar_index_header_t;
+
+typedef struct
+{
+    guint32 link_inode;         /* 1-based number of inode this entry is hard link to, 0 if none */
+    guint32 name_len;           /* length of path of entry from archive root */
+    guint32 linkname_len;
+    guint32 mode;
+    guint32 uid;
+    guint32 gid;
+    guint64 rdev;
+    gint64 data_offset;
+    gint64 size;
+    gint64 mtime;
+    gint64 atime;
+    gint64 ctime;
+} tar_index_record_t;
+
 /*** file scope variables ************************************************************************/
 
 static struct vfs_class vfs_tarfs_ops;
@@ -271,8 +307,7 @@ tar_free_archive (struct vfs_class *me, struct vfs_s_super *archive)
     {
         tar_super_data_t *arch = (tar_super_data_t *) archive->data;
 
-        if (arch->fd != -1)
-            mc_close (arch->fd);
+        vfs_zstream_free (arch->stream);
         g_free (archive->data);
     }
 }
@@ -299,15 +334,14 @@ tar_open_archive_int (struct vfs_class *me, const vfs_path_t * vpath, struct vfs
     archive->data = g_new (tar_super_data_t, 1);
     arch = (tar_super_data_t *) archive->data;
     mc_stat (vpath, &arch->st);
-    arch->fd = -1;
     arch->type = TAR_UNKNOWN;
 
     /* Find out the method to handle this tar file */
     type = get_compression_type (result, archive->name);
-    if (type == COMPRESSION_NONE)
-        mc_lseek (result, 0, SEEK_SET);
-    else
+    arch->stream = vfs_zstream_new (result, type);
+    if (arch->stream == NULL)
     {
+        /* decompress by external program */
         char *s;
         vfs_path_t *tmp_vpath;
 
@@ -324,9 +358,9 @@ tar_open_archive_int (struct vfs_class *me, const vfs_path_t * vpath, struct vfs
             MC_PTR_FREE (archive->name);
             ERRNOR (ENOENT, -1);
         }
+        arch->stream = vfs_zstream_new (result, COMPRESSION_NONE);
     }
 
-    arch->fd = result;
     mode = arch->st.st_mode & 07777;
     if (mode & 0400)
         mode |= 0100;
@@ -350,13 +384,12 @@ tar_open_archive_int (struct vfs_class *me, const vfs_path_t * vpath, struct vfs
 /* --------------------------------------------------------------------------------------------- */
 
 static union record *
-tar_get_next_record (struct vfs_s_super *archive, int tard)
+tar_get_next_record (struct vfs_s_super *archive)
 {
-    int n;
-
-    (void) archive;
+    tar_super_data_t *arch = (tar_super_data_t *) archive->data;
+    ssize_t n;
 
-    n = mc_read (tard, rec_buf.charptr, sizeof (rec_buf.charptr));
+    n = vfs_zstream_read (arch->stream, rec_buf.charptr, sizeof (rec_buf.charptr));
     if (n != sizeof (rec_buf.charptr))
         return NULL;            /* An error has occurred */
     current_tar_position += sizeof (rec_buf.charptr);
@@ -366,11 +399,11 @@ tar_get_next_record (struct vfs_s_super *archive, int tard)
 /* --------------------------------------------------------------------------------------------- */
 
 static void
-tar_skip_n_records (struct vfs_s_super *archive, int tard, size_t n)
+tar_skip_n_records (struct vfs_s_super *archive, size_t n)
 {
-    (void) archive;
+    tar_super_data_t *arch = (tar_super_data_t *) archive->data;
 
-    mc_lseek (tard, n * sizeof (rec_buf.charptr), SEEK_CUR);
+    vfs_zstream_seek (arch->stream, n * sizeof (rec_buf.charptr), SEEK_CUR);
     current_tar_position += n * sizeof (rec_buf.charptr);
 }
 
@@ -464,7 +497,7 @@ tar_fill_stat (struct vfs_s_super *archive, struct stat *st, union record *heade
  *
  */
 static ReadStatus
-tar_read_header (struct vfs_class *me, struct vfs_s_super *archive, int tard, size_t * h_size)
+tar_read_header (struct vfs_class *me, struct vfs_s_super *archive, size_t * h_size)
 {
     tar_super_data_t *arch = (tar_super_data_t *) archive->data;
 
@@ -476,7 +509,7 @@ tar_read_header (struct vfs_class *me, struct vfs_s_super *archive, int tard, si
 
   recurse:
 
-    header = tar_get_next_record (archive, tard);
+    header = tar_get_next_record (archive);
     if (NULL == header)
         return STATUS_EOF;
 
@@ -599,7 +632,7 @@ tar_read_header (struct vfs_class *me, struct vfs_s_super *archive, int tard, si
 
         for (size = *h_size; size > 0; size -= written)
         {
-            data = tar_get_next_record (archive, tard)->charptr;
+            data = tar_get_next_record (archive)->charptr;
             if (data == NULL)
             {
                 MC_PTR_FREE (*longp);
@@ -750,7 +783,7 @@ tar_read_header (struct vfs_class *me, struct vfs_s_super *archive, int tard, si
 
         if (arch->type == TAR_GNU && header->header.unused.oldgnu.isextended)
         {
-            while (tar_get_next_record (archive, tard)->ext_hdr.isextended != 0)
+            while (tar_get_next_record (archive)->ext_hdr.isextended != 0)
                 ;
 
             if (inode != NULL)
@@ -760,36 +793,320 @@ tar_read_header (struct vfs_class *me, struct vfs_s_super *archive, int tard, si
     }
 }
 
+/* --------------------------------------------------------------------------------------------- */
+/**
+ * Get name of index file of archive.
+ *
+ * @return newly allocated file name, NULL if archive is not indexed
+ */
+
+static char *
+tar_index_file_name (const vfs_path_t * vpath, const struct stat *st)
+{
+    char *hash, *name;
+
+    if (!tar_index_cache || st->st_size < TAR_INDEX_MIN_SIZE || !vfs_file_is_local (vpath))
+        return NULL;
+
+    hash = g_compute_checksum_for_string (G_CHECKSUM_MD5, vfs_path_as_str (vpath), -1);
+    name = mc_build_filename (mc_config_get_cache_path (), MC_TARFS_INDEX_DIR, hash, (char *) NULL);
+    g_free (hash);
+
+    return name;
+}
+
+/* --------------------------------------------------------------------------------------------- */
+
+static void
+tar_index_save_dir (GString * buf, const struct vfs_s_inode *dir, const char *path,
+                    GHashTable * inodes, guint32 * count)
+{
+    GList *iter;
+
+    for (iter = dir->subdir; iter != NULL; iter = g_list_next (iter))
+    {
+        const struct vfs_s_entry *ent = (const struct vfs_s_entry *) iter->data;
+        const struct vfs_s_inode *ino = ent->ino;
+        tar_index_record_t rec;
+        char *name;
+
+        name = (*path == '\0') ? g_strdup (ent->name)
+            : g_strconcat (path, PATH_SEP_STR, ent->name, (char *) NULL);
+
+        memset (&rec, 0, sizeof (rec));
+        rec.link_inode = GPOINTER_TO_UINT (g_hash_table_lookup (inodes, ino));
+        rec.name_len = strlen (name);
+        rec.linkname_len = ino->linkname != NULL ? strlen (ino->linkname) : 0;
+        rec.mode = ino->st.st_mode;
+        rec.uid = ino->st.st_uid;
+        rec.gid = ino->st.st_gid;
+#ifdef HAVE_STRUCT_STAT_ST_RDEV
+        rec.rdev = ino->st.st_rdev;
+#endif
+        rec.data_offset = ino->data_offset;
+        rec.size = ino->st.st_size;
+        rec.mtime = ino->st.st_mtime;
+        rec.atime = ino->st.st_atime;
+        rec.ctime = ino->st.st_ctime;
+
+        g_string_append_len (buf, (const char *) &rec, sizeof (rec));
+        g_string_append_len (buf, name, rec.name_len);
+        if (rec.linkname_len != 0)
+            g_string_append_len (buf, ino->linkname, rec.linkname_len);
+        (*count)++;
+
+        if (rec.link_inode == 0)
+        {
+            g_hash_table_insert (inodes, (gpointer) ino,
+                                 GUINT_TO_POINTER (g_hash_table_size (inodes) + 1));
+            if (S_ISDIR (ino->st.st_mode))
+                tar_index_save_dir (buf, ino, name, inodes, count);
+        }
+
+        g_free (name);
+    }
+}
+
+/* --------------------------------------------------------------------------------------------- */
+/**
+ * Store entries of just read archive in the index file.
+ */
+
+static void
+tar_index_save (struct vfs_s_super *archive, const vfs_path_t * vpath)
+{
+    tar_super_data_t *arch = (tar_super_data_t *) archive->data;
+    char *file_name, *dir;
+    tar_index_header_t header;
+    GString *buf;
+    GHashTable *inodes;
+    guint32 count = 0;
+
+    file_name = tar_index_file_name (vpath, &arch->st);
+    if (file_name == NULL)
+        return;
+
+    memset (&header, 0, sizeof (header));
+    g_strlcpy (header.magic, TAR_INDEX_MAGIC, sizeof (header.magic));
+    header.archive_size = arch->st.st_size;
+    header.archive_mtime = arch->st.st_mtime;
+    header.name_len = strlen (archive->name);
+
+    buf = g_string_sized_new (64 * 1024);
+    g_string_append_len (buf, (const char *) &header, sizeof (header));
+    g_string_append_len (buf, archive->name, header.name_len);
+
+    inodes = g_hash_table_new (g_direct_hash, g_direct_equal);
+    tar_index_save_dir (buf, archive->root, "", inodes, &count);
+    g_hash_table_destroy (inodes);
+
+    /* store number of records now when it is known */
+    header.count = count;
+    memcpy (buf->str, &header, sizeof (header));
+
+    dir = g_path_get_dirname (file_name);
+    if (g_mkdir_with_parents (dir, 0700) == 0)
+        (void) g_file_set_contents (file_name, buf->str, buf->len, NULL);
+    g_free (dir);
+
+    g_string_free (buf, TRUE);
+    g_free (file_name);
+}
+
+/* --------------------------------------------------------------------------------------------- */
+/**
+ * Check that index file belongs to this version of archive and is not damaged.
+ *
+ * @return number of records, -1 if index is not valid
+ */
+
+static int
+tar_index_check (const char *data, size_t len, const char *archive_name, const struct stat *st,
+                 const char **records)
+{
+    tar_index_header_t header;
+    const char *p, *end;
+    guint32 i, n_inodes = 0;
+
+    if (len < sizeof (header))
+        return -1;
+
+    memcpy (&header, data, sizeof (header));
+    if (strncmp (header.magic, TAR_INDEX_MAGIC, sizeof (header.magic)) != 0
+        || header.archive_size != (gint64) st->st_size
+        || header.archive_mtime != (gint64) st->st_mtime
+        || header.name_len != strlen (archive_name)
+        || len - sizeof (header) < header.name_len
+        || memcmp (data + sizeof (header), archive_name, header.name_len) != 0)
+        return -1;
+
+    p = data + sizeof (header) + header.name_len;
+    end = data + len;
+    *records = p;
+
+    for (i = 0; i < header.count; i++)
+    {
+        tar_index_record_t rec;
+
+        if ((size_t) (end - p) < sizeof (rec))
+            return -1;
+        memcpy (&rec, p, sizeof (rec));
+        p += sizeof (rec);
+
+        if (rec.name_len == 0 || (size_t) (end - p) < (size_t) rec.name_len + rec.linkname_len
+            || rec.link_inode > n_inodes || memchr (p, '\0', rec.name_len) != NULL)
+            return -1;
+        p += rec.name_len + rec.linkname_len;
+
+        if (rec.link_inode == 0)
+            n_inodes++;
+    }
+
+    return (p == end) ? (int) header.count : -1;
+}
+
+/* --------------------------------------------------------------------------------------------- */
+/**
+ * Build directory tree of archive from the index file without reading the archive.
+ *
+ * @return TRUE if tree is built from the index
+ */
+
+static gboolean
+tar_index_load (struct vfs_class *me, struct vfs_s_super *archive, const vfs_path_t * vpath)
+{
+    tar_super_data_t *arch = (tar_super_data_t *) archive->data;
+    char *file_name;
+    GMappedFile *mapped;
+    const char *data, *p;
+    int count, i;
+    GPtrArray *inodes;
+    gboolean ret = TRUE;
+
+    file_name = tar_index_file_name (vpath, &arch->st);
+    if (file_name == NULL)
+        return FALSE;
+
+    mapped = g_mapped_file_new (file_name, FALSE, NULL);
+    g_free (file_name);
+    if (mapped == NULL)
+        return FALSE;
+
+    data = g_mapped_file_get_contents (mapped);
+    count = tar_index_check (data, g_mapped_file_get_length (mapped), archive->name, &arch->st,
+                             &p);
+    if (count < 0)
+    {
+        g_mapped_file_unref (mapped);
+        return FALSE;
+    }
+
+    inodes = g_ptr_array_new ();
+
+    for (i = 0; i < count && ret; i++)
+    {
+        tar_index_record_t rec;
+        struct vfs_s_inode *parent, *inode;
+        struct vfs_s_entry *entry;
+        char *path, *name;
+
+        memcpy (&rec, p, sizeof (rec));
+        p += sizeof (rec);
+        path = g_strndup (p, rec.name_len);
+        p += rec.name_len;
+
+        name = strrchr (path, PATH_SEP);
+        if (name == NULL)
+        {
+            name = path;
+            parent = archive->root;
+        }
+        else
+        {
+            *name++ = '\0';
+            parent = vfs_s_find_inode (me, archive, path, LINK_NO_FOLLOW, FL_MKDIR);
+        }
+
+        if (rec.link_inode != 0)
+            inode = (struct vfs_s_inode *) g_ptr_array_index (inodes, rec.link_inode - 1);
+        else
+        {
+            struct stat st;
+
+            memset (&st, 0, sizeof (st));
+            st.st_mode = rec.mode;
+            st.st_uid = rec.uid;
+            st.st_gid = rec.gid;
+#ifdef HAVE_STRUCT_STAT_ST_RDEV
+            st.st_rdev = rec.rdev;
+#endif
+            st.st_size = rec.size;
+            st.st_mtime = rec.mtime;
+            st.st_atime = rec.atime;
+            st.st_ctime = rec.ctime;
+#ifdef HAVE_STRUCT_STAT_ST_BLKSIZE
+            st.st_blksize = 8 * 1024;   /* FIXME */
+#endif
+            vfs_adjust_stat (&st);
+
+            inode = vfs_s_new_inode (me, archive, &st);
+            inode->data_offset = rec.data_offset;
+            if (rec.linkname_len != 0)
+                inode->linkname = g_strndup (p, rec.linkname_len);
+            g_ptr_array_add (inodes, inode);
+        }
+        p += rec.linkname_len;
+
+        if (parent == NULL)
+        {
+            if (rec.link_inode == 0)
+                vfs_s_free_inode (me, inode);
+            ret = FALSE;
+        }
+        else
+        {
+            entry = vfs_s_new_entry (me, name, inode);
+            vfs_s_insert_entry (me, parent, entry);
+        }
+
+        g_free (path);
+    }
+
+    g_ptr_array_free (inodes, TRUE);
+    g_mapped_file_unref (mapped);
+
+    /* archive will be read from scratch */
+    if (!ret)
+        while (archive->root->subdir != NULL)
+            vfs_s_free_entry (me, (struct vfs_s_entry *) archive->root->subdir->data);
+
+    return ret;
+}
+
 /* --------------------------------------------------------------------------------------------- */
 /**
  * Main loop for reading an archive.
  * Returns 0 on success, -1 on error.
  */
 static int
-tar_open_archive (struct vfs_s_super *archive, const vfs_path_t * vpath,
-                  const vfs_path_element_t * vpath_element)
+tar_read_archive (struct vfs_class *me, struct vfs_s_super *archive, const vfs_path_t * vpath)
 {
     /* Initial status at start of archive */
     ReadStatus status = STATUS_EOFMARK;
-    int tard;
 
     current_tar_position = 0;
-    /* Open for reading */
-    tard = tar_open_archive_int (vpath_element->class, vpath, archive);
-    if (tard == -1)
-        return -1;
 
     while (TRUE)
     {
         size_t h_size;
         ReadStatus prev_status = status;
 
-        status = tar_read_header (vpath_element->class, archive, tard, &h_size);
+        status = tar_read_header (me, archive, &h_size);
 
         switch (status)
         {
         case STATUS_SUCCESS:
-            tar_skip_n_records (archive, tard, (h_size + RECORDSIZE - 1) / RECORDSIZE);
+            tar_skip_n_records (archive, (h_size + RECORDSIZE - 1) / RECORDSIZE);
             continue;
 
             /*
@@ -839,6 +1156,28 @@ tar_open_archive (struct vfs_s_super *archive, const vfs_path_t * vpath,
 
 /* --------------------------------------------------------------------------------------------- */
 
+static int
+tar_open_archive (struct vfs_s_super *archive, const vfs_path_t * vpath,
+                  const vfs_path_element_t * vpath_element)
+{
+    struct vfs_class *me = vpath_element->class;
+
+    /* Open for reading */
+    if (tar_open_archive_int (me, vpath, archive) == -1)
+        return -1;
+
+    if (tar_index_load (me, archive, vpath))
+        return 0;
+
+    if (tar_read_archive (me, archive, vpath) != 0)
+        return -1;
+
+    tar_index_save (archive, vpath);
+    return 0;
+}
+
+/* --------------------------------------------------------------------------------------------- */
+
 static void *
 tar_super_check (const vfs_path_t * vpath)
 {
@@ -882,16 +1221,16 @@ static ssize_t
 tar_read (void *fh, char *buffer, size_t count)
 {
     off_t begin = FH->ino->data_offset;
-    int fd = ((tar_super_data_t *) FH_SUPER->data)->fd;
+    vfs_zstream_t *stream = ((tar_super_data_t *) FH_SUPER->data)->stream;
     struct vfs_class *me = FH_SUPER->me;
     ssize_t res;
 
-    if (mc_lseek (fd, begin + FH->pos, SEEK_SET) != begin + FH->pos)
+    if (vfs_zstream_seek (stream, begin + FH->pos, SEEK_SET) != begin + FH->pos)
         ERRNOR (EIO, -1);
 
     count = MIN (count, (size_t) (FH->ino->st.st_size - FH->pos));
 
-    res = mc_read (fd, buffer, count);
+    res = vfs_zstream_read (stream, buffer, count);
     if (res == -1)
         ERRNOR (errno, -1);
 
@@ -9,6 +9,8 @@
 
 /*** global variables defined in .c file *********************************************************/
 
+extern gboolean tar_index_cache;
+
 /*** declarations of public functions ************************************************************/
 
 void init_tarfs (void);
@@ -167,7 +167,9 @@ mcview_continue_search_cmd (WView * view)
 #endif
                 view->search->is_case_sensitive = mcview_search_options.case_sens;
                 view->search->whole_words = mcview_search_options.whole_words;
+                view->search->multiline = mcview_search_options.multiline;
                 view->search->search_fn = mcview_search_cmd_callback;
+                view->search->block_fn = mcview_search_block_cmd_callback;
                 view->search->update_fn = mcview_search_update_cmd_callback;
 
                 mcview_search (view, FALSE);
@@ -228,6 +228,50 @@ mcview_get_ptr_string (WView * view, off_t byte_index)
     return NULL;
 }
 
+/* --------------------------------------------------------------------------------------------- */
+/**
+ * Get pointer to contiguous block of already loaded data.
+ *
+ * @param view viewer object
+ * @param byte_index offset of the first byte of block
+ * @param len length of block
+ *
+ * @return pointer to data at byte_index, NULL if byte_index is out of data
+ */
+
+char *
+mcview_get_ptr_block (WView * view, off_t byte_index, size_t * len)
+{
+    char *p = NULL;
+
+    *len = 0;
+
+    switch (view->datasource)
+    {
+    case DS_STDIO_PIPE:
+    case DS_VFS_PIPE:
+        p = mcview_get_ptr_growing_buffer (view, byte_index);
+        if (p != NULL)
+            *len = mcview_growbuf_block_len (view, byte_index);
+        break;
+    case DS_FILE:
+        p = mcview_get_ptr_file (view, byte_index);
+        if (p != NULL)
+            *len = view->ds_file_datalen - (byte_index - view->ds_file_offset);
+        break;
+    case DS_STRING:
+        p = mcview_get_ptr_string (view, byte_index);
+        if (p != NULL)
+            *len = view->ds_string_len - byte_index;
+        break;
+    case DS_NONE:
+    default:
+        break;
+    }
+
+    return p;
+}
+
 /* --------------------------------------------------------------------------------------------- */
 
 gboolean
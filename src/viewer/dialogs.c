@@ -57,6 +57,7 @@ mcview_search_options_t mcview_search_options = {
     .case_sens = FALSE,
     .backwards = FALSE,
     .whole_words = FALSE,
+    .multiline = FALSE,
     .all_codepages = FALSE
 };
 
@@ -97,6 +98,7 @@ mcview_dialog_search (WView * view)
                 QUICK_CHECKBOX (N_("Cas&e sensitive"), &mcview_search_options.case_sens, NULL),
                 QUICK_CHECKBOX (N_("&Backwards"), &mcview_search_options.backwards, NULL),
                 QUICK_CHECKBOX (N_("&Whole words"), &mcview_search_options.whole_words, NULL),
+                QUICK_CHECKBOX (N_("&Multi-line regex"), &mcview_search_options.multiline, NULL),
 #ifdef HAVE_CHARSET
                 QUICK_CHECKBOX (N_("&All charsets"), &mcview_search_options.all_codepages, NULL),
 #endif
@@ -155,7 +157,9 @@ mcview_dialog_search (WView * view)
 #endif
         view->search->is_case_sensitive = mcview_search_options.case_sens;
         view->search->whole_words = mcview_search_options.whole_words;
+        view->search->multiline = mcview_search_options.multiline;
         view->search->search_fn = mcview_search_cmd_callback;
+        view->search->block_fn = mcview_search_block_cmd_callback;
         view->search->update_fn = mcview_search_update_cmd_callback;
     }
 
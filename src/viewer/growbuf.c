@@ -290,3 +290,25 @@ mcview_get_ptr_growing_buffer (WView * view, off_t byte_index)
 }
 
 /* --------------------------------------------------------------------------------------------- */
+/**
+ * @return number of already read bytes from byte_index up to the end of its page
+ */
+
+size_t
+mcview_growbuf_block_len (WView * view, off_t byte_index)
+{
+    off_t pageno, pageindex;
+
+    pageno = byte_index / VIEW_PAGE_SIZE;
+    pageindex = byte_index % VIEW_PAGE_SIZE;
+
+    if (byte_index < 0 || pageno >= (off_t) view->growbuf_blockptr->len)
+        return 0;
+    if (pageno < (off_t) view->growbuf_blockptr->len - 1)
+        return VIEW_PAGE_SIZE - pageindex;
+    if (pageindex < (off_t) view->growbuf_lastindex)
+        return view->growbuf_lastindex - pageindex;
+    return 0;
+}
+
+/* --------------------------------------------------------------------------------------------- */
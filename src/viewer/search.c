@@ -134,6 +134,12 @@ mcview_find (mcview_search_status_msg_t * ssm, off_t search_start, off_t search_
     if (mcview_search_options.backwards)
     {
         search_end = mcview_get_filesize (view);
+
+        if (!view->text_nroff_mode)
+            return mc_search_run_backward (view->search, (void *) ssm, 0, search_start, search_end,
+                                           len);
+
+        /* nroff sequences are processed by callback sequentially: try every offset */
         while (search_start >= 0)
         {
             gboolean ok;
@@ -253,6 +259,24 @@ mcview_search_cmd_callback (const void *user_data, gsize char_offset, int *curre
 
 /* --------------------------------------------------------------------------------------------- */
 
+mc_search_cbret_t
+mcview_search_block_cmd_callback (const void *user_data, gsize char_offset, const char **block,
+                                  gsize * block_len)
+{
+    WView *view = ((const mcview_search_status_msg_t *) user_data)->view;
+    size_t len;
+
+    /* nroff sequences are processed by mcview_search_cmd_callback() */
+    if (view->text_nroff_mode)
+        return MC_SEARCH_CB_INVALID;
+
+    *block = mcview_get_ptr_block (view, (off_t) char_offset, &len);
+    *block_len = len;
+    return (*block != NULL) ? MC_SEARCH_CB_OK : MC_SEARCH_CB_NOTFOUND;
+}
+
+/* --------------------------------------------------------------------------------------------- */
+
 mc_search_cbret_t
 mcview_search_update_cmd_callback (const void *user_data, gsize char_offset)
 {
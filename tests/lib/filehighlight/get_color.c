@@ -0,0 +1,311 @@
+/*
+   lib/filehighlight - tests for mc_fhl_get_color() function
+
+   Copyright (C) 2017
+   Free Software Foundation, Inc.
+
+   This file is part of the Midnight Commander.
+
+   The Midnight Commander is free software: you can redistribute it
+   and/or modify it under the terms of the GNU General Public License as
+   published by the Free Software Foundation, either version 3 of the License,
+   or (at your option) any later version.
+
+   The Midnight Commander is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#define TEST_SUITE_NAME "/lib/filehighlight"
+
+#include "tests/mctest.h"
+
+#include <string.h>
+
+#include "lib/strutil.h"
+#include "lib/skin.h"
+#include "lib/filehighlight.h"
+#include "lib/filehighlight/internal.h"
+
+static mc_fhl_t *fhl;
+
+/* --------------------------------------------------------------------------------------------- */
+
+static void
+fhl_add_filetype (int color, mc_flhgh_ftype_type file_type)
+{
+    mc_fhl_filter_t *mc_filter;
+
+    mc_filter = g_new0 (mc_fhl_filter_t, 1);
+    mc_filter->type = MC_FLHGH_T_FTYPE;
+    mc_filter->file_type = file_type;
+    mc_filter->color_pair_index = color;
+    g_ptr_array_add (fhl->filters, mc_filter);
+}
+
+/* --------------------------------------------------------------------------------------------- */
+
+static void
+fhl_add_regexp (int color, const char *regexp)
+{
+    mc_fhl_filter_t *mc_filter;
+
+    mc_filter = g_new0 (mc_fhl_filter_t, 1);
+    mc_filter->type = MC_FLHGH_T_FREGEXP;
+    mc_filter->search_condition = mc_search_new (regexp, DEFAULT_CHARSET);
+    mc_filter->search_condition->is_case_sensitive = TRUE;
+    mc_filter->search_condition->search_type = MC_SEARCH_T_REGEX;
+    mc_filter->color_pair_index = color;
+    g_ptr_array_add (fhl->filters, mc_filter);
+}
+
+/* --------------------------------------------------------------------------------------------- */
+
+static void
+fhl_add_extensions (int color, const char *extensions, gboolean extensions_case)
+{
+    mc_fhl_filter_t *mc_filter;
+
+    mc_filter = g_new0 (mc_fhl_filter_t, 1);
+    mc_filter->type = MC_FLHGH_T_EXT;
+    mc_filter->extensions = g_strsplit (extensions, ";", -1);
+    mc_filter->extensions_case = extensions_case;
+    mc_filter->color_pair_index = color;
+    g_ptr_array_add (fhl->filters, mc_filter);
+}
+
+/* --------------------------------------------------------------------------------------------- */
+
+/* rules are reloaded in the same way as mc_fhl_parse_ini_file() does */
+static void
+fhl_reload (void)
+{
+    mc_fhl_array_free (fhl);
+    fhl->filters = g_ptr_array_new ();
+}
+
+/* --------------------------------------------------------------------------------------------- */
+
+static void
+file_entry_init (file_entry_t * fe, const char *fname, mode_t mode)
+{
+    memset (fe, 0, sizeof (*fe));
+    fe->fname = (char *) fname;
+    fe->fnamelen = strlen (fname);
+    fe->st.st_mode = mode;
+    fe->st.st_nlink = 1;
+}
+
+/* --------------------------------------------------------------------------------------------- */
+
+/* @Before */
+static void
+setup (void)
+{
+    str_init_strings (NULL);
+
+    fhl = mc_fhl_new (FALSE);
+    fhl->filters = g_ptr_array_new ();
+
+    fhl_add_filetype (1, MC_FLHGH_FTYPE_T_FILE_EXE);
+    fhl_add_regexp (2, "^main\\.");
+    fhl_add_extensions (3, "c;h", TRUE);
+    fhl_add_extensions (4, "tar.gz;gz", TRUE);
+    /* never used for *.gz files: extension filter above is matched first */
+    fhl_add_regexp (5, "\\.gz$");
+    fhl_add_extensions (6, "txt", FALSE);
+    fhl_add_extensions (7, "c", TRUE);
+    /* filter without color */
+    fhl_add_regexp (0, "^tmp");
+    fhl_add_regexp (8, "~$");
+    fhl_add_regexp (9, "^tmp");
+
+    mc_fhl_compile (fhl);
+}
+
+/* --------------------------------------------------------------------------------------------- */
+
+/* @After */
+static void
+teardown (void)
+{
+    mc_fhl_free (&fhl);
+    str_uninit_strings ();
+}
+
+/* --------------------------------------------------------------------------------------------- */
+
+/* @DataSource("test_first_filter_ds") */
+/* *INDENT-OFF* */
+static const struct test_first_filter_ds
+{
+    const char *fname;
+    mode_t mode;
+    int expected_color;         /* 0: file isn't highlighted */
+} test_first_filter_ds[] =
+{
+    { /* 0. file type filter is before regexp one */
+        "main.c", S_IFREG | 0755, 1
+    },
+    { /* 1. regexp filter is before extension one */
+        "main.c", S_IFREG | 0644, 2
+    },
+    { /* 2. */
+        "util.c", S_IFREG | 0644, 3
+    },
+    { /* 3. extension with dot */
+        "archive.tar.gz", S_IFREG | 0644, 4
+    },
+    { /* 4. regexp after matched extension filter */
+        "archive.gz", S_IFREG | 0644, 4
+    },
+    { /* 5. case insensitive extension */
+        "README.TxT", S_IFREG | 0644, 6
+    },
+    { /* 6. case sensitive extension */
+        "util.C", S_IFREG | 0644, 0
+    },
+    { /* 7. filter without color is skipped */
+        "tmpfile", S_IFREG | 0644, 9
+    },
+    { /* 8. */
+        "util.c~", S_IFREG | 0644, 8
+    },
+    { /* 9. no filter matches */
+        "Makefile", S_IFREG | 0644, 0
+    },
+    { /* 10. */
+        "main.c", S_IFDIR | 0755, 2
+    },
+};
+/* *INDENT-ON* */
+
+/* @Test(dataSource = "test_first_filter_ds") */
+/* *INDENT-OFF* */
+START_PARAMETRIZED_TEST (test_first_filter, test_first_filter_ds)
+/* *INDENT-ON* */
+{
+    /* given */
+    file_entry_t fe;
+    int color;
+
+    file_entry_init (&fe, data->fname, data->mode);
+
+    /* when */
+    color = mc_fhl_get_color (fhl, &fe);
+
+    /* then */
+    if (data->expected_color == 0)
+        mctest_assert_int_eq (color, NORMAL_COLOR);
+    else
+        mctest_assert_int_eq (color, -data->expected_color);
+}
+/* *INDENT-OFF* */
+END_PARAMETRIZED_TEST
+/* *INDENT-ON* */
+
+/* --------------------------------------------------------------------------------------------- */
+
+/* @Test */
+/* *INDENT-OFF* */
+START_TEST (test_standalone_regexp)
+/* *INDENT-ON* */
+{
+    /* given */
+    file_entry_t fe;
+
+    /* regexp with back reference cannot be combined with other ones */
+    fhl_reload ();
+    fhl_add_regexp (1, "^(.)\\1");
+    fhl_add_regexp (2, "\\.c$");
+    mc_fhl_compile (fhl);
+
+    /* when, then */
+    mctest_assert_null (fhl->regexp);
+    file_entry_init (&fe, "aab.c", S_IFREG | 0644);
+    mctest_assert_int_eq (mc_fhl_get_color (fhl, &fe), -1);
+    file_entry_init (&fe, "abb.c", S_IFREG | 0644);
+    mctest_assert_int_eq (mc_fhl_get_color (fhl, &fe), -2);
+}
+/* *INDENT-OFF* */
+END_TEST
+/* *INDENT-ON* */
+
+/* --------------------------------------------------------------------------------------------- */
+
+/* @Test */
+/* *INDENT-OFF* */
+START_TEST (test_cache_invalidation)
+/* *INDENT-ON* */
+{
+    /* given */
+    file_entry_t fe;
+    unsigned int id;
+
+    file_entry_init (&fe, "util.c", S_IFREG | 0644);
+    mctest_assert_int_eq (mc_fhl_get_color (fhl, &fe), -3);
+    id = fe.fhl_id;
+    mctest_assert_int_ne (id, 0);
+
+    /* when: rules are changed but not compiled yet */
+    fe.fname = (char *) "util.h";
+    fhl_add_regexp (10, "^util");
+
+    /* then */
+    mctest_assert_int_eq (mc_fhl_get_color (fhl, &fe), -3);
+
+    /* when: rules are reloaded */
+    fhl_reload ();
+    fhl_add_regexp (10, "^util");
+    fhl_add_extensions (3, "c;h", TRUE);
+    mc_fhl_compile (fhl);
+
+    /* then */
+    mctest_assert_int_ne (fhl->id, id);
+    mctest_assert_int_eq (mc_fhl_get_color (fhl, &fe), -10);
+    mctest_assert_int_eq (fe.fhl_id, fhl->id);
+
+    /* when: rules are cleared */
+    fhl_reload ();
+    mc_fhl_compile (fhl);
+
+    /* then */
+    mctest_assert_int_eq (mc_fhl_get_color (fhl, &fe), NORMAL_COLOR);
+}
+/* *INDENT-OFF* */
+END_TEST
+/* *INDENT-ON* */
+
+/* --------------------------------------------------------------------------------------------- */
+
+int
+main (void)
+{
+    int number_failed;
+
+    Suite *s = suite_create (TEST_SUITE_NAME);
+    TCase *tc_core = tcase_create ("Core");
+    SRunner *sr;
+
+    tcase_add_checked_fixture (tc_core, setup, teardown);
+
+    /* Add new tests here: *************** */
+    mctest_add_parameterized_test (tc_core, test_first_filter, test_first_filter_ds);
+    tcase_add_test (tc_core, test_standalone_regexp);
+    tcase_add_test (tc_core, test_cache_invalidation);
+    /* *********************************** */
+
+    suite_add_tcase (s, tc_core);
+    sr = srunner_create (s);
+    srunner_set_log (sr, "get_color.log");
+    srunner_run_all (sr, CK_ENV);
+    number_failed = srunner_ntests_failed (sr);
+    srunner_free (sr);
+    return (number_failed == 0) ? EXIT_SUCCESS : EXIT_FAILURE;
+}
+
+/* --------------------------------------------------------------------------------------------- */
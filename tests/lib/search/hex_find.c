@@ -0,0 +1,264 @@
+/*
+   libmc - checks for hex search
+
+   Copyright (C) 2017
+   Free Software Foundation, Inc.
+
+   This file is part of the Midnight Commander.
+
+   The Midnight Commander is free software: you can redistribute it
+   and/or modify it under the terms of the GNU General Public License as
+   published by the Free Software Foundation, either version 3 of the License,
+   or (at your option) any later version.
+
+   The Midnight Commander is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#define TEST_SUITE_NAME "lib/search/hex"
+
+#include "tests/mctest.h"
+
+#include "lib/strutil.h"
+#include "lib/search.h"
+
+/* --------------------------------------------------------------------------------------------- */
+
+/* binary data: may contain NULs */
+typedef struct
+{
+    const char *data;
+    gsize len;
+} test_data_t;
+
+/* --------------------------------------------------------------------------------------------- */
+
+/* @Before */
+static void
+setup (void)
+{
+    str_init_strings (NULL);
+}
+
+/* --------------------------------------------------------------------------------------------- */
+
+/* @After */
+static void
+teardown (void)
+{
+    str_uninit_strings ();
+}
+
+/* --------------------------------------------------------------------------------------------- */
+
+static mc_search_cbret_t
+search_callback (const void *user_data, gsize char_offset, int *current_char)
+{
+    const test_data_t *d = (const test_data_t *) user_data;
+
+    if (char_offset >= d->len)
+        return MC_SEARCH_CB_NOTFOUND;
+
+    *current_char = (unsigned char) d->data[char_offset];
+    return MC_SEARCH_CB_OK;
+}
+
+/* --------------------------------------------------------------------------------------------- */
+
+/* gives data by small blocks to check matches across block boundaries */
+static mc_search_cbret_t
+search_block_callback (const void *user_data, gsize char_offset, const char **block,
+                       gsize * block_len)
+{
+    const test_data_t *d = (const test_data_t *) user_data;
+
+    if (char_offset >= d->len)
+        return MC_SEARCH_CB_NOTFOUND;
+
+    *block = d->data + char_offset;
+    *block_len = MIN (d->len - char_offset, 3);
+    return MC_SEARCH_CB_OK;
+}
+
+/* --------------------------------------------------------------------------------------------- */
+
+/* @DataSource("test_hex_find_ds") */
+/* *INDENT-OFF* */
+static const struct test_hex_find_ds
+{
+    const char *pattern;
+    const char *input_value;
+    gsize input_len;
+    gboolean case_sensitive;
+    gboolean whole_words;
+    gboolean expected_found;
+    off_t expected_offset;
+    gsize expected_len;
+} test_hex_find_ds[] =
+{
+    { /* 0. */
+        "12 34", "\x01\x12\x12\x34\x56", 5, TRUE, FALSE, TRUE, 2, 2
+    },
+    { /* 1. NUL bytes */
+        "00 ff 00", "\xff\x00\xff\x01\x00\xff\x00", 7, TRUE, FALSE, TRUE, 4, 3
+    },
+    { /* 2. mixed with quoted string */
+        "\"ab\" 0", "ab ab\x00", 6, TRUE, FALSE, TRUE, 3, 3
+    },
+    { /* 3. */
+        "\"AB\"", "ab", 2, TRUE, FALSE, FALSE, 0, 0
+    },
+    { /* 4. */
+        "\"AB\"", "xab", 3, FALSE, FALSE, TRUE, 1, 2
+    },
+    { /* 5. hex numbers are case-sensitive */
+        "41 42", "ab AB", 5, FALSE, FALSE, TRUE, 3, 2
+    },
+    { /* 6. wildcard nibbles */
+        "de ?? b? ?f", "\xde\xad\xbe\xee\xde\x00\xb1\x0f", 8, TRUE, FALSE, TRUE, 4, 4
+    },
+    { /* 7. */
+        "\"foo\"", "foobar foo_x afoo foo", 21, TRUE, TRUE, TRUE, 18, 3
+    },
+    { /* 8. pattern is longer than data */
+        "1 2 3", "\x01\x02", 2, TRUE, FALSE, FALSE, 0, 0
+    },
+};
+/* *INDENT-ON* */
+
+/* @Test(dataSource = "test_hex_find_ds") */
+/* *INDENT-OFF* */
+START_PARAMETRIZED_TEST (test_hex_find, test_hex_find_ds)
+/* *INDENT-ON* */
+{
+    /* given */
+    test_data_t d = { data->input_value, data->input_len };
+    mc_search_t *s;
+    gsize found_len = 0;
+    gboolean found;
+
+    s = mc_search_new (data->pattern, NULL);
+    s->search_type = MC_SEARCH_T_HEX;
+    s->is_case_sensitive = data->case_sensitive;
+    s->whole_words = data->whole_words;
+    s->search_fn = search_callback;
+
+    /* when */
+    found = mc_search_run (s, &d, 0, d.len - 1, &found_len);
+
+    /* then */
+    mctest_assert_int_eq (found, data->expected_found);
+    if (found)
+    {
+        mctest_assert_int_eq (s->normal_offset, data->expected_offset);
+        mctest_assert_int_eq (found_len, data->expected_len);
+    }
+    else
+        mctest_assert_int_eq (s->error, MC_SEARCH_E_NOTFOUND);
+
+    /* when: same data is read by blocks */
+    s->block_fn = search_block_callback;
+    found = mc_search_run (s, &d, 0, d.len - 1, &found_len);
+
+    /* then */
+    mctest_assert_int_eq (found, data->expected_found);
+    if (found)
+    {
+        mctest_assert_int_eq (s->normal_offset, data->expected_offset);
+        mctest_assert_int_eq (found_len, data->expected_len);
+    }
+
+    /* when: search backward from the end */
+    found = mc_search_run_backward (s, &d, 0, d.len - 1, d.len - 1, &found_len);
+
+    /* then: there is only one match in data */
+    mctest_assert_int_eq (found, data->expected_found);
+    if (found)
+        mctest_assert_int_eq (s->normal_offset, data->expected_offset);
+
+    mc_search_free (s);
+}
+/* *INDENT-OFF* */
+END_PARAMETRIZED_TEST
+/* *INDENT-ON* */
+
+/* --------------------------------------------------------------------------------------------- */
+
+/* @Test */
+/* *INDENT-OFF* */
+START_TEST (test_hex_find_long)
+/* *INDENT-ON* */
+{
+    /* given */
+    const gsize size = 300 * 1000;
+    char *str;
+    test_data_t d;
+    mc_search_t *s;
+    gsize found_len, i;
+
+    /* binary data without pattern; pattern crosses boundaries of read windows */
+    str = g_malloc (size);
+    for (i = 0; i < size; i++)
+        str[i] = (char) (i % 251);
+    memcpy (str + 64 * 1024 - 2, "\xde\xad\xbe\xef", 4);
+    memcpy (str + size - 4, "\xde\xad\xbe\xef", 4);
+    d.data = str;
+    d.len = size;
+
+    s = mc_search_new ("de ad be ef", NULL);
+    s->search_type = MC_SEARCH_T_HEX;
+    s->search_fn = search_callback;
+    s->block_fn = search_block_callback;
+
+    /* when, then */
+    mctest_assert_int_eq (mc_search_run (s, &d, 0, size - 1, &found_len), TRUE);
+    mctest_assert_int_eq (s->normal_offset, 64 * 1024 - 2);
+    mctest_assert_int_eq (mc_search_run (s, &d, 64 * 1024, size - 1, &found_len), TRUE);
+    mctest_assert_int_eq (s->normal_offset, size - 4);
+    mctest_assert_int_eq (mc_search_run_backward (s, &d, 0, size - 5, size - 1, &found_len),
+                          TRUE);
+    mctest_assert_int_eq (s->normal_offset, 64 * 1024 - 2);
+    mctest_assert_int_eq (mc_search_run_backward (s, &d, 0, 64 * 1024 - 3, size - 1, &found_len),
+                          FALSE);
+
+    mc_search_free (s);
+    g_free (str);
+}
+/* *INDENT-OFF* */
+END_TEST
+/* *INDENT-ON* */
+
+/* --------------------------------------------------------------------------------------------- */
+
+int
+main (void)
+{
+    int number_failed;
+
+    Suite *s = suite_create (TEST_SUITE_NAME);
+    TCase *tc_core = tcase_create ("Core");
+    SRunner *sr;
+
+    tcase_add_checked_fixture (tc_core, setup, teardown);
+
+    /* Add new tests here: *************** */
+    mctest_add_parameterized_test (tc_core, test_hex_find, test_hex_find_ds);
+    tcase_add_test (tc_core, test_hex_find_long);
+    /* *********************************** */
+
+    suite_add_tcase (s, tc_core);
+    sr = srunner_create (s);
+    srunner_set_log (sr, "hex_find.log");
+    srunner_run_all (sr, CK_ENV);
+    number_failed = srunner_ntests_failed (sr);
+    srunner_free (sr);
+    return (number_failed == 0) ? EXIT_SUCCESS : EXIT_FAILURE;
+}
+
+/* --------------------------------------------------------------------------------------------- */
@@ -28,144 +28,179 @@
 
 /* --------------------------------------------------------------------------------------------- */
 
-/* @DataSource("test_hex_translate_to_regex_ds") */
+/* @DataSource("test_hex_parse_ds") */
 /* *INDENT-OFF* */
-static const struct test_hex_translate_to_regex_ds
+static const struct test_hex_parse_ds
 {
     const char *input_value;
-    const char *expected_result;
+    gboolean case_sensitive;
+    const char *expected_value;
+    const char *expected_mask;  /* NULL if all bits are compared */
+    guint expected_len;
     mc_search_hex_parse_error_t expected_error;
-} test_hex_translate_to_regex_ds[] =
+} test_hex_parse_ds[] =
 {
     {
         /* Simplest case */
-        "12 34",
-        "\\x12\\x34",
+        "12 34", TRUE,
+        "\x12\x34", NULL, 2,
         MC_SEARCH_HEX_E_OK
     },
     {
         /* Prefixes (0x, 0X) */
-        "0x12 0X34",
-        "\\x12\\x34",
+        "0x12 0X34", TRUE,
+        "\x12\x34", NULL, 2,
         MC_SEARCH_HEX_E_OK
     },
     {
         /* Prefix "0" doesn't signify octal! Numbers are always interpreted in hex. */
-        "012",
-        "\\x12",
+        "012", TRUE,
+        "\x12", NULL, 1,
         MC_SEARCH_HEX_E_OK
     },
     {
         /* Extra whitespace */
-        "  12  34  ",
-        "\\x12\\x34",
+        "  12  34  ", TRUE,
+        "\x12\x34", NULL, 2,
         MC_SEARCH_HEX_E_OK
     },
     {
         /* Min/max values */
-        "0 ff",
-        "\\x00\\xFF",
+        "0 ff", TRUE,
+        "\x00\xFF", NULL, 2,
         MC_SEARCH_HEX_E_OK
     },
     {
         /* Error: Number out of range */
-        "100",
-        NULL,
+        "100", TRUE,
+        NULL, NULL, 0,
         MC_SEARCH_HEX_E_NUM_OUT_OF_RANGE
     },
     {
         /* Error: Number out of range (negative) */
-        "-1",
-        NULL,
+        "-1", TRUE,
+        NULL, NULL, 0,
         MC_SEARCH_HEX_E_NUM_OUT_OF_RANGE
     },
     {
         /* Error: Invalid characters */
-        "1 z 2",
-        NULL,
+        "1 z 2", TRUE,
+        NULL, NULL, 0,
         MC_SEARCH_HEX_E_INVALID_CHARACTER
     },
     /*
      * Quotes.
      */
     {
-        " \"abc\" ",
-        "abc",
+        " \"abc\" ", TRUE,
+        "abc", NULL, 3,
         MC_SEARCH_HEX_E_OK
     },
     {
         /* Preserve upper/lower case */
-        "\"aBc\"",
-        "aBc",
+        "\"aBc\"", TRUE,
+        "aBc", NULL, 3,
         MC_SEARCH_HEX_E_OK
     },
     {
-        " 12\"abc\"34 ",
-        "\\x12abc\\x34",
+        " 12\"abc\"34 ", TRUE,
+        "\x12" "abc\x34", NULL, 5,
         MC_SEARCH_HEX_E_OK
     },
     {
-        "\"a\"\"b\"",
-        "ab",
+        "\"a\"\"b\"", TRUE,
+        "ab", NULL, 2,
         MC_SEARCH_HEX_E_OK
     },
     /* Empty quotes */
     {
-        "\"\"",
-        "",
+        "\"\"", TRUE,
+        "", NULL, 0,
         MC_SEARCH_HEX_E_OK
     },
     {
-        "12 \"\"",
-        "\\x12",
+        "12 \"\"", TRUE,
+        "\x12", NULL, 1,
         MC_SEARCH_HEX_E_OK
     },
     /* Error: Unmatched quotes */
     {
-        "\"a",
-        NULL,
+        "\"a", TRUE,
+        NULL, NULL, 0,
         MC_SEARCH_HEX_E_UNMATCHED_QUOTES
     },
     {
-        "\"",
-        NULL,
+        "\"", TRUE,
+        NULL, NULL, 0,
         MC_SEARCH_HEX_E_UNMATCHED_QUOTES
     },
     /* Escaped quotes */
     {
-        "\"a\\\"b\"",
-        "a\"b",
+        "\"a\\\"b\"", TRUE,
+        "a\"b", NULL, 3,
         MC_SEARCH_HEX_E_OK
     },
     {
-        "\"a\\\\b\"",
-        "a\\b",
+        "\"a\\\\b\"", TRUE,
+        "a\\b", NULL, 3,
         MC_SEARCH_HEX_E_OK
     },
+    /* Case-insensitive letters differ in bit 5 only */
+    {
+        "\"a1\" 61", FALSE,
+        "A1a", "\xDF\xFF\xFF", 3,
+        MC_SEARCH_HEX_E_OK
+    },
+    /*
+     * Wildcard nibbles.
+     */
+    {
+        "12 ?? 4? ?5 ?", TRUE,
+        "\x12\x00\x40\x05\x00", "\xFF\x00\xF0\x0F\x00", 5,
+        MC_SEARCH_HEX_E_OK
+    },
+    {
+        /* Error: too long wildcard */
+        "12 4??", TRUE,
+        NULL, NULL, 0,
+        MC_SEARCH_HEX_E_INVALID_CHARACTER
+    },
 };
 /* *INDENT-ON* */
 
-/* @Test(dataSource = "test_hex_translate_to_regex_ds") */
+/* @Test(dataSource = "test_hex_parse_ds") */
 /* *INDENT-OFF* */
-START_PARAMETRIZED_TEST (test_hex_translate_to_regex, test_hex_translate_to_regex_ds)
+START_PARAMETRIZED_TEST (test_hex_parse, test_hex_parse_ds)
 /* *INDENT-ON* */
 {
-    GString *tmp, *dest_str;
+    GString *tmp;
+    mc_search_hex_t *hex;
     mc_search_hex_parse_error_t error;
 
     /* given */
     tmp = g_string_new (data->input_value);
 
     /* when */
-    dest_str = mc_search__hex_translate_to_regex (tmp, &error, NULL);
+    hex = mc_search__hex_parse (tmp, data->case_sensitive, &error, NULL);
 
     g_string_free (tmp, TRUE);
 
     /* then */
-    if (dest_str != NULL)
+    if (hex != NULL)
     {
-        mctest_assert_str_eq (dest_str->str, data->expected_result);
-        g_string_free (dest_str, TRUE);
+        guint i;
+
+        mctest_assert_int_eq (hex->value->len, data->expected_len);
+        for (i = 0; i < data->expected_len; i++)
+        {
+            guchar mask;
+
+            mask = data->expected_mask != NULL ? (guchar) data->expected_mask[i] : 0xFF;
+            mctest_assert_int_eq (hex->value->data[i], (guchar) data->expected_value[i] & mask);
+            mctest_assert_int_eq (hex->mask->data[i], mask);
+        }
+        mctest_assert_int_eq (hex->exact, data->expected_mask == NULL);
+        mc_search__hex_free (hex);
     }
     else
     {
@@ -188,13 +223,12 @@ main (void)
     SRunner *sr;
 
     /* Add new tests here: *************** */
-    mctest_add_parameterized_test (tc_core, test_hex_translate_to_regex,
-                                   test_hex_translate_to_regex_ds);
+    mctest_add_parameterized_test (tc_core, test_hex_parse, test_hex_parse_ds);
     /* *********************************** */
 
     suite_add_tcase (s, tc_core);
     sr = srunner_create (s);
-    srunner_set_log (sr, "hex_translate_to_regex.log");
+    srunner_set_log (sr, "hex_parse.log");
     srunner_run_all (sr, CK_ENV);
     number_failed = srunner_ntests_failed (sr);
     srunner_free (sr);
@@ -0,0 +1,251 @@
+/*
+   libmc - checks for literal search of plain strings
+
+   Copyright (C) 2017
+   Free Software Foundation, Inc.
+
+   This file is part of the Midnight Commander.
+
+   The Midnight Commander is free software: you can redistribute it
+   and/or modify it under the terms of the GNU General Public License as
+   published by the Free Software Foundation, either version 3 of the License,
+   or (at your option) any later version.
+
+   The Midnight Commander is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#define TEST_SUITE_NAME "lib/search/normal"
+
+#include "tests/mctest.h"
+
+#include "lib/strutil.h"
+#include "lib/search.h"
+
+/* --------------------------------------------------------------------------------------------- */
+
+/* @Before */
+static void
+setup (void)
+{
+    str_init_strings (NULL);
+}
+
+/* --------------------------------------------------------------------------------------------- */
+
+/* @After */
+static void
+teardown (void)
+{
+    str_uninit_strings ();
+}
+
+/* --------------------------------------------------------------------------------------------- */
+
+static mc_search_cbret_t
+search_callback (const void *user_data, gsize char_offset, int *current_char)
+{
+    const char *str = (const char *) user_data;
+
+    if (str[char_offset] == '\0')
+        return MC_SEARCH_CB_NOTFOUND;
+
+    *current_char = (unsigned char) str[char_offset];
+    return MC_SEARCH_CB_OK;
+}
+
+/* --------------------------------------------------------------------------------------------- */
+
+/* gives data by small blocks to check matches across block boundaries */
+static mc_search_cbret_t
+search_block_callback (const void *user_data, gsize char_offset, const char **block,
+                       gsize * block_len)
+{
+    const char *str = (const char *) user_data;
+
+    if (char_offset >= strlen (str))
+        return MC_SEARCH_CB_NOTFOUND;
+
+    *block = str + char_offset;
+    *block_len = MIN (strlen (*block), 3);
+    return MC_SEARCH_CB_OK;
+}
+
+/* --------------------------------------------------------------------------------------------- */
+
+/* @DataSource("test_normal_find_ds") */
+/* *INDENT-OFF* */
+static const struct test_normal_find_ds
+{
+    const char *pattern;
+    const char *input_value;
+    gboolean case_sensitive;
+    gboolean whole_words;
+    gboolean expected_found;
+    off_t expected_offset;
+    gsize expected_len;
+} test_normal_find_ds[] =
+{
+    { /* 0. short pattern */
+        "ab", "xxaxabyy", TRUE, FALSE, TRUE, 4, 2
+    },
+    { /* 1. long pattern with repeated prefix */
+        "abcd", "abcabcabd abcd", TRUE, FALSE, TRUE, 10, 4
+    },
+    { /* 2. special symbols of regex are ordinary ones */
+        "a.*(b", "aXb a.*(b", TRUE, FALSE, TRUE, 4, 5
+    },
+    { /* 3. */
+        "abcd", "ABCD", TRUE, FALSE, FALSE, 0, 0
+    },
+    { /* 4. */
+        "abcd", "xABcD", FALSE, FALSE, TRUE, 1, 4
+    },
+    { /* 5. case of non-ASCII letters */
+        "привет", "ааПРИвет", FALSE, FALSE, TRUE, 4, 12
+    },
+    { /* 6. */
+        "foo", "foobar foo_x afoo foo", TRUE, TRUE, TRUE, 18, 3
+    },
+    { /* 7. */
+        "foo", "foobar, FOO!", FALSE, TRUE, TRUE, 8, 3
+    },
+    { /* 8. non-ASCII letter is part of word */
+        "foo", "éfoo foo", TRUE, TRUE, TRUE, 6, 3
+    },
+    { /* 9. pattern is longer than text */
+        "xyz", "xy", FALSE, FALSE, FALSE, 0, 0
+    },
+};
+/* *INDENT-ON* */
+
+/* @Test(dataSource = "test_normal_find_ds") */
+/* *INDENT-OFF* */
+START_PARAMETRIZED_TEST (test_normal_find, test_normal_find_ds)
+/* *INDENT-ON* */
+{
+    /* given */
+    mc_search_t *s;
+    gsize found_len = 0;
+    gboolean found;
+
+    s = mc_search_new (data->pattern, "UTF-8");
+    s->search_type = MC_SEARCH_T_NORMAL;
+    s->is_case_sensitive = data->case_sensitive;
+    s->whole_words = data->whole_words;
+
+    /* when */
+    found = mc_search_run (s, data->input_value, 0, strlen (data->input_value), &found_len);
+
+    /* then */
+    mctest_assert_int_eq (found, data->expected_found);
+    if (found)
+    {
+        mctest_assert_int_eq (s->normal_offset, data->expected_offset);
+        mctest_assert_int_eq (found_len, data->expected_len);
+    }
+    else
+        mctest_assert_int_eq (s->error, MC_SEARCH_E_NOTFOUND);
+
+    /* when: same data is read by callback */
+    mc_search_free (s);
+    s = mc_search_new (data->pattern, "UTF-8");
+    s->search_type = MC_SEARCH_T_NORMAL;
+    s->is_case_sensitive = data->case_sensitive;
+    s->whole_words = data->whole_words;
+    s->search_fn = search_callback;
+    found = mc_search_run (s, data->input_value, 0, strlen (data->input_value), &found_len);
+
+    /* then */
+    mctest_assert_int_eq (found, data->expected_found);
+    if (found)
+    {
+        mctest_assert_int_eq (s->normal_offset, data->expected_offset);
+        mctest_assert_int_eq (found_len, data->expected_len);
+    }
+
+    /* when: same data is read by blocks */
+    s->block_fn = search_block_callback;
+    found = mc_search_run (s, data->input_value, 0, strlen (data->input_value), &found_len);
+
+    /* then */
+    mctest_assert_int_eq (found, data->expected_found);
+    if (found)
+    {
+        mctest_assert_int_eq (s->normal_offset, data->expected_offset);
+        mctest_assert_int_eq (found_len, data->expected_len);
+    }
+
+    mc_search_free (s);
+}
+/* *INDENT-OFF* */
+END_PARAMETRIZED_TEST
+/* *INDENT-ON* */
+
+/* --------------------------------------------------------------------------------------------- */
+
+/* @Test */
+/* *INDENT-OFF* */
+START_TEST (test_normal_find_bounds)
+/* *INDENT-ON* */
+{
+    /* given */
+    static const char str[] = "abc\0abc abc";
+    mc_search_t *s;
+    gsize found_len;
+
+    s = mc_search_new ("abc", "UTF-8");
+    s->search_type = MC_SEARCH_T_NORMAL;
+    s->is_case_sensitive = TRUE;
+
+    /* when, then: search starts at given offset */
+    mctest_assert_int_eq (mc_search_run (s, str, 4, sizeof (str) - 1, &found_len), TRUE);
+    mctest_assert_int_eq (s->normal_offset, 4);
+
+    /* search stops at NUL */
+    mctest_assert_int_eq (mc_search_run (s, str, 1, sizeof (str) - 1, &found_len), FALSE);
+
+    /* search stops at end_search which is inclusive */
+    mctest_assert_int_eq (mc_search_run (s, str, 5, 9, &found_len), FALSE);
+    mctest_assert_int_eq (mc_search_run (s, str, 5, 10, &found_len), TRUE);
+    mctest_assert_int_eq (s->normal_offset, 8);
+
+    mc_search_free (s);
+}
+/* *INDENT-OFF* */
+END_TEST
+/* *INDENT-ON* */
+
+/* --------------------------------------------------------------------------------------------- */
+
+int
+main (void)
+{
+    int number_failed;
+
+    Suite *s = suite_create (TEST_SUITE_NAME);
+    TCase *tc_core = tcase_create ("Core");
+    SRunner *sr;
+
+    tcase_add_checked_fixture (tc_core, setup, teardown);
+
+    /* Add new tests here: *************** */
+    mctest_add_parameterized_test (tc_core, test_normal_find, test_normal_find_ds);
+    tcase_add_test (tc_core, test_normal_find_bounds);
+    /* *********************************** */
+
+    suite_add_tcase (s, tc_core);
+    sr = srunner_create (s);
+    srunner_set_log (sr, "normal_find.log");
+    srunner_run_all (sr, CK_ENV);
+    number_failed = srunner_ntests_failed (sr);
+    srunner_free (sr);
+    return (number_failed == 0) ? EXIT_SUCCESS : EXIT_FAILURE;
+}
+
+/* --------------------------------------------------------------------------------------------- */
@@ -0,0 +1,198 @@
+/*
+   libmc - checks for backward search
+
+   Copyright (C) 2017
+   Free Software Foundation, Inc.
+
+   This file is part of the Midnight Commander.
+
+   The Midnight Commander is free software: you can redistribute it
+   and/or modify it under the terms of the GNU General Public License as
+   published by the Free Software Foundation, either version 3 of the License,
+   or (at your option) any later version.
+
+   The Midnight Commander is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#define TEST_SUITE_NAME "lib/search"
+
+#include "tests/mctest.h"
+
+#include "lib/strutil.h"
+#include "lib/search.h"
+
+/* --------------------------------------------------------------------------------------------- */
+
+/* @Before */
+static void
+setup (void)
+{
+    str_init_strings (NULL);
+}
+
+/* --------------------------------------------------------------------------------------------- */
+
+/* @After */
+static void
+teardown (void)
+{
+    str_uninit_strings ();
+}
+
+/* --------------------------------------------------------------------------------------------- */
+
+/* @DataSource("test_run_backward_ds") */
+/* *INDENT-OFF* */
+static const struct test_run_backward_ds
+{
+    mc_search_type_t type;
+    const char *pattern;
+    const char *input_value;
+    gsize last_start;
+    gboolean expected_found;
+    off_t expected_offset;
+    gsize expected_len;
+} test_run_backward_ds[] =
+{
+    { /* 0. the last one */
+        MC_SEARCH_T_NORMAL, "ab", "ab ab ab", 7, TRUE, 6, 2
+    },
+    { /* 1. match may end after last_start */
+        MC_SEARCH_T_NORMAL, "ab", "ab ab ab", 6, TRUE, 6, 2
+    },
+    { /* 2. */
+        MC_SEARCH_T_NORMAL, "ab", "ab ab ab", 5, TRUE, 3, 2
+    },
+    { /* 3. overlapped matches */
+        MC_SEARCH_T_NORMAL, "aa", "aaaa", 3, TRUE, 2, 2
+    },
+    { /* 4. previous lines; the last match starts at the last 'b' */
+        MC_SEARCH_T_REGEX, "b+", "abbb\nxyz\nc", 9, TRUE, 3, 1
+    },
+    { /* 5. the last match in line is not the first one */
+        MC_SEARCH_T_REGEX, "[0-9]+", "a12 b345 c6\n", 11, TRUE, 10, 1
+    },
+    { /* 6. beginning of line */
+        MC_SEARCH_T_REGEX, "^x", "x1 x2\nx3 x4\n", 11, TRUE, 6, 1
+    },
+    { /* 7. */
+        MC_SEARCH_T_NORMAL, "zz", "ab ab ab", 7, FALSE, 0, 0
+    },
+};
+/* *INDENT-ON* */
+
+/* @Test(dataSource = "test_run_backward_ds") */
+/* *INDENT-OFF* */
+START_PARAMETRIZED_TEST (test_run_backward, test_run_backward_ds)
+/* *INDENT-ON* */
+{
+    /* given */
+    mc_search_t *s;
+    gsize found_len = 0;
+    gboolean found;
+
+    s = mc_search_new (data->pattern, "UTF-8");
+    s->search_type = data->type;
+    s->is_case_sensitive = TRUE;
+
+    /* when */
+    found =
+        mc_search_run_backward (s, data->input_value, 0, data->last_start,
+                                strlen (data->input_value), &found_len);
+
+    /* then */
+    mctest_assert_int_eq (found, data->expected_found);
+    if (found)
+    {
+        mctest_assert_int_eq (s->normal_offset, data->expected_offset);
+        mctest_assert_int_eq (found_len, data->expected_len);
+    }
+    else
+        mctest_assert_int_eq (s->error, MC_SEARCH_E_NOTFOUND);
+
+    mc_search_free (s);
+}
+/* *INDENT-OFF* */
+END_PARAMETRIZED_TEST
+/* *INDENT-ON* */
+
+/* --------------------------------------------------------------------------------------------- */
+
+/* @Test */
+/* *INDENT-OFF* */
+START_TEST (test_run_backward_chunks)
+/* *INDENT-ON* */
+{
+    /* given */
+    const gsize size = 300 * 1000;
+    char *str;
+    mc_search_t *s;
+    gsize found_len, i;
+
+    /* lines of 99 dots; pattern is in the first line, at the end of data and in long line */
+    str = g_malloc (size + 1);
+    for (i = 0; i < size; i++)
+        str[i] = (i % 100 == 99) ? '\n' : '.';
+    str[size] = '\0';
+    memcpy (str + 10, "needle", 6);
+    memcpy (str + size - 10, "needle", 6);
+
+    s = mc_search_new ("needle", "UTF-8");
+    s->search_type = MC_SEARCH_T_NORMAL;
+    s->is_case_sensitive = TRUE;
+
+    /* when, then */
+    mctest_assert_int_eq (mc_search_run_backward (s, str, 0, size - 1, size, &found_len), TRUE);
+    mctest_assert_int_eq (s->normal_offset, size - 10);
+    mctest_assert_int_eq (mc_search_run_backward (s, str, 0, size - 11, size, &found_len), TRUE);
+    mctest_assert_int_eq (s->normal_offset, 10);
+    mctest_assert_int_eq (mc_search_run_backward (s, str, 11, size - 11, size, &found_len), FALSE);
+
+    /* one long line */
+    for (i = 0; i < size; i++)
+        if (str[i] == '\n')
+            str[i] = '.';
+    mctest_assert_int_eq (mc_search_run_backward (s, str, 0, size - 11, size, &found_len), TRUE);
+    mctest_assert_int_eq (s->normal_offset, 10);
+
+    mc_search_free (s);
+    g_free (str);
+}
+/* *INDENT-OFF* */
+END_TEST
+/* *INDENT-ON* */
+
+/* --------------------------------------------------------------------------------------------- */
+
+int
+main (void)
+{
+    int number_failed;
+
+    Suite *s = suite_create (TEST_SUITE_NAME);
+    TCase *tc_core = tcase_create ("Core");
+    SRunner *sr;
+
+    tcase_add_checked_fixture (tc_core, setup, teardown);
+
+    /* Add new tests here: *************** */
+    mctest_add_parameterized_test (tc_core, test_run_backward, test_run_backward_ds);
+    tcase_add_test (tc_core, test_run_backward_chunks);
+    /* *********************************** */
+
+    suite_add_tcase (s, tc_core);
+    sr = srunner_create (s);
+    srunner_set_log (sr, "run_backward.log");
+    srunner_run_all (sr, CK_ENV);
+    number_failed = srunner_ntests_failed (sr);
+    srunner_free (sr);
+    return (number_failed == 0) ? EXIT_SUCCESS : EXIT_FAILURE;
+}
+
+/* --------------------------------------------------------------------------------------------- */
@@ -0,0 +1,247 @@
+/*
+   libmc - checks for multi-line regex search
+
+   Copyright (C) 2017
+   Free Software Foundation, Inc.
+
+   This file is part of the Midnight Commander.
+
+   The Midnight Commander is free software: you can redistribute it
+   and/or modify it under the terms of the GNU General Public License as
+   published by the Free Software Foundation, either version 3 of the License,
+   or (at your option) any later version.
+
+   The Midnight Commander is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#define TEST_SUITE_NAME "lib/search"
+
+#include "tests/mctest.h"
+
+#include "lib/strutil.h"
+#include "lib/search.h"
+
+/* --------------------------------------------------------------------------------------------- */
+
+/* @Before */
+static void
+setup (void)
+{
+    str_init_strings (NULL);
+}
+
+/* --------------------------------------------------------------------------------------------- */
+
+/* @After */
+static void
+teardown (void)
+{
+    str_uninit_strings ();
+}
+
+/* --------------------------------------------------------------------------------------------- */
+
+static mc_search_t *
+multiline_search_new (const char *pattern)
+{
+    mc_search_t *s;
+
+    s = mc_search_new (pattern, "UTF-8");
+    s->search_type = MC_SEARCH_T_REGEX;
+    s->is_case_sensitive = TRUE;
+    s->multiline = TRUE;
+
+    return s;
+}
+
+/* --------------------------------------------------------------------------------------------- */
+
+/* @DataSource("test_run_multiline_ds") */
+/* *INDENT-OFF* */
+static const struct test_run_multiline_ds
+{
+    const char *pattern;
+    const char *input_value;
+    gsize start;
+    gboolean expected_found;
+    off_t expected_offset;
+    gsize expected_len;
+} test_run_multiline_ds[] =
+{
+    { /* 0. match across lines */
+        "o\\nb", "foo\nbar baz\n", 0, TRUE, 2, 3
+    },
+    { /* 1. '^' and '$' match at every line */
+        "^bar", "foo\nbar baz\n", 0, TRUE, 4, 3
+    },
+    { /* 2. */
+        "z$", "foo\nbar baz\nqux", 0, TRUE, 10, 1
+    },
+    { /* 3. empty line */
+        "\\n^$\\n", "foo\nbar\n\nbaz", 0, TRUE, 7, 2
+    },
+    { /* 4. several lines */
+        "bar[a-z\\s]+qux", "foo\nbar\nbaz\nqux\n", 0, TRUE, 4, 11
+    },
+    { /* 5. search from the middle */
+        "[a-z]+\\n[a-z]+", "foo\nbar\nbaz", 5, TRUE, 5, 6
+    },
+    { /* 6. '.' doesn't match newline */
+        "foo.bar", "foo\nbar", 0, FALSE, 0, 0
+    },
+};
+/* *INDENT-ON* */
+
+/* @Test(dataSource = "test_run_multiline_ds") */
+/* *INDENT-OFF* */
+START_PARAMETRIZED_TEST (test_run_multiline, test_run_multiline_ds)
+/* *INDENT-ON* */
+{
+    /* given */
+    mc_search_t *s;
+    gsize found_len = 0;
+    gboolean found;
+
+    s = multiline_search_new (data->pattern);
+
+    /* when */
+    found =
+        mc_search_run (s, data->input_value, data->start, strlen (data->input_value), &found_len);
+
+    /* then */
+    mctest_assert_int_eq (found, data->expected_found);
+    if (found)
+    {
+        mctest_assert_int_eq (s->normal_offset, data->expected_offset);
+        mctest_assert_int_eq (found_len, data->expected_len);
+    }
+    else
+        mctest_assert_int_eq (s->error, MC_SEARCH_E_NOTFOUND);
+
+    mc_search_free (s);
+}
+/* *INDENT-OFF* */
+END_PARAMETRIZED_TEST
+/* *INDENT-ON* */
+
+/* --------------------------------------------------------------------------------------------- */
+
+/* @Test */
+/* *INDENT-OFF* */
+START_TEST (test_run_multiline_long_match)
+/* *INDENT-ON* */
+{
+    /* given */
+    const gsize size = 700 * 1000;
+    char *str;
+    mc_search_t *s;
+    gsize found_len, i;
+
+    /* match is much longer than the initial window */
+    str = g_malloc (size + 1);
+    for (i = 0; i < size; i++)
+        str[i] = (i % 37 == 36) ? '\n' : 'a' + (i * 7 % 26);
+    str[size] = '\0';
+    memcpy (str + 5000, "START", 5);
+    memcpy (str + 300000, "STOP", 4);
+    memcpy (str + 650000, "xx\nyy", 5);
+
+    s = multiline_search_new ("START[^S]*STOP");
+
+    /* when, then */
+    mctest_assert_int_eq (mc_search_run (s, str, 0, size, &found_len), TRUE);
+    mctest_assert_int_eq (s->normal_offset, 5000);
+    mctest_assert_int_eq (found_len, 300000 + 4 - 5000);
+    mctest_assert_int_eq (mc_search_run (s, str, 5001, size, &found_len), FALSE);
+    mc_search_free (s);
+
+    /* match far after the start of search */
+    s = multiline_search_new ("xx\\nyy");
+    mctest_assert_int_eq (mc_search_run (s, str, 0, size, &found_len), TRUE);
+    mctest_assert_int_eq (s->normal_offset, 650000);
+    mctest_assert_int_eq (mc_search_run_backward (s, str, 0, size - 1, size, &found_len), TRUE);
+    mctest_assert_int_eq (s->normal_offset, 650000);
+    mctest_assert_int_eq (mc_search_run_backward (s, str, 0, 649999, size, &found_len), FALSE);
+    mc_search_free (s);
+
+    g_free (str);
+}
+/* *INDENT-OFF* */
+END_TEST
+/* *INDENT-ON* */
+
+/* --------------------------------------------------------------------------------------------- */
+
+/* @Test */
+/* *INDENT-OFF* */
+START_TEST (test_run_first_line_of_string)
+/* *INDENT-ON* */
+{
+    /* given */
+    const char *str = "foo\nbar baz\nqux\n";
+    const char *fname = "a\nb.c";
+    mc_search_t *s;
+    gsize found_len;
+
+    /* without multi-line mode forward search in string stops at the end of line */
+    s = mc_search_new ("ba+z", "UTF-8");
+    s->search_type = MC_SEARCH_T_REGEX;
+
+    /* when, then */
+    mctest_assert_int_eq (mc_search_run (s, str, 0, strlen (str), &found_len), FALSE);
+    mctest_assert_int_eq (mc_search_run (s, str, 4, strlen (str), &found_len), TRUE);
+    mctest_assert_int_eq (s->normal_offset, 8);
+    mctest_assert_int_eq (found_len, 3);
+    mctest_assert_int_eq (mc_search_run (s, str, 9, strlen (str), &found_len), FALSE);
+    mc_search_free (s);
+
+    /* file name with newline: other lines of it don't match filter */
+    s = mc_search_new ("b*", "UTF-8");
+    s->search_type = MC_SEARCH_T_GLOB;
+    mctest_assert_int_eq (mc_search_run (s, fname, 0, strlen (fname), NULL), FALSE);
+    mc_search_free (s);
+
+    s = mc_search_new ("a*", "UTF-8");
+    s->search_type = MC_SEARCH_T_GLOB;
+    mctest_assert_int_eq (mc_search_run (s, fname, 0, strlen (fname), NULL), TRUE);
+    mc_search_free (s);
+}
+/* *INDENT-OFF* */
+END_TEST
+/* *INDENT-ON* */
+
+/* --------------------------------------------------------------------------------------------- */
+
+int
+main (void)
+{
+    int number_failed;
+
+    Suite *s = suite_create (TEST_SUITE_NAME);
+    TCase *tc_core = tcase_create ("Core");
+    SRunner *sr;
+
+    tcase_add_checked_fixture (tc_core, setup, teardown);
+
+    /* Add new tests here: *************** */
+    mctest_add_parameterized_test (tc_core, test_run_multiline, test_run_multiline_ds);
+    tcase_add_test (tc_core, test_run_multiline_long_match);
+    tcase_add_test (tc_core, test_run_first_line_of_string);
+    /* *********************************** */
+
+    suite_add_tcase (s, tc_core);
+    sr = srunner_create (s);
+    srunner_set_log (sr, "run_multiline.log");
+    srunner_run_all (sr, CK_ENV);
+    number_failed = srunner_ntests_failed (sr);
+    srunner_free (sr);
+    return (number_failed == 0) ? EXIT_SUCCESS : EXIT_FAILURE;
+}
+
+/* --------------------------------------------------------------------------------------------- */
@@ -0,0 +1,604 @@
+/*
+   libmc - benchmark of search engines
+
+   Copyright (C) 2017
+   Free Software Foundation, Inc.
+
+   This file is part of the Midnight Commander.
+
+   The Midnight Commander is free software: you can redistribute it
+   and/or modify it under the terms of the GNU General Public License as
+   published by the Free Software Foundation, either version 3 of the License,
+   or (at your option) any later version.
+
+   The Midnight Commander is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/*
+ * Measures throughput of mc_search_run() and mc_search_run_backward() for each search type
+ * on several kinds of data. Data is given as string, by callbacks from memory and by callbacks
+ * which read a file by pages as the viewer does. Results of all modes must be the same.
+ *
+ * Forward regex and glob search in string stops at the end of the first line, so in string mode
+ * they are run line by line, as Find does.
+ *
+ * Output is tab-separated: one line per measurement, lines of comments start with '#'.
+ * If results of a previous run are given by --baseline, a measurement which is slower than
+ * baseline by more than --tolerance percents is reported as regression.
+ *
+ * Exit code is 0 if there are no errors and regressions, 1 otherwise.
+ */
+
+#include <config.h>
+
+#include <errno.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "lib/global.h"
+#include "lib/strutil.h"
+#include "lib/search.h"
+
+/*** file scope macro definitions ****************************************************************/
+
+/* page size of file provider, like the viewer */
+#define BENCH_PAGE_SIZE 8192
+
+/* distance of the match from the end (forward search) or from the beginning (backward search) */
+#define BENCH_MATCH_DISTANCE 200
+
+/*** file scope type declarations ****************************************************************/
+
+typedef enum
+{
+    CORPUS_SHORT_LINES,
+    CORPUS_LONG_LINES,
+    CORPUS_UTF8,
+    CORPUS_BINARY
+} corpus_kind_t;
+
+typedef enum
+{
+    MODE_STRING,
+    MODE_CALLBACK,
+    MODE_FILE
+} data_mode_t;
+
+typedef struct
+{
+    corpus_kind_t kind;
+    const char *name;
+    char *data;
+    gsize size;
+    char *path;                 /* the same data in file */
+    int fd;
+    /* the match planted into data */
+    const char *needle;
+    const char *needle_upper;
+    gsize planted_pos;
+    gsize planted_len;
+} corpus_t;
+
+/* data for callbacks */
+typedef struct
+{
+    const char *data;           /* memory */
+    gsize size;
+    int fd;                     /* file */
+    off_t page_offset;
+    gsize page_len;
+    char page[BENCH_PAGE_SIZE];
+} provider_t;
+
+/* result of one search, to compare modes */
+typedef struct
+{
+    gboolean found;
+    off_t offset;
+    gsize len;
+} result_t;
+
+/*** file scope variables ************************************************************************/
+
+static const char *const type_names[] = { "normal", "regex", "hex", "glob" };
+
+static const char *const mode_names[] = { "string", "callback", "file" };
+
+static const char *const ascii_words[] = {
+    "the", "quick", "brown", "fox", "jumps", "over", "lazy", "dog", "search", "engine",
+    "midnight", "commander", "buffer", "line", "pattern", "offset", "file", "viewer"
+};
+
+static const char *const utf8_words[] = {
+    "съешь", "же", "ещё", "этих", "мягких", "французских", "булок", "да", "выпей", "чаю",
+    "γαζέες", "καὶ", "μυρτιὲς", "δὲν", "θὰ", "βρῶ", "日本語", "テキスト", "検索"
+};
+
+static int opt_size = 8;
+static int opt_repeat = 3;
+static char *opt_baseline = NULL;
+static int opt_tolerance = 25;
+
+/* *INDENT-OFF* */
+static GOptionEntry bench_options[] =
+{
+    { "size", 's', 0, G_OPTION_ARG_INT, &opt_size, "Size of each corpus in megabytes", "MB" },
+    { "repeat", 'r', 0, G_OPTION_ARG_INT, &opt_repeat, "Repeat each search, the best time is taken", "N" },
+    { "baseline", 'b', 0, G_OPTION_ARG_FILENAME, &opt_baseline, "Compare with results of previous run", "FILE" },
+    { "tolerance", 't', 0, G_OPTION_ARG_INT, &opt_tolerance, "Allowed slowdown in percents", "PCT" },
+    { NULL, 0, 0, 0, NULL, NULL, NULL }
+};
+/* *INDENT-ON* */
+
+static GHashTable *baseline = NULL;
+static int errors = 0;
+static int regressions = 0;
+
+/*** file scope functions ************************************************************************/
+/* --------------------------------------------------------------------------------------------- */
+
+static void
+corpus_fill_text (GString * s, const char *const *words, size_t num, gsize size, gsize line_len)
+{
+    gsize line_start = 0;
+
+    while (s->len < size)
+    {
+        g_string_append (s, words[g_random_int_range (0, num)]);
+
+        if (s->len - line_start >= line_len)
+        {
+            g_string_append_c (s, '\n');
+            line_start = s->len;
+        }
+        else
+            g_string_append_c (s, ' ');
+    }
+}
+
+/* --------------------------------------------------------------------------------------------- */
+
+static void
+corpus_init (corpus_t * c, corpus_kind_t kind, gsize size)
+{
+    GString *s;
+
+    memset (c, 0, sizeof (*c));
+    c->kind = kind;
+    c->needle = "needle42";
+    c->needle_upper = "NEEDLE42";
+
+    s = g_string_sized_new (size + 64);
+
+    switch (kind)
+    {
+    case CORPUS_SHORT_LINES:
+        c->name = "short-lines";
+        corpus_fill_text (s, ascii_words, G_N_ELEMENTS (ascii_words), size, 40);
+        break;
+    case CORPUS_LONG_LINES:
+        c->name = "long-lines";
+        corpus_fill_text (s, ascii_words, G_N_ELEMENTS (ascii_words), size, 10000);
+        break;
+    case CORPUS_UTF8:
+        c->name = "utf8";
+        c->needle = "иголка42";
+        c->needle_upper = "ИГОЛКА42";
+        corpus_fill_text (s, utf8_words, G_N_ELEMENTS (utf8_words), size, 80);
+        break;
+    case CORPUS_BINARY:
+    default:
+        c->name = "binary";
+        /* no NULs: string mode stops at NUL */
+        while (s->len < size)
+            g_string_append_c (s, (char) g_random_int_range (1, 256));
+        break;
+    }
+
+    g_string_truncate (s, size);
+    c->size = s->len;
+    c->data = g_string_free (s, FALSE);
+
+    c->fd = g_file_open_tmp ("mc-search-bench-XXXXXX", &c->path, NULL);
+    if (c->fd == -1 || write (c->fd, c->data, c->size) != (ssize_t) c->size)
+    {
+        fprintf (stderr, "Cannot write temporary file: %s\n", g_strerror (errno));
+        exit (EXIT_FAILURE);
+    }
+}
+
+/* --------------------------------------------------------------------------------------------- */
+
+static void
+corpus_free (corpus_t * c)
+{
+    close (c->fd);
+    unlink (c->path);
+    g_free (c->path);
+    g_free (c->data);
+}
+
+/* --------------------------------------------------------------------------------------------- */
+/**
+ * Put the match into data and file. Previous match is removed.
+ *
+ * @return offset of the match
+ */
+
+static off_t
+corpus_plant (corpus_t * c, const char *needle, gboolean backward)
+{
+    gsize pos, len;
+
+    len = strlen (needle);
+    pos = backward ? BENCH_MATCH_DISTANCE : c->size - BENCH_MATCH_DISTANCE;
+
+    /* replace previous match by letters which are not in any needle */
+    memset (c->data + c->planted_pos, 'z', c->planted_len);
+
+    /* keep text valid UTF-8: replace whole characters */
+    if (c->kind != CORPUS_BINARY)
+    {
+        while (pos > 0 && ((guchar) c->data[pos] & 0xC0) == 0x80)
+            pos--;
+        memcpy (c->data + pos, needle, len);
+        while (((guchar) c->data[pos + len] & 0xC0) == 0x80)
+            c->data[pos + len++] = 'z';
+    }
+    else
+        memcpy (c->data + pos, needle, len);
+
+    if (pwrite (c->fd, c->data + c->planted_pos, c->planted_len, c->planted_pos) < 0
+        || pwrite (c->fd, c->data + pos, len, pos) < 0)
+    {
+        fprintf (stderr, "Cannot write %s: %s\n", c->path, g_strerror (errno));
+        exit (EXIT_FAILURE);
+    }
+
+    c->planted_pos = pos;
+    c->planted_len = len;
+
+    return (off_t) pos;
+}
+
+/* --------------------------------------------------------------------------------------------- */
+
+static const char *
+provider_page (provider_t * p, gsize offset, gsize * len)
+{
+    if (p->fd == -1)
+    {
+        if (offset >= p->size)
+            return NULL;
+        *len = p->size - offset;
+        return p->data + offset;
+    }
+
+    if ((off_t) offset < p->page_offset || (off_t) offset >= p->page_offset + (off_t) p->page_len)
+    {
+        ssize_t r;
+
+        p->page_offset = (off_t) (offset - offset % BENCH_PAGE_SIZE);
+        r = pread (p->fd, p->page, BENCH_PAGE_SIZE, p->page_offset);
+        p->page_len = r > 0 ? (gsize) r : 0;
+        if ((off_t) offset >= p->page_offset + (off_t) p->page_len)
+            return NULL;
+    }
+
+    *len = p->page_offset + p->page_len - offset;
+    return p->page + (offset - p->page_offset);
+}
+
+/* --------------------------------------------------------------------------------------------- */
+
+static mc_search_cbret_t
+provider_char (const void *user_data, gsize char_offset, int *current_char)
+{
+    gsize len;
+    const char *p;
+
+    p = provider_page ((provider_t *) user_data, char_offset, &len);
+    if (p == NULL)
+        return MC_SEARCH_CB_NOTFOUND;
+
+    *current_char = (unsigned char) *p;
+    return MC_SEARCH_CB_OK;
+}
+
+/* --------------------------------------------------------------------------------------------- */
+
+static mc_search_cbret_t
+provider_block (const void *user_data, gsize char_offset, const char **block, gsize * block_len)
+{
+    *block = provider_page ((provider_t *) user_data, char_offset, block_len);
+    return (*block != NULL) ? MC_SEARCH_CB_OK : MC_SEARCH_CB_NOTFOUND;
+}
+
+/* --------------------------------------------------------------------------------------------- */
+
+static char *
+make_pattern (mc_search_type_t type, const char *needle)
+{
+    GString *s;
+    const char *p;
+
+    switch (type)
+    {
+    case MC_SEARCH_T_REGEX:
+        /* "needle42" -> "needle[0-9]+" */
+        return g_strdup_printf ("%.*s[0-9]+", (int) (strlen (needle) - 2), needle);
+    case MC_SEARCH_T_GLOB:
+        /* "needle42" -> "needle?2" */
+        return g_strdup_printf ("%.*s?2", (int) (strlen (needle) - 2), needle);
+    case MC_SEARCH_T_HEX:
+        s = g_string_new ("");
+        for (p = needle; *p != '\0'; p++)
+            g_string_append_printf (s, "%02x ", (unsigned char) *p);
+        return g_string_free (s, FALSE);
+    default:
+        return g_strdup (needle);
+    }
+}
+
+/* --------------------------------------------------------------------------------------------- */
+
+static gboolean
+run_once (mc_search_t * s, corpus_t * c, data_mode_t mode, gboolean backward, provider_t * p,
+          result_t * r)
+{
+    const void *user_data = c->data;
+    gsize found_len = 0;
+
+    s->search_fn = NULL;
+    s->block_fn = NULL;
+
+    if (mode != MODE_STRING)
+    {
+        p->data = c->data;
+        p->size = c->size;
+        p->page_offset = 0;
+        p->page_len = 0;
+        s->search_fn = provider_char;
+        if (mode == MODE_FILE)
+            s->block_fn = provider_block;
+        user_data = p;
+    }
+
+    if (backward)
+        r->found = mc_search_run_backward (s, user_data, 0, c->size - 1, c->size - 1, &found_len);
+    else if (mode == MODE_STRING
+             && (s->search_type == MC_SEARCH_T_REGEX || s->search_type == MC_SEARCH_T_GLOB))
+    {
+        gsize start = 0;
+
+        r->found = FALSE;
+
+        while (start < c->size)
+        {
+            const char *eol;
+
+            r->found = mc_search_run (s, user_data, start, c->size - 1, &found_len);
+            if (r->found || s->error != MC_SEARCH_E_NOTFOUND)
+                break;
+
+            eol = memchr (c->data + start, '\n', c->size - start);
+            start = eol != NULL ? (gsize) (eol - c->data) + 1 : c->size;
+        }
+    }
+    else
+        r->found = mc_search_run (s, user_data, 0, c->size - 1, &found_len);
+
+    r->offset = r->found ? s->normal_offset : -1;
+    r->len = r->found ? found_len : 0;
+
+    return r->found || s->error == MC_SEARCH_E_NOTFOUND;
+}
+
+/* --------------------------------------------------------------------------------------------- */
+
+static void
+check_baseline (const char *key, double mb_per_s)
+{
+    const double *old;
+
+    if (baseline == NULL)
+        return;
+
+    old = g_hash_table_lookup (baseline, key);
+    if (old != NULL && mb_per_s < *old * (100 - opt_tolerance) / 100)
+    {
+        fprintf (stderr, "REGRESSION\t%s\t%.1f MB/s, baseline %.1f MB/s\n", key, mb_per_s, *old);
+        regressions++;
+    }
+}
+
+/* --------------------------------------------------------------------------------------------- */
+
+static void
+bench (corpus_t * c, mc_search_type_t type, gboolean case_sens, gboolean backward)
+{
+    const char *needle;
+    char *pattern;
+    off_t planted;
+    provider_t p;
+    result_t first = { FALSE, -1, 0 };
+    data_mode_t mode;
+
+    needle = case_sens ? c->needle : c->needle_upper;
+    planted = corpus_plant (c, needle, backward);
+    pattern = make_pattern (type, c->needle);
+
+    for (mode = MODE_STRING; mode <= MODE_FILE; mode++)
+    {
+        mc_search_t *s;
+        gint64 best = G_MAXINT64;
+        result_t r = { FALSE, -1, 0 };
+        char *key;
+        double mb_per_s;
+        int i;
+
+        s = mc_search_new (pattern, "UTF-8");
+        s->search_type = type;
+        s->is_case_sensitive = case_sens;
+
+        /* memory callbacks don't use the file */
+        p.fd = mode == MODE_FILE ? c->fd : -1;
+
+        for (i = 0; i < MAX (opt_repeat, 1); i++)
+        {
+            gint64 t;
+
+            t = g_get_monotonic_time ();
+            if (!run_once (s, c, mode, backward, &p, &r))
+            {
+                fprintf (stderr, "ERROR\t%s\t%s\t%s: %s\n", type_names[type], c->name,
+                         mode_names[mode], s->error_str != NULL ? s->error_str : "search failed");
+                errors++;
+                break;
+            }
+            best = MIN (best, g_get_monotonic_time () - t);
+        }
+
+        mc_search_free (s);
+
+        if (r.offset != planted)
+        {
+            fprintf (stderr, "ERROR\t%s\t%s\t%s\t%s: match at %jd, expected at %jd\n",
+                     type_names[type], c->name, mode_names[mode],
+                     backward ? "backward" : "forward", (intmax_t) r.offset, (intmax_t) planted);
+            errors++;
+        }
+
+        if (mode == MODE_STRING)
+            first = r;
+        else if (r.found != first.found || r.offset != first.offset || r.len != first.len)
+        {
+            fprintf (stderr, "ERROR\t%s\t%s\t%s: result differs from string mode\n",
+                     type_names[type], c->name, mode_names[mode]);
+            errors++;
+        }
+
+        best = MAX (best, 1);
+        mb_per_s = (double) c->size / best;     /* bytes per microsecond */
+
+        key = g_strdup_printf ("%s\t%s\t%s\t%s\t%s", type_names[type], c->name, mode_names[mode],
+                               backward ? "backward" : "forward",
+                               case_sens ? "case" : "nocase");
+        printf ("%s\t%zu\t%" G_GINT64_FORMAT "\t%.1f\n", key, c->size, best, mb_per_s);
+        fflush (stdout);
+        check_baseline (key, mb_per_s);
+        g_free (key);
+    }
+
+    g_free (pattern);
+}
+
+/* --------------------------------------------------------------------------------------------- */
+
+static void
+load_baseline (const char *path)
+{
+    char *contents;
+    char **lines, **l;
+    GError *error = NULL;
+
+    if (!g_file_get_contents (path, &contents, NULL, &error))
+    {
+        fprintf (stderr, "Cannot read baseline: %s\n", error->message);
+        exit (EXIT_FAILURE);
+    }
+
+    baseline = g_hash_table_new_full (g_str_hash, g_str_equal, g_free, g_free);
+
+    lines = g_strsplit (contents, "\n", -1);
+    for (l = lines; *l != NULL; l++)
+    {
+        char **fields;
+
+        if (**l == '#' || **l == '\0')
+            continue;
+
+        fields = g_strsplit (*l, "\t", -1);
+        if (g_strv_length (fields) == 8)
+        {
+            double *v;
+
+            v = g_new (double, 1);
+            *v = g_ascii_strtod (fields[7], NULL);
+            g_hash_table_insert (baseline,
+                                 g_strjoin ("\t", fields[0], fields[1], fields[2], fields[3],
+                                            fields[4], (char *) NULL), v);
+        }
+        g_strfreev (fields);
+    }
+
+    g_strfreev (lines);
+    g_free (contents);
+}
+
+/* --------------------------------------------------------------------------------------------- */
+
+int
+main (int argc, char *argv[])
+{
+    GOptionContext *context;
+    GError *error = NULL;
+    corpus_kind_t kind;
+
+    context = g_option_context_new ("- benchmark of search engines");
+    g_option_context_add_main_entries (context, bench_options, NULL);
+    if (!g_option_context_parse (context, &argc, &argv, &error))
+    {
+        fprintf (stderr, "%s\n", error->message);
+        return EXIT_FAILURE;
+    }
+    g_option_context_free (context);
+
+    if (opt_baseline != NULL)
+        load_baseline (opt_baseline);
+
+    str_init_strings (NULL);
+    g_random_set_seed (42);
+
+    printf ("# type\tcorpus\tmode\tdirection\tcase\tbytes\tusec\tmb_per_s\n");
+
+    for (kind = CORPUS_SHORT_LINES; kind <= CORPUS_BINARY; kind++)
+    {
+        corpus_t c;
+        mc_search_type_t type;
+
+        corpus_init (&c, kind, (gsize) MAX (opt_size, 1) * 1024 * 1024);
+
+        for (type = MC_SEARCH_T_NORMAL; type <= MC_SEARCH_T_GLOB; type++)
+        {
+            bench (&c, type, TRUE, FALSE);
+            bench (&c, type, TRUE, TRUE);
+
+            /* hex search is case-insensitive in quoted text only */
+            if (type != MC_SEARCH_T_HEX && kind != CORPUS_BINARY)
+                bench (&c, type, FALSE, FALSE);
+        }
+
+        corpus_free (&c);
+    }
+
+    str_uninit_strings ();
+
+    if (baseline != NULL)
+        g_hash_table_destroy (baseline);
+
+    printf ("# errors: %d, regressions: %d\n", errors, regressions);
+
+    return (errors == 0 && regressions == 0) ? EXIT_SUCCESS : EXIT_FAILURE;
+}
+
+/* --------------------------------------------------------------------------------------------- */
@@ -0,0 +1,146 @@
+/*
+   lib - tests for shared handler of SIGBUS
+
+   Copyright (C) 2017
+   Free Software Foundation, Inc.
+
+   This file is part of the Midnight Commander.
+
+   The Midnight Commander is free software: you can redistribute it
+   and/or modify it under the terms of the GNU General Public License as
+   published by the Free Software Foundation, either version 3 of the License,
+   or (at your option) any later version.
+
+   The Midnight Commander is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#define TEST_SUITE_NAME "/lib"
+
+#include "tests/mctest.h"
+
+#include <signal.h>
+#include <string.h>
+
+#include "lib/sigbus.h"
+
+static volatile sig_atomic_t previous_called;
+static volatile sig_atomic_t first_called;
+static volatile sig_atomic_t second_called;
+static volatile sig_atomic_t second_handles;
+
+/* --------------------------------------------------------------------------------------------- */
+
+/* @Mock */
+static void
+previous_handler (int sig)
+{
+    (void) sig;
+
+    previous_called++;
+}
+
+/* --------------------------------------------------------------------------------------------- */
+
+/* @Mock */
+static gboolean
+first_handler (void *addr, void *data)
+{
+    (void) addr;
+    (void) data;
+
+    first_called++;
+    return FALSE;
+}
+
+/* --------------------------------------------------------------------------------------------- */
+
+/* @Mock */
+static gboolean
+second_handler (void *addr, void *data)
+{
+    (void) addr;
+
+    mctest_assert_str_eq ((const char *) data, "second");
+    second_called++;
+    return second_handles != 0;
+}
+
+/* --------------------------------------------------------------------------------------------- */
+
+/* @Test */
+/* *INDENT-OFF* */
+START_TEST (test_sigbus_handlers)
+/* *INDENT-ON* */
+{
+    /* given */
+    struct sigaction sa;
+
+    memset (&sa, 0, sizeof (sa));
+    sa.sa_handler = previous_handler;
+    sigemptyset (&sa.sa_mask);
+    sigaction (SIGBUS, &sa, NULL);
+
+    mctest_assert_true (mc_sigbus_add_handler (first_handler, NULL));
+    mctest_assert_true (mc_sigbus_add_handler (second_handler, (void *) "second"));
+
+    /* when: fault isn't handled by added handlers */
+    raise (SIGBUS);
+
+    /* then: it is passed to the previous signal handler */
+    mctest_assert_int_eq (first_called, 1);
+    mctest_assert_int_eq (second_called, 1);
+    mctest_assert_int_eq (previous_called, 1);
+
+    /* when: fault is handled */
+    second_handles = 1;
+    raise (SIGBUS);
+
+    /* then: handlers are called in order of adding, the previous one isn't called */
+    mctest_assert_int_eq (first_called, 2);
+    mctest_assert_int_eq (second_called, 2);
+    mctest_assert_int_eq (previous_called, 1);
+
+    /* when: fault isn't handled again */
+    second_handles = 0;
+    raise (SIGBUS);
+
+    /* then: signal handler is kept installed */
+    mctest_assert_int_eq (first_called, 3);
+    mctest_assert_int_eq (second_called, 3);
+    mctest_assert_int_eq (previous_called, 2);
+}
+/* *INDENT-OFF* */
+END_TEST
+/* *INDENT-ON* */
+
+/* --------------------------------------------------------------------------------------------- */
+
+int
+main (void)
+{
+    int number_failed;
+
+    Suite *s = suite_create (TEST_SUITE_NAME);
+    TCase *tc_core = tcase_create ("Core");
+    SRunner *sr;
+
+    /* Add new tests here: *************** */
+    tcase_add_test (tc_core, test_sigbus_handlers);
+    /* *********************************** */
+
+    suite_add_tcase (s, tc_core);
+    sr = srunner_create (s);
+    srunner_set_log (sr, "sigbus.log");
+    srunner_run_all (sr, CK_ENV);
+    number_failed = srunner_ntests_failed (sr);
+    srunner_free (sr);
+    return (number_failed == 0) ? EXIT_SUCCESS : EXIT_FAILURE;
+}
+
+/* --------------------------------------------------------------------------------------------- */
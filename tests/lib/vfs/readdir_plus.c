@@ -0,0 +1,205 @@
+/*
+   lib/vfs - test readdir_plus method of VFS classes
+
+   Copyright (C) 2017
+   Free Software Foundation, Inc.
+
+   This file is part of the Midnight Commander.
+
+   The Midnight Commander is free software: you can redistribute it
+   and/or modify it under the terms of the GNU General Public License as
+   published by the Free Software Foundation, either version 3 of the License,
+   or (at your option) any later version.
+
+   The Midnight Commander is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#define TEST_SUITE_NAME "/lib/vfs"
+
+#include "tests/mctest.h"
+
+#include <errno.h>
+
+#include "lib/global.h"
+#include "lib/strutil.h"
+#include "lib/vfs/xdirentry.h"
+
+#include "src/vfs/local/local.c"
+
+static struct vfs_s_subclass test_subclass1, test_subclass2;
+static struct vfs_class vfs_test_ops1, vfs_test_ops2;
+
+/* directory handle of class with own opendir(), like sftpfs */
+typedef struct
+{
+    int index;
+} test_dir_t;
+
+static const char *test_dir_names[] = { "first", "second", NULL };
+
+/* --------------------------------------------------------------------------------------------- */
+
+/* @Mock */
+static void *
+test_opendir (const vfs_path_t * vpath)
+{
+    (void) vpath;
+
+    return g_new0 (test_dir_t, 1);
+}
+
+/* --------------------------------------------------------------------------------------------- */
+
+/* @Mock */
+static void *
+test_readdir (void *data)
+{
+    static union vfs_dirent dir;
+    test_dir_t *d = (test_dir_t *) data;
+
+    if (test_dir_names[d->index] == NULL)
+        return NULL;
+
+    g_strlcpy (dir.dent.d_name, test_dir_names[d->index++], MC_MAXPATHLEN);
+
+    return &dir;
+}
+
+/* --------------------------------------------------------------------------------------------- */
+
+/* @Mock */
+static int
+test_closedir (void *data)
+{
+    g_free (data);
+
+    return 0;
+}
+
+/* --------------------------------------------------------------------------------------------- */
+
+/* @Before */
+static void
+setup (void)
+{
+    str_init_strings (NULL);
+
+    vfs_init ();
+    init_localfs ();
+    vfs_setup_work_dir ();
+
+    /* class keeps directory methods of direntry framework */
+    vfs_s_init_class (&vfs_test_ops1, &test_subclass1);
+    vfs_test_ops1.name = "testfs1";
+    vfs_test_ops1.flags = VFSF_NOLINKS;
+    vfs_test_ops1.prefix = "test1";
+    vfs_register_class (&vfs_test_ops1);
+
+    /* class has own directory handles */
+    vfs_s_init_class (&vfs_test_ops2, &test_subclass2);
+    vfs_test_ops2.name = "testfs2";
+    vfs_test_ops2.flags = VFSF_NOLINKS;
+    vfs_test_ops2.prefix = "test2";
+    vfs_test_ops2.opendir = test_opendir;
+    vfs_test_ops2.readdir = test_readdir;
+    vfs_test_ops2.closedir = test_closedir;
+    vfs_register_class (&vfs_test_ops2);
+}
+
+/* --------------------------------------------------------------------------------------------- */
+
+/* @After */
+static void
+teardown (void)
+{
+    vfs_shut ();
+    str_uninit_strings ();
+}
+
+/* --------------------------------------------------------------------------------------------- */
+
+/* @Test */
+/* *INDENT-OFF* */
+START_TEST (test_readdir_plus_direntry)
+/* *INDENT-ON* */
+{
+    /* given, when, then */
+    mctest_assert_not_null (vfs_test_ops1.readdir_plus);
+}
+/* *INDENT-OFF* */
+END_TEST
+/* *INDENT-ON* */
+
+/* --------------------------------------------------------------------------------------------- */
+
+/* @Test */
+/* *INDENT-OFF* */
+START_TEST (test_readdir_plus_own_opendir)
+/* *INDENT-ON* */
+{
+    vfs_path_t *vpath;
+    DIR *dirp;
+    vfs_dirent_plus_t entries[4];
+    struct dirent *dp;
+
+    /* given */
+    mctest_assert_null (vfs_test_ops2.readdir_plus);
+    vpath = vfs_path_from_str ("/test2://dir");
+
+    /* when */
+    dirp = mc_opendir (vpath);
+    mctest_assert_not_null (dirp);
+
+    /* then */
+    mctest_assert_int_eq (mc_readdir_plus (dirp, entries, G_N_ELEMENTS (entries)), -1);
+    mctest_assert_int_eq (errno, E_NOTSUPP);
+
+    dp = mc_readdir (dirp);
+    mctest_assert_not_null (dp);
+    mctest_assert_str_eq (dp->d_name, "first");
+    dp = mc_readdir (dirp);
+    mctest_assert_not_null (dp);
+    mctest_assert_str_eq (dp->d_name, "second");
+    mctest_assert_null (mc_readdir (dirp));
+
+    mc_closedir (dirp);
+    vfs_path_free (vpath);
+}
+/* *INDENT-OFF* */
+END_TEST
+/* *INDENT-ON* */
+
+/* --------------------------------------------------------------------------------------------- */
+
+int
+main (void)
+{
+    int number_failed;
+
+    Suite *s = suite_create (TEST_SUITE_NAME);
+    TCase *tc_core = tcase_create ("Core");
+    SRunner *sr;
+
+    tcase_add_checked_fixture (tc_core, setup, teardown);
+
+    /* Add new tests here: *************** */
+    tcase_add_test (tc_core, test_readdir_plus_direntry);
+    tcase_add_test (tc_core, test_readdir_plus_own_opendir);
+    /* *********************************** */
+
+    suite_add_tcase (s, tc_core);
+    sr = srunner_create (s);
+    srunner_set_log (sr, "readdir_plus.log");
+    srunner_run_all (sr, CK_ENV);
+    number_failed = srunner_ntests_failed (sr);
+    srunner_free (sr);
+    return (number_failed == 0) ? EXIT_SUCCESS : EXIT_FAILURE;
+}
+
+/* --------------------------------------------------------------------------------------------- */
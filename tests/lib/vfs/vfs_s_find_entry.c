@@ -0,0 +1,192 @@
+/*
+   lib/vfs - test vfs_s_find_entry_tree() function
+
+   Copyright (C) 2017
+   Free Software Foundation, Inc.
+
+   This file is part of the Midnight Commander.
+
+   The Midnight Commander is free software: you can redistribute it
+   and/or modify it under the terms of the GNU General Public License as
+   published by the Free Software Foundation, either version 3 of the License,
+   or (at your option) any later version.
+
+   The Midnight Commander is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#define TEST_SUITE_NAME "/lib/vfs"
+
+#include "tests/mctest.h"
+
+#include "lib/strutil.h"
+#include "lib/vfs/direntry.c"   /* for testing static methods  */
+
+#define ENTRIES_COUNT (VFS_S_SUBDIR_INDEX_MIN * 4)
+
+static struct vfs_s_subclass test_subclass;
+static struct vfs_class vfs_test_ops;
+
+static struct vfs_s_super *test_super;
+
+/* --------------------------------------------------------------------------------------------- */
+
+static struct vfs_s_entry *
+test_add_entry (struct vfs_s_inode *dir, const char *name, mode_t mode)
+{
+    struct vfs_s_entry *ent;
+
+    ent = vfs_s_generate_entry (&vfs_test_ops, name, dir, mode);
+    vfs_s_insert_entry (&vfs_test_ops, dir, ent);
+    return ent;
+}
+
+/* --------------------------------------------------------------------------------------------- */
+
+/* @Before */
+static void
+setup (void)
+{
+    str_init_strings (NULL);
+
+    vfs_init ();
+
+    vfs_s_init_class (&vfs_test_ops, &test_subclass);
+    vfs_test_ops.name = "testfs";
+    vfs_test_ops.prefix = "test:";
+    vfs_register_class (&vfs_test_ops);
+
+    test_super = vfs_s_new_super (&vfs_test_ops);
+    test_super->name = g_strdup ("test");
+    test_super->root =
+        vfs_s_new_inode (&vfs_test_ops, test_super,
+                         vfs_s_default_stat (&vfs_test_ops, S_IFDIR | 0755));
+}
+
+/* --------------------------------------------------------------------------------------------- */
+
+/* @After */
+static void
+teardown (void)
+{
+    vfs_s_free_super (&vfs_test_ops, test_super);
+    vfs_shut ();
+    str_uninit_strings ();
+}
+
+/* --------------------------------------------------------------------------------------------- */
+
+void
+vfs_die (const char *m)
+{
+    printf ("VFS_DIE: '%s'\n", m);
+}
+
+/* --------------------------------------------------------------------------------------------- */
+
+/* @Test */
+/* *INDENT-OFF* */
+START_TEST (test_vfs_s_find_entry_small_dir)
+/* *INDENT-ON* */
+{
+    /* given */
+    struct vfs_s_entry *ent;
+
+    test_add_entry (test_super->root, "a", 0644);
+    ent = test_add_entry (test_super->root, "b", 0644);
+
+    /* when */
+    /* then */
+    mctest_assert_ptr_eq (vfs_s_find_entry_tree (&vfs_test_ops, test_super->root, "b",
+                                                 LINK_NO_FOLLOW, FL_NONE), ent);
+    mctest_assert_null (vfs_s_find_entry_tree (&vfs_test_ops, test_super->root, "c",
+                                               LINK_NO_FOLLOW, FL_NONE));
+    mctest_assert_null (test_super->root->subdir_index);
+}
+/* *INDENT-OFF* */
+END_TEST
+/* *INDENT-ON* */
+
+/* --------------------------------------------------------------------------------------------- */
+
+/* @Test */
+/* *INDENT-OFF* */
+START_TEST (test_vfs_s_find_entry_indexed_dir)
+/* *INDENT-ON* */
+{
+    /* given */
+    struct vfs_s_entry *ents[ENTRIES_COUNT];
+    struct vfs_s_entry *subdir, *ent, *dup;
+    int i;
+
+    subdir = test_add_entry (test_super->root, "dir", S_IFDIR | 0755);
+    for (i = 0; i < ENTRIES_COUNT; i++)
+    {
+        char *name;
+
+        name = g_strdup_printf ("file%d", i);
+        ents[i] = test_add_entry (subdir->ino, name, 0644);
+        g_free (name);
+    }
+
+    /* when */
+    ent = vfs_s_find_entry_tree (&vfs_test_ops, test_super->root, "dir/file42",
+                                 LINK_NO_FOLLOW, FL_NONE);
+
+    /* then */
+    mctest_assert_ptr_eq (ent, ents[42]);
+    mctest_assert_not_null (subdir->ino->subdir_index);
+
+    /* index follows insertions and removals */
+    dup = test_add_entry (subdir->ino, "file7", 0644);
+    ent = test_add_entry (subdir->ino, "new_file", 0644);
+    mctest_assert_ptr_eq (vfs_s_find_entry_tree (&vfs_test_ops, test_super->root,
+                                                 "dir/new_file", LINK_NO_FOLLOW, FL_NONE), ent);
+    mctest_assert_ptr_eq (vfs_s_find_entry_tree (&vfs_test_ops, test_super->root,
+                                                 "/dir/file7", LINK_NO_FOLLOW, FL_NONE), ents[7]);
+
+    vfs_s_free_entry (&vfs_test_ops, ents[7]);
+    mctest_assert_ptr_eq (vfs_s_find_entry_tree (&vfs_test_ops, test_super->root,
+                                                 "dir/file7", LINK_NO_FOLLOW, FL_NONE), dup);
+
+    vfs_s_free_entry (&vfs_test_ops, ents[42]);
+    mctest_assert_null (vfs_s_find_entry_tree (&vfs_test_ops, test_super->root, "dir/file42",
+                                               LINK_NO_FOLLOW, FL_NONE));
+}
+/* *INDENT-OFF* */
+END_TEST
+/* *INDENT-ON* */
+
+/* --------------------------------------------------------------------------------------------- */
+
+int
+main (void)
+{
+    int number_failed;
+
+    Suite *s = suite_create (TEST_SUITE_NAME);
+    TCase *tc_core = tcase_create ("Core");
+    SRunner *sr;
+
+    tcase_add_checked_fixture (tc_core, setup, teardown);
+
+    /* Add new tests here: *************** */
+    tcase_add_test (tc_core, test_vfs_s_find_entry_small_dir);
+    tcase_add_test (tc_core, test_vfs_s_find_entry_indexed_dir);
+    /* *********************************** */
+
+    suite_add_tcase (s, tc_core);
+    sr = srunner_create (s);
+    srunner_set_log (sr, "vfs_s_find_entry.log");
+    srunner_run_all (sr, CK_ENV);
+    number_failed = srunner_ntests_failed (sr);
+    srunner_free (sr);
+    return (number_failed == 0) ? EXIT_SUCCESS : EXIT_FAILURE;
+}
+
+/* --------------------------------------------------------------------------------------------- */
@@ -0,0 +1,301 @@
+/*
+   lib/vfs - test in-process decompression of archives
+
+   Copyright (C) 2017
+   Free Software Foundation, Inc.
+
+   This file is part of the Midnight Commander.
+
+   The Midnight Commander is free software: you can redistribute it
+   and/or modify it under the terms of the GNU General Public License as
+   published by the Free Software Foundation, either version 3 of the License,
+   or (at your option) any later version.
+
+   The Midnight Commander is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#define TEST_SUITE_NAME "/lib/vfs"
+
+#include "tests/mctest.h"
+
+#ifdef HAVE_ZLIB
+#include <zlib.h>
+#endif
+#ifdef HAVE_BZLIB
+#include <bzlib.h>
+#endif
+
+#include "lib/strutil.h"
+#include "lib/util.h"
+#include "lib/vfs/xdirentry.h"
+#include "lib/vfs/path.h"
+#include "lib/vfs/zstream.h"
+
+#include "src/vfs/local/local.c"
+
+/* larger than distance between checkpoints */
+#define DATA_SIZE (10 * 1024 * 1024)
+
+static char *data;
+static vfs_path_t *file_vpath;
+
+/* --------------------------------------------------------------------------------------------- */
+
+/* @Before */
+static void
+setup (void)
+{
+    size_t i;
+
+    str_init_strings (NULL);
+
+    vfs_init ();
+    init_localfs ();
+    vfs_setup_work_dir ();
+
+    data = g_malloc (DATA_SIZE);
+    for (i = 0; i < DATA_SIZE; i++)
+        data[i] = "abcdefghijklmnopqrstuvwxyz0123456789\n"[(i * 7 + i / 1000) % 37];
+
+    file_vpath = NULL;
+}
+
+/* --------------------------------------------------------------------------------------------- */
+
+/* @After */
+static void
+teardown (void)
+{
+    if (file_vpath != NULL)
+    {
+        unlink (vfs_path_as_str (file_vpath));
+        vfs_path_free (file_vpath);
+    }
+    g_free (data);
+
+    vfs_shut ();
+    str_uninit_strings ();
+}
+
+/* --------------------------------------------------------------------------------------------- */
+
+static vfs_zstream_t *
+open_stream (int type)
+{
+    int fd;
+
+    fd = mc_open (file_vpath, O_RDONLY);
+    mctest_assert_int_ne (fd, -1);
+    return vfs_zstream_new (fd, type);
+}
+
+/* --------------------------------------------------------------------------------------------- */
+
+static void
+check_read (vfs_zstream_t * zs, off_t offset, size_t count)
+{
+    char *buf;
+    size_t expected;
+
+    expected = MIN (count, (size_t) (DATA_SIZE - offset));
+    buf = g_malloc (count);
+
+    mctest_assert_int_eq (vfs_zstream_seek (zs, offset, SEEK_SET), offset);
+    mctest_assert_int_eq (vfs_zstream_read (zs, buf, count), expected);
+    fail_unless (memcmp (buf, data + offset, expected) == 0, "\nwrong data at %ld\n",
+                 (long) offset);
+
+    g_free (buf);
+}
+
+/* --------------------------------------------------------------------------------------------- */
+
+/* @Test */
+/* *INDENT-OFF* */
+START_TEST (test_vfs_zstream_none)
+/* *INDENT-ON* */
+{
+    /* given */
+    vfs_zstream_t *zs;
+    int fd;
+
+    fd = mc_mkstemps (&file_vpath, "mctest-", NULL);
+    mctest_assert_int_eq (write (fd, data, DATA_SIZE), DATA_SIZE);
+    close (fd);
+
+    /* when */
+    zs = open_stream (COMPRESSION_NONE);
+
+    /* then */
+    mctest_assert_not_null (zs);
+    check_read (zs, 0, 1000);
+    check_read (zs, DATA_SIZE - 10, 1000);
+    check_read (zs, 12345, 100000);
+    vfs_zstream_free (zs);
+}
+/* *INDENT-OFF* */
+END_TEST
+/* *INDENT-ON* */
+
+/* --------------------------------------------------------------------------------------------- */
+
+#ifdef HAVE_ZLIB
+static void
+write_gzip_member (int fd, const char *buf, size_t len)
+{
+    z_stream s;
+    char out[64 * 1024];
+    int r;
+
+    memset (&s, 0, sizeof (s));
+    deflateInit2 (&s, Z_DEFAULT_COMPRESSION, Z_DEFLATED, MAX_WBITS + 16, 8, Z_DEFAULT_STRATEGY);
+    s.next_in = (Bytef *) buf;
+    s.avail_in = len;
+
+    do
+    {
+        s.next_out = (Bytef *) out;
+        s.avail_out = sizeof (out);
+        r = deflate (&s, Z_FINISH);
+        mctest_assert_int_eq (write (fd, out, sizeof (out) - s.avail_out),
+                              sizeof (out) - s.avail_out);
+    }
+    while (r == Z_OK);
+
+    deflateEnd (&s);
+}
+
+/* --------------------------------------------------------------------------------------------- */
+
+/* @Test */
+/* *INDENT-OFF* */
+START_TEST (test_vfs_zstream_gzip)
+/* *INDENT-ON* */
+{
+    /* given */
+    static const char garbage[512] = "";
+    vfs_zstream_t *zs;
+    char buf[512];
+    off_t total = 0;
+    ssize_t n;
+    int fd;
+
+    /* two members and trailing zeros, like some tape utilities write */
+    fd = mc_mkstemps (&file_vpath, "mctest-", NULL);
+    write_gzip_member (fd, data, DATA_SIZE / 2);
+    write_gzip_member (fd, data + DATA_SIZE / 2, DATA_SIZE - DATA_SIZE / 2);
+    mctest_assert_int_eq (write (fd, garbage, sizeof (garbage)), sizeof (garbage));
+    close (fd);
+
+    /* when */
+    zs = open_stream (COMPRESSION_GZIP);
+    mctest_assert_not_null (zs);
+
+    while ((n = vfs_zstream_read (zs, buf, sizeof (buf))) > 0)
+    {
+        fail_unless (memcmp (buf, data + total, n) == 0, "\nwrong data at %ld\n", (long) total);
+        total += n;
+    }
+
+    /* then */
+    mctest_assert_int_eq (n, 0);
+    mctest_assert_int_eq (total, DATA_SIZE);
+
+    /* seek back in the first and in the second member */
+    check_read (zs, 5 * 1024 * 1024 + 17, 300000);
+    check_read (zs, 1000, 70000);
+    check_read (zs, DATA_SIZE - 100, 1000);
+    /* short seek back is served from recently decompressed data */
+    check_read (zs, DATA_SIZE - 40000, 1000);
+    /* seek beyond end stops at end */
+    mctest_assert_int_eq (vfs_zstream_seek (zs, DATA_SIZE + 100, SEEK_SET), DATA_SIZE);
+
+    vfs_zstream_free (zs);
+}
+/* *INDENT-OFF* */
+END_TEST
+/* *INDENT-ON* */
+#endif /* HAVE_ZLIB */
+
+/* --------------------------------------------------------------------------------------------- */
+
+#ifdef HAVE_BZLIB
+/* @Test */
+/* *INDENT-OFF* */
+START_TEST (test_vfs_zstream_bzip2_backward)
+/* *INDENT-ON* */
+{
+    /* given */
+    vfs_zstream_t *zs;
+    unsigned int len;
+    char *buf;
+    off_t offset;
+    int fd;
+
+    /* one stream: decoder state can't be saved inside it */
+    len = DATA_SIZE + DATA_SIZE / 100 + 600;
+    buf = g_malloc (len);
+    mctest_assert_int_eq (BZ2_bzBuffToBuffCompress (buf, &len, data, DATA_SIZE, 1, 0, 0), BZ_OK);
+    fd = mc_mkstemps (&file_vpath, "mctest-", NULL);
+    mctest_assert_int_eq (write (fd, buf, len), len);
+    close (fd);
+    g_free (buf);
+
+    /* when */
+    zs = open_stream (COMPRESSION_BZIP2);
+    mctest_assert_not_null (zs);
+
+    /* then: data is read backward by large chunks */
+    check_read (zs, DATA_SIZE - 1000, 1000);
+    for (offset = DATA_SIZE - 1000; offset > 0; offset -= 1000 * 1000 + 17)
+        check_read (zs, MAX (offset - 1000 * 1000, 0), 1000 * 1000);
+    check_read (zs, 0, DATA_SIZE);
+    /* seek beyond end stops at end */
+    mctest_assert_int_eq (vfs_zstream_seek (zs, DATA_SIZE + 100, SEEK_SET), DATA_SIZE);
+
+    vfs_zstream_free (zs);
+}
+/* *INDENT-OFF* */
+END_TEST
+/* *INDENT-ON* */
+#endif /* HAVE_BZLIB */
+
+/* --------------------------------------------------------------------------------------------- */
+
+int
+main (void)
+{
+    int number_failed;
+
+    Suite *s = suite_create (TEST_SUITE_NAME);
+    TCase *tc_core = tcase_create ("Core");
+    SRunner *sr;
+
+    tcase_add_checked_fixture (tc_core, setup, teardown);
+
+    /* Add new tests here: *************** */
+    tcase_add_test (tc_core, test_vfs_zstream_none);
+#ifdef HAVE_ZLIB
+    tcase_add_test (tc_core, test_vfs_zstream_gzip);
+#endif
+#ifdef HAVE_BZLIB
+    tcase_add_test (tc_core, test_vfs_zstream_bzip2_backward);
+#endif
+    /* *********************************** */
+
+    suite_add_tcase (s, tc_core);
+    sr = srunner_create (s);
+    srunner_set_log (sr, "vfs_zstream.log");
+    srunner_run_all (sr, CK_ENV);
+    number_failed = srunner_ntests_failed (sr);
+    srunner_free (sr);
+    return (number_failed == 0) ? EXIT_SUCCESS : EXIT_FAILURE;
+}
+
+/* --------------------------------------------------------------------------------------------- */
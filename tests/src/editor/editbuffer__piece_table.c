@@ -0,0 +1,405 @@
+/*
+   src/editor - tests for editor text keep buffers
+
+   Copyright (C) 2017
+   Free Software Foundation, Inc.
+
+   This file is part of the Midnight Commander.
+
+   The Midnight Commander is free software: you can redistribute it
+   and/or modify it under the terms of the GNU General Public License as
+   published by the Free Software Foundation, either version 3 of the License,
+   or (at your option) any later version.
+
+   The Midnight Commander is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#define TEST_SUITE_NAME "/src/editor"
+
+#include "tests/mctest.h"
+
+#include <string.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#include <sys/time.h>
+
+#include "src/editor/edit-impl.h"
+#include "src/editor/editbuffer.h"
+
+/* --------------------------------------------------------------------------------------------- */
+
+static edit_buffer_t buf;
+static GString *expected;
+static off_t expected_cursor;
+
+/* --------------------------------------------------------------------------------------------- */
+
+/* @Before */
+static void
+setup (void)
+{
+    expected = g_string_new (NULL);
+    expected_cursor = 0;
+    g_random_set_seed (42);
+}
+
+/* --------------------------------------------------------------------------------------------- */
+
+/* @After */
+static void
+teardown (void)
+{
+    edit_buffer_clean (&buf);
+    g_string_free (expected, TRUE);
+    option_piece_table = FALSE;
+}
+
+/* --------------------------------------------------------------------------------------------- */
+
+static void
+check_buffer (void)
+{
+    off_t i;
+    off_t first, last;
+    long lines = 0;
+
+    mctest_assert_int_eq (buf.size, expected->len);
+    mctest_assert_int_eq (buf.curs1, expected_cursor);
+    mctest_assert_int_eq (buf.curs1 + buf.curs2, buf.size);
+
+    for (i = 0; i < buf.size; i++)
+        if (edit_buffer_get_byte (&buf, i) != (unsigned char) expected->str[i])
+            break;
+    mctest_assert_int_eq (i, buf.size);
+
+    for (i = 0; i < buf.size;)
+    {
+        const char *block;
+        size_t len;
+
+        block = edit_buffer_get_block (&buf, i, &len);
+        mctest_assert_not_null (block);
+        mctest_assert_true (len != 0 && i + (off_t) len <= buf.size);
+        mctest_assert_int_eq (memcmp (block, expected->str + i, len), 0);
+        i += len;
+    }
+
+    first = g_random_int_range (0, buf.size + 1);
+    last = g_random_int_range (first, buf.size + 1);
+    for (i = first; i < last; i++)
+        if (expected->str[i] == '\n')
+            lines++;
+    mctest_assert_int_eq (edit_buffer_count_lines (&buf, first, last), lines);
+
+    /* beginning of line after the last newline before "last" */
+    lines = edit_buffer_count_lines (&buf, 0, last);
+    for (i = last; i > 0 && expected->str[i - 1] != '\n'; i--)
+        ;
+    mctest_assert_int_eq (edit_buffer_find_line (&buf, lines), i);
+    mctest_assert_int_eq (edit_buffer_get_backward_offset (&buf, last, 10),
+                          edit_buffer_find_line (&buf, lines - 10));
+    mctest_assert_int_eq (edit_buffer_get_forward_offset (&buf, i, 10, 0),
+                          edit_buffer_find_line (&buf, lines + 10));
+}
+
+/* --------------------------------------------------------------------------------------------- */
+
+static void
+check_total_lines (void)
+{
+    off_t i;
+    long lines = 0;
+
+    for (i = 0; i < (off_t) expected->len; i++)
+        if (expected->str[i] == '\n')
+            lines++;
+
+    edit_buffer_count_pending_lines (&buf, buf.size, 0);
+    mctest_assert_int_eq (buf.lines, lines);
+}
+
+/* --------------------------------------------------------------------------------------------- */
+
+/* edit buffer randomly and count lines like editor does */
+static void
+random_edit (int count)
+{
+    int i;
+
+    for (i = 0; i < count; i++)
+    {
+        char c;
+        int d;
+
+        c = g_random_int_range (0, 8) == 0 ? '\n' : 'a' + g_random_int_range (0, 26);
+
+        switch (g_random_int_range (0, 10))
+        {
+        case 0:
+        case 1:
+        case 2:
+            edit_buffer_insert (&buf, c);
+            g_string_insert_c (expected, expected_cursor++, c);
+            if (c == '\n')
+                buf.lines++;
+            break;
+        case 3:
+            edit_buffer_insert_ahead (&buf, c);
+            g_string_insert_c (expected, expected_cursor, c);
+            if (c == '\n')
+                buf.lines++;
+            break;
+        case 4:
+            if (expected_cursor < (off_t) expected->len)
+            {
+                d = edit_buffer_delete (&buf);
+                mctest_assert_int_eq (d, (unsigned char) expected->str[expected_cursor]);
+                g_string_erase (expected, expected_cursor, 1);
+                if (d == '\n')
+                    buf.lines--;
+            }
+            break;
+        case 5:
+            if (expected_cursor > 0)
+            {
+                expected_cursor--;
+                d = edit_buffer_backspace (&buf);
+                mctest_assert_int_eq (d, (unsigned char) expected->str[expected_cursor]);
+                g_string_erase (expected, expected_cursor, 1);
+                if (d == '\n')
+                    buf.lines--;
+            }
+            break;
+        case 6:
+            /* jump */
+            expected_cursor = g_random_int_range (0, expected->len + 1);
+            edit_buffer_set_cursor (&buf, expected_cursor);
+            break;
+        default:
+            /* step */
+            expected_cursor += g_random_int_range (-3, 4);
+            expected_cursor = CLAMP (expected_cursor, 0, (off_t) expected->len);
+            edit_buffer_set_cursor (&buf, expected_cursor);
+            break;
+        }
+
+        if (i % 5000 == 0)
+            check_buffer ();
+    }
+
+    check_buffer ();
+}
+
+/* --------------------------------------------------------------------------------------------- */
+
+/* @DataSource("test_edit_buffer_ds") */
+/* *INDENT-OFF* */
+static const struct test_edit_buffer_ds
+{
+    gboolean piece_table;
+} test_edit_buffer_ds[] =
+{
+    { /* 0. gap buffer */
+        FALSE
+    },
+    { /* 1. piece table */
+        TRUE
+    },
+};
+/* *INDENT-ON* */
+
+/* @Test(dataSource = "test_edit_buffer_ds") */
+/* *INDENT-OFF* */
+START_PARAMETRIZED_TEST (test_edit_buffer, test_edit_buffer_ds)
+/* *INDENT-ON* */
+{
+    /* given */
+    option_piece_table = data->piece_table;
+    edit_buffer_init (&buf, 0);
+    mctest_assert_int_eq (buf.pieces != NULL, data->piece_table);
+
+    /* when, then */
+    random_edit (100000);
+    check_total_lines ();
+}
+/* *INDENT-OFF* */
+END_PARAMETRIZED_TEST
+/* *INDENT-ON* */
+
+/* --------------------------------------------------------------------------------------------- */
+
+#ifdef HAVE_MMAP
+/* @Test */
+/* *INDENT-OFF* */
+START_TEST (test_edit_buffer_map_file)
+/* *INDENT-ON* */
+{
+    char name[] = "editbuffer__piece_table.XXXXXX";
+    int fd, i;
+
+    /* given */
+    for (i = 0; i < 1000000; i++)
+        g_string_append_c (expected, g_random_int_range (0, 50) == 0 ? '\n' : 'x');
+
+    fd = mkstemp (name);
+    mctest_assert_true (fd >= 0);
+    mctest_assert_int_eq (write (fd, expected->str, expected->len), expected->len);
+
+    option_piece_table = TRUE;
+    edit_buffer_init (&buf, expected->len);
+
+    /* when */
+    mctest_assert_true (edit_buffer_map_file (&buf, fd, expected->len));
+    close (fd);
+    unlink (name);
+
+    /* then */
+    mctest_assert_true (edit_buffer_is_mapped (&buf));
+    mctest_assert_int_eq (buf.lines, 0);
+    random_edit (20000);
+    check_total_lines ();
+}
+/* *INDENT-OFF* */
+END_TEST
+/* *INDENT-ON* */
+
+/* --------------------------------------------------------------------------------------------- */
+
+/* @Test */
+/* *INDENT-OFF* */
+START_TEST (test_edit_buffer_map_truncated)
+/* *INDENT-ON* */
+{
+    char name[] = "editbuffer__piece_table.XXXXXX";
+    const off_t new_size = 1000;
+    int fd, i;
+
+    /* given */
+    for (i = 0; i < 1000000; i++)
+        g_string_append_c (expected, g_random_int_range (0, 50) == 0 ? '\n' : 'x');
+
+    fd = mkstemp (name);
+    mctest_assert_true (fd >= 0);
+    mctest_assert_int_eq (write (fd, expected->str, expected->len), expected->len);
+    unlink (name);
+
+    option_piece_table = TRUE;
+    edit_buffer_init (&buf, expected->len);
+    mctest_assert_true (edit_buffer_map_file (&buf, fd, expected->len));
+    mctest_assert_false (edit_buffer_check_mapped (&buf));
+    edit_buffer_count_pending_lines (&buf, expected->len / 2, 0);
+
+    /* when: file is truncated by another program */
+    mctest_assert_int_eq (ftruncate (fd, new_size), 0);
+    close (fd);
+
+    /* then: bytes beyond the new end of file are zeros */
+    mctest_assert_int_eq (edit_buffer_get_byte (&buf, expected->len - 1), 0);
+    mctest_assert_true (edit_buffer_check_mapped (&buf));
+    mctest_assert_false (edit_buffer_is_mapped (&buf));
+
+    memset (expected->str + new_size, '\0', expected->len - new_size);
+    check_buffer ();
+    check_total_lines ();
+    random_edit (1000);
+    check_total_lines ();
+}
+/* *INDENT-OFF* */
+END_TEST
+/* *INDENT-ON* */
+
+/* --------------------------------------------------------------------------------------------- */
+
+/* @Test */
+/* *INDENT-OFF* */
+START_TEST (test_edit_buffer_map_changed)
+/* *INDENT-ON* */
+{
+    char name[] = "editbuffer__piece_table.XXXXXX";
+    GString *changed;
+    struct stat st;
+    struct timeval times[2];
+    int fd, i;
+
+    /* given */
+    changed = g_string_new (NULL);
+    for (i = 0; i < 100000; i++)
+    {
+        g_string_append_c (expected, g_random_int_range (0, 50) == 0 ? '\n' : 'x');
+        g_string_append_c (changed, g_random_int_range (0, 1000) == 0 ? '\n' : 'y');
+    }
+
+    fd = mkstemp (name);
+    mctest_assert_true (fd >= 0);
+    mctest_assert_int_eq (write (fd, expected->str, expected->len), expected->len);
+
+    option_piece_table = TRUE;
+    edit_buffer_init (&buf, expected->len);
+    mctest_assert_true (edit_buffer_map_file (&buf, fd, expected->len));
+    check_total_lines ();
+
+    /* when: file of the same size is rewritten in place */
+    mctest_assert_int_eq (lseek (fd, 0, SEEK_SET), 0);
+    mctest_assert_int_eq (write (fd, changed->str, changed->len), changed->len);
+    mctest_assert_int_eq (fstat (fd, &st), 0);
+    times[0].tv_sec = st.st_atime;
+    times[0].tv_usec = 0;
+    times[1].tv_sec = st.st_mtime + 10;
+    times[1].tv_usec = 0;
+    mctest_assert_int_eq (utimes (name, times), 0);
+    close (fd);
+    unlink (name);
+
+    /* then: stale numbers of newlines don't break line lookup */
+    edit_buffer_find_line (&buf, buf.lines);
+    mctest_assert_true (edit_buffer_check_mapped (&buf));
+
+    g_string_assign (expected, changed->str);
+    check_buffer ();
+    check_total_lines ();
+
+    g_string_free (changed, TRUE);
+}
+/* *INDENT-OFF* */
+END_TEST
+/* *INDENT-ON* */
+#endif /* HAVE_MMAP */
+
+/* --------------------------------------------------------------------------------------------- */
+
+int
+main (void)
+{
+    int number_failed;
+
+    Suite *s = suite_create (TEST_SUITE_NAME);
+    TCase *tc_core = tcase_create ("Core");
+    SRunner *sr;
+
+    tcase_add_checked_fixture (tc_core, setup, teardown);
+
+    /* Add new tests here: *************** */
+    mctest_add_parameterized_test (tc_core, test_edit_buffer, test_edit_buffer_ds);
+#ifdef HAVE_MMAP
+    tcase_add_test (tc_core, test_edit_buffer_map_file);
+    tcase_add_test (tc_core, test_edit_buffer_map_truncated);
+    tcase_add_test (tc_core, test_edit_buffer_map_changed);
+#endif
+    /* *********************************** */
+
+    suite_add_tcase (s, tc_core);
+    sr = srunner_create (s);
+    srunner_set_log (sr, "editbuffer__piece_table.log");
+    srunner_run_all (sr, CK_ENV);
+    number_failed = srunner_ntests_failed (sr);
+    srunner_free (sr);
+    return (number_failed == 0) ? EXIT_SUCCESS : EXIT_FAILURE;
+}
+
+/* --------------------------------------------------------------------------------------------- */
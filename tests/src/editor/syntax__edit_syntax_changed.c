@@ -0,0 +1,492 @@
+/*
+   src/editor - tests for cache of syntax states of lines
+
+   Copyright (C) 2017
+   Free Software Foundation, Inc.
+
+   This file is part of the Midnight Commander.
+
+   The Midnight Commander is free software: you can redistribute it
+   and/or modify it under the terms of the GNU General Public License as
+   published by the Free Software Foundation, either version 3 of the License,
+   or (at your option) any later version.
+
+   The Midnight Commander is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#define TEST_SUITE_NAME "/src/editor"
+
+#include "tests/mctest.h"
+
+#include <string.h>
+#include <unistd.h>
+
+#include "lib/tty/color-internal.h"     /* use_colors */
+
+#include "src/editor/syntax.c"
+
+/* rules are read without colors: tty isn't initialized */
+static const char test_syntax[] =
+    "file .\\* Test\n"
+    "context default\n"
+    "    keyword whole int\n"
+    "    keyword whole return\n"
+    "    keyword {\n"
+    "    keyword }\n"
+    "context /\\* \\*/\n"
+    "    keyword TODO\n"
+    "context exclusive \" \"\n"
+    "context linestart # \\n\n"
+    "    keyword include\n";
+
+static const char test_text[] =
+    "int a;\n"
+    "/* comment\n"
+    "   TODO */\n"
+    "#include \"a.h\"\n"
+    "int\n"
+    "f (void)\n"
+    "{\n"
+    "    return \"not /* comment\";\n"
+    "}\n";
+
+/* text is repeated to be longer than look-ahead of lexer */
+#define TEST_TEXT_REPEAT 100
+
+static WEdit *edit;
+
+/* --------------------------------------------------------------------------------------------- */
+
+static void
+load_syntax (void)
+{
+    char *path;
+    int fd;
+
+    fd = g_file_open_tmp ("syntax-XXXXXX", &path, NULL);
+    mctest_assert_int_ne (fd, -1);
+    mctest_assert_int_eq (write (fd, test_syntax, strlen (test_syntax)), strlen (test_syntax));
+    close (fd);
+
+    mctest_assert_int_eq (edit_read_syntax_file (edit, NULL, path, NULL, "", "Test"), 0);
+    mctest_assert_not_null (edit->rules);
+
+    unlink (path);
+    g_free (path);
+}
+
+/* --------------------------------------------------------------------------------------------- */
+
+/* each keyword of each context gets own color */
+static void
+set_colors (void)
+{
+    guint i, j;
+
+    for (i = 0; i < edit->rules->len; i++)
+    {
+        context_rule_t *r;
+
+        r = CONTEXT_RULE (g_ptr_array_index (edit->rules, i));
+        for (j = 0; j < r->keyword->len; j++)
+            SYNTAX_KEYWORD (g_ptr_array_index (r->keyword, j))->color = i * 100 + j + 1;
+    }
+}
+
+/* --------------------------------------------------------------------------------------------- */
+
+static void
+move_to (long line, long column)
+{
+    edit_buffer_set_cursor (&edit->buffer, edit_buffer_find_line (&edit->buffer, line) + column);
+    edit->buffer.curs_line = line;
+}
+
+/* --------------------------------------------------------------------------------------------- */
+
+/* insert text before cursor like edit_insert() does */
+static void
+insert_text (const char *text)
+{
+    for (; *text != '\0'; text++)
+    {
+        edit_buffer_insert (&edit->buffer, *text);
+        edit_syntax_changed (edit, edit->buffer.curs_line, *text == '\n' ? 1 : 0);
+        if (*text == '\n')
+        {
+            edit->buffer.curs_line++;
+            edit->buffer.lines++;
+        }
+    }
+}
+
+/* --------------------------------------------------------------------------------------------- */
+
+/* delete text after cursor like edit_delete() does */
+static void
+delete_text (int count)
+{
+    for (; count > 0; count--)
+    {
+        int c;
+
+        c = edit_buffer_delete (&edit->buffer);
+        edit_syntax_changed (edit, edit->buffer.curs_line, c == '\n' ? -1 : 0);
+        if (c == '\n')
+            edit->buffer.lines--;
+    }
+}
+
+/* --------------------------------------------------------------------------------------------- */
+
+/* delete text before cursor like edit_backspace() does */
+static void
+backspace_text (int count)
+{
+    for (; count > 0; count--)
+    {
+        int c;
+
+        c = edit_buffer_backspace (&edit->buffer);
+        if (c == '\n')
+        {
+            edit->buffer.curs_line--;
+            edit->buffer.lines--;
+        }
+        edit_syntax_changed (edit, edit->buffer.curs_line, c == '\n' ? -1 : 0);
+    }
+}
+
+/* --------------------------------------------------------------------------------------------- */
+
+/* get colors of text lexed from the beginning without the cache */
+static int *
+get_reference_colors (void)
+{
+    GArray *syntax_lines;
+    long syntax_valid, syntax_dirty, syntax_line;
+    off_t last_get_rule;
+    edit_syntax_rule_t rule;
+    int *colors;
+    off_t i;
+
+    syntax_lines = edit->syntax_lines;
+    syntax_valid = edit->syntax_valid;
+    syntax_dirty = edit->syntax_dirty;
+    syntax_line = edit->syntax_line;
+    last_get_rule = edit->last_get_rule;
+    rule = edit->rule;
+
+    colors = g_new (int, edit->buffer.size);
+    edit->syntax_lines = NULL;
+    for (i = 0; i < edit->buffer.size; i++)
+        colors[i] = edit_get_syntax_color (edit, i);
+    g_array_free (edit->syntax_lines, TRUE);
+
+    /* keep the cache for following edits */
+    edit->syntax_lines = syntax_lines;
+    edit->syntax_valid = syntax_valid;
+    edit->syntax_dirty = syntax_dirty;
+    edit->syntax_line = syntax_line;
+    edit->last_get_rule = last_get_rule;
+    edit->rule = rule;
+
+    return colors;
+}
+
+/* --------------------------------------------------------------------------------------------- */
+
+static void
+check_colors (const int *colors, off_t first, off_t last)
+{
+    int *reference;
+    off_t i;
+
+    reference = get_reference_colors ();
+    for (i = first; i < last; i++)
+        if (colors[i - first] != reference[i])
+            break;
+    mctest_assert_int_eq (i, last);
+    g_free (reference);
+}
+
+/* --------------------------------------------------------------------------------------------- */
+
+/* get colors of lines like editor draws them */
+static void
+draw_lines (long line, long count)
+{
+    off_t first, last, i;
+    int *colors;
+
+    first = edit_buffer_find_line (&edit->buffer, line);
+    last = edit_buffer_find_line (&edit->buffer, line + count);
+
+    colors = g_new (int, last - first + 1);
+    for (i = first; i < last; i++)
+        colors[i - first] = edit_get_syntax_color (edit, i);
+
+    check_colors (colors, first, last);
+    g_free (colors);
+}
+
+/* --------------------------------------------------------------------------------------------- */
+
+static void
+draw_screen (void)
+{
+    draw_lines (edit->buffer.curs_line - 10, 20);
+}
+
+/* --------------------------------------------------------------------------------------------- */
+
+/* get colors of all lines from the end of file: lexing of each one starts from its cached state */
+static void
+draw_all_lines (void)
+{
+    int *colors;
+    long line;
+
+    colors = g_new (int, edit->buffer.size + 1);
+
+    for (line = edit->buffer.lines; line >= 0; line--)
+    {
+        off_t i, eol;
+
+        eol = (line < edit->buffer.lines) ? edit_buffer_find_line (&edit->buffer, line + 1)
+            : edit->buffer.size;
+        for (i = edit_buffer_find_line (&edit->buffer, line); i < eol; i++)
+            colors[i] = edit_get_syntax_color (edit, i);
+    }
+
+    check_colors (colors, 0, edit->buffer.size);
+    g_free (colors);
+}
+
+/* --------------------------------------------------------------------------------------------- */
+
+/* @Before */
+static void
+setup (void)
+{
+    int i;
+
+    use_colors = TRUE;
+
+    edit = g_new0 (WEdit, 1);
+    edit_buffer_init (&edit->buffer, 0);
+    for (i = 0; i < TEST_TEXT_REPEAT; i++)
+        insert_text (test_text);
+    move_to (0, 0);
+
+    load_syntax ();
+    set_colors ();
+
+    /* states of all lines are in the cache */
+    draw_all_lines ();
+    mctest_assert_int_eq (edit->syntax_valid, edit->buffer.lines + 1);
+
+    g_random_set_seed (42);
+}
+
+/* --------------------------------------------------------------------------------------------- */
+
+/* @After */
+static void
+teardown (void)
+{
+    /* edit_free_syntax_rules() frees tty colors, which aren't initialized */
+    destroy_defines (&edit->defines);
+    g_ptr_array_foreach (edit->rules, (GFunc) context_rule_free, NULL);
+    g_ptr_array_free (edit->rules, TRUE);
+    g_array_free (edit->syntax_lines, TRUE);
+    g_free (edit->syntax_type);
+    edit_buffer_clean (&edit->buffer);
+    g_free (edit);
+
+    use_colors = FALSE;
+}
+
+/* --------------------------------------------------------------------------------------------- */
+
+/* @DataSource("test_edit_ds") */
+/* *INDENT-OFF* */
+static const struct test_edit_ds
+{
+    long line;
+    long column;
+    const char *inserted;
+    int deleted;
+    int backspaced;
+} test_edit_ds[] =
+{
+    { /* 0. comment is opened at the top of file */
+        0, 0, "/*", 0, 0
+    },
+    { /* 1. comment is closed at the top of file */
+        1, 0, "", 2, 0
+    },
+    { /* 2. keyword is changed in the middle of line */
+        4 + 9 * 40, 2, "x", 0, 0
+    },
+    { /* 3. string is opened in the middle of file */
+        5 + 9 * 50, 3, "\"", 0, 0
+    },
+    { /* 4. comment is closed before its end */
+        1 + 9 * 50, 3, "*/", 0, 0
+    },
+    { /* 5. newlines are inserted into comment */
+        1 + 9 * 50, 6, "\n*/\n/*\n", 0, 0
+    },
+    { /* 6. line start context is moved to the middle of line */
+        3 + 9 * 50, 0, "", 0, 1
+    },
+    { /* 7. line start context is joined with the next line */
+        4 + 9 * 50, 0, "", 0, 1
+    },
+    { /* 8. lines are joined across comment */
+        1 + 9 * 50, 2, "", 14, 0
+    },
+    { /* 9. text is changed at the end of file */
+        9 * TEST_TEXT_REPEAT, 0, "/* \"\n#\n", 0, 0
+    },
+};
+/* *INDENT-ON* */
+
+/* @Test(dataSource = "test_edit_ds") */
+/* *INDENT-OFF* */
+START_PARAMETRIZED_TEST (test_edit, test_edit_ds)
+/* *INDENT-ON* */
+{
+    /* given: lines are drawn up to the cursor */
+    move_to (data->line, data->column);
+    draw_lines (edit->buffer.curs_line - 10, 11);
+
+    /* when */
+    insert_text (data->inserted);
+    delete_text (data->deleted);
+    backspace_text (data->backspaced);
+
+    /* lexing continues after the changed line */
+    draw_lines (edit->buffer.curs_line + 1, 10);
+    draw_screen ();
+
+    /* then: drawn colors are checked */
+    draw_all_lines ();
+}
+/* *INDENT-OFF* */
+END_PARAMETRIZED_TEST
+/* *INDENT-ON* */
+
+/* --------------------------------------------------------------------------------------------- */
+
+/* @Test */
+/* *INDENT-OFF* */
+START_TEST (test_states_reused)
+/* *INDENT-ON* */
+{
+    /* given */
+    move_to (4 + 9 * 20, 2);
+    draw_screen ();
+
+    /* when: keyword is changed, but states of following lines are not */
+    insert_text ("x");
+    mctest_assert_int_eq (edit->syntax_valid, 4 + 9 * 20);
+    draw_screen ();
+
+    /* then: following lines aren't lexed again */
+    mctest_assert_int_eq (edit->syntax_valid, edit->buffer.lines + 1);
+    mctest_assert_true (edit->last_get_rule < edit->buffer.size / 2);
+    draw_all_lines ();
+}
+/* *INDENT-OFF* */
+END_TEST
+/* *INDENT-ON* */
+
+/* --------------------------------------------------------------------------------------------- */
+
+/* @Test */
+/* *INDENT-OFF* */
+START_TEST (test_random_edits)
+/* *INDENT-ON* */
+{
+    static const char chars[] = "\n\n/*\" #ax{}";
+    int i;
+
+    for (i = 0; i < 300; i++)
+    {
+        /* given */
+        off_t offset;
+
+        offset = g_random_int_range (0, edit->buffer.size + 1);
+        edit_buffer_set_cursor (&edit->buffer, offset);
+        edit->buffer.curs_line = edit_buffer_count_lines (&edit->buffer, 0, offset);
+
+        /* when */
+        switch (g_random_int_range (0, 3))
+        {
+        case 0:
+            {
+                char text[2];
+
+                text[0] = chars[g_random_int_range (0, sizeof (chars) - 1)];
+                text[1] = '\0';
+                insert_text (text);
+            }
+            break;
+        case 1:
+            delete_text (MIN (edit->buffer.curs2, g_random_int_range (1, 4)));
+            break;
+        default:
+            backspace_text (MIN (edit->buffer.curs1, g_random_int_range (1, 4)));
+            break;
+        }
+
+        /* then: drawn colors are checked */
+        if (g_random_boolean ())
+            draw_screen ();
+        if (i % 10 == 0)
+            draw_all_lines ();
+    }
+
+    draw_all_lines ();
+}
+/* *INDENT-OFF* */
+END_TEST
+/* *INDENT-ON* */
+
+/* --------------------------------------------------------------------------------------------- */
+
+int
+main (void)
+{
+    int number_failed;
+
+    Suite *s = suite_create (TEST_SUITE_NAME);
+    TCase *tc_core = tcase_create ("Core");
+    SRunner *sr;
+
+    tcase_add_checked_fixture (tc_core, setup, teardown);
+
+    /* Add new tests here: *************** */
+    mctest_add_parameterized_test (tc_core, test_edit, test_edit_ds);
+    tcase_add_test (tc_core, test_states_reused);
+    tcase_add_test (tc_core, test_random_edits);
+    /* *********************************** */
+
+    suite_add_tcase (s, tc_core);
+    sr = srunner_create (s);
+    srunner_set_log (sr, "syntax__edit_syntax_changed.log");
+    srunner_run_all (sr, CK_ENV);
+    number_failed = srunner_ntests_failed (sr);
+    srunner_free (sr);
+    return (number_failed == 0) ? EXIT_SUCCESS : EXIT_FAILURE;
+}
+
+/* --------------------------------------------------------------------------------------------- */
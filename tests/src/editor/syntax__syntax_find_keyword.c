@@ -0,0 +1,425 @@
+/*
+   src/editor - tests for syntax_find_keyword() function
+
+   Copyright (C) 2017
+   Free Software Foundation, Inc.
+
+   This file is part of the Midnight Commander.
+
+   The Midnight Commander is free software: you can redistribute it
+   and/or modify it under the terms of the GNU General Public License as
+   published by the Free Software Foundation, either version 3 of the License,
+   or (at your option) any later version.
+
+   The Midnight Commander is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#define TEST_SUITE_NAME "/src/editor"
+
+#include "tests/mctest.h"
+
+#include <string.h>
+#include <unistd.h>
+
+#include "src/editor/syntax.c"
+
+/* size of chunk of edit buffer, EDIT_BUF_SIZE in editbuffer.c */
+#define TEST_CHUNK_SIZE 65536
+
+static WEdit *edit;
+
+/* --------------------------------------------------------------------------------------------- */
+
+/* read rules without colors: tty isn't initialized */
+static void
+load_syntax (const char *rules)
+{
+    char *syntax, *path;
+    int fd;
+
+    syntax = g_strconcat ("file .\\* Test\n", rules, (char *) NULL);
+
+    fd = g_file_open_tmp ("syntax-XXXXXX", &path, NULL);
+    mctest_assert_int_ne (fd, -1);
+    mctest_assert_int_eq (write (fd, syntax, strlen (syntax)), strlen (syntax));
+    close (fd);
+
+    mctest_assert_int_eq (edit_read_syntax_file (edit, NULL, path, NULL, "", "Test"), 0);
+    mctest_assert_not_null (edit->rules);
+
+    unlink (path);
+    g_free (path);
+    g_free (syntax);
+}
+
+/* --------------------------------------------------------------------------------------------- */
+
+/* first keyword matched by comparing of all keywords in order, like before keywords were compiled */
+static int
+find_keyword_slowly (const context_rule_t * r, off_t i, off_t * end)
+{
+    guint k;
+
+    for (k = 1; k < r->keyword->len; k++)
+    {
+        const syntax_keyword_t *kw;
+        off_t e;
+
+        kw = SYNTAX_KEYWORD (g_ptr_array_index (r->keyword, k));
+        e = compare_word_to_right (edit, i, kw->keyword, kw->whole_word_chars_left,
+                                   kw->whole_word_chars_right, kw->line_start);
+        if (e > 0)
+        {
+            *end = e;
+            return (int) k;
+        }
+    }
+
+    return 0;
+}
+
+/* --------------------------------------------------------------------------------------------- */
+
+/* @Before */
+static void
+setup (void)
+{
+    edit = g_new0 (WEdit, 1);
+    edit_buffer_init (&edit->buffer, 0);
+}
+
+/* --------------------------------------------------------------------------------------------- */
+
+/* @After */
+static void
+teardown (void)
+{
+    /* edit_free_syntax_rules() frees tty colors, which aren't initialized */
+    if (edit->defines != NULL)
+        destroy_defines (&edit->defines);
+    if (edit->rules != NULL)
+    {
+        g_ptr_array_foreach (edit->rules, (GFunc) context_rule_free, NULL);
+        g_ptr_array_free (edit->rules, TRUE);
+    }
+    g_free (edit->syntax_type);
+    edit_buffer_clean (&edit->buffer);
+    g_free (edit);
+}
+
+/* --------------------------------------------------------------------------------------------- */
+
+/* @DataSource("test_find_keyword_ds") */
+/* *INDENT-OFF* */
+static const struct test_find_keyword_ds
+{
+    const char *rules;
+    const char *text;
+    size_t size;
+    off_t padding;              /* spaces inserted before and after text */
+    off_t cursor;
+    off_t offset;
+    int expected_keyword;
+    off_t expected_end;
+} test_find_keyword_ds[] =
+{
+    { /* 0. keywords with shared prefix: the first matched one wins */
+        "context default\n"
+        "    keyword foreach\n"
+        "    keyword for\n"
+        "    keyword fo\n",
+        "format", 6, 0, 0, 0,
+        2, 3
+    },
+    { /* 1. */
+        "context default\n"
+        "    keyword foreach\n"
+        "    keyword for\n"
+        "    keyword fo\n",
+        "foreach", 7, 0, 0, 0,
+        1, 7
+    },
+    { /* 2. shorter keyword is before longer one */
+        "context default\n"
+        "    keyword fo\n"
+        "    keyword for\n",
+        "for", 3, 0, 0, 0,
+        1, 2
+    },
+    { /* 3. no keyword matches */
+        "context default\n"
+        "    keyword foreach\n"
+        "    keyword for\n",
+        "fox", 3, 0, 0, 0,
+        0, 0
+    },
+    { /* 4. keyword started with wildcard is before literal one */
+        "context default\n"
+        "    keyword \\{0123456789\\}px\n"
+        "    keyword 5\n",
+        "5px", 3, 0, 0, 0,
+        1, 3
+    },
+    { /* 5. */
+        "context default\n"
+        "    keyword \\{0123456789\\}px\n"
+        "    keyword 5\n",
+        "5em", 3, 0, 0, 0,
+        2, 1
+    },
+    { /* 6. keyword started with wildcard is after literal one */
+        "context default\n"
+        "    keyword 5\n"
+        "    keyword \\{0123456789\\}px\n",
+        "5px", 3, 0, 0, 0,
+        1, 1
+    },
+    { /* 7. literal prefix is followed by wildcard */
+        "context default\n"
+        "    keyword #*\\n\n",
+        "#if x\ny", 7, 0, 0, 0,
+        1, 6
+    },
+    { /* 8. whole word */
+        "context default\n"
+        "    keyword whole int\n",
+        "int x", 5, 0, 0, 0,
+        1, 3
+    },
+    { /* 9. */
+        "context default\n"
+        "    keyword whole int\n",
+        "intx", 4, 0, 0, 0,
+        0, 0
+    },
+    { /* 10. */
+        "context default\n"
+        "    keyword whole int\n",
+        "xint", 4, 0, 0, 1,
+        0, 0
+    },
+    { /* 11. end of text isn't a part of word */
+        "context default\n"
+        "    keyword whole int\n",
+        "int", 3, 0, 0, 0,
+        1, 3
+    },
+    { /* 12. NUL byte is treated as a part of word on the right */
+        "context default\n"
+        "    keyword whole int\n",
+        "int\0", 4, 0, 0, 0,
+        0, 0
+    },
+    { /* 13. ... and on the left */
+        "context default\n"
+        "    keyword whole int\n",
+        "\0int", 4, 0, 0, 1,
+        0, 0
+    },
+    { /* 14. */
+        "context default\n"
+        "    keyword wholeleft pre\n",
+        "prefix", 6, 0, 0, 0,
+        1, 3
+    },
+    { /* 15. */
+        "context default\n"
+        "    keyword wholeleft pre\n",
+        "xpre", 4, 0, 0, 1,
+        0, 0
+    },
+    { /* 16. */
+        "context default\n"
+        "    keyword wholeright fix\n",
+        "xfix", 4, 0, 0, 1,
+        1, 4
+    },
+    { /* 17. */
+        "context default\n"
+        "    keyword wholeright fix\n",
+        "fixx", 4, 0, 0, 0,
+        0, 0
+    },
+    { /* 18. whole word with own set of word characters */
+        "wholechars abc\n"
+        "context default\n"
+        "    keyword whole b\n",
+        "xbx", 3, 0, 0, 1,
+        1, 2
+    },
+    { /* 19. */
+        "wholechars abc\n"
+        "context default\n"
+        "    keyword whole b\n",
+        "abc", 3, 0, 0, 1,
+        0, 0
+    },
+    { /* 20. case insensitive context */
+        "caseinsensitive\n"
+        "context default\n"
+        "    keyword whole Select\n",
+        "SeLeCT x", 8, 0, 0, 0,
+        1, 6
+    },
+    { /* 21. */
+        "caseinsensitive\n"
+        "context default\n"
+        "    keyword whole Select\n",
+        "SELECTED", 8, 0, 0, 0,
+        0, 0
+    },
+    { /* 22. case sensitive context */
+        "context default\n"
+        "    keyword whole Select\n",
+        "select", 6, 0, 0, 0,
+        0, 0
+    },
+    { /* 23. keyword is split by cursor */
+        "context default\n"
+        "    keyword foreach\n"
+        "    keyword for\n",
+        "foreach", 7, 0, 4, 0,
+        1, 7
+    },
+    { /* 24. keyword is split by chunks of buffer before cursor */
+        "context default\n"
+        "    keyword foreach\n"
+        "    keyword for\n",
+        "foreach", 7, TEST_CHUNK_SIZE - 3, 7, 0,
+        1, 7
+    },
+    { /* 25. keyword is split by chunks of buffer after cursor */
+        "context default\n"
+        "    keyword foreach\n"
+        "    keyword for\n",
+        "foreach", 7, TEST_CHUNK_SIZE - 3, -TEST_CHUNK_SIZE + 3, 0,
+        1, 7
+    },
+};
+/* *INDENT-ON* */
+
+/* @Test(dataSource = "test_find_keyword_ds") */
+/* *INDENT-OFF* */
+START_PARAMETRIZED_TEST (test_find_keyword, test_find_keyword_ds)
+/* *INDENT-ON* */
+{
+    /* given */
+    const context_rule_t *r;
+    off_t i, end = 0, slow_end = 0;
+    int keyword, slow_keyword;
+    size_t j;
+
+    load_syntax (data->rules);
+    r = CONTEXT_RULE (g_ptr_array_index (edit->rules, 0));
+
+    for (i = 0; i < data->padding; i++)
+        edit_buffer_insert (&edit->buffer, ' ');
+    for (j = 0; j < data->size; j++)
+        edit_buffer_insert (&edit->buffer, data->text[j]);
+    for (i = 0; i < data->padding; i++)
+        edit_buffer_insert (&edit->buffer, ' ');
+    edit_buffer_set_cursor (&edit->buffer, data->padding + data->cursor);
+
+    i = data->padding + data->offset;
+
+    /* when */
+    keyword = syntax_find_keyword (edit, r, i,
+                                   xx_tolower (edit, edit_buffer_get_byte (&edit->buffer, i)),
+                                   &end);
+
+    /* then */
+    mctest_assert_int_eq (keyword, data->expected_keyword);
+    if (keyword != 0)
+        mctest_assert_int_eq (end, data->padding + data->expected_end);
+
+    /* result is the same as one of comparing of all keywords */
+    slow_keyword = find_keyword_slowly (r, i, &slow_end);
+    mctest_assert_int_eq (slow_keyword, keyword);
+    mctest_assert_int_eq (slow_end, end);
+}
+/* *INDENT-OFF* */
+END_PARAMETRIZED_TEST
+/* *INDENT-ON* */
+
+/* --------------------------------------------------------------------------------------------- */
+
+/* @Test */
+/* *INDENT-OFF* */
+START_TEST (test_compile_keywords)
+/* *INDENT-ON* */
+{
+    /* given */
+    const context_rule_t *r;
+    const syntax_trie_node_t *trie;
+    const syntax_keyword_t *k;
+    int node;
+
+    /* when */
+    load_syntax ("context default\n"
+                 "    keyword foreach\n"
+                 "    keyword *x\n"
+                 "    keyword for\n"
+                 "    keyword fo\\[abc\\]\n"
+                 "    keyword for\n");
+
+    /* then: keywords with the same literal prefix are listed in order */
+    r = CONTEXT_RULE (g_ptr_array_index (edit->rules, 0));
+    trie = (const syntax_trie_node_t *) r->keyword_trie->data;
+
+    node = syntax_trie_next (r, 0, 'f');
+    mctest_assert_int_ne (node, 0);
+    mctest_assert_int_eq (trie[node].keyword, 0);
+    node = syntax_trie_next (r, node, 'o');
+    mctest_assert_int_ne (node, 0);
+    mctest_assert_int_eq (trie[node].keyword, 4);
+    node = syntax_trie_next (r, node, 'r');
+    mctest_assert_int_ne (node, 0);
+    mctest_assert_int_eq (trie[node].keyword, 3);
+    k = SYNTAX_KEYWORD (g_ptr_array_index (r->keyword, 3));
+    mctest_assert_int_eq (k->literal, 3);
+    mctest_assert_int_eq (k->next, 5);
+    mctest_assert_int_eq (SYNTAX_KEYWORD (g_ptr_array_index (r->keyword, 5))->next, 0);
+    mctest_assert_int_eq (syntax_trie_next (r, node, 'x'), 0);
+
+    /* keyword started with wildcard is in the root */
+    mctest_assert_int_eq (trie[0].keyword, 2);
+    mctest_assert_int_eq (SYNTAX_KEYWORD (g_ptr_array_index (r->keyword, 2))->literal, 0);
+}
+/* *INDENT-OFF* */
+END_TEST
+/* *INDENT-ON* */
+
+/* --------------------------------------------------------------------------------------------- */
+
+int
+main (void)
+{
+    int number_failed;
+
+    Suite *s = suite_create (TEST_SUITE_NAME);
+    TCase *tc_core = tcase_create ("Core");
+    SRunner *sr;
+
+    tcase_add_checked_fixture (tc_core, setup, teardown);
+
+    /* Add new tests here: *************** */
+    mctest_add_parameterized_test (tc_core, test_find_keyword, test_find_keyword_ds);
+    tcase_add_test (tc_core, test_compile_keywords);
+    /* *********************************** */
+
+    suite_add_tcase (s, tc_core);
+    sr = srunner_create (s);
+    srunner_set_log (sr, "syntax__syntax_find_keyword.log");
+    srunner_run_all (sr, CK_ENV);
+    number_failed = srunner_ntests_failed (sr);
+    srunner_free (sr);
+    return (number_failed == 0) ? EXIT_SUCCESS : EXIT_FAILURE;
+}
+
+/* --------------------------------------------------------------------------------------------- */
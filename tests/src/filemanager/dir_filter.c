@@ -0,0 +1,192 @@
+/*
+   src/filemanager - tests for filter of directory listing
+
+   Copyright (C) 2017
+   Free Software Foundation, Inc.
+
+   This file is part of the Midnight Commander.
+
+   The Midnight Commander is free software: you can redistribute it
+   and/or modify it under the terms of the GNU General Public License as
+   published by the Free Software Foundation, either version 3 of the License,
+   or (at your option) any later version.
+
+   The Midnight Commander is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#define TEST_SUITE_NAME "/src/filemanager"
+
+#include "tests/mctest.h"
+
+#include "lib/strutil.h"
+
+#include "src/filemanager/dir.c"
+
+/* --------------------------------------------------------------------------------------------- */
+
+/* @Before */
+static void
+setup (void)
+{
+    str_init_strings (NULL);
+}
+
+/* --------------------------------------------------------------------------------------------- */
+
+/* @After */
+static void
+teardown (void)
+{
+    str_uninit_strings ();
+}
+
+/* --------------------------------------------------------------------------------------------- */
+
+/* filter compiled without "*suffix" shortcut, as other patterns are */
+static dir_filter_t *
+glob_filter_new (const char *pattern)
+{
+    dir_filter_t *fltr;
+
+    fltr = g_new0 (dir_filter_t, 1);
+    fltr->search = mc_search_new (pattern, NULL);
+    fltr->search->search_type = MC_SEARCH_T_GLOB;
+    fltr->search->is_case_sensitive = TRUE;
+    fltr->search->is_entire_line = TRUE;
+
+    return fltr;
+}
+
+/* --------------------------------------------------------------------------------------------- */
+
+/* @DataSource("test_dir_filter_match_ds") */
+/* *INDENT-OFF* */
+static const struct test_dir_filter_match_ds
+{
+    const char *pattern;
+    const char *name;
+    gboolean is_suffix;
+    gboolean expected;
+} test_dir_filter_match_ds[] =
+{
+    { /* 0. suffix match */
+        "*.c", "foo.c", TRUE, TRUE
+    },
+    { /* 1. suffix is the whole name */
+        "*.c", ".c", TRUE, TRUE
+    },
+    { /* 2. near miss: suffix is followed by more chars */
+        "*.c", "foo.cc", TRUE, FALSE
+    },
+    { /* 3. near miss: name is shorter than suffix */
+        "*.c", "c", TRUE, FALSE
+    },
+    { /* 4. near miss: suffix is in the middle */
+        "*.c", "foo.c.orig", TRUE, FALSE
+    },
+    { /* 5. */
+        "*.tar.gz", "foo.tar.gz", TRUE, TRUE
+    },
+    { /* 6. near miss: one char differs */
+        "*.tar.gz", "foo.tar.gx", TRUE, FALSE
+    },
+    { /* 7. dot is not a wildcard */
+        "*-1.2", "foo-1x2", TRUE, FALSE
+    },
+    { /* 8. empty suffix matches any name */
+        "*", "foo", TRUE, TRUE
+    },
+    { /* 9. empty suffix matches hidden files too */
+        "*", ".foo", TRUE, TRUE
+    },
+    { /* 10. case of letters matters */
+        "*.C", "foo.c", TRUE, FALSE
+    },
+    { /* 11. */
+        "*.c", "FOO.C", TRUE, FALSE
+    },
+    { /* 12. */
+        "*.C", "FOO.C", TRUE, TRUE
+    },
+    { /* 13. non-ASCII suffix */
+        "*.тест", "файл.тест", TRUE, TRUE
+    },
+    { /* 14. */
+        "*.тест", "файл.Тест", TRUE, FALSE
+    },
+    { /* 15. wildcards in suffix: glob is used */
+        "*.?", "foo.c", FALSE, TRUE
+    },
+    { /* 16. */
+        "*.[ch]", "foo.h", FALSE, TRUE
+    },
+    { /* 17. */
+        "*.c*", "foo.cc", FALSE, TRUE
+    },
+    { /* 18. pattern doesn't start with asterisk: glob is used */
+        "foo.*", "foo.c", FALSE, TRUE
+    },
+};
+/* *INDENT-ON* */
+
+/* @Test(dataSource = "test_dir_filter_match_ds") */
+/* *INDENT-OFF* */
+START_PARAMETRIZED_TEST (test_dir_filter_match, test_dir_filter_match_ds)
+/* *INDENT-ON* */
+{
+    /* given */
+    dir_filter_t *fltr, *glob;
+    gboolean actual, expected_by_glob;
+
+    fltr = dir_filter_new (data->pattern);
+    glob = glob_filter_new (data->pattern);
+
+    /* when */
+    actual = dir_filter_match (fltr, data->name);
+    expected_by_glob = dir_filter_match (glob, data->name);
+
+    /* then */
+    mctest_assert_int_eq (fltr->suffix != NULL, data->is_suffix);
+    mctest_assert_int_eq (actual, data->expected);
+    mctest_assert_int_eq (actual, expected_by_glob);
+
+    dir_filter_free (glob);
+    dir_filter_free (fltr);
+}
+/* *INDENT-OFF* */
+END_PARAMETRIZED_TEST
+/* *INDENT-ON* */
+
+/* --------------------------------------------------------------------------------------------- */
+
+int
+main (void)
+{
+    int number_failed;
+
+    Suite *s = suite_create (TEST_SUITE_NAME);
+    TCase *tc_core = tcase_create ("Core");
+    SRunner *sr;
+
+    tcase_add_checked_fixture (tc_core, setup, teardown);
+
+    /* Add new tests here: *************** */
+    mctest_add_parameterized_test (tc_core, test_dir_filter_match, test_dir_filter_match_ds);
+    /* *********************************** */
+
+    suite_add_tcase (s, tc_core);
+    sr = srunner_create (s);
+    srunner_set_log (sr, "dir_filter.log");
+    srunner_run_all (sr, CK_ENV);
+    number_failed = srunner_ntests_failed (sr);
+    srunner_free (sr);
+    return (number_failed == 0) ? EXIT_SUCCESS : EXIT_FAILURE;
+}
+
+/* --------------------------------------------------------------------------------------------- */
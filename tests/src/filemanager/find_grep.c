@@ -0,0 +1,395 @@
+/*
+   src/filemanager - tests for content search of Find File
+
+   Copyright (C) 2017
+   Free Software Foundation, Inc.
+
+   This file is part of the Midnight Commander.
+
+   The Midnight Commander is free software: you can redistribute it
+   and/or modify it under the terms of the GNU General Public License as
+   published by the Free Software Foundation, either version 3 of the License,
+   or (at your option) any later version.
+
+   The Midnight Commander is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#define TEST_SUITE_NAME "/src/filemanager"
+
+#include "tests/mctest.h"
+
+#include <string.h>
+#include <unistd.h>
+
+#include "lib/strutil.h"
+
+#include "src/filemanager/findgrep.h"
+
+/* content read by read_chunk() */
+static const char *read_data;
+static size_t read_size;
+static size_t read_pos;
+
+/* --------------------------------------------------------------------------------------------- */
+
+/* @Mock */
+static ssize_t
+read_chunk (int fd, void *buf, size_t count)
+{
+    (void) fd;
+
+    /* small chunks: lines cross the boundaries of input buffer */
+    count = MIN (count, MIN (3, read_size - read_pos));
+    memcpy (buf, read_data + read_pos, count);
+    read_pos += count;
+
+    return (ssize_t) count;
+}
+
+/* --------------------------------------------------------------------------------------------- */
+
+static mc_search_t *
+search_new (const char *pattern, mc_search_type_t search_type)
+{
+    mc_search_t *search;
+
+    search = mc_search_new (pattern, NULL);
+    search->search_type = search_type;
+    search->is_case_sensitive = TRUE;
+
+    return search;
+}
+
+/* --------------------------------------------------------------------------------------------- */
+
+static mc_search_t *
+search_needle_new (void)
+{
+    return search_new ("needle", MC_SEARCH_T_NORMAL);
+}
+
+/* --------------------------------------------------------------------------------------------- */
+
+/* @Before */
+static void
+setup (void)
+{
+    str_init_strings (NULL);
+}
+
+/* --------------------------------------------------------------------------------------------- */
+
+/* @After */
+static void
+teardown (void)
+{
+    str_uninit_strings ();
+}
+
+/* --------------------------------------------------------------------------------------------- */
+
+/* @DataSource("test_lines_ds") */
+/* *INDENT-OFF* */
+static const struct test_lines_ds
+{
+    const char *pattern;
+    mc_search_type_t search_type;
+    const char *content;
+    size_t size;
+    guint expected_count;
+    find_grep_match_t expected[3];
+} test_lines_ds[] =
+{
+    { /* 0. */
+        "ba", MC_SEARCH_T_NORMAL,
+        "foo\nbar baz\nqux\n", 16,
+        1, { { 2, 5, 7 } }
+    },
+    { /* 1. binary line gives one match */
+        "abc", MC_SEARCH_T_NORMAL,
+        "abc\0abc\nxabc\n", 13,
+        2, { { 1, 1, 4 }, { 2, 10, 13 } }
+    },
+    { /* 2. leading NULs and empty lines */
+        "^fo+$", MC_SEARCH_T_REGEX,
+        "\0\0foo\n\nfoo\nfoox", 15,
+        2, { { 1, 3, 6 }, { 3, 8, 11 } }
+    },
+    { /* 3. no newline at the end of file */
+        "o", MC_SEARCH_T_NORMAL,
+        "bar\nfoo", 7,
+        1, { { 2, 6, 7 } }
+    },
+    { /* 4. empty file */
+        "o", MC_SEARCH_T_NORMAL,
+        "", 0,
+        0, { { 0, 0, 0 } }
+    },
+    { /* 5. one match per line */
+        "a", MC_SEARCH_T_NORMAL,
+        "aaa\n\na\n", 7,
+        2, { { 1, 1, 2 }, { 3, 6, 7 } }
+    },
+};
+/* *INDENT-ON* */
+
+/* @Test(dataSource = "test_lines_ds") */
+/* *INDENT-OFF* */
+START_PARAMETRIZED_TEST (test_lines, test_lines_ds)
+/* *INDENT-ON* */
+{
+    /* given */
+    mc_search_t *search;
+    find_grep_lines_t lines;
+    find_grep_scan_t scan;
+    find_grep_match_t match;
+    char buffer[16];
+    GArray *read_matches, *scan_matches;
+    guint i;
+
+    search = search_new (data->pattern, data->search_type);
+    read_matches = g_array_new (FALSE, FALSE, sizeof (find_grep_match_t));
+    scan_matches = g_array_new (FALSE, FALSE, sizeof (find_grep_match_t));
+
+    read_data = data->content;
+    read_size = data->size;
+    read_pos = 0;
+
+    /* when */
+    find_grep_lines_init (&lines, -1, read_chunk, buffer, sizeof (buffer));
+    while (!lines.eof)
+        if (find_grep_lines_next (&lines, search, 1, &match))
+            g_array_append_val (read_matches, match);
+    find_grep_lines_deinit (&lines);
+
+    /* file mapped to memory */
+    find_grep_scan_init (&scan, data->content, data->size);
+    while (scan.pos < data->size)
+        if (find_grep_scan (&scan, search, scan.pos + 1, &match))
+            g_array_append_val (scan_matches, match);
+
+    /* then */
+    mctest_assert_int_eq (read_matches->len, data->expected_count);
+    mctest_assert_int_eq (scan_matches->len, data->expected_count);
+
+    for (i = 0; i < data->expected_count; i++)
+    {
+        const find_grep_match_t *r, *m;
+
+        r = &g_array_index (read_matches, find_grep_match_t, i);
+        m = &g_array_index (scan_matches, find_grep_match_t, i);
+
+        mctest_assert_int_eq (r->line, data->expected[i].line);
+        mctest_assert_int_eq (r->start, data->expected[i].start);
+        mctest_assert_int_eq (r->end, data->expected[i].end);
+
+        mctest_assert_int_eq (m->line, r->line);
+        mctest_assert_int_eq (m->start, r->start);
+        mctest_assert_int_eq (m->end, r->end);
+    }
+
+    g_array_free (read_matches, TRUE);
+    g_array_free (scan_matches, TRUE);
+    mc_search_free (search);
+}
+/* *INDENT-OFF* */
+END_PARAMETRIZED_TEST
+/* *INDENT-ON* */
+
+/* --------------------------------------------------------------------------------------------- */
+
+/* @Test */
+/* *INDENT-OFF* */
+START_TEST (test_threads_disabled)
+/* *INDENT-ON* */
+{
+    /* given, when, then */
+    mctest_assert_null (find_grep_new (0, FALSE, search_needle_new));
+    mctest_assert_null (find_grep_new (1, FALSE, search_needle_new));
+}
+/* *INDENT-OFF* */
+END_TEST
+/* *INDENT-ON* */
+
+/* --------------------------------------------------------------------------------------------- */
+
+/* @Test */
+/* *INDENT-OFF* */
+START_TEST (test_queue_order)
+/* *INDENT-ON* */
+{
+    /* given */
+    const int files_num = 16;
+    char *paths[16];
+    find_grep_t *g;
+    int i, popped = 0;
+
+    g = find_grep_new (4, FALSE, search_needle_new);
+#if GLIB_CHECK_VERSION (2, 32, 0)
+    mctest_assert_not_null (g);
+#endif
+    if (g == NULL)
+        return;
+
+    /* file i has i matches */
+    for (i = 0; i < files_num; i++)
+    {
+        GString *content;
+        int fd, j;
+
+        content = g_string_new ("");
+        for (j = 0; j < i; j++)
+            g_string_append (content, "hay needle\nhay\n");
+
+        fd = g_file_open_tmp ("find_grep-XXXXXX", &paths[i], NULL);
+        mctest_assert_int_ne (fd, -1);
+        mctest_assert_int_eq (write (fd, content->str, content->len), content->len);
+        close (fd);
+        g_string_free (content, TRUE);
+    }
+
+    /* when */
+    for (i = 0; i < files_num; i++)
+    {
+        char name[8];
+
+        g_snprintf (name, sizeof (name), "%d", i);
+        find_grep_push (g, find_grep_job_new ("/tmp", name, paths[i]));
+    }
+
+    /* then: jobs are returned in order of push */
+    while (find_grep_length (g) != 0)
+    {
+        find_grep_job_t *job;
+
+        job = find_grep_pop (g, TRUE);
+        if (job == NULL)
+            continue;
+
+        mctest_assert_int_eq (atoi (job->filename), popped);
+        mctest_assert_int_eq (job->matches->len, popped);
+        if (job->matches->len != 0)
+        {
+            const find_grep_match_t *m;
+
+            m = &g_array_index (job->matches, find_grep_match_t, job->matches->len - 1);
+            mctest_assert_int_eq (m->line, 2 * popped - 1);
+        }
+
+        find_grep_job_free (job);
+        popped++;
+    }
+
+    mctest_assert_int_eq (popped, files_num);
+
+    find_grep_free (g);
+    for (i = 0; i < files_num; i++)
+    {
+        unlink (paths[i]);
+        g_free (paths[i]);
+    }
+}
+/* *INDENT-OFF* */
+END_TEST
+/* *INDENT-ON* */
+
+/* --------------------------------------------------------------------------------------------- */
+
+/* @Test */
+/* *INDENT-OFF* */
+START_TEST (test_truncated_file)
+/* *INDENT-ON* */
+{
+    /* given */
+    const size_t size = 64 * 1024;
+    GString *content;
+    char *path, *data;
+    size_t mapped_size;
+    mc_search_t *search;
+    find_grep_scan_t scan;
+    find_grep_match_t match;
+    int fd, found = 0;
+
+    content = g_string_new ("needle\n");
+    while (content->len < size - 7)
+        g_string_append (content, "hay\n");
+    g_string_append (content, "needle\n");
+
+    fd = g_file_open_tmp ("find_grep-XXXXXX", &path, NULL);
+    mctest_assert_int_ne (fd, -1);
+    mctest_assert_int_eq (write (fd, content->str, content->len), content->len);
+
+    data = find_grep_map_file (fd, &mapped_size);
+    if (data == NULL)
+    {
+        /* files aren't mapped on this system */
+        close (fd);
+        unlink (path);
+        g_free (path);
+        g_string_free (content, TRUE);
+        return;
+    }
+    mctest_assert_int_eq (mapped_size, content->len);
+
+    search = search_needle_new ();
+    find_grep_scan_init (&scan, data, mapped_size);
+
+    /* when: file becomes shorter than it was when it was mapped */
+    mctest_assert_int_eq (ftruncate (fd, 100), 0);
+
+    while (scan.pos < mapped_size)
+        if (find_grep_scan (&scan, search, scan.pos + 1, &match))
+            found++;
+
+    /* then: data beyond the new end of file is not searched */
+    mctest_assert_int_eq (found, 1);
+    mctest_assert_int_eq (match.line, 1);
+    mctest_assert_int_eq (scan.pos, mapped_size);
+
+    mc_search_free (search);
+    find_grep_unmap_file (data, mapped_size);
+    close (fd);
+    unlink (path);
+    g_free (path);
+    g_string_free (content, TRUE);
+}
+/* *INDENT-OFF* */
+END_TEST
+/* *INDENT-ON* */
+
+/* --------------------------------------------------------------------------------------------- */
+
+int
+main (void)
+{
+    int number_failed;
+
+    Suite *s = suite_create (TEST_SUITE_NAME);
+    TCase *tc_core = tcase_create ("Core");
+    SRunner *sr;
+
+    tcase_add_checked_fixture (tc_core, setup, teardown);
+
+    /* Add new tests here: *************** */
+    mctest_add_parameterized_test (tc_core, test_lines, test_lines_ds);
+    tcase_add_test (tc_core, test_threads_disabled);
+    tcase_add_test (tc_core, test_queue_order);
+    tcase_add_test (tc_core, test_truncated_file);
+    /* *********************************** */
+
+    suite_add_tcase (s, tc_core);
+    sr = srunner_create (s);
+    srunner_set_log (sr, "find_grep.log");
+    srunner_run_all (sr, CK_ENV);
+    number_failed = srunner_ntests_failed (sr);
+    srunner_free (sr);
+    return (number_failed == 0) ? EXIT_SUCCESS : EXIT_FAILURE;
+}
+
+/* --------------------------------------------------------------------------------------------- */
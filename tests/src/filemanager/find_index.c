@@ -0,0 +1,470 @@
+/*
+   src/filemanager - tests for file name index of Find File
+
+   Copyright (C) 2017
+   Free Software Foundation, Inc.
+
+   This file is part of the Midnight Commander.
+
+   The Midnight Commander is free software: you can redistribute it
+   and/or modify it under the terms of the GNU General Public License as
+   published by the Free Software Foundation, either version 3 of the License,
+   or (at your option) any later version.
+
+   The Midnight Commander is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#define TEST_SUITE_NAME "/src/filemanager"
+
+#include "tests/mctest.h"
+
+#include <stdio.h>
+#include <unistd.h>
+
+#include "lib/strutil.h"
+
+/* small index to test eviction */
+#define FIND_INDEX_MAX_SIZE 1024
+
+#include "src/filemanager/findindex.c"
+
+#define TEST_ROOT WORKDIR PATH_SEP_STR "find_index.tmp"
+
+/* --------------------------------------------------------------------------------------------- */
+
+static char *
+test_path (const char *name)
+{
+    return g_build_filename (TEST_ROOT, name, (char *) NULL);
+}
+
+/* --------------------------------------------------------------------------------------------- */
+
+static void
+test_mkdir (const char *name)
+{
+    char *path;
+
+    path = test_path (name);
+    mctest_assert_int_eq (g_mkdir_with_parents (path, 0700), 0);
+    g_free (path);
+}
+
+/* --------------------------------------------------------------------------------------------- */
+
+static void
+test_touch (const char *name)
+{
+    char *path;
+
+    path = test_path (name);
+    mctest_assert_true (g_file_set_contents (path, "", 0, NULL));
+    g_free (path);
+}
+
+/* --------------------------------------------------------------------------------------------- */
+
+static void
+test_remove (const char *name)
+{
+    char *path;
+
+    path = test_path (name);
+    mctest_assert_int_eq (remove (path), 0);
+    g_free (path);
+}
+
+/* --------------------------------------------------------------------------------------------- */
+
+static void
+remove_tree (const char *path)
+{
+    GDir *dir;
+
+    dir = g_dir_open (path, 0, NULL);
+    if (dir != NULL)
+    {
+        const char *name;
+
+        while ((name = g_dir_read_name (dir)) != NULL)
+        {
+            char *child;
+
+            child = g_build_filename (path, name, (char *) NULL);
+            remove_tree (child);
+            g_free (child);
+        }
+        g_dir_close (dir);
+    }
+
+    remove (path);
+}
+
+/* --------------------------------------------------------------------------------------------- */
+
+static const find_index_dir_t *
+get_dir (const char *name)
+{
+    const find_index_dir_t *dir;
+    char *path;
+
+    path = test_path (name);
+    dir = find_index_get_dir (path);
+    g_free (path);
+
+    return dir;
+}
+
+/* --------------------------------------------------------------------------------------------- */
+
+/* directory as it is in the index, without reading it */
+static const find_index_dir_t *
+lookup_dir (const char *name)
+{
+    const find_index_dir_t *dir;
+    char *path;
+
+    path = test_path (name);
+    dir = (const find_index_dir_t *) g_hash_table_lookup (dirs, path);
+    g_free (path);
+
+    return dir;
+}
+
+/* --------------------------------------------------------------------------------------------- */
+
+static gboolean
+dir_has_entry (const find_index_dir_t * dir, const char *name, gboolean is_dir)
+{
+    const char *n;
+    gboolean d;
+    size_t pos = 0;
+
+    while ((n = find_index_dir_next (dir, &pos, &d)) != NULL)
+        if (strcmp (n, name) == 0)
+            return d == is_dir;
+
+    return FALSE;
+}
+
+/* --------------------------------------------------------------------------------------------- */
+
+/* save the index, forget it and load it from the file again */
+static void
+reload_index (void)
+{
+    find_index_done ();
+    find_index_load ();
+}
+
+/* --------------------------------------------------------------------------------------------- */
+
+static off_t
+index_file_size (void)
+{
+    char *file_name;
+    struct stat st;
+
+    file_name = find_index_file_name ();
+    mctest_assert_int_eq (stat (file_name, &st), 0);
+    g_free (file_name);
+
+    return st.st_size;
+}
+
+/* --------------------------------------------------------------------------------------------- */
+
+/* @Before */
+static void
+setup (void)
+{
+    /* the index is saved in cache directory of profile */
+    remove_tree (TEST_ROOT);
+    g_setenv ("MC_PROFILE_ROOT", TEST_ROOT, TRUE);
+
+    str_init_strings (NULL);
+    mc_config_init_config_paths (NULL);
+
+    test_mkdir ("tree/sub");
+    test_touch ("tree/a");
+    test_touch ("tree/sub/b");
+}
+
+/* --------------------------------------------------------------------------------------------- */
+
+/* @After */
+static void
+teardown (void)
+{
+    find_index_done ();
+    mc_config_deinit_config_paths ();
+    str_uninit_strings ();
+
+    remove_tree (TEST_ROOT);
+}
+
+/* --------------------------------------------------------------------------------------------- */
+
+/* @Test */
+/* *INDENT-OFF* */
+START_TEST (test_round_trip)
+/* *INDENT-ON* */
+{
+    const find_index_dir_t *dir;
+
+    /* given */
+    mctest_assert_not_null (get_dir ("tree"));
+    mctest_assert_not_null (get_dir ("tree/sub"));
+
+    /* when */
+    reload_index ();
+
+    /* then */
+    mctest_assert_int_eq (g_hash_table_size (dirs), 2);
+    mctest_assert_true (index_known);
+
+    dir = lookup_dir ("tree");
+    mctest_assert_not_null (dir);
+    mctest_assert_true (dir_has_entry (dir, "a", FALSE));
+    mctest_assert_true (dir_has_entry (dir, "sub", TRUE));
+
+    dir = lookup_dir ("tree/sub");
+    mctest_assert_not_null (dir);
+    mctest_assert_true (dir_has_entry (dir, "b", FALSE));
+}
+/* *INDENT-OFF* */
+END_TEST
+/* *INDENT-ON* */
+
+/* --------------------------------------------------------------------------------------------- */
+
+/* @Test */
+/* *INDENT-OFF* */
+START_TEST (test_changed_dir_appended)
+/* *INDENT-ON* */
+{
+    const find_index_dir_t *dir;
+    off_t len;
+
+    /* given */
+    get_dir ("tree");
+    get_dir ("tree/sub");
+    find_index_save ();
+    len = index_file_size ();
+
+    /* when */
+    test_touch ("tree/sub/c");
+    dir = get_dir ("tree/sub");
+    mctest_assert_true (dir_has_entry (dir, "c", FALSE));
+    find_index_save ();
+
+    /* then: only record of changed directory is written */
+    mctest_assert_int_eq (index_file_size (), len + find_index_record_size (dir));
+
+    reload_index ();
+    mctest_assert_int_eq (g_hash_table_size (dirs), 2);
+    dir = lookup_dir ("tree/sub");
+    mctest_assert_true (dir_has_entry (dir, "b", FALSE));
+    mctest_assert_true (dir_has_entry (dir, "c", FALSE));
+}
+/* *INDENT-OFF* */
+END_TEST
+/* *INDENT-ON* */
+
+/* --------------------------------------------------------------------------------------------- */
+
+/* @Test */
+/* *INDENT-OFF* */
+START_TEST (test_removed_dir)
+/* *INDENT-ON* */
+{
+    const find_index_dir_t *dir;
+
+    /* given */
+    get_dir ("tree");
+    get_dir ("tree/sub");
+    find_index_save ();
+
+    /* when */
+    test_remove ("tree/sub/b");
+    test_remove ("tree/sub");
+    dir = get_dir ("tree");
+
+    /* then */
+    mctest_assert_not_null (dir);
+    mctest_assert_false (dir_has_entry (dir, "sub", TRUE));
+    mctest_assert_null (lookup_dir ("tree/sub"));
+    mctest_assert_null (get_dir ("tree/sub"));
+
+    reload_index ();
+    mctest_assert_int_eq (g_hash_table_size (dirs), 1);
+    mctest_assert_null (lookup_dir ("tree/sub"));
+    mctest_assert_false (dir_has_entry (lookup_dir ("tree"), "sub", TRUE));
+}
+/* *INDENT-OFF* */
+END_TEST
+/* *INDENT-ON* */
+
+/* --------------------------------------------------------------------------------------------- */
+
+/* @Test */
+/* *INDENT-OFF* */
+START_TEST (test_compaction)
+/* *INDENT-ON* */
+{
+    const find_index_dir_t *dir;
+    int i;
+
+    /* given */
+    get_dir ("tree");
+    get_dir ("tree/sub");
+    find_index_save ();
+
+    /* when: one directory is changed many times */
+    for (i = 0; i < 10; i++)
+    {
+        char name[16];
+
+        g_snprintf (name, sizeof (name), "tree/sub/f%d", i);
+        test_touch (name);
+        get_dir ("tree/sub");
+        find_index_save ();
+
+        /* then: outdated records don't take more than half of the file */
+        mctest_assert_int_eq (index_file_size (), index_len);
+        mctest_assert_true ((gsize) index_len
+                            <= 2 * (sizeof (find_index_header_t) + find_index_evict ()));
+    }
+
+    reload_index ();
+    mctest_assert_int_eq (g_hash_table_size (dirs), 2);
+    dir = lookup_dir ("tree/sub");
+    mctest_assert_true (dir_has_entry (dir, "f0", FALSE));
+    mctest_assert_true (dir_has_entry (dir, "f9", FALSE));
+}
+/* *INDENT-OFF* */
+END_TEST
+/* *INDENT-ON* */
+
+/* --------------------------------------------------------------------------------------------- */
+
+/* @Test */
+/* *INDENT-OFF* */
+START_TEST (test_damaged_file)
+/* *INDENT-ON* */
+{
+    char *file_name;
+    FILE *f;
+
+    /* given */
+    get_dir ("tree");
+    get_dir ("tree/sub");
+    find_index_done ();
+
+    /* when: the last record is written partially */
+    file_name = find_index_file_name ();
+    f = fopen (file_name, "a");
+    mctest_assert_not_null (f);
+    fputs ("garbage", f);
+    fclose (f);
+    g_free (file_name);
+
+    find_index_load ();
+
+    /* then: records before damaged one are kept and file is written again */
+    mctest_assert_int_eq (g_hash_table_size (dirs), 2);
+    mctest_assert_false (index_known);
+
+    reload_index ();
+    mctest_assert_int_eq (g_hash_table_size (dirs), 2);
+    mctest_assert_true (index_known);
+}
+/* *INDENT-OFF* */
+END_TEST
+/* *INDENT-ON* */
+
+/* --------------------------------------------------------------------------------------------- */
+
+/* @Test */
+/* *INDENT-OFF* */
+START_TEST (test_eviction)
+/* *INDENT-ON* */
+{
+    const int dirs_num = 20;
+    guint count;
+    int i;
+
+    /* given */
+    for (i = 0; i < dirs_num; i++)
+    {
+        char name[32];
+
+        g_snprintf (name, sizeof (name), "tree/d%02d/file", i);
+        test_mkdir (name);
+    }
+
+    /* when */
+    for (i = 0; i < dirs_num; i++)
+    {
+        char name[32];
+
+        g_snprintf (name, sizeof (name), "tree/d%02d", i);
+        mctest_assert_not_null (get_dir (name));
+    }
+    find_index_save ();
+
+    /* then: least recently used directories are dropped */
+    mctest_assert_true (find_index_evict () <= FIND_INDEX_MAX_SIZE);
+    mctest_assert_null (lookup_dir ("tree/d00"));
+    mctest_assert_not_null (lookup_dir ("tree/d19"));
+
+    count = g_hash_table_size (dirs);
+    mctest_assert_true (count < (guint) dirs_num);
+
+    reload_index ();
+    mctest_assert_int_eq (g_hash_table_size (dirs), count);
+    mctest_assert_null (lookup_dir ("tree/d00"));
+    mctest_assert_not_null (lookup_dir ("tree/d19"));
+}
+/* *INDENT-OFF* */
+END_TEST
+/* *INDENT-ON* */
+
+/* --------------------------------------------------------------------------------------------- */
+
+int
+main (void)
+{
+    int number_failed;
+
+    Suite *s = suite_create (TEST_SUITE_NAME);
+    TCase *tc_core = tcase_create ("Core");
+    SRunner *sr;
+
+    tcase_add_checked_fixture (tc_core, setup, teardown);
+
+    /* Add new tests here: *************** */
+    tcase_add_test (tc_core, test_round_trip);
+    tcase_add_test (tc_core, test_changed_dir_appended);
+    tcase_add_test (tc_core, test_removed_dir);
+    tcase_add_test (tc_core, test_compaction);
+    tcase_add_test (tc_core, test_damaged_file);
+    tcase_add_test (tc_core, test_eviction);
+    /* *********************************** */
+
+    suite_add_tcase (s, tc_core);
+    sr = srunner_create (s);
+    srunner_set_log (sr, "find_index.log");
+    srunner_run_all (sr, CK_ENV);
+    number_failed = srunner_ntests_failed (sr);
+    srunner_free (sr);
+    return (number_failed == 0) ? EXIT_SUCCESS : EXIT_FAILURE;
+}
+
+/* --------------------------------------------------------------------------------------------- */